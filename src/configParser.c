@@ -23,6 +23,8 @@
 #include "configParser.h"
 #include <strings.h>
 #include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
 
 static bool isWhitespace(char const data) {
   return data == ' '
@@ -165,3 +167,33 @@ bool parseBool(char const * const data) {
     return false;
   }
 }
+
+bool parseSize(char const * const data, unsigned long long * const size) {
+  char *end;
+  unsigned long long value;
+  unsigned int shift = 0;
+
+  if(NULL == data || !isdigit((unsigned char)data[0])) {
+    return false;
+  }
+  errno = 0;
+  value = strtoull(data, &end, 10);
+  if(ERANGE == errno) {
+    return false;
+  }
+  if('k' == *end || 'K' == *end) {
+    shift = 10;
+    ++end;
+  } else if('m' == *end || 'M' == *end) {
+    shift = 20;
+    ++end;
+  } else if('g' == *end || 'G' == *end) {
+    shift = 30;
+    ++end;
+  }
+  if('\0' != *end || value > (~0ULL >> shift)) {
+    return false;
+  }
+  *size = value << shift;
+  return true;
+}
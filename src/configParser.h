@@ -81,3 +81,14 @@ char * trimWhitespace(char const * const data);
  * @param data the string to compare, must be null terminated
  */
 bool parseBool(char const * const data);
+
+/**
+ * Parse data as a size in bytes. A k, m or g suffix (any case)
+ * multiplies by 1024, 1048576 or 1073741824.
+ *
+ * @param data the string to parse, must be null terminated
+ * @param size output parameter, only set on success
+ * @return false if data is not a number with an optional suffix or
+ * does not fit
+ */
+bool parseSize(char const * const data, unsigned long long * const size);
@@ -0,0 +1,143 @@
+/*
+  Durability handling of the session logfile.
+
+  The logfile used to be opened with O_SYNC, so every echoed keystroke
+  cost a synchronous disk write. Group mode collects writes and syncs
+  them together once enough bytes or enough time has piled up.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if HAVE_FCNTL_H
+#  include <fcntl.h>
+#endif
+
+#include "durability.h"
+
+/*
+//  logFd		The logfile, -1 if nothing is tracked.
+//
+//  unsynced		Bytes written since the last sync.
+//
+//  firstUnsynced	When the oldest of these bytes was written, in
+//			milliseconds of the monotonic clock.
+//
+//  boundary		Ends a frame of the compressed logfile. Without it
+//			only group mode counts the bytes.
+*/
+static int logFd = -1;
+static enum durability durabilityMode = DURABILITY_SYNC;
+static size_t maxUnsynced;
+static int maxAge;
+static size_t unsynced = 0;
+static long long firstUnsynced;
+static void (*boundary)(void) = NULL;
+
+
+static long long nowMs(void) {
+  struct timespec now;
+#ifdef CLOCK_MONOTONIC
+  clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+  clock_gettime(CLOCK_REALTIME, &now);
+#endif
+  return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+bool durabilityParse(char const * const value, enum durability * const mode) {
+  if(0 == strcmp("sync", value)) {
+    *mode = DURABILITY_SYNC;
+  } else if(0 == strcmp("group", value)) {
+    *mode = DURABILITY_GROUP;
+  } else if(0 == strcmp("none", value)) {
+    *mode = DURABILITY_NONE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+int durabilityOpenFlags(enum durability const mode) {
+  return DURABILITY_SYNC == mode ? O_SYNC : 0;
+}
+
+void durabilityOpen(int const fd, enum durability const mode,
+                    size_t const groupBytes, int const groupMs,
+                    void (*const frameEnd)(void)) {
+  logFd = fd;
+  durabilityMode = mode;
+  maxUnsynced = groupBytes;
+  maxAge = groupMs;
+  boundary = frameEnd;
+  unsynced = 0;
+}
+
+void durabilityFlush(void) {
+  if(logFd < 0 || 0 == unsynced) {
+    return;
+  }
+  if(NULL != boundary) {
+    boundary();
+  }
+  /*
+  //  A compressed logfile in sync mode is written with O_SYNC like a
+  //  plain one, the frame is on disk when boundary returns.
+  */
+  if(DURABILITY_GROUP == durabilityMode) {
+#if HAVE_FDATASYNC
+    if(fdatasync(logFd) < 0) {
+#else
+    if(fsync(logFd) < 0) {
+#endif
+      perror("Error syncing logfile");
+    }
+  }
+  unsynced = 0;
+}
+
+void durabilityWritten(size_t const length) {
+  if((DURABILITY_GROUP != durabilityMode && NULL == boundary) || 0 == length) {
+    return;
+  }
+  if(0 == unsynced) {
+    firstUnsynced = nowMs();
+  }
+  unsynced += length;
+  if(unsynced >= maxUnsynced || nowMs() - firstUnsynced >= maxAge) {
+    durabilityFlush();
+  }
+}
+
+int durabilityIdle(void) {
+  long long age;
+
+  if((DURABILITY_GROUP != durabilityMode && NULL == boundary) || 0 == unsynced) {
+    return -1;
+  }
+  age = nowMs() - firstUnsynced;
+  if(age >= maxAge) {
+    durabilityFlush();
+    return -1;
+  }
+  return (int)(maxAge - age);
+}
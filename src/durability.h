@@ -0,0 +1,92 @@
+/*
+  Header for the durability handling of the session logfile.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef DURABILITY_H
+#define DURABILITY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * When logfile writes are forced to disk.
+ */
+enum durability {
+  /** every write, the logfile is opened with O_SYNC */
+  DURABILITY_SYNC,
+  /** fdatasync after a number of bytes or milliseconds */
+  DURABILITY_GROUP,
+  /** whenever the kernel writes back */
+  DURABILITY_NONE
+};
+
+/**
+ * Parse the value of "file.durability".
+ *
+ * @param value sync, group or none
+ * @param mode output parameter
+ * @return false if value is none of the above
+ */
+bool durabilityParse(char const * const value, enum durability * const mode);
+
+/**
+ * @return the flags the logfile has to be opened with in addition to
+ * its access mode
+ */
+int durabilityOpenFlags(enum durability const mode);
+
+/**
+ * Start tracking writes to a logfile.
+ *
+ * @param fd the logfile
+ * @param mode the durability mode
+ * @param groupBytes group mode syncs once this many bytes are unsynced
+ * @param groupMs group mode syncs once the oldest unsynced byte is
+ * this old
+ * @param boundary called before every sync, may be NULL. If it is
+ * set, it is also called at the thresholds of group mode in the other
+ * modes, which don't sync there.
+ */
+void durabilityOpen(int const fd, enum durability const mode,
+                    size_t const groupBytes, int const groupMs,
+                    void (*boundary)(void));
+
+/**
+ * Account for a write to the logfile, syncs if a threshold is reached.
+ * Must be called by the thread that writes the logfile.
+ */
+void durabilityWritten(size_t const length);
+
+/**
+ * Sync if the time threshold is reached. Has to be called when the
+ * writing thread is idle, so the last output of a quiet session gets
+ * to disk too.
+ *
+ * @return milliseconds until the next call is due, -1 if nothing
+ * waits to be synced
+ */
+int durabilityIdle(void);
+
+/**
+ * Sync everything written so far, after the boundary.
+ */
+void durabilityFlush(void);
+
+#endif
@@ -0,0 +1,88 @@
+/*
+  Escape filter for the lines sent to syslog.
+
+  A DFA over bytes. The transition table is generated at build time
+  from the reference state machine (escReference.c), so per byte the
+  filter does one table lookup and no branches. Runs of plain text
+  are copied in bulk. There is a table for 8 bit and one for UTF-8
+  streams.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <stdbool.h>
+#include <string.h>
+
+#include "escFilter.h"
+#include "plainScan.h"
+#include "escTable.h"
+
+#define ESCNORMAL 0
+
+void escFilterInit(struct escFilter * const filter,
+                   enum escCharset const charset) {
+  filter->charset = (unsigned char)charset;
+  filter->state = ESCNORMAL;
+}
+
+size_t escFilterRun(struct escFilter * const filter, char *dst,
+                    char const *src, size_t length) {
+  char * const start = dst;
+  bool const utf8 = ESCCHARSET_UTF8 == filter->charset;
+  unsigned char const (* const table)[256] = utf8 ? escTableUtf8 : escTable;
+  unsigned int state = filter->state;
+
+  while (length > 0) {
+    if (state == ESCNORMAL) {
+      /*
+      //  copy plain text in bulk, only control bytes need the table
+      */
+      size_t const plain = utf8 ? plainSpanUtf8(src, length)
+        : plainSpan(src, length);
+      if (plain > 0) {
+        if (dst != src) {
+          memmove(dst, src, plain);
+        }
+        dst += plain;
+        src += plain;
+        length -= plain;
+        if (length == 0) {
+          break;
+        }
+      }
+    }
+    /*
+    //  Every byte is stored, dst only moves past it if it is kept.
+    //  A C2 held back in UTF-8 is stored the same way before it, it
+    //  was read already, so this works in place too.
+    //  Runs until the filter is back to normal text.
+    */
+    do {
+      unsigned char const chr = (unsigned char)*src++;
+      unsigned char const next = table[state][chr];
+      *dst = (char)0xC2;
+      dst += (next & ESCHELD) >> 6;
+      *dst = (char)chr;
+      dst += next >> 7;
+      state = next & ESCSTATEMASK;
+    } while (--length > 0 && state != ESCNORMAL);
+  }
+  filter->state = (unsigned char)state;
+  return(dst - start);
+}
@@ -0,0 +1,72 @@
+/*
+  Header for the escape filter.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef ESCFILTER_H
+#define ESCFILTER_H
+
+#include <stddef.h>
+
+/**
+ * How bytes from 0x80 on are read.
+ */
+enum escCharset {
+  /** as 8 bit C1 controls (0x80-0x9F) and printable Latin-1 */
+  ESCCHARSET_8BIT,
+  /** as UTF-8, C1 controls are only recognized as C2 80 to C2 9F */
+  ESCCHARSET_UTF8
+};
+
+/*
+//  The state of one stream. An escape sequence may be split across
+//  calls, the filter picks up where the last call stopped.
+*/
+struct escFilter {
+  unsigned char charset;
+  unsigned char state;
+};
+
+/**
+ * @param filter the filter to setup, a zeroed one is setup for
+ * ESCCHARSET_8BIT
+ * @param charset how to read the stream
+ */
+void escFilterInit(struct escFilter * const filter,
+                   enum escCharset const charset);
+
+/**
+ * Remove escape sequences and control characters except BEL, BS,
+ * TAB, LF, VT, FF and CR. NUL bytes are dropped like the other
+ * controls. In UTF-8 bytes which are no part of a valid character are
+ * dropped too.
+ *
+ * @param filter the state of the stream
+ * @param dst where the result goes, may be src unless a C2 is held back
+ * @param src what to filter
+ * @param length how large src is
+ * @return how many bytes were written to dst. In UTF-8 a C2 at the end
+ * of src is held back and may go out with the next call, so a call
+ * writes at most length + 1 bytes. Otherwise the result is never
+ * longer than the input.
+ */
+size_t escFilterRun(struct escFilter * const filter, char *dst,
+                    char const *src, size_t length);
+
+#endif
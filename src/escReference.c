@@ -0,0 +1,229 @@
+/*
+  Reference state machine of the escape filter.
+
+  This is the switch the syslog filter used to run for every byte.
+  The build runs it for every state and byte to generate the
+  transition table of the filter, see mkEscTable.c.
+
+  Copyright (C) 2004 Gerhard Lausser
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdbool.h>
+
+#include "escReference.h"
+
+#define BEL 0x07
+#define BS 0x08
+#define TAB 0x09
+#define LF 0x0A
+#define VT 0x0B
+#define FF 0x0C
+#define CR 0x0D
+#define SO 0x0E
+#define SI 0x0F
+#define CAN 0x18
+#define SUB 0x1A
+#define ESC 0x1B
+#define DEL 0x7F
+
+#define SS2 0x8E
+#define SS3 0x8F
+#define DCS 0x90
+#define CSI 0x9B
+#define ST 0x9C
+#define OSC 0x9D
+#define PM 0x9E
+#define APC 0x9F
+
+/* 
+//  algorithm mostly copied from 
+//  news:<3g5hjg$re2@newhub.xylogics.com> by james carlson
+*/
+bool escReferenceStep(enum escState * const state, int chr) {
+  bool kept = false;
+
+  chr &= 0xFF;
+  if (*state == DropOne) {
+    *state = Normal;
+    return false;
+  }
+  /* 
+  //  Handle normal ANSI escape mechanism
+  //  (Note that this terminates DCS strings!) 
+  */
+  if (*state == Esc && chr >= 0x40 && chr <= 0x5F) {
+   *state = Normal;
+   chr += 0x40;
+  }
+  switch (chr) {
+    case CAN: case SUB:
+      *state = Normal;
+      break;
+    case ESC:
+      *state = Esc;
+      break;
+    case CSI:
+      *state = Csi;
+      break;
+    case DCS: case PM: case APC:
+      *state = Dcs;  
+      break;
+    case OSC:
+      *state = Osc;  
+      break;
+    default:
+      if ((chr & 0x6F) < 0x20) { /* Check controls */
+        switch (chr) {
+          case BEL:
+            if (*state == OscString)
+              *state = Normal;
+            else
+              kept = true;
+            break;
+          case BS: case TAB: case LF: case VT: case FF: case CR:
+            kept = true;
+            break;
+        }
+        break;
+      }
+      switch (*state) {
+        case Normal:
+          kept = true;
+          break;
+        case Esc:
+          *state = Normal;
+          switch (chr) {
+            case 'c': case '7': case '8': case '=': case '>': case '~':
+            case 'n': case '\123': case 'o':
+            case '|':
+              break;
+            case '#': case ' ': case '(': case ')': case '*': case '+':
+              *state = DropOne;
+              break;
+          }
+          break;
+        case Csi: case Dcs:
+          if (chr >= 0x40 && chr <= 0x7E) {
+            if (*state == Csi) {
+              *state = Normal;
+            } else {
+              *state = DcsString;
+            }
+          }
+          break;
+        case Osc:
+          if (chr >= 0x40 && chr <= 0x7E)
+            *state = OscString;
+          break;
+        case DecSet:
+          if (chr == 0x68) {
+            *state = Normal;
+          }
+          break;
+        case DcsString:
+          break;
+        case OscString:
+          break;
+        case DropOne:
+          break;
+      }
+  }
+  return kept;
+}
+
+/*
+//  Bytes of characters mean nothing to the escape sequences, they go
+//  through the state machine as a printable byte.
+*/
+#define INERT 0xA0
+
+int escReferenceStepUtf8(enum escState * const state,
+                         enum utf8Wait * const wait, int chr) {
+  chr &= 0xFF;
+  switch (*wait) {
+    case UTF8_NONE:
+      break;
+    case UTF8_C2:
+      *wait = UTF8_NONE;
+      if (chr >= 0x80 && chr <= 0x9F) {
+        /* a C1 control, it is never kept */
+        escReferenceStep(state, chr);
+        return 0;
+      }
+      if (chr >= 0xA0 && chr <= 0xBF) {
+        if (*state == Normal) {
+          return ESCSTEP_KEPT | ESCSTEP_HELD;
+        }
+        escReferenceStep(state, INERT);
+        return 0;
+      }
+      /* a lone C2 is dropped, go on with chr */
+      break;
+    default:
+      if ((*wait == UTF8_E0 && chr >= 0xA0 && chr <= 0xBF)
+          || (*wait == UTF8_ED && chr >= 0x80 && chr <= 0x9F)
+          || ((*wait == UTF8_NEED1 || *wait == UTF8_NEED2 || *wait == UTF8_NEED3)
+              && chr >= 0x80 && chr <= 0xBF)) {
+        *wait = (*wait == UTF8_NEED3) ? UTF8_NEED2
+          : (*wait == UTF8_NEED2) ? UTF8_NEED1
+          : (*wait == UTF8_NEED1) ? UTF8_NONE : UTF8_NEED1;
+        return ESCSTEP_KEPT;
+      }
+      if ((*wait == UTF8_F0 && chr >= 0x90 && chr <= 0xBF)
+          || (*wait == UTF8_F4 && chr >= 0x80 && chr <= 0x8F)) {
+        *wait = UTF8_NEED2;
+        return ESCSTEP_KEPT;
+      }
+      /* the character is cut short, chr starts something new */
+      *wait = UTF8_NONE;
+      break;
+  }
+
+  if (chr < 0x80) {
+    return escReferenceStep(state, chr) ? ESCSTEP_KEPT : 0;
+  }
+  if (chr == 0xC2) {
+    /* hold it back until we know whether it starts a C1 control */
+    *wait = UTF8_C2;
+    return 0;
+  }
+  if (*state != Normal) {
+    escReferenceStep(state, INERT);
+    return 0;
+  }
+  if (chr >= 0xC3 && chr <= 0xDF) {
+    *wait = UTF8_NEED1;
+  } else if (chr == 0xE0) {
+    *wait = UTF8_E0;
+  } else if (chr == 0xED) {
+    *wait = UTF8_ED;
+  } else if (chr >= 0xE1 && chr <= 0xEF) {
+    *wait = UTF8_NEED2;
+  } else if (chr == 0xF0) {
+    *wait = UTF8_F0;
+  } else if (chr == 0xF4) {
+    *wait = UTF8_F4;
+  } else if (chr >= 0xF1 && chr <= 0xF3) {
+    *wait = UTF8_NEED3;
+  } else {
+    /* a stray continuation byte or one that never appears in UTF-8 */
+    return 0;
+  }
+  return ESCSTEP_KEPT;
+}
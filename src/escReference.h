@@ -0,0 +1,86 @@
+/*
+  Header for the reference state machine of the escape filter.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef ESCREFERENCE_H
+#define ESCREFERENCE_H
+
+#include <stdbool.h>
+
+/**
+ * The states of the filter. Normal must stay 0, a zeroed filter
+ * starts there.
+ */
+enum escState {
+  Normal, Esc, Csi, Dcs, DcsString, Osc, OscString, DropOne, DecSet
+};
+#define ESCSTATES (DecSet + 1)
+
+/**
+ * Feed one byte to the state machine. Slow, it is used to generate
+ * the filter's transition table and to test the filter against.
+ *
+ * @param state the state before the byte, updated
+ * @param chr the byte
+ * @return true if the byte is kept
+ */
+bool escReferenceStep(enum escState * const state, int chr);
+
+/**
+ * What the UTF-8 decoder waits for. Only in the Normal state a
+ * character can be waited for, in the other states only the second
+ * byte of a C2 lead can.
+ */
+enum utf8Wait {
+  /** the start of a character */
+  UTF8_NONE,
+  /** the byte after a C2 lead, 80-9F makes it a C1 control */
+  UTF8_C2,
+  /** 1, 2 or 3 continuation bytes */
+  UTF8_NEED1, UTF8_NEED2, UTF8_NEED3,
+  /** the restricted second bytes after E0, ED, F0 and F4 */
+  UTF8_E0, UTF8_ED, UTF8_F0, UTF8_F4
+};
+#define UTF8WAITS (UTF8_F4 + 1)
+
+/**
+ * Returned by escReferenceStepUtf8: the byte is kept, and a C2 lead
+ * that was held back goes out before it.
+ */
+#define ESCSTEP_KEPT 1
+#define ESCSTEP_HELD 2
+
+/**
+ * Feed one byte to the state machine in UTF-8 mode. C1 controls are
+ * only recognized in their encoded form (C2 80 to C2 9F), bytes
+ * 0x80-0xFF are otherwise parts of characters. Characters are
+ * checked as they come in: bytes which can't start or continue one
+ * are dropped. The part of a character that turns out to be cut
+ * short has been kept already.
+ *
+ * @param state the state before the byte, updated
+ * @param wait what the decoder waits for, updated
+ * @param chr the byte
+ * @return ESCSTEP_KEPT and ESCSTEP_HELD bits
+ */
+int escReferenceStepUtf8(enum escState * const state,
+                         enum utf8Wait * const wait, int chr);
+
+#endif
@@ -0,0 +1,381 @@
+/*
+  Event loop which drives the session relay.
+
+  On Linux the loop uses edge triggered epoll together with a
+  signalfd, everywhere else (or when epoll is not available at runtime)
+  it falls back to pselect.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#if HAVE_SYS_SELECT_H
+#  include <sys/select.h>
+#endif
+
+#if HAVE_SYS_EPOLL_H && HAVE_SYS_SIGNALFD_H && HAVE_EPOLL_CREATE1 && HAVE_SIGNALFD
+#  define USE_EPOLL 1
+#  include <sys/epoll.h>
+#  include <sys/signalfd.h>
+#endif
+
+#include "eventLoop.h"
+
+/*
+//  The relay only ever watches a handful of descriptors.
+*/
+#define MAXWATCHED 16
+
+/*
+//  watched		The descriptors and events registered with the loop.
+//			Used by the pselect backend to build its fd_sets.
+//
+//  blockedSet		The signals handed to eventLoopOpen.
+//
+//  origMask		The signal mask before eventLoopOpen, restored by
+//			eventLoopClose.
+//
+//  waitMask		origMask without blockedSet, used by pselect while
+//			waiting. The caller may have blocked the signals
+//			before eventLoopOpen.
+//
+//  epollFd		The epoll instance or -1 if pselect is used.
+//
+//  signalFd		The signalfd watched by epoll.
+//
+//  alwaysReady		Flags descriptors epoll refuses to watch (regular
+//			files, /dev/null). Like select, we report them as
+//			ready on every pass.
+*/
+static struct eventLoopEvent watched[MAXWATCHED];
+static bool alwaysReady[MAXWATCHED];
+static int watchedCount = 0;
+static sigset_t blockedSet;
+static sigset_t origMask;
+static sigset_t waitMask;
+static eventLoopSignalHandler signalHandler = NULL;
+static bool isOpen = false;
+#if USE_EPOLL
+static int epollFd = -1;
+static int signalFd = -1;
+#endif
+
+
+static int findWatched(int const fd) {
+  int i;
+  for(i = 0; i < watchedCount; ++i) {
+    if(watched[i].fd == fd) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+#if USE_EPOLL
+static uint32_t toEpoll(unsigned int const events) {
+  uint32_t epollEvents = EPOLLET;
+  if(events & EVENTLOOP_READ) {
+    epollEvents |= EPOLLIN | EPOLLRDHUP;
+  }
+  if(events & EVENTLOOP_WRITE) {
+    epollEvents |= EPOLLOUT;
+  }
+  return epollEvents;
+}
+
+/*
+//  Pass every pending signal from the signalfd to the handler.
+*/
+static void drainSignalFd(void) {
+  struct signalfd_siginfo info;
+  while(read(signalFd, &info, sizeof(info)) == sizeof(info)) {
+    signalHandler((int)info.ssi_signo);
+  }
+}
+
+static bool openEpoll(void) {
+  struct epoll_event event;
+
+  if((epollFd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+    return false;
+  }
+  if((signalFd = signalfd(-1, &blockedSet, SFD_NONBLOCK|SFD_CLOEXEC)) < 0) {
+    close(epollFd);
+    epollFd = -1;
+    return false;
+  }
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN | EPOLLET;
+  event.data.fd = signalFd;
+  if(epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event) < 0) {
+    close(signalFd);
+    close(epollFd);
+    signalFd = -1;
+    epollFd = -1;
+    return false;
+  }
+  return true;
+}
+#endif
+
+/*
+//  The pselect backend gets its signals through a real handler.
+//  Handle these signals (posix functions preferred).
+*/
+static void installHandlers(int const * const signals, int const signalCount) {
+  int i;
+#if HAVE_SIGACTION
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = signalHandler;
+#endif
+
+  for(i = 0; i < signalCount; ++i) {
+#if HAVE_SIGACTION
+    sigaction(signals[i], &action, NULL);
+#elif HAVE_SIGSET
+    sigset(signals[i], signalHandler);
+#else
+    signal(signals[i], signalHandler);
+#endif
+  }
+}
+
+bool eventLoopOpen(int const * const signals, int const signalCount,
+                   eventLoopSignalHandler const handler) {
+  int i;
+
+  signalHandler = handler;
+  watchedCount = 0;
+
+  sigemptyset(&blockedSet);
+  for(i = 0; i < signalCount; ++i) {
+    sigaddset(&blockedSet, signals[i]);
+  }
+  /*
+  //  Keep the signals blocked while we are not waiting. Either signalfd
+  //  picks them up or pselect unblocks them atomically.
+  */
+  if(sigprocmask(SIG_BLOCK, &blockedSet, &origMask) < 0) {
+    return false;
+  }
+  waitMask = origMask;
+  for(i = 0; i < signalCount; ++i) {
+    sigdelset(&waitMask, signals[i]);
+  }
+
+#if USE_EPOLL
+  if(openEpoll()) {
+    isOpen = true;
+    return true;
+  }
+#endif
+
+  installHandlers(signals, signalCount);
+  isOpen = true;
+  return true;
+}
+
+bool eventLoopAdd(int const fd, unsigned int const events) {
+  if(watchedCount >= MAXWATCHED) {
+    errno = ENOSPC;
+    return false;
+  }
+  alwaysReady[watchedCount] = false;
+#if USE_EPOLL
+  if(epollFd >= 0) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = toEpoll(events);
+    event.data.fd = fd;
+    if(epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+      if(EPERM != errno) {
+        return false;
+      }
+      alwaysReady[watchedCount] = true;
+    }
+  }
+#endif
+  watched[watchedCount].fd = fd;
+  watched[watchedCount].events = events;
+  ++watchedCount;
+  return true;
+}
+
+bool eventLoopModify(int const fd, unsigned int const events) {
+  int const index = findWatched(fd);
+  if(index < 0) {
+    errno = ENOENT;
+    return false;
+  }
+  if(watched[index].events == events) {
+    return true;
+  }
+#if USE_EPOLL
+  if(epollFd >= 0 && !alwaysReady[index]) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = toEpoll(events);
+    event.data.fd = fd;
+    if(epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) < 0) {
+      return false;
+    }
+  }
+#endif
+  watched[index].events = events;
+  return true;
+}
+
+bool eventLoopRemove(int const fd) {
+  int const index = findWatched(fd);
+  if(index < 0) {
+    errno = ENOENT;
+    return false;
+  }
+#if USE_EPOLL
+  if(epollFd >= 0 && !alwaysReady[index]) {
+    /* a closed descriptor has already left the epoll set */
+    if(epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL) < 0 && errno != EBADF) {
+      return false;
+    }
+  }
+#endif
+  --watchedCount;
+  watched[index] = watched[watchedCount];
+  alwaysReady[index] = alwaysReady[watchedCount];
+  return true;
+}
+
+int eventLoopWait(struct eventLoopEvent * const events, int const maxEvents,
+                  int const timeoutMs) {
+  fd_set readmask, writemask;
+  struct timespec timeout;
+  int maxFd = -1;
+  int n, i, count;
+
+#if USE_EPOLL
+  if(epollFd >= 0) {
+    struct epoll_event ready[MAXWATCHED + 1];
+    count = 0;
+    for(i = 0; i < watchedCount && count < maxEvents; ++i) {
+      if(alwaysReady[i] && watched[i].events) {
+        events[count++] = watched[i];
+      }
+    }
+    n = epoll_wait(epollFd, ready, MAXWATCHED + 1, count > 0 ? 0 : timeoutMs);
+    if(n < 0) {
+      return (EINTR == errno) ? count : -1;
+    }
+    for(i = 0; i < n; ++i) {
+      if(ready[i].data.fd == signalFd) {
+        drainSignalFd();
+      } else if(count < maxEvents) {
+        events[count].fd = ready[i].data.fd;
+        events[count].events = 0;
+        /*
+        //  Errors and hangups are reported as readable so the caller
+        //  finds out about them from read.
+        */
+        if(ready[i].events & (EPOLLIN|EPOLLRDHUP|EPOLLHUP|EPOLLERR)) {
+          events[count].events |= EVENTLOOP_READ;
+        }
+        if(ready[i].events & (EPOLLOUT|EPOLLERR)) {
+          events[count].events |= EVENTLOOP_WRITE;
+        }
+        ++count;
+      }
+    }
+    return count;
+  }
+#endif
+
+  FD_ZERO(&readmask);
+  FD_ZERO(&writemask);
+  for(i = 0; i < watchedCount; ++i) {
+    if(watched[i].events & EVENTLOOP_READ) {
+      FD_SET(watched[i].fd, &readmask);
+    }
+    if(watched[i].events & EVENTLOOP_WRITE) {
+      FD_SET(watched[i].fd, &writemask);
+    }
+    if(watched[i].events && watched[i].fd > maxFd) {
+      maxFd = watched[i].fd;
+    }
+  }
+  if(timeoutMs >= 0) {
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (long)(timeoutMs % 1000) * 1000000L;
+  }
+
+  /*  Wait for something to read or a signal */
+  n = pselect(maxFd + 1, &readmask, &writemask, (fd_set *) 0,
+              timeoutMs >= 0 ? &timeout : (struct timespec *) 0, &waitMask);
+  if(n < 0) {
+    return (EINTR == errno) ? 0 : -1;
+  }
+  count = 0;
+  for(i = 0; i < watchedCount && count < maxEvents; ++i) {
+    unsigned int ready = 0;
+    if(FD_ISSET(watched[i].fd, &readmask)) {
+      ready |= EVENTLOOP_READ;
+    }
+    if(FD_ISSET(watched[i].fd, &writemask)) {
+      ready |= EVENTLOOP_WRITE;
+    }
+    if(ready) {
+      events[count].fd = watched[i].fd;
+      events[count].events = ready;
+      ++count;
+    }
+  }
+  return count;
+}
+
+void eventLoopClose(void) {
+  if(!isOpen) {
+    return;
+  }
+#if USE_EPOLL
+  if(epollFd >= 0) {
+    close(signalFd);
+    close(epollFd);
+    signalFd = -1;
+    epollFd = -1;
+  }
+#endif
+  watchedCount = 0;
+  sigprocmask(SIG_SETMASK, &origMask, NULL);
+  isOpen = false;
+}
+
+char const * eventLoopBackend(void) {
+#if USE_EPOLL
+  if(epollFd >= 0) {
+    return "epoll";
+  }
+#endif
+  return "pselect";
+}
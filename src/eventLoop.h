@@ -0,0 +1,111 @@
+/*
+  Header for the event loop which drives the session relay.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <stdbool.h>
+
+/* the file descriptor has data to read (or hit end of file) */
+#define EVENTLOOP_READ 0x01
+/* the file descriptor can accept more data */
+#define EVENTLOOP_WRITE 0x02
+
+/**
+ * Called for every signal delivered while the loop is open.
+ * Runs in normal program context with the epoll backend and in
+ * signal context with the pselect backend, so it must only set
+ * flags.
+ */
+typedef void (*eventLoopSignalHandler)(int const signal);
+
+struct eventLoopEvent {
+  int fd;
+  unsigned int events;
+};
+
+/**
+ * Setup the event loop and take over delivery of the given signals.
+ * The signals stay blocked outside of eventLoopWait.
+ *
+ * Readiness is edge triggered with the epoll backend, so callers
+ * must drain a ready file descriptor until read or write returns
+ * EAGAIN before waiting for it again. The pselect backend
+ * behaves the same way when used like this.
+ *
+ * @param signals the signals to watch
+ * @param signalCount number of entries in signals
+ * @param handler called with each received signal
+ * @return false if the loop could not be setup
+ */
+bool eventLoopOpen(int const * const signals, int const signalCount,
+                   eventLoopSignalHandler const handler);
+
+/**
+ * Start watching fd.
+ *
+ * @param fd a non-blocking file descriptor
+ * @param events EVENTLOOP_READ and/or EVENTLOOP_WRITE
+ * @return false on error, errno is set
+ */
+bool eventLoopAdd(int const fd, unsigned int const events);
+
+/**
+ * Change the events watched for fd.
+ *
+ * @param fd a file descriptor previously passed to eventLoopAdd
+ * @param events EVENTLOOP_READ and/or EVENTLOOP_WRITE, 0 to pause
+ * @return false on error, errno is set
+ */
+bool eventLoopModify(int const fd, unsigned int const events);
+
+/**
+ * Stop watching fd.
+ *
+ * @return false on error, errno is set
+ */
+bool eventLoopRemove(int const fd);
+
+/**
+ * Wait for file descriptors to become ready or a signal to arrive.
+ * Signals are passed to the handler given to eventLoopOpen before
+ * this function returns.
+ *
+ * @param events output parameter, filled with the ready descriptors
+ * @param maxEvents size of events
+ * @param timeoutMs milliseconds to wait, -1 waits forever
+ * @return number of entries filled in events (0 on timeout or when
+ * only signals arrived), -1 on error with errno set
+ */
+int eventLoopWait(struct eventLoopEvent * const events, int const maxEvents,
+                  int const timeoutMs);
+
+/**
+ * Release the resources of the loop and restore the signal mask.
+ */
+void eventLoopClose(void);
+
+/**
+ * @return the name of the backend in use, for diagnostics
+ */
+char const * eventLoopBackend(void);
+
+#endif
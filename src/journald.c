@@ -0,0 +1,307 @@
+/*
+  A sink for journald which keeps the session data as fields instead
+  of free text. Every message is one datagram of "FIELD=value" lines
+  on the native socket, the ones of a read chunk go out with one
+  sendmmsg. A datagram too large for the socket is written to a
+  sealed memfd which is passed instead, like sd_journal_send does.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+/* sendmmsg and memfd_create are GNU extensions */
+#define _GNU_SOURCE 1
+
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "journald.h"
+#include "util.h"
+
+/*
+//  At most this many messages, together no longer than the batch
+//  buffer, go out with one sendmmsg. A message larger than a datagram
+//  goes out on its own.
+*/
+#define JOURNALDBATCH 64
+#define JOURNALDBATCHSIZE (4 * JOURNALDDATAGRAMSIZE)
+
+/*
+//  socketFd		The datagram socket connected to journald, -1
+//			while syslog(3) is used.
+//
+//  fields		The fields all messages share, from
+//			SYSLOG_IDENTIFIER to TTY. Made once, every
+//			datagram starts with them.
+*/
+static int socketFd = -1;
+static struct sockaddr_un socketPath;
+static char fields[2048];
+static size_t fieldsLength;
+
+/*
+//  The queued messages. Only the fields of their own are copied into
+//  the batch buffer, the shared ones are the first iovec of each.
+//  texts and textLengths tell syslog(3) what to log if the socket
+//  fails.
+*/
+static char batch[JOURNALDBATCHSIZE];
+static size_t batchUsed;
+static struct mmsghdr messages[JOURNALDBATCH];
+static struct iovec vectors[JOURNALDBATCH][2];
+static int priorities[JOURNALDBATCH];
+static char const *texts[JOURNALDBATCH];
+static size_t textLengths[JOURNALDBATCH];
+static unsigned int batchCount;
+
+/*
+//  Append a field, with the binary form for values which may hold a
+//  newline: the name, a newline, the length as 64 bit little endian
+//  and the value.
+*/
+static size_t addField(char *buffer, char const *name, char const *value,
+                       size_t const length) {
+  size_t const nameLength = strlen(name);
+  size_t offset = nameLength;
+  int i;
+
+  memcpy(buffer, name, nameLength);
+  if (NULL == memchr(value, '\n', length)) {
+    buffer[offset++] = '=';
+  } else {
+    buffer[offset++] = '\n';
+    for (i = 0; i < 8; ++i) {
+      buffer[offset++] = (char)((uint64_t)length >> (8 * i));
+    }
+  }
+  memcpy(buffer + offset, value, length);
+  offset += length;
+  buffer[offset++] = '\n';
+  return offset;
+}
+
+/*
+//  The space addField needs at most.
+*/
+static size_t fieldSize(char const *name, size_t const length) {
+  return strlen(name) + 1 + 8 + length + 1;
+}
+
+bool journaldOpen(char const *path, char const *ident, pid_t const pid,
+                  char const *session, char const *user, char const *runas,
+                  char const *tty) {
+  char number[16];
+
+  if (strlen(path) >= sizeof(socketPath.sun_path)) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  if (fieldSize("SYSLOG_IDENTIFIER", strlen(ident)) + fieldSize("SYSLOG_PID", 12)
+      + fieldSize("ROOTSH_SESSION", strlen(session)) + fieldSize("ROOTSH_USER", strlen(user))
+      + fieldSize("ROOTSH_RUNAS", strlen(runas)) + fieldSize("TTY", strlen(tty))
+      > sizeof(fields)) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  memset(&socketPath, 0, sizeof(socketPath));
+  socketPath.sun_family = AF_UNIX;
+  strcpy(socketPath.sun_path, path);
+  snprintf(number, sizeof(number), "%d", (int)pid);
+  fieldsLength = addField(fields, "SYSLOG_IDENTIFIER", ident, strlen(ident));
+  fieldsLength += addField(fields + fieldsLength, "SYSLOG_PID", number, strlen(number));
+  fieldsLength += addField(fields + fieldsLength, "ROOTSH_SESSION", session, strlen(session));
+  fieldsLength += addField(fields + fieldsLength, "ROOTSH_USER", user, strlen(user));
+  fieldsLength += addField(fields + fieldsLength, "ROOTSH_RUNAS", runas, strlen(runas));
+  fieldsLength += addField(fields + fieldsLength, "TTY", tty, strlen(tty));
+  batchUsed = 0;
+  batchCount = 0;
+  socketFd = socket(AF_UNIX, SOCK_DGRAM, 0);
+  if (socketFd < 0) {
+    return false;
+  }
+  fcntl(socketFd, F_SETFD, FD_CLOEXEC);
+  if (connect(socketFd, (struct sockaddr *)&socketPath, sizeof(socketPath)) < 0) {
+    int const saved = errno;
+    close(socketFd);
+    socketFd = -1;
+    errno = saved;
+    return false;
+  }
+  return true;
+}
+
+bool journaldActive(void) {
+  return socketFd >= 0;
+}
+
+/*
+//  Write the datagram of message index to a sealed memfd and pass
+//  that. journald only takes it sealed, so it can't change while it
+//  is read.
+*/
+static bool sendMemfd(unsigned int const index) {
+#if HAVE_MEMFD_CREATE
+  struct msghdr header;
+  struct cmsghdr *control;
+  union {
+    struct cmsghdr align;
+    char buffer[CMSG_SPACE(sizeof(int))];
+  } controlBuffer;
+  int const fd = memfd_create("rootsh-journal", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  bool sent;
+
+  if (fd < 0) {
+    return false;
+  }
+  if (writev(fd, vectors[index], 2)
+      != (ssize_t)(vectors[index][0].iov_len + vectors[index][1].iov_len)
+      || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+    close(fd);
+    return false;
+  }
+  memset(&header, 0, sizeof(header));
+  memset(&controlBuffer, 0, sizeof(controlBuffer));
+  header.msg_control = controlBuffer.buffer;
+  header.msg_controllen = sizeof(controlBuffer.buffer);
+  control = CMSG_FIRSTHDR(&header);
+  control->cmsg_level = SOL_SOCKET;
+  control->cmsg_type = SCM_RIGHTS;
+  control->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(control), &fd, sizeof(int));
+  sent = sendmsg(socketFd, &header, MSG_NOSIGNAL) >= 0;
+  close(fd);
+  return sent;
+#else
+  errno = ENOSYS;
+  return false;
+#endif
+}
+
+/*
+//  Give the queued messages from first on to syslog(3).
+*/
+static void fallback(unsigned int first) {
+  for (; first < batchCount; ++first) {
+    syslog(priorities[first], "%.*s", (int)textLengths[first], texts[first]);
+  }
+}
+
+void journaldFlush(void) {
+  unsigned int done = 0;
+
+  while (done < batchCount && socketFd >= 0) {
+    int const sent = sendmmsg(socketFd, messages + done, batchCount - done, MSG_NOSIGNAL);
+    if (sent > 0) {
+      done += sent;
+    } else if (EINTR == errno) {
+      continue;
+    } else if ((EMSGSIZE == errno || ENOBUFS == errno) && sendMemfd(done)) {
+      ++done;
+    } else {
+      /*
+      //  journald is gone, syslog(3) finds another way
+      */
+      close(socketFd);
+      socketFd = -1;
+    }
+  }
+  fallback(done);
+  batchUsed = 0;
+  batchCount = 0;
+}
+
+void journaldAdd(int const priority, long long const sequence,
+                 char const *fragment, char const *text, size_t const length) {
+  size_t const size = 64 + fieldSize("ROOTSH_FRAGMENT", strlen(fragment))
+    + fieldSize("MESSAGE", length);
+  bool const large = fieldsLength + size > JOURNALDDATAGRAMSIZE;
+  char number[24];
+  char *message;
+  size_t used;
+
+  if (socketFd < 0) {
+    syslog(priority, "%.*s", (int)length, text);
+    return;
+  }
+  if (size > JOURNALDBATCHSIZE) {
+    syslog(priority, "%.*s", (int)length, text);
+    return;
+  }
+  if (JOURNALDBATCH == batchCount || batchUsed + size > JOURNALDBATCHSIZE || large) {
+    journaldFlush();
+  }
+  message = batch + batchUsed;
+  snprintf(number, sizeof(number), "%d", priority & LOG_PRIMASK);
+  used = addField(message, "PRIORITY", number, strlen(number));
+  snprintf(number, sizeof(number), "%d", (priority & LOG_FACMASK) >> 3);
+  used += addField(message + used, "SYSLOG_FACILITY", number, strlen(number));
+  if (sequence >= 0) {
+    snprintf(number, sizeof(number), "%lld", sequence);
+    used += addField(message + used, "SEQ", number, strlen(number));
+  }
+  if ('\0' != fragment[0]) {
+    used += addField(message + used, "ROOTSH_FRAGMENT", fragment, strlen(fragment));
+  }
+  texts[batchCount] = message + used + strlen("MESSAGE=");
+  textLengths[batchCount] = length;
+  used += addField(message + used, "MESSAGE", text, length);
+  if (NULL != memchr(text, '\n', length)) {
+    texts[batchCount] += 8;
+  }
+  priorities[batchCount] = priority;
+  vectors[batchCount][0].iov_base = fields;
+  vectors[batchCount][0].iov_len = fieldsLength;
+  vectors[batchCount][1].iov_base = message;
+  vectors[batchCount][1].iov_len = used;
+  memset(&messages[batchCount], 0, sizeof(messages[batchCount]));
+  messages[batchCount].msg_hdr.msg_iov = vectors[batchCount];
+  messages[batchCount].msg_hdr.msg_iovlen = 2;
+  batchUsed += used;
+  ++batchCount;
+  /*
+  //  too large for a datagram: it goes out alone, through a memfd
+  */
+  if (large) {
+    if (!sendMemfd(0)) {
+      fallback(0);
+    }
+    batchUsed = 0;
+    batchCount = 0;
+  }
+}
+
+void journaldClose(void) {
+  if (socketFd < 0) {
+    return;
+  }
+  journaldFlush();
+  if (socketFd >= 0) {
+    close(socketFd);
+    socketFd = -1;
+  }
+}
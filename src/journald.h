@@ -0,0 +1,87 @@
+/*
+  Header for the sink that writes to the native socket of journald.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef JOURNALD_H
+#define JOURNALD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * The native socket of journald.
+ */
+#define JOURNALDPATH "/run/systemd/journal/socket"
+
+/**
+ * Datagrams larger than this are passed in a sealed memfd.
+ */
+#define JOURNALDDATAGRAMSIZE 65536
+
+/**
+ * Connect to journald. Every message gets SYSLOG_IDENTIFIER,
+ * SYSLOG_PID, ROOTSH_SESSION, ROOTSH_USER, ROOTSH_RUNAS and TTY as
+ * fields. openlog must have been called before, syslog(3) takes over
+ * whenever the socket fails.
+ *
+ * @param path the socket, normally JOURNALDPATH
+ * @param ident the program name
+ * @param pid the process id
+ * @param session the session id
+ * @param user who called rootsh
+ * @param runas whom the shell runs as
+ * @param tty the terminal
+ * @return false if the socket can't be used, errno is set
+ */
+bool journaldOpen(char const *path, char const *ident, pid_t const pid,
+                  char const *session, char const *user, char const *runas,
+                  char const *tty);
+
+/**
+ * @return true between journaldOpen and journaldClose
+ */
+bool journaldActive(void);
+
+/**
+ * Queue a message for the next journaldFlush, one datagram of its
+ * own.
+ *
+ * @param priority facility and priority
+ * @param sequence the number of the line as SEQ, -1 for none
+ * @param fragment which piece of a split line this is, like "2+", as
+ *        ROOTSH_FRAGMENT, "" for a whole line
+ * @param text the message, needs no \0
+ * @param length how long text is
+ */
+void journaldAdd(int const priority, long long const sequence,
+                 char const *fragment, char const *text, size_t const length);
+
+/**
+ * Send the queued messages, as far as possible with one syscall.
+ */
+void journaldFlush(void);
+
+/**
+ * Send what is left and close the socket.
+ */
+void journaldClose(void);
+
+#endif
@@ -0,0 +1,584 @@
+/*
+  Streaming compression of the session logfile. The logfile is a
+  series of gzip members, one per frame, so gzip and zcat read it as
+  one file and a crash loses no more than the frame that was open.
+  The file sink ends a frame at each group commit and after a fixed
+  number of bytes, the compression runs on its logger thread and
+  leaves the relay alone. When the logfile is closed a footer indexes
+  the frames, a reader decompresses only the frame it needs.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if HAVE_ZLIB_H && HAVE_LIBZ
+#  define USE_ZLIB 1
+#  include <zlib.h>
+#endif
+
+#include "logCompress.h"
+#include "util.h"
+
+#if USE_ZLIB
+
+/*
+//  Compressed output is collected in out and written when it is full
+//  or the frame ends.
+*/
+#define OUTSIZE 65536
+
+/*
+//  15 bits of window, 16 asks zlib for a gzip header and trailer.
+*/
+#define GZIPWINDOWBITS (15 + 16)
+
+/*
+//  A footer member: the gzip header with FEXTRA, XLEN, the subfield
+//  header, the subfield, an empty final deflate block, CRC and size.
+//  The extra field holds at most 65535 bytes.
+*/
+#define ENTRYSIZE 24
+#define MEMBERHEADER 16
+#define MEMBERTAIL 10
+#define ENTRIESPERMEMBER ((65535 - 4) / ENTRYSIZE)
+
+struct logCompress {
+  int fd;
+  int level;
+  size_t frameSize;
+  /*
+  //  in and out count what went into the logfile before and after
+  //  compression, inFrame how much of it is in the current frame.
+  */
+  unsigned long long in;
+  unsigned long long out;
+  size_t frameIn;
+  /*
+  //  The deflate state only lives while a frame is open, between
+  //  frames a logfile costs no more than this struct and the index.
+  */
+  bool inFrame;
+  z_stream stream;
+  struct logCompressEntry *entries;
+  size_t count;
+  size_t size;
+  unsigned char buffer[OUTSIZE];
+};
+
+static bool writeAll(int const fd, unsigned char const *data, size_t length) {
+  while (length > 0) {
+    ssize_t const written = write(fd, data, length);
+    if (written < 0 && EINTR == errno) {
+      continue;
+    } else if (written <= 0) {
+      if (0 == written) {
+        errno = EIO;
+      }
+      return false;
+    }
+    data += written;
+    length -= written;
+  }
+  return true;
+}
+
+/*
+//  Run deflate until it took all input, or with Z_FINISH until the
+//  frame is complete, and write what it produced.
+*/
+static bool deflateAll(struct logCompress * const compress, int const flush) {
+  int result;
+
+  do {
+    size_t produced;
+
+    compress->stream.next_out = compress->buffer;
+    compress->stream.avail_out = sizeof(compress->buffer);
+    result = deflate(&compress->stream, flush);
+    if (Z_STREAM_ERROR == result) {
+      errno = EINVAL;
+      return false;
+    }
+    produced = sizeof(compress->buffer) - compress->stream.avail_out;
+    if (!writeAll(compress->fd, compress->buffer, produced)) {
+      return false;
+    }
+    compress->out += produced;
+  } while (0 == compress->stream.avail_out
+           || (Z_FINISH == flush && Z_STREAM_END != result));
+  return true;
+}
+
+struct logCompress *logCompressOpen(int const fd, int const level,
+                                    size_t const frameSize) {
+  struct logCompress *compress;
+  off_t const end = lseek(fd, 0, SEEK_END);
+
+  if (level < 1 || level > 9 || 0 == frameSize) {
+    errno = EINVAL;
+    return NULL;
+  }
+  if (NULL == (compress = malloc(sizeof(*compress)))) {
+    return NULL;
+  }
+  compress->fd = fd;
+  compress->level = level;
+  compress->frameSize = frameSize;
+  compress->in = 0;
+  compress->out = end > 0 ? (unsigned long long)end : 0;
+  compress->frameIn = 0;
+  compress->inFrame = false;
+  compress->entries = NULL;
+  compress->count = 0;
+  compress->size = 0;
+  return compress;
+}
+
+/*
+//  Open a frame and note it in the index.
+*/
+/*
+//  Index a frame that starts at the current end of the logfile.
+*/
+static bool addEntry(struct logCompress * const compress, unsigned long long const time) {
+  struct logCompressEntry *entry;
+
+  if (compress->count == compress->size) {
+    size_t const size = compress->size > 0 ? 2 * compress->size : 64;
+    struct logCompressEntry * const grown =
+      realloc(compress->entries, size * sizeof(*grown));
+    if (NULL == grown) {
+      return false;
+    }
+    compress->entries = grown;
+    compress->size = size;
+  }
+  entry = &compress->entries[compress->count++];
+  entry->in = compress->in;
+  entry->out = compress->out;
+  entry->time = time;
+  return true;
+}
+
+static bool startFrame(struct logCompress * const compress, unsigned long long const time) {
+  compress->stream.zalloc = Z_NULL;
+  compress->stream.zfree = Z_NULL;
+  compress->stream.opaque = Z_NULL;
+  if (Z_OK != deflateInit2(&compress->stream, compress->level, Z_DEFLATED,
+                           GZIPWINDOWBITS, 8, Z_DEFAULT_STRATEGY)) {
+    errno = ENOMEM;
+    return false;
+  }
+  if (!addEntry(compress, time)) {
+    deflateEnd(&compress->stream);
+    return false;
+  }
+  compress->frameIn = 0;
+  compress->inFrame = true;
+  return true;
+}
+
+bool logCompressWritev(struct logCompress * const compress, unsigned long long const time,
+                       struct iovec const * const vector, int const count) {
+  int i;
+
+  if (!compress->inFrame && !startFrame(compress, time)) {
+    return false;
+  }
+  for (i = 0; i < count; ++i) {
+    unsigned char *data = vector[i].iov_base;
+    size_t left = vector[i].iov_len;
+
+    while (left > 0) {
+      uInt const part = left > UINT_MAX ? UINT_MAX : (uInt)left;
+      compress->stream.next_in = data;
+      compress->stream.avail_in = part;
+      if (!deflateAll(compress, Z_NO_FLUSH)) {
+        return false;
+      }
+      data += part;
+      left -= part;
+      compress->in += part;
+      compress->frameIn += part;
+    }
+  }
+  if (compress->frameIn >= compress->frameSize) {
+    return logCompressFrame(compress);
+  }
+  return true;
+}
+
+bool logCompressFrame(struct logCompress * const compress) {
+  bool written;
+
+  if (!compress->inFrame) {
+    return true;
+  }
+  compress->stream.next_in = Z_NULL;
+  compress->stream.avail_in = 0;
+  written = deflateAll(compress, Z_FINISH);
+  deflateEnd(&compress->stream);
+  compress->inFrame = false;
+  return written;
+}
+
+unsigned char *logCompressDeflate(int const level, void const * const data,
+                                  size_t const size, size_t * const length) {
+  unsigned char const *in = data;
+  size_t left = size;
+  unsigned char *frame;
+  z_stream stream;
+  int result;
+
+  memset(&stream, 0, sizeof(stream));
+  if (level < 1 || level > 9) {
+    errno = EINVAL;
+    return NULL;
+  }
+  if (Z_OK != deflateInit2(&stream, level, Z_DEFLATED, GZIPWINDOWBITS, 8,
+                           Z_DEFAULT_STRATEGY)) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  /* the bound holds for the whole frame, header and trailer included */
+  *length = (size_t)deflateBound(&stream, size > ULONG_MAX ? ULONG_MAX : (uLong)size);
+  if (size > ULONG_MAX || NULL == (frame = malloc(*length))) {
+    deflateEnd(&stream);
+    errno = ENOMEM;
+    return NULL;
+  }
+  stream.next_out = frame;
+  do {
+    size_t const room = *length - (size_t)(stream.next_out - frame);
+
+    if (0 == stream.avail_in) {
+      uInt const part = left > UINT_MAX ? UINT_MAX : (uInt)left;
+      stream.next_in = (unsigned char *)in;
+      stream.avail_in = part;
+      in += part;
+      left -= part;
+    }
+    stream.avail_out = room > UINT_MAX ? UINT_MAX : (uInt)room;
+    result = deflate(&stream, 0 == left ? Z_FINISH : Z_NO_FLUSH);
+  } while (Z_OK == result);
+  *length = (size_t)(stream.next_out - frame);
+  deflateEnd(&stream);
+  if (Z_STREAM_END != result) {
+    free(frame);
+    errno = EINVAL;
+    return NULL;
+  }
+  return frame;
+}
+
+bool logCompressAppend(struct logCompress * const compress, unsigned long long const time,
+                       unsigned char const * const frame, size_t const length,
+                       size_t const size) {
+  if (compress->inFrame) {
+    errno = EINVAL;
+    return false;
+  }
+  if (!addEntry(compress, time) || !writeAll(compress->fd, frame, length)) {
+    return false;
+  }
+  compress->in += size;
+  compress->out += length;
+  return true;
+}
+
+/*
+//  An empty gzip member with subfield id and length bytes of data in
+//  its extra field, the data follows at member + MEMBERHEADER.
+*/
+static void fillMember(unsigned char * const member, char const * const id,
+                       size_t const length) {
+  static unsigned char const header[10] = {
+    0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff
+  };
+  unsigned char * const tail = member + MEMBERHEADER + length;
+
+  memcpy(member, header, sizeof(header));
+  member[10] = (unsigned char)((length + 4) & 0xff);
+  member[11] = (unsigned char)((length + 4) >> 8);
+  member[12] = (unsigned char)id[0];
+  member[13] = (unsigned char)id[1];
+  member[14] = (unsigned char)(length & 0xff);
+  member[15] = (unsigned char)(length >> 8);
+  /* final fixed block with nothing but its end, CRC and size are 0 */
+  memset(tail, 0, MEMBERTAIL);
+  tail[0] = 3;
+}
+
+bool logCompressFooter(struct logCompress const * const compress, int const fd) {
+  unsigned char member[MEMBERHEADER + ENTRIESPERMEMBER * ENTRYSIZE + MEMBERTAIL];
+  size_t done = 0;
+
+  if (compress->inFrame) {
+    errno = EINVAL;
+    return false;
+  }
+  do {
+    size_t const entries = compress->count - done > ENTRIESPERMEMBER
+      ? ENTRIESPERMEMBER : compress->count - done;
+    size_t i;
+
+    fillMember(member, "RI", entries * ENTRYSIZE);
+    for (i = 0; i < entries; ++i) {
+      unsigned char * const entry = member + MEMBERHEADER + i * ENTRYSIZE;
+      utilPut64(entry, compress->entries[done + i].in);
+      utilPut64(entry + 8, compress->entries[done + i].out);
+      utilPut64(entry + 16, compress->entries[done + i].time);
+    }
+    if (!writeAll(fd, member, MEMBERHEADER + entries * ENTRYSIZE + MEMBERTAIL)) {
+      return false;
+    }
+    done += entries;
+  } while (done < compress->count);
+  fillMember(member, "RT", ENTRYSIZE);
+  utilPut64(member + MEMBERHEADER, compress->out);
+  utilPut64(member + MEMBERHEADER + 8, compress->count);
+  utilPut64(member + MEMBERHEADER + 16, compress->in);
+  return writeAll(fd, member, LOGCOMPRESSTRAILERSIZE);
+}
+
+bool logCompressClose(struct logCompress * const compress) {
+  bool const written = logCompressFrame(compress)
+    && logCompressFooter(compress, compress->fd);
+
+  free(compress->entries);
+  free(compress);
+  return written;
+}
+
+/*
+//  The length of the footer member at member with subfield id,
+//  0 if it is none.
+*/
+static size_t footerMember(unsigned char const * const member, size_t const available,
+                           char const * const id, size_t * const length) {
+  size_t extra;
+
+  if (available < MEMBERHEADER + MEMBERTAIL || 0x1f != member[0] || 0x8b != member[1]
+      || 8 != member[2] || 4 != member[3] || member[12] != (unsigned char)id[0]
+      || member[13] != (unsigned char)id[1]) {
+    return 0;
+  }
+  extra = member[10] | (size_t)member[11] << 8;
+  *length = member[14] | (size_t)member[15] << 8;
+  if (*length + 4 != extra || available < MEMBERHEADER + *length + MEMBERTAIL) {
+    return 0;
+  }
+  return MEMBERHEADER + *length + MEMBERTAIL;
+}
+
+bool logCompressReadFooter(unsigned char const * const file, size_t const size,
+                           struct logCompressEntry ** const entries,
+                           size_t * const count, unsigned long long * const total) {
+  unsigned char const *trailer;
+  unsigned long long start, number;
+  size_t length, position, done = 0;
+
+  if (size < LOGCOMPRESSTRAILERSIZE) {
+    errno = ENOENT;
+    return false;
+  }
+  trailer = file + size - LOGCOMPRESSTRAILERSIZE;
+  if (LOGCOMPRESSTRAILERSIZE != footerMember(trailer, LOGCOMPRESSTRAILERSIZE, "RT", &length)
+      || ENTRYSIZE != length) {
+    errno = ENOENT;
+    return false;
+  }
+  start = utilGet64(trailer + MEMBERHEADER);
+  number = utilGet64(trailer + MEMBERHEADER + 8);
+  *total = utilGet64(trailer + MEMBERHEADER + 16);
+  if (start > size - LOGCOMPRESSTRAILERSIZE || number > size / ENTRYSIZE) {
+    errno = EINVAL;
+    return false;
+  }
+  if (NULL == (*entries = malloc((number > 0 ? number : 1) * sizeof(**entries)))) {
+    return false;
+  }
+  position = (size_t)start;
+  while (done < number) {
+    size_t const used = footerMember(file + position,
+                                     size - LOGCOMPRESSTRAILERSIZE - position,
+                                     "RI", &length);
+    size_t i;
+
+    if (0 == used || 0 != length % ENTRYSIZE || done + length / ENTRYSIZE > number) {
+      break;
+    }
+    for (i = 0; i < length / ENTRYSIZE; ++i, ++done) {
+      unsigned char const * const entry = file + position + MEMBERHEADER + i * ENTRYSIZE;
+      (*entries)[done].in = utilGet64(entry);
+      (*entries)[done].out = utilGet64(entry + 8);
+      (*entries)[done].time = utilGet64(entry + 16);
+      if ((*entries)[done].out >= start || (*entries)[done].in > *total
+          || (done > 0 && ((*entries)[done].in < (*entries)[done - 1].in
+                           || (*entries)[done].out <= (*entries)[done - 1].out))) {
+        break;
+      }
+    }
+    if (i < length / ENTRYSIZE) {
+      break;
+    }
+    position += used;
+  }
+  if (done < number || (0 == number && *total > 0) || (number > 0 && 0 != (*entries)[0].in)) {
+    free(*entries);
+    *entries = NULL;
+    errno = EINVAL;
+    return false;
+  }
+  *count = (size_t)number;
+  return true;
+}
+
+bool logCompressInflate(unsigned char const * const frame, size_t const available,
+                        unsigned char * const out, size_t const outSize) {
+  z_stream stream;
+  int result;
+
+  memset(&stream, 0, sizeof(stream));
+  if (Z_OK != inflateInit2(&stream, GZIPWINDOWBITS)) {
+    return false;
+  }
+  stream.next_in = (unsigned char *)frame;
+  stream.avail_in = available > UINT_MAX ? UINT_MAX : (uInt)available;
+  stream.next_out = out;
+  stream.avail_out = (uInt)outSize;
+  result = inflate(&stream, Z_FINISH);
+  inflateEnd(&stream);
+  return Z_STREAM_END == result && 0 == stream.avail_out;
+}
+
+unsigned char *logCompressInflateAll(unsigned char const * const file,
+                                     size_t const size, size_t * const length) {
+  size_t capacity = size > 0 ? 4 * size : 1;
+  unsigned char *out = malloc(capacity);
+  z_stream stream;
+  size_t position = 0;
+
+  *length = 0;
+  if (NULL == out) {
+    return NULL;
+  }
+  memset(&stream, 0, sizeof(stream));
+  if (Z_OK != inflateInit2(&stream, GZIPWINDOWBITS)) {
+    free(out);
+    return NULL;
+  }
+  while (position < size && size - position >= 2
+         && 0x1f == file[position] && 0x8b == file[position + 1]) {
+    int result;
+
+    stream.next_in = (unsigned char *)file + position;
+    stream.avail_in = size - position > UINT_MAX ? UINT_MAX : (uInt)(size - position);
+    do {
+      if (*length == capacity) {
+        unsigned char * const grown = realloc(out, 2 * capacity);
+        if (NULL == grown) {
+          inflateEnd(&stream);
+          free(out);
+          return NULL;
+        }
+        out = grown;
+        capacity *= 2;
+      }
+      stream.next_out = out + *length;
+      stream.avail_out = capacity - *length > UINT_MAX ? UINT_MAX
+                                                       : (uInt)(capacity - *length);
+      result = inflate(&stream, Z_NO_FLUSH);
+      *length = (size_t)(stream.next_out - out);
+    } while (Z_OK == result);
+    position = (size_t)(stream.next_in - file);
+    if (Z_STREAM_END != result) {
+      /* cut short or broken, keep what came out */
+      break;
+    }
+    inflateReset(&stream);
+  }
+  inflateEnd(&stream);
+  return out;
+}
+
+#else
+
+struct logCompress *logCompressOpen(int const fd, int const level,
+                                    size_t const frameSize) {
+  errno = ENOSYS;
+  return NULL;
+}
+
+bool logCompressWritev(struct logCompress * const compress, unsigned long long const time,
+                       struct iovec const * const vector, int const count) {
+  errno = ENOSYS;
+  return false;
+}
+
+bool logCompressFrame(struct logCompress * const compress) {
+  return true;
+}
+
+unsigned char *logCompressDeflate(int const level, void const * const data,
+                                  size_t const size, size_t * const length) {
+  errno = ENOSYS;
+  return NULL;
+}
+
+bool logCompressAppend(struct logCompress * const compress, unsigned long long const time,
+                       unsigned char const * const frame, size_t const length,
+                       size_t const size) {
+  errno = ENOSYS;
+  return false;
+}
+
+bool logCompressFooter(struct logCompress const * const compress, int const fd) {
+  errno = ENOSYS;
+  return false;
+}
+
+bool logCompressClose(struct logCompress * const compress) {
+  return true;
+}
+
+bool logCompressReadFooter(unsigned char const * const file, size_t const size,
+                           struct logCompressEntry ** const entries,
+                           size_t * const count, unsigned long long * const total) {
+  errno = ENOSYS;
+  return false;
+}
+
+bool logCompressInflate(unsigned char const * const frame, size_t const available,
+                        unsigned char * const out, size_t const outSize) {
+  return false;
+}
+
+unsigned char *logCompressInflateAll(unsigned char const * const file,
+                                     size_t const size, size_t * const length) {
+  errno = ENOSYS;
+  return NULL;
+}
+
+#endif
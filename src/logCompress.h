@@ -0,0 +1,173 @@
+/*
+  Header for the streaming compression of the session logfile.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef LOGCOMPRESS_H
+#define LOGCOMPRESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+/**
+ * The default compression level, zlib's 1 (fastest) to 9 (best).
+ */
+#define LOGCOMPRESSLEVEL 6
+
+/**
+ * The default size of a frame before compression.
+ */
+#define LOGCOMPRESSFRAMESIZE 262144
+
+/**
+ * A compressed logfile ends with a footer that indexes its frames.
+ * The footer is a series of empty gzip members, gzip reads past it.
+ * Their extra field holds subfield "RI" with index entries, three 64
+ * bit little endian numbers each: where the frame starts in the
+ * uncompressed and in the compressed logfile and the time of its
+ * first write in microseconds since the epoch. The last member, the
+ * trailer, has this size and subfield "RT" with the offset of the
+ * first index member, the number of entries and the uncompressed size
+ * of the logfile.
+ */
+#define LOGCOMPRESSTRAILERSIZE 50
+
+/**
+ * One frame in the footer.
+ */
+struct logCompressEntry {
+  /** offset of the frame in the uncompressed logfile */
+  unsigned long long in;
+  /** offset of its gzip member in the compressed logfile */
+  unsigned long long out;
+  /** the time of the first write into it */
+  unsigned long long time;
+};
+
+struct logCompress;
+
+/**
+ * Start compressing into a logfile. The output is a series of gzip
+ * members, frames, which gzip reads as one file. Each frame can be
+ * decompressed on its own, a crash only loses the frame that was not
+ * ended yet.
+ *
+ * @param fd the logfile, written with write(2) from its current end
+ * @param level 1 to 9
+ * @param frameSize a frame ends after the write that fills it up to
+ *        this many bytes, so a write is never split between frames
+ * @return NULL if out of memory or rootsh was built without zlib,
+ * errno is set
+ */
+struct logCompress *logCompressOpen(int const fd, int const level,
+                                    size_t const frameSize);
+
+/**
+ * Compress data into the current frame, it starts one if needed.
+ * Compressed output is written as it comes, the end of the frame
+ * waits for logCompressFrame or for the frame size.
+ *
+ * @param time goes into the index if the write starts a frame
+ * @return false on error, errno is set
+ */
+bool logCompressWritev(struct logCompress * const compress, unsigned long long const time,
+                       struct iovec const * const vector, int const count);
+
+/**
+ * End the current frame and write the rest of it, nothing happens
+ * if no data came since the last frame.
+ *
+ * @return false on error, errno is set
+ */
+bool logCompressFrame(struct logCompress * const compress);
+
+/**
+ * Compress one frame into memory. A writer that compresses its frames
+ * in parallel hands them to logCompressAppend in order.
+ *
+ * @param size the length of data
+ * @param length gets the length of the frame
+ * @return the frame, a gzip member, free(3) it, NULL on error with
+ *         errno set
+ */
+unsigned char *logCompressDeflate(int const level, void const * const data,
+                                  size_t const size, size_t * const length);
+
+/**
+ * Write a frame compressed by logCompressDeflate to the logfile and
+ * index it. The current frame has to be ended.
+ *
+ * @param time the time of the first record in the frame
+ * @param size the length of the frame before compression
+ * @return false on error, errno is set
+ */
+bool logCompressAppend(struct logCompress * const compress, unsigned long long const time,
+                       unsigned char const * const frame, size_t const length,
+                       size_t const size);
+
+/**
+ * Write the footer of the frames written so far to fd, the logfile
+ * or a copy of it. The current frame has to be ended.
+ *
+ * @return false on error, errno is set
+ */
+bool logCompressFooter(struct logCompress const * const compress, int const fd);
+
+/**
+ * End the current frame, write the footer and free compress.
+ *
+ * @return false if something could not be written, errno is set
+ */
+bool logCompressClose(struct logCompress * const compress);
+
+/**
+ * Read the footer of a compressed logfile.
+ *
+ * @param file the whole logfile
+ * @param entries gets the frames, free(3) them
+ * @param total gets the size of the uncompressed logfile
+ * @return false if there is no footer (errno is ENOENT, the session
+ *         did not end) or no memory
+ */
+bool logCompressReadFooter(unsigned char const * const file, size_t const size,
+                           struct logCompressEntry ** const entries,
+                           size_t * const count, unsigned long long * const total);
+
+/**
+ * Decompress one frame.
+ *
+ * @param frame the frame's gzip member and whatever follows
+ * @param out gets exactly outSize bytes
+ * @return false if the frame is broken or has another size
+ */
+bool logCompressInflate(unsigned char const * const frame, size_t const available,
+                        unsigned char * const out, size_t const outSize);
+
+/**
+ * Decompress all frames of a logfile without a footer, like zcat.
+ * A frame cut short by a crash is decompressed as far as it goes.
+ *
+ * @param length gets the length of the result
+ * @return the uncompressed logfile, free(3) it, NULL on error
+ */
+unsigned char *logCompressInflateAll(unsigned char const * const file,
+                                     size_t const size, size_t * const length);
+
+#endif
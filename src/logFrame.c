@@ -0,0 +1,317 @@
+/*
+  The framed logfile format. Every piece of the session is a record
+  with its time and the stream it came from, so a session can be
+  replayed at its own speed. A sparse index next to the logfile maps
+  time to file offsets, a reader finds a point in time of a large
+  session with a binary search instead of reading it all.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "logFrame.h"
+#include "util.h"
+
+/*
+//  A varint holds 7 bits per byte, the high bit says more follow.
+*/
+#define VARINTSIZE 10
+
+static size_t putVarint(unsigned char *buffer, unsigned long long value) {
+  size_t length = 0;
+
+  while (value >= 0x80) {
+    buffer[length++] = (unsigned char)(value | 0x80);
+    value >>= 7;
+  }
+  buffer[length++] = (unsigned char)value;
+  return length;
+}
+
+/*
+//  Returns the length of the varint, 0 if it goes on past available
+//  and -1 if it is too long.
+*/
+static ssize_t getVarint(unsigned char const *buffer, size_t const available,
+                         unsigned long long * const value) {
+  size_t length;
+
+  *value = 0;
+  for (length = 0; length < available; ++length) {
+    if (VARINTSIZE == length) {
+      return -1;
+    }
+    *value |= (unsigned long long)(buffer[length] & 0x7f) << (7 * length);
+    if (0 == (buffer[length] & 0x80)) {
+      return (ssize_t)length + 1;
+    }
+  }
+  return VARINTSIZE == length ? -1 : 0;
+}
+
+/*
+//  Write all of the vector, regular files seldom take less.
+*/
+static bool writeAllv(int const fd, struct iovec *vector, int count) {
+  while (count > 0) {
+    ssize_t written = writev(fd, vector, count);
+    if (written < 0 && EINTR == errno) {
+      continue;
+    } else if (written <= 0) {
+      if (0 == written) {
+        errno = EIO;
+      }
+      return false;
+    }
+    while (count > 0 && (size_t)written >= vector->iov_len) {
+      written -= vector->iov_len;
+      ++vector;
+      --count;
+    }
+    if (count > 0) {
+      vector->iov_base = (char *)vector->iov_base + written;
+      vector->iov_len -= written;
+    }
+  }
+  return true;
+}
+
+/*
+//  The logfile goes through the compression if there is one, the
+//  index never does.
+*/
+static bool writeLog(struct logFrame const * const frame, unsigned long long const time,
+                     struct iovec *vector, int const count) {
+  if (NULL != frame->compress) {
+    return logCompressWritev(frame->compress, time, vector, count);
+  }
+  return writeAllv(frame->fd, vector, count);
+}
+
+static void fillHeader(unsigned char * const header, char const * const magic,
+                       unsigned long long const start) {
+  memcpy(header, magic, 8);
+  utilPut64(header + 8, start);
+}
+
+bool logFrameOpen(struct logFrame * const frame, int const fd,
+                  struct logCompress * const compress, int const indexFd,
+                  unsigned long long const start, unsigned long long const interval) {
+  unsigned char header[LOGFRAMEHEADERSIZE];
+  struct iovec vector;
+
+  frame->fd = fd;
+  frame->compress = compress;
+  frame->indexFd = indexFd;
+  frame->time = start;
+  frame->offset = LOGFRAMEHEADERSIZE;
+  frame->indexed = 0;
+  frame->interval = interval;
+  frame->anyIndexed = false;
+  vector.iov_base = header;
+  vector.iov_len = sizeof(header);
+  fillHeader(header, LOGFRAMEMAGIC, start);
+  if (!writeLog(frame, start, &vector, 1)) {
+    return false;
+  }
+  fillHeader(header, LOGFRAMEINDEXMAGIC, start);
+  vector.iov_base = header;
+  vector.iov_len = sizeof(header);
+  if (indexFd >= 0 && !writeAllv(indexFd, &vector, 1)) {
+    return false;
+  }
+  return true;
+}
+
+size_t logFrameEncode(unsigned char * const header, unsigned long long const delta,
+                      enum logStream const stream, unsigned long long const length) {
+  size_t used = putVarint(header, delta);
+
+  header[used++] = (unsigned char)stream;
+  used += putVarint(header + used, length);
+  return used;
+}
+
+ssize_t logFrameDecode(unsigned char const * const buffer, size_t const available,
+                       unsigned long long * const delta, enum logStream * const stream,
+                       unsigned long long * const length) {
+  ssize_t const deltaLength = getVarint(buffer, available, delta);
+  ssize_t lengthLength;
+
+  if (deltaLength <= 0) {
+    return deltaLength;
+  }
+  if ((size_t)deltaLength == available) {
+    return 0;
+  }
+  if (buffer[deltaLength] > LOGSTREAM_META) {
+    return -1;
+  }
+  *stream = (enum logStream)buffer[deltaLength];
+  lengthLength = getVarint(buffer + deltaLength + 1, available - deltaLength - 1, length);
+  if (lengthLength <= 0) {
+    return lengthLength;
+  }
+  return deltaLength + 1 + lengthLength;
+}
+
+ssize_t logFrameWrite(struct logFrame * const frame, enum logStream const stream,
+                      unsigned long long time, char const * const data,
+                      size_t const length) {
+  unsigned char header[LOGFRAMEMAXRECORDHEADER];
+  struct iovec vector[2];
+  size_t headerLength;
+
+  if (time < frame->time) {
+    time = frame->time;
+  }
+  /*
+  //  The entry goes in before the record, a reader may find an entry
+  //  whose record never made it to the disk but no record is missed.
+  */
+  if (frame->indexFd >= 0
+      && (!frame->anyIndexed || frame->offset - frame->indexed >= frame->interval)) {
+    unsigned char entry[LOGFRAMEENTRYSIZE];
+    struct iovec entryVector;
+
+    utilPut64(entry, time);
+    utilPut64(entry + 8, frame->offset);
+    entryVector.iov_base = entry;
+    entryVector.iov_len = sizeof(entry);
+    if (writeAllv(frame->indexFd, &entryVector, 1)) {
+      frame->indexed = frame->offset;
+      frame->anyIndexed = true;
+    }
+  }
+  headerLength = logFrameEncode(header, time - frame->time, stream, length);
+  vector[0].iov_base = header;
+  vector[0].iov_len = headerLength;
+  vector[1].iov_base = (char *)data;
+  vector[1].iov_len = length;
+  if (!writeLog(frame, time, vector, 2)) {
+    return -1;
+  }
+  frame->time = time;
+  frame->offset += headerLength + length;
+  return (ssize_t)(headerLength + length);
+}
+
+bool logFrameStart(unsigned char const * const header, char const * const magic,
+                   unsigned long long * const start) {
+  if (0 != memcmp(header, magic, 8)) {
+    return false;
+  }
+  *start = utilGet64(header + 8);
+  return true;
+}
+
+static bool readEntry(int const indexFd, off_t const position,
+                      unsigned char * const buffer, size_t const size) {
+  size_t done = 0;
+
+  while (done < size) {
+    ssize_t const n = pread(indexFd, buffer + done, size - done, position + (off_t)done);
+    if (n < 0 && EINTR == errno) {
+      continue;
+    } else if (n <= 0) {
+      if (0 == n) {
+        errno = EINVAL;
+      }
+      return false;
+    }
+    done += n;
+  }
+  return true;
+}
+
+/*
+//  The binary search of logFrameSeek and logFrameSeekOffset, field
+//  is 0 for the time of the entries and 8 for the offset.
+*/
+static bool seekEntry(int const indexFd, int const field, unsigned long long const value,
+                      unsigned long long * const offset,
+                      unsigned long long * const recordTime) {
+  unsigned char buffer[LOGFRAMEHEADERSIZE];
+  unsigned long long start;
+  off_t end;
+  size_t low, high;
+
+  if (!readEntry(indexFd, 0, buffer, sizeof(buffer))) {
+    return false;
+  }
+  if (!logFrameStart(buffer, LOGFRAMEINDEXMAGIC, &start)) {
+    errno = EINVAL;
+    return false;
+  }
+  if ((end = lseek(indexFd, 0, SEEK_END)) < 0) {
+    return false;
+  }
+  /*
+  //  An entry cut short by a crash is left out. The first record
+  //  always has an entry, it is the answer if all are later.
+  */
+  low = 0;
+  high = (size_t)((end - LOGFRAMEHEADERSIZE) / LOGFRAMEENTRYSIZE);
+  if (0 == high) {
+    errno = ENOENT;
+    return false;
+  }
+  {
+    unsigned char entry[LOGFRAMEENTRYSIZE];
+    if (!readEntry(indexFd, LOGFRAMEHEADERSIZE, entry, sizeof(entry))) {
+      return false;
+    }
+    *recordTime = utilGet64(entry);
+    *offset = utilGet64(entry + 8);
+  }
+  while (low < high) {
+    size_t const middle = low + (high - low) / 2;
+    unsigned char entry[LOGFRAMEENTRYSIZE];
+
+    if (!readEntry(indexFd, LOGFRAMEHEADERSIZE + (off_t)middle * LOGFRAMEENTRYSIZE,
+                   entry, sizeof(entry))) {
+      return false;
+    }
+    if (utilGet64(entry + field) <= value) {
+      *recordTime = utilGet64(entry);
+      *offset = utilGet64(entry + 8);
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return true;
+}
+
+bool logFrameSeek(int const indexFd, unsigned long long const time,
+                  unsigned long long * const offset,
+                  unsigned long long * const recordTime) {
+  return seekEntry(indexFd, 0, time, offset, recordTime);
+}
+
+bool logFrameSeekOffset(int const indexFd, unsigned long long const position,
+                        unsigned long long * const offset,
+                        unsigned long long * const recordTime) {
+  return seekEntry(indexFd, 8, position, offset, recordTime);
+}
@@ -0,0 +1,167 @@
+/*
+  Header for the framed logfile format and its time index.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef LOGFRAME_H
+#define LOGFRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "logStream.h"
+#include "logCompress.h"
+
+/**
+ * A framed logfile starts with this magic and the start time as 64
+ * bit little endian microseconds since the epoch. Then the records
+ * follow: the time since the previous record (or the start) in
+ * microseconds as varint, the logStream as one byte, the length of
+ * the data as varint and the data.
+ */
+#define LOGFRAMEMAGIC "RSHLOG1\n"
+
+/**
+ * The index <logfile>.idx starts with this magic and the same start
+ * time. Then entries follow, each the time and the offset of a record
+ * as 64 bit little endian numbers, both only grow.
+ */
+#define LOGFRAMEINDEXMAGIC "RSHIDX1\n"
+
+/**
+ * Size of the file headers and of an index entry.
+ */
+#define LOGFRAMEHEADERSIZE 16
+#define LOGFRAMEENTRYSIZE 16
+
+/**
+ * A record header is never longer than this.
+ */
+#define LOGFRAMEMAXRECORDHEADER 21
+
+/**
+ * Default distance of the index entries in bytes of logfile.
+ */
+#define LOGFRAMEINDEXINTERVAL 65536
+
+/**
+ * The writing side of one framed logfile.
+ */
+struct logFrame {
+  /** the logfile */
+  int fd;
+  /** compresses the logfile, NULL if it is plain */
+  struct logCompress *compress;
+  /** its index, -1 for none */
+  int indexFd;
+  /** the time of the last record */
+  unsigned long long time;
+  /** where the next record starts */
+  unsigned long long offset;
+  /** where the last indexed record starts */
+  unsigned long long indexed;
+  /** bytes between index entries */
+  unsigned long long interval;
+  /** false until the first entry is written */
+  bool anyIndexed;
+};
+
+/**
+ * Write the headers of a new logfile and its index.
+ *
+ * @param frame set up for logFrameWrite
+ * @param fd the empty logfile
+ * @param compress compresses what goes to fd, NULL for none
+ * @param indexFd the empty index, -1 for none. Its offsets are those
+ *        of the uncompressed logfile.
+ * @param start the start time in microseconds since the epoch
+ * @param interval bytes of logfile between index entries
+ * @return false if a header could not be written, errno is set
+ */
+bool logFrameOpen(struct logFrame * const frame, int const fd,
+                  struct logCompress * const compress, int const indexFd,
+                  unsigned long long const start, unsigned long long const interval);
+
+/**
+ * Write one record with a single writev, after an index entry if one
+ * is due.
+ *
+ * @param time microseconds since the epoch, an earlier time than the
+ *        last record's counts as the same
+ * @return the bytes written to the logfile including the record
+ *         header, -1 on error
+ */
+ssize_t logFrameWrite(struct logFrame * const frame, enum logStream const stream,
+                      unsigned long long const time, char const * const data,
+                      size_t const length);
+
+/**
+ * Put a record header into header, which has room for
+ * LOGFRAMEMAXRECORDHEADER bytes.
+ *
+ * @return the length of the header
+ */
+size_t logFrameEncode(unsigned char * const header, unsigned long long const delta,
+                      enum logStream const stream, unsigned long long const length);
+
+/**
+ * Read a record header.
+ *
+ * @param available how many bytes there are at buffer
+ * @return the length of the header, 0 if it needs more bytes, -1 if
+ *         it is broken
+ */
+ssize_t logFrameDecode(unsigned char const * const buffer, size_t const available,
+                       unsigned long long * const delta, enum logStream * const stream,
+                       unsigned long long * const length);
+
+/**
+ * Read the start time from the header of a logfile or an index.
+ *
+ * @param magic LOGFRAMEMAGIC or LOGFRAMEINDEXMAGIC
+ * @return false if header is no such header
+ */
+bool logFrameStart(unsigned char const * const header, char const * const magic,
+                   unsigned long long * const start);
+
+/**
+ * Find the last indexed record not later than time with a binary
+ * search over the index.
+ *
+ * @param offset gets the offset of the record in the logfile, the
+ *        first record if all are later
+ * @param recordTime gets the time of that record, the delta in its
+ *        header doesn't count
+ * @return false if the index can't be read or has no entry, errno is
+ *         set
+ */
+bool logFrameSeek(int const indexFd, unsigned long long const time,
+                  unsigned long long * const offset,
+                  unsigned long long * const recordTime);
+
+/**
+ * Like logFrameSeek, find the last indexed record which starts not
+ * after position in the logfile.
+ */
+bool logFrameSeekOffset(int const indexFd, unsigned long long const position,
+                        unsigned long long * const offset,
+                        unsigned long long * const recordTime);
+
+#endif
@@ -0,0 +1,446 @@
+/*
+  Queue between the session relay and the logger thread.
+
+  The relay copies every chunk of output into a single producer,
+  single consumer ring buffer and goes back to the terminal. A logger
+  thread takes the data out and passes it to one log sink, so a slow
+  disk or a slow syslog daemon doesn't delay the user's echo. Every
+  sink has a queue and a thread of its own, see sink.c.
+  Neither side takes a lock to move data, the mutexes are only used
+  to sleep when there is nothing to do.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#if HAVE_PTHREAD_H && HAVE_STDATOMIC_H && HAVE_PTHREAD_CREATE
+#  define USE_LOGQUEUE 1
+#  include <pthread.h>
+#  include <stdatomic.h>
+#endif
+
+#include "logQueue.h"
+
+bool logQueueParseFull(char const * const value, enum logQueueFull * const policy) {
+  if(0 == strcmp("block", value)) {
+    *policy = LOGQUEUE_BLOCK;
+  } else if(0 == strcmp("spill", value)) {
+    *policy = LOGQUEUE_SPILL;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+#if USE_LOGQUEUE
+
+/*
+//  The smallest and largest queue we allocate.
+*/
+#define MINQUEUESIZE 4096
+#define MAXQUEUESIZE (64 * 1024 * 1024)
+
+/*
+//  How much the logger reads back from the spill file at once.
+*/
+#define SPILLCHUNK 65536
+
+/*
+//  ring		The buffer shared by the relay and the logger.
+//
+//  capacity		Size of ring, a power of two.
+//
+//  head		Bytes taken out so far, only written by the logger.
+//
+//  tail		Bytes put in so far, only written by the relay.
+//			The fill level is tail - head, both only grow.
+//
+//  spilling		Set by the relay when the ring was full and the
+//			data went to the spill file. Everything that
+//			follows goes there too, until the logger has read
+//			it all back and clears the flag. This keeps the
+//			output in order.
+//
+//  stopping		Set by logQueueStop, the logger exits once both
+//			the ring and the spill file are empty.
+//
+//  loggerSleeping	Set while a side waits for the other one.
+//  relaySleeping	The other side only takes wakeLock to signal
+//			when it sees the flag.
+//
+//  spillFd		The unlinked spill file, -1 until it is needed.
+//
+//  spillWritten	Offsets in the spill file, protected by spillLock.
+//  spillRead
+//
+//  stats		Only touched by the relay.
+*/
+struct logQueue {
+  char *ring;
+  size_t capacity;
+  atomic_size_t head;
+  atomic_size_t tail;
+  atomic_bool spilling;
+  atomic_bool stopping;
+  atomic_bool loggerSleeping;
+  atomic_bool relaySleeping;
+  pthread_mutex_t wakeLock;
+  pthread_cond_t loggerWake;
+  pthread_cond_t relayWake;
+  clockid_t waitClock;
+
+  pthread_mutex_t spillLock;
+  char spillName[BUFSIZ];
+  int spillFd;
+  off_t spillWritten;
+  off_t spillRead;
+  char spillBuf[SPILLCHUNK];
+
+  enum logQueueFull fullPolicy;
+  logQueueSink sink;
+  logQueueIdle idle;
+  void *context;
+  pthread_t logger;
+  struct logQueueStats stats;
+};
+
+
+static bool loggerHasWork(struct logQueue * const queue) {
+  return atomic_load(&queue->tail) != atomic_load(&queue->head)
+    || atomic_load(&queue->spilling) || atomic_load(&queue->stopping);
+}
+
+static bool relayCanPush(struct logQueue * const queue) {
+  return !atomic_load(&queue->spilling)
+    && atomic_load(&queue->tail) - atomic_load(&queue->head) < queue->capacity;
+}
+
+/*
+//  Sleep until ready() holds or timeoutMs (-1 forever) passed. The flag
+//  is set before ready() is checked and the other side changes its
+//  state before it checks the flag, so one of us always sees the other.
+*/
+static void sleepUntil(struct logQueue * const queue, atomic_bool * const sleeping,
+                       pthread_cond_t * const cond,
+                       bool (* const ready)(struct logQueue *), int const timeoutMs) {
+  struct timespec deadline;
+
+  if(timeoutMs >= 0) {
+    clock_gettime(queue->waitClock, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+    if(deadline.tv_nsec >= 1000000000L) {
+      ++deadline.tv_sec;
+      deadline.tv_nsec -= 1000000000L;
+    }
+  }
+  pthread_mutex_lock(&queue->wakeLock);
+  atomic_store(sleeping, true);
+  while(!ready(queue)) {
+    if(timeoutMs < 0) {
+      pthread_cond_wait(cond, &queue->wakeLock);
+    } else if(ETIMEDOUT == pthread_cond_timedwait(cond, &queue->wakeLock, &deadline)) {
+      break;
+    }
+  }
+  atomic_store(sleeping, false);
+  pthread_mutex_unlock(&queue->wakeLock);
+}
+
+/*
+//  Timed waits should not jump with the wall clock.
+*/
+static void initConditions(struct logQueue * const queue) {
+  pthread_condattr_t attributes;
+
+  queue->waitClock = CLOCK_REALTIME;
+  pthread_condattr_init(&attributes);
+#if defined(CLOCK_MONOTONIC) && HAVE_PTHREAD_CONDATTR_SETCLOCK
+  if(0 == pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC)) {
+    queue->waitClock = CLOCK_MONOTONIC;
+  }
+#endif
+  pthread_mutex_init(&queue->wakeLock, NULL);
+  pthread_mutex_init(&queue->spillLock, NULL);
+  pthread_cond_init(&queue->loggerWake, &attributes);
+  pthread_cond_init(&queue->relayWake, &attributes);
+  pthread_condattr_destroy(&attributes);
+}
+
+static void destroyConditions(struct logQueue * const queue) {
+  pthread_cond_destroy(&queue->relayWake);
+  pthread_cond_destroy(&queue->loggerWake);
+  pthread_mutex_destroy(&queue->spillLock);
+  pthread_mutex_destroy(&queue->wakeLock);
+}
+
+static void wake(struct logQueue * const queue, atomic_bool * const sleeping,
+                 pthread_cond_t * const cond) {
+  if(atomic_load(sleeping)) {
+    pthread_mutex_lock(&queue->wakeLock);
+    pthread_cond_signal(cond);
+    pthread_mutex_unlock(&queue->wakeLock);
+  }
+}
+
+/*
+//  Append to the spill file and switch to spilling.
+//  Returns false if the data could not be written.
+*/
+static bool spillAppend(struct logQueue * const queue, char const * const msgbuf,
+                        size_t const msglen) {
+  size_t done = 0;
+
+  pthread_mutex_lock(&queue->spillLock);
+  if(queue->spillFd < 0) {
+    if((queue->spillFd = mkstemp(queue->spillName)) < 0) {
+      perror(queue->spillName);
+      pthread_mutex_unlock(&queue->spillLock);
+      return false;
+    }
+    unlink(queue->spillName);
+  }
+  while(done < msglen) {
+    ssize_t const n = pwrite(queue->spillFd, msgbuf + done, msglen - done,
+                             queue->spillWritten + (off_t)done);
+    if(n < 0 && EINTR == errno) {
+      continue;
+    } else if(n <= 0) {
+      /* spillWritten is unchanged, whatever we wrote gets overwritten */
+      perror("Error writing to spill file");
+      pthread_mutex_unlock(&queue->spillLock);
+      return false;
+    }
+    done += n;
+  }
+  queue->spillWritten += (off_t)msglen;
+  atomic_store(&queue->spilling, true);
+  pthread_mutex_unlock(&queue->spillLock);
+  queue->stats.spilled += msglen;
+  return true;
+}
+
+/*
+//  Give the next chunk of the spill file to the sink. Once everything
+//  is read back, the file is emptied and the relay may use the ring
+//  again.
+*/
+static void spillDrain(struct logQueue * const queue) {
+  off_t available;
+  ssize_t n;
+
+  pthread_mutex_lock(&queue->spillLock);
+  available = queue->spillWritten - queue->spillRead;
+  if(0 == available) {
+    if(ftruncate(queue->spillFd, 0) < 0) {
+      perror("Error truncating spill file");
+    }
+    queue->spillWritten = queue->spillRead = 0;
+    atomic_store(&queue->spilling, false);
+    pthread_mutex_unlock(&queue->spillLock);
+    return;
+  }
+  do {
+    n = pread(queue->spillFd, queue->spillBuf,
+              available > SPILLCHUNK ? SPILLCHUNK : (size_t)available,
+              queue->spillRead);
+  } while(n < 0 && EINTR == errno);
+  if(n <= 0) {
+    /* don't get stuck on a broken spill file, the rest is lost */
+    perror("Error reading spill file");
+    queue->spillRead = queue->spillWritten;
+  }
+  pthread_mutex_unlock(&queue->spillLock);
+
+  if(n > 0) {
+    queue->sink(queue->context, queue->spillBuf, (int)n);
+    pthread_mutex_lock(&queue->spillLock);
+    queue->spillRead += n;
+    pthread_mutex_unlock(&queue->spillLock);
+  }
+}
+
+static void *loggerMain(void *argument) {
+  struct logQueue * const queue = argument;
+
+  for(;;) {
+    /*
+    //  Look at spilling before the ring: the relay doesn't touch the
+    //  ring while it spills, so all data in the ring is older than
+    //  the data in the spill file.
+    */
+    bool const spill = atomic_load(&queue->spilling);
+    size_t const h = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t const t = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    if(t != h) {
+      size_t const offset = h & (queue->capacity - 1);
+      size_t const n = (t - h < queue->capacity - offset)
+        ? t - h : queue->capacity - offset;
+
+      queue->sink(queue->context, queue->ring + offset, (int)n);
+      atomic_store(&queue->head, h + n);
+      wake(queue, &queue->relaySleeping, &queue->relayWake);
+    } else if(spill) {
+      spillDrain(queue);
+      wake(queue, &queue->relaySleeping, &queue->relayWake);
+    } else if(atomic_load(&queue->stopping)) {
+      break;
+    } else {
+      int const timeoutMs = NULL == queue->idle ? -1 : queue->idle(queue->context);
+      sleepUntil(queue, &queue->loggerSleeping, &queue->loggerWake, loggerHasWork,
+                 timeoutMs);
+    }
+  }
+  return NULL;
+}
+
+struct logQueue *logQueueStart(size_t const size, enum logQueueFull const policy,
+                               char const * const spillTemplate,
+                               logQueueSink const sink, logQueueIdle const idle,
+                               void * const context) {
+  struct logQueue *queue;
+  sigset_t allSignals, oldMask;
+  int error;
+
+  if(NULL == (queue = calloc(1, sizeof(*queue)))) {
+    return NULL;
+  }
+  queue->capacity = MINQUEUESIZE;
+  while(queue->capacity < size && queue->capacity < MAXQUEUESIZE) {
+    queue->capacity <<= 1;
+  }
+  if(NULL == (queue->ring = malloc(queue->capacity))) {
+    free(queue);
+    return NULL;
+  }
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+  atomic_init(&queue->spilling, false);
+  atomic_init(&queue->stopping, false);
+  atomic_init(&queue->loggerSleeping, false);
+  atomic_init(&queue->relaySleeping, false);
+  snprintf(queue->spillName, sizeof(queue->spillName), "%s", spillTemplate);
+  queue->spillFd = -1;
+  queue->fullPolicy = policy;
+  queue->sink = sink;
+  queue->idle = idle;
+  queue->context = context;
+  initConditions(queue);
+
+  /*
+  //  Signals are for the relay, the logger never gets one.
+  */
+  sigfillset(&allSignals);
+  pthread_sigmask(SIG_SETMASK, &allSignals, &oldMask);
+  error = pthread_create(&queue->logger, NULL, loggerMain, queue);
+  pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+  if(0 != error) {
+    destroyConditions(queue);
+    free(queue->ring);
+    free(queue);
+    errno = error;
+    return NULL;
+  }
+  return queue;
+}
+
+void logQueuePush(struct logQueue * const queue, char const * msgbuf, size_t msglen) {
+  while(msglen > 0) {
+    size_t const t = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t space, n, offset, first;
+
+    if(atomic_load(&queue->spilling)) {
+      if(spillAppend(queue, msgbuf, msglen)) {
+        wake(queue, &queue->loggerSleeping, &queue->loggerWake);
+        return;
+      }
+      /* can't spill, wait for the logger to empty the spill file */
+      ++queue->stats.blocked;
+      sleepUntil(queue, &queue->relaySleeping, &queue->relayWake, relayCanPush, -1);
+      continue;
+    }
+
+    space = queue->capacity
+      - (t - atomic_load_explicit(&queue->head, memory_order_acquire));
+    if(0 == space) {
+      if(LOGQUEUE_SPILL == queue->fullPolicy && spillAppend(queue, msgbuf, msglen)) {
+        wake(queue, &queue->loggerSleeping, &queue->loggerWake);
+        return;
+      }
+      ++queue->stats.blocked;
+      sleepUntil(queue, &queue->relaySleeping, &queue->relayWake, relayCanPush, -1);
+      continue;
+    }
+
+    n = msglen < space ? msglen : space;
+    offset = t & (queue->capacity - 1);
+    first = n < queue->capacity - offset ? n : queue->capacity - offset;
+    memcpy(queue->ring + offset, msgbuf, first);
+    memcpy(queue->ring, msgbuf + first, n - first);
+    atomic_store(&queue->tail, t + n);
+    wake(queue, &queue->loggerSleeping, &queue->loggerWake);
+
+    msgbuf += n;
+    msglen -= n;
+  }
+}
+
+void logQueueStop(struct logQueue * const queue, struct logQueueStats * const stats) {
+  atomic_store(&queue->stopping, true);
+  wake(queue, &queue->loggerSleeping, &queue->loggerWake);
+  pthread_join(queue->logger, NULL);
+
+  if(NULL != stats) {
+    *stats = queue->stats;
+  }
+  if(queue->spillFd >= 0) {
+    close(queue->spillFd);
+  }
+  destroyConditions(queue);
+  free(queue->ring);
+  free(queue);
+}
+
+#else
+/*
+//  Without threads the caller logs inline.
+*/
+struct logQueue *logQueueStart(size_t const size, enum logQueueFull const policy,
+                               char const * const spillTemplate,
+                               logQueueSink const sink, logQueueIdle const idle,
+                               void * const context) {
+  errno = ENOSYS;
+  return NULL;
+}
+
+void logQueuePush(struct logQueue * const queue, char const * msgbuf, size_t msglen) {
+}
+
+void logQueueStop(struct logQueue * const queue, struct logQueueStats * const stats) {
+}
+#endif
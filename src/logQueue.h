@@ -0,0 +1,107 @@
+/*
+  Header for the queue between the session relay and a logger thread.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef LOGQUEUE_H
+#define LOGQUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * What the relay does when the logger thread fell so far behind
+ * that the queue is full.
+ */
+enum logQueueFull {
+  /** wait for the logger, the session stalls like without a queue */
+  LOGQUEUE_BLOCK,
+  /** append to a spill file which the logger reads back in order */
+  LOGQUEUE_SPILL
+};
+
+/**
+ * What happened to the relay side of a queue.
+ */
+struct logQueueStats {
+  /** how often the relay waited for the logger */
+  unsigned long long blocked;
+  /** bytes that went through the spill file */
+  unsigned long long spilled;
+};
+
+struct logQueue;
+
+/**
+ * Read a policy from the configuration.
+ *
+ * @param value "block" or "spill"
+ * @param policy gets the policy
+ * @return false if value is neither
+ */
+bool logQueueParseFull(char const * const value, enum logQueueFull * const policy);
+
+/**
+ * Called by the logger thread with the next piece of output.
+ */
+typedef void (*logQueueSink)(void *context, char *msgbuf, int msglen);
+
+/**
+ * Called by the logger thread when the queue is empty.
+ *
+ * @return milliseconds until it wants to be called again, -1 to sleep
+ * until there is new data
+ */
+typedef int (*logQueueIdle)(void *context);
+
+/**
+ * Start a logger thread. Only one thread may call logQueuePush on the
+ * queue.
+ *
+ * @param size capacity of the queue in bytes, rounded up to a power of two
+ * @param policy what to do when the queue is full
+ * @param spillTemplate mkstemp(3) template for the spill file, it is
+ * only created when needed and unlinked right away
+ * @param sink gets the data in the order it was pushed
+ * @param idle may be NULL
+ * @param context passed to sink and idle
+ * @return NULL if the thread could not be started, the caller has
+ * to log inline then
+ */
+struct logQueue *logQueueStart(size_t const size, enum logQueueFull const policy,
+                               char const * const spillTemplate,
+                               logQueueSink const sink, logQueueIdle const idle,
+                               void * const context);
+
+/**
+ * Hand data to the logger thread. Returns as soon as the data is
+ * copied, unless the queue is full and the policy is to block.
+ */
+void logQueuePush(struct logQueue * const queue, char const * const msgbuf,
+                  size_t const msglen);
+
+/**
+ * Let the logger thread write everything that is still queued, wait
+ * for it to finish and free the queue.
+ *
+ * @param stats gets the counters of the queue, may be NULL
+ */
+void logQueueStop(struct logQueue * const queue, struct logQueueStats * const stats);
+
+#endif
@@ -0,0 +1,41 @@
+/*
+  Header for the streams a session's log is made of.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef LOGSTREAM_H
+#define LOGSTREAM_H
+
+/**
+ * Where a piece of logged data came from. A pty session only has
+ * LOGSTREAM_OUT, the pty echoes the input into it. A batch session
+ * runs the shell over pipes and keeps the three apart.
+ */
+enum logStream {
+  /** what was passed to the shell's stdin */
+  LOGSTREAM_IN,
+  /** the shell's stdout, or everything the pty showed */
+  LOGSTREAM_OUT,
+  /** the shell's stderr */
+  LOGSTREAM_ERR,
+  /** rootsh's own messages */
+  LOGSTREAM_META
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*
+  Generates the transition table of the escape filter.
+
+  Runs the reference state machines for every state and byte and
+  writes the result to stdout as a C header. Run by the build.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "escReference.h"
+
+/*
+//  Print one row of a table, 256 entries.
+*/
+static void printRow(unsigned char const * const row, bool const last) {
+  int chr;
+  printf("  {");
+  for (chr = 0; chr < 256; ++chr) {
+    printf("%s0x%02x%s", (chr % 12) ? " " : "\n    ", (unsigned int)row[chr],
+           chr < 255 ? "," : "");
+  }
+  printf("\n  }%s\n", last ? "" : ",");
+}
+
+/*
+//  The UTF-8 machine has an escape state and a decoder state. Only
+//  the pairs reachable from the start get a number, the start is 0.
+*/
+static int utf8Ids[ESCSTATES][UTF8WAITS];
+static int utf8States = 0;
+static enum escState utf8Esc[ESCSTATES * UTF8WAITS];
+static enum utf8Wait utf8Wait[ESCSTATES * UTF8WAITS];
+
+static int utf8Id(enum escState const state, enum utf8Wait const wait) {
+  if (utf8Ids[state][wait] < 0) {
+    utf8Ids[state][wait] = utf8States;
+    utf8Esc[utf8States] = state;
+    utf8Wait[utf8States] = wait;
+    ++utf8States;
+  }
+  return utf8Ids[state][wait];
+}
+
+int main(int argc, char **argv) {
+  static unsigned char utf8Table[ESCSTATES * UTF8WAITS][256];
+  unsigned char row[256];
+  int state, wait, chr, id;
+
+  printf("/* generated by mkEscTable, do not edit */\n\n");
+  printf("/*\n"
+         "//  Indexed by state and byte: the next state in the low bits,\n"
+         "//  ESCKEEP if the byte is kept, ESCHELD if a C2 that was held\n"
+         "//  back goes out before it (UTF-8 only).\n"
+         "*/\n");
+  printf("#define ESCKEEP 0x80\n");
+  printf("#define ESCHELD 0x40\n");
+  printf("#define ESCSTATEMASK 0x3F\n\n");
+
+  printf("#define ESCTABLESTATES %d\n\n", (int)ESCSTATES);
+  printf("static unsigned char const escTable[ESCTABLESTATES][256] = {\n");
+  for (state = 0; state < ESCSTATES; ++state) {
+    for (chr = 0; chr < 256; ++chr) {
+      enum escState next = (enum escState)state;
+      bool const kept = escReferenceStep(&next, chr);
+      row[chr] = (unsigned char)next | (kept ? 0x80 : 0);
+    }
+    printRow(row, state == ESCSTATES - 1);
+  }
+  printf("};\n\n");
+
+  /*
+  //  Number the states breadth first while filling the table.
+  */
+  for (state = 0; state < ESCSTATES; ++state) {
+    for (wait = 0; wait < UTF8WAITS; ++wait) {
+      utf8Ids[state][wait] = -1;
+    }
+  }
+  utf8Id(Normal, UTF8_NONE);
+  for (id = 0; id < utf8States; ++id) {
+    for (chr = 0; chr < 256; ++chr) {
+      enum escState next = utf8Esc[id];
+      enum utf8Wait nextWait = utf8Wait[id];
+      int const step = escReferenceStepUtf8(&next, &nextWait, chr);
+      int const nextId = utf8Id(next, nextWait);
+      if (nextId > 0x3F) {
+        fprintf(stderr, "mkEscTable: too many UTF-8 states\n");
+        return EXIT_FAILURE;
+      }
+      utf8Table[id][chr] = (unsigned char)nextId
+        | ((step & ESCSTEP_KEPT) ? 0x80 : 0)
+        | ((step & ESCSTEP_HELD) ? 0x40 : 0);
+    }
+  }
+  printf("#define ESCUTF8STATES %d\n\n", utf8States);
+  printf("static unsigned char const escTableUtf8[ESCUTF8STATES][256] = {\n");
+  for (id = 0; id < utf8States; ++id) {
+    printRow(utf8Table[id], id == utf8States - 1);
+  }
+  printf("};\n");
+  return ferror(stdout) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
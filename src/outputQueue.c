@@ -0,0 +1,105 @@
+/*
+  Bounded output queues of the session relay.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "outputQueue.h"
+
+bool outputQueueInit(struct outputQueue * const queue, size_t const capacity) {
+  queue->head = 0;
+  queue->length = 0;
+  queue->capacity = capacity;
+  queue->data = malloc(capacity);
+  return NULL != queue->data;
+}
+
+size_t outputQueueSpace(struct outputQueue const * const queue) {
+  return queue->capacity - queue->length;
+}
+
+bool outputQueueEmpty(struct outputQueue const * const queue) {
+  return 0 == queue->length;
+}
+
+size_t outputQueueAppend(struct outputQueue * const queue,
+                         char const * const data, size_t length) {
+  size_t tail, first;
+
+  if(length > outputQueueSpace(queue)) {
+    length = outputQueueSpace(queue);
+  }
+  tail = (queue->head + queue->length) % queue->capacity;
+  first = queue->capacity - tail;
+  if(first > length) {
+    first = length;
+  }
+  memcpy(queue->data + tail, data, first);
+  memcpy(queue->data, data + first, length - first);
+  queue->length += length;
+  return length;
+}
+
+bool outputQueueFlush(struct outputQueue * const queue, int const fd) {
+  while(queue->length > 0) {
+    struct iovec iov[2];
+    int count = 1;
+    ssize_t n;
+
+    iov[0].iov_base = queue->data + queue->head;
+    iov[0].iov_len = queue->capacity - queue->head;
+    if(iov[0].iov_len >= queue->length) {
+      iov[0].iov_len = queue->length;
+    } else {
+      iov[1].iov_base = queue->data;
+      iov[1].iov_len = queue->length - iov[0].iov_len;
+      count = 2;
+    }
+
+    if((n = writev(fd, iov, count)) < 0) {
+      if(EINTR == errno) {
+        continue;
+      }
+      return EAGAIN == errno || EWOULDBLOCK == errno;
+    }
+    queue->head = (queue->head + (size_t)n) % queue->capacity;
+    queue->length -= (size_t)n;
+  }
+  /* keep the next writes in one piece */
+  queue->head = 0;
+  return true;
+}
+
+void outputQueueClear(struct outputQueue * const queue) {
+  queue->head = 0;
+  queue->length = 0;
+}
+
+void outputQueueFree(struct outputQueue * const queue) {
+  free(queue->data);
+  queue->data = NULL;
+  queue->capacity = 0;
+  queue->length = 0;
+}
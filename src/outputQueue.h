@@ -0,0 +1,82 @@
+/*
+  Header for the bounded output queues of the session relay.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef OUTPUTQUEUE_H
+#define OUTPUTQUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+//  Data read from one side of the relay that the other side did not
+//  take yet. A ring buffer, so the data may wrap around the end.
+*/
+struct outputQueue {
+  char *data;
+  size_t capacity;
+  size_t head;
+  size_t length;
+};
+
+/**
+ * @param queue the queue to setup
+ * @param capacity the most bytes the queue holds
+ * @return false if the memory could not be allocated
+ */
+bool outputQueueInit(struct outputQueue * const queue, size_t const capacity);
+
+/**
+ * @return the number of bytes that can still be appended
+ */
+size_t outputQueueSpace(struct outputQueue const * const queue);
+
+/**
+ * @return true if nothing waits to be written
+ */
+bool outputQueueEmpty(struct outputQueue const * const queue);
+
+/**
+ * Append data, at most outputQueueSpace bytes are taken.
+ *
+ * @return the number of bytes appended
+ */
+size_t outputQueueAppend(struct outputQueue * const queue,
+                         char const * const data, size_t const length);
+
+/**
+ * Write as much as the non-blocking descriptor takes, with writev
+ * so a wrapped queue still costs a single call.
+ *
+ * @return false on an error other than EAGAIN, errno is set
+ */
+bool outputQueueFlush(struct outputQueue * const queue, int const fd);
+
+/**
+ * Forget the queued data.
+ */
+void outputQueueClear(struct outputQueue * const queue);
+
+/**
+ * Release the memory.
+ */
+void outputQueueFree(struct outputQueue * const queue);
+
+#endif
@@ -0,0 +1,283 @@
+/*
+  Search of plain text in terminal output.
+
+  Most of what a shell prints is printable ASCII. The escape filter
+  copies such runs in bulk and runs its state machine only from the
+  next control byte on. Finding the end of a run is done 16 or 32
+  bytes at a time where the CPU allows it. In UTF-8 runs also take
+  in whole, valid characters.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "plainScan.h"
+
+#if HAVE_IMMINTRIN_H && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define USE_X86_SIMD 1
+#  include <immintrin.h>
+#else
+#  define USE_X86_SIMD 0
+#endif
+
+/*
+//  Folding 0x80-0x9F onto 0x00-0x1F leaves one comparison for all
+//  controls, DEL is the only other byte that isn't plain.
+*/
+static inline bool isPlain(unsigned char const chr) {
+  return (chr & 0x7F) >= 0x20 && chr != 0x7F;
+}
+
+static size_t scanNone(char const *buffer, size_t length) {
+  return 0;
+}
+
+static size_t scanScalar(char const *buffer, size_t length) {
+  size_t i;
+  for (i = 0; i < length && isPlain((unsigned char)buffer[i]); ++i) {
+  }
+  return i;
+}
+
+/*
+//  Length of the UTF-8 character at buffer, 0 if it is invalid, cut
+//  short by the end of the buffer or a C1 control (C2 80-9F).
+*/
+static size_t utf8Length(unsigned char const *buffer, size_t const length) {
+  unsigned char const lead = buffer[0];
+  unsigned char min = 0x80, max = 0xBF;
+  size_t need, i;
+
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    need = 1;
+    if (lead == 0xC2) {
+      min = 0xA0;
+    }
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    need = 2;
+    if (lead == 0xE0) {
+      min = 0xA0;
+    } else if (lead == 0xED) {
+      max = 0x9F;
+    }
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    need = 3;
+    if (lead == 0xF0) {
+      min = 0x90;
+    } else if (lead == 0xF4) {
+      max = 0x8F;
+    }
+  } else {
+    return 0;
+  }
+  if (need >= length || buffer[1] < min || buffer[1] > max) {
+    return 0;
+  }
+  for (i = 2; i <= need; ++i) {
+    if ((buffer[i] & 0xC0) != 0x80) {
+      return 0;
+    }
+  }
+  return need + 1;
+}
+
+static size_t scanUtf8Scalar(char const *buffer, size_t length) {
+  unsigned char const * const bytes = (unsigned char const *)buffer;
+  size_t i = 0;
+
+  while (i < length) {
+    if (bytes[i] < 0x80) {
+      if (bytes[i] < 0x20 || bytes[i] == 0x7F) {
+        break;
+      }
+      ++i;
+    } else {
+      size_t const n = utf8Length(bytes + i, length - i);
+      if (n == 0) {
+        break;
+      }
+      i += n;
+    }
+  }
+  return i;
+}
+
+#if USE_X86_SIMD
+/*
+//  The same test on 16 bytes: after the masking all bytes are
+//  0-0x7F, so the signed comparison works.
+*/
+__attribute__((target("sse2")))
+static size_t scanSse2(char const *buffer, size_t length) {
+  __m128i const low7 = _mm_set1_epi8(0x7F);
+  __m128i const space = _mm_set1_epi8(0x20);
+  size_t i = 0;
+
+  for (; i + 16 <= length; i += 16) {
+    __m128i const chunk = _mm_loadu_si128((__m128i const *)(buffer + i));
+    __m128i const special =
+      _mm_or_si128(_mm_cmplt_epi8(_mm_and_si128(chunk, low7), space),
+                   _mm_cmpeq_epi8(chunk, low7));
+    int const mask = _mm_movemask_epi8(special);
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return i + scanScalar(buffer + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scanAvx2(char const *buffer, size_t length) {
+  __m256i const low7 = _mm256_set1_epi8(0x7F);
+  __m256i const space = _mm256_set1_epi8(0x20);
+  size_t i = 0;
+
+  for (; i + 32 <= length; i += 32) {
+    __m256i const chunk = _mm256_loadu_si256((__m256i const *)(buffer + i));
+    __m256i const special =
+      _mm256_or_si256(_mm256_cmpgt_epi8(space, _mm256_and_si256(chunk, low7)),
+                      _mm256_cmpeq_epi8(chunk, low7));
+    unsigned int const mask = (unsigned int)_mm256_movemask_epi8(special);
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return i + scanSse2(buffer + i, length - i);
+}
+
+/*
+//  In UTF-8 the vectors only skip printable ASCII. Signed, every byte
+//  from 0x80 on is below 0x20 too, so the first control or non-ASCII
+//  byte is found with one comparison. A character there is checked
+//  by utf8Length and skipped, then the search goes on.
+*/
+__attribute__((target("sse2")))
+static size_t scanUtf8Sse2(char const *buffer, size_t length) {
+  unsigned char const * const bytes = (unsigned char const *)buffer;
+  __m128i const del = _mm_set1_epi8(0x7F);
+  __m128i const space = _mm_set1_epi8(0x20);
+  size_t i = 0;
+
+  while (i + 16 <= length) {
+    __m128i const chunk = _mm_loadu_si128((__m128i const *)(buffer + i));
+    int const mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmplt_epi8(chunk, space),
+                                                    _mm_cmpeq_epi8(chunk, del)));
+    size_t n;
+    if (mask == 0) {
+      i += 16;
+      continue;
+    }
+    i += __builtin_ctz(mask);
+    if (bytes[i] < 0x80 || (n = utf8Length(bytes + i, length - i)) == 0) {
+      return i;
+    }
+    i += n;
+  }
+  return i + scanUtf8Scalar(buffer + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scanUtf8Avx2(char const *buffer, size_t length) {
+  unsigned char const * const bytes = (unsigned char const *)buffer;
+  __m256i const del = _mm256_set1_epi8(0x7F);
+  __m256i const space = _mm256_set1_epi8(0x20);
+  size_t i = 0;
+
+  while (i + 32 <= length) {
+    __m256i const chunk = _mm256_loadu_si256((__m256i const *)(buffer + i));
+    unsigned int const mask = (unsigned int)_mm256_movemask_epi8(
+      _mm256_or_si256(_mm256_cmpgt_epi8(space, chunk), _mm256_cmpeq_epi8(chunk, del)));
+    size_t n;
+    if (mask == 0) {
+      i += 32;
+      continue;
+    }
+    i += __builtin_ctz(mask);
+    if (bytes[i] < 0x80 || (n = utf8Length(bytes + i, length - i)) == 0) {
+      return i;
+    }
+    i += n;
+  }
+  return i + scanUtf8Sse2(buffer + i, length - i);
+}
+#endif
+
+static size_t (*scan)(char const *, size_t) = NULL;
+static size_t (*scanUtf8)(char const *, size_t) = NULL;
+static enum plainScanLevel level = PLAINSCAN_NONE;
+
+bool plainScanSelect(enum plainScanLevel const wanted) {
+  switch (wanted) {
+    case PLAINSCAN_NONE:
+      scan = scanNone;
+      scanUtf8 = scanNone;
+      break;
+    case PLAINSCAN_SCALAR:
+      scan = scanScalar;
+      scanUtf8 = scanUtf8Scalar;
+      break;
+#if USE_X86_SIMD
+    case PLAINSCAN_SSE2:
+      __builtin_cpu_init();
+      if (!__builtin_cpu_supports("sse2")) {
+        return false;
+      }
+      scan = scanSse2;
+      scanUtf8 = scanUtf8Sse2;
+      break;
+    case PLAINSCAN_AVX2:
+      __builtin_cpu_init();
+      if (!__builtin_cpu_supports("avx2")) {
+        return false;
+      }
+      scan = scanAvx2;
+      scanUtf8 = scanUtf8Avx2;
+      break;
+#endif
+    default:
+      return false;
+  }
+  level = wanted;
+  return true;
+}
+
+enum plainScanLevel plainScanLevel(void) {
+  if (NULL == scan) {
+    if (!plainScanSelect(PLAINSCAN_AVX2) && !plainScanSelect(PLAINSCAN_SSE2)) {
+      plainScanSelect(PLAINSCAN_SCALAR);
+    }
+  }
+  return level;
+}
+
+size_t plainSpan(char const *buffer, size_t length) {
+  if (NULL == scan) {
+    plainScanLevel();
+  }
+  return scan(buffer, length);
+}
+
+size_t plainSpanUtf8(char const *buffer, size_t length) {
+  if (NULL == scan) {
+    plainScanLevel();
+  }
+  return scanUtf8(buffer, length);
+}
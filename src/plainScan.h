@@ -0,0 +1,72 @@
+/*
+  Header for the search of plain text in terminal output.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef PLAINSCAN_H
+#define PLAINSCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The implementations of plainSpan, from slowest to fastest.
+ */
+enum plainScanLevel {
+  /** no search, plainSpan always returns 0 */
+  PLAINSCAN_NONE,
+  /** one byte at a time */
+  PLAINSCAN_SCALAR,
+  /** 16 bytes at a time */
+  PLAINSCAN_SSE2,
+  /** 32 bytes at a time */
+  PLAINSCAN_AVX2
+};
+
+/**
+ * Plain bytes are the printable ones: 0x20 to 0x7E and 0xA0 to 0xFF.
+ * Everything else (C0 controls including ESC, DEL and the 8 bit C1
+ * controls 0x80 to 0x9F) may change the state of the escape filter.
+ *
+ * @return how many bytes at the start of buffer are plain
+ */
+size_t plainSpan(char const *buffer, size_t length);
+
+/**
+ * The same for UTF-8: plain are printable ASCII and complete, valid
+ * characters, except the encoded C1 controls C2 80 to C2 9F.
+ *
+ * @return how many bytes at the start of buffer are plain
+ */
+size_t plainSpanUtf8(char const *buffer, size_t length);
+
+/**
+ * Choose the implementation of plainSpan and plainSpanUtf8. Without
+ * a call the fastest one the CPU supports is used.
+ *
+ * @return false if the CPU or the build doesn't support level
+ */
+bool plainScanSelect(enum plainScanLevel const level);
+
+/**
+ * @return the implementation plainSpan and plainSpanUtf8 use
+ */
+enum plainScanLevel plainScanLevel(void);
+
+#endif
@@ -37,14 +37,18 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <time.h>
 #include <syslog.h>
 #include <string.h>
+#include <strings.h>
 #include <pwd.h>
 #include <limits.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <dirent.h>
 #include <regex.h>
 #include <wordexp.h>
+#include <poll.h>
 #if HAVE_SYS_SELECT_H
 #  include <sys/select.h>
 #endif
@@ -77,7 +81,23 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <stdbool.h>
 
 #include "write2syslog.h"
+#include "journald.h"
+#include "syslogClient.h"
+#include "syslogTcp.h"
 #include "configParser.h"
+#include "eventLoop.h"
+#include "zeroCopy.h"
+#include "logQueue.h"
+#include "sink.h"
+#include "durability.h"
+#include "outputQueue.h"
+#include "logStream.h"
+#include "logFrame.h"
+#include "logCompress.h"
+#if USE_IO_URING
+#  include <sys/signalfd.h>
+#  include "uring.h"
+#endif
 
 #include <inttypes.h>
 
@@ -99,6 +119,8 @@ void endusershell(void);
  */
 bool readConfigFile(void);
 void logSession(const int);
+static pid_t forkpipes(void);
+static void batchSession(const int);
 void execShell(const char *, const char *);
 char *setupusername(void);
 char *setupshell(void);
@@ -106,13 +128,22 @@ int setupusermode(void);
 void finish(void);
 char* consume_remaining_args(int, char **, char *);
 int beginlogging(const char *);
-void dologging(char *, int);
+void dologging(enum logStream const, char *, int);
+static bool openFileSink(void);
+static void writeFileSink(struct sinkBatchEntry const *, int);
+static void closeFileSink(void);
+static bool openSyslogSink(void);
+static void writeSyslogSink(struct sinkBatchEntry const *, int);
+static void closeSyslogSink(void);
+static int openlogsegment(void);
+static void endLogFrame(void);
 void endlogging(void);
-int recoverfile(int, char *);
+int recoverfile(int, char *, struct logCompress const *);
 int forceopen(char *);
 char *getDefaultshell(void);
 char **saveenv(char *);
 void restoreenv(void);
+static enum escCharset localeCharset(void);
 #ifndef HAVE_CLEARENV
 int clearenv(void);
 #endif
@@ -122,7 +153,6 @@ void usage(void);
 pid_t forkpty(int *, char *, struct termios *, struct winsize *);
 #endif
 void signalHandler(int const signal);
-void setupSignalHandlers(void);
 
 /* 
 //  global variables 
@@ -154,12 +184,24 @@ void setupSignalHandlers(void);
 //  userLogFileDir	A user supplied directory where the logfile 
 //			will be created.
 //
-//  logInode		The inode of the logfile.
+//  logSegments		The files the session was logged to. Without a
+//			size limit this is just logFileName, otherwise
+//			<logFileName>.000, .001, ... Each one keeps its
+//			descriptor, inode and device. Inode and device are
+//			determined when the segment is opened and compared
+//			again before it is closed. Should they be different,
+//			then somebody manipulated the logfile.
+//
+//  logFileSize		The number of bytes in the current segment.
+//
+//  logManifest		Lists the segments in order, -1 without a size
+//			limit.
+//
+//  logIndex		The time index of the current segment in the
+//			framed format, -1 otherwise.
 //
-//  logDev		The device of the logfile. These two values will
-//			be determined when the logfile will be opened
-//			and before the logfile will be closed. Should they
-//			be different, then somebody manipulated the logfile.
+//  logCompressor	Compresses the current segment, NULL if the
+//			logfile is not compressed.
 //			
 //  userName		The name of the user who called this executable.
 //
@@ -188,6 +230,30 @@ void setupSignalHandlers(void);
 //
 //  winSize		The size of the calling terminal. The slave pty will
 //			be set to these values.
+//
+//  stdinFlags		The file status flags of stdin before it was
+//			switched to non-blocking mode, -1 if unchanged.
+//
+//  stdoutFlags		The same for stdout and stderr.
+//  stderrFlags
+//
+//  screenQueue		Output of the shell the screen did not take yet.
+//
+//  ptyQueue		Keystrokes the pty did not take yet.
+//
+//  screenBlocked	The last flush of the queue left data behind, it
+//  ptyBlocked		is flushed again once the loop reports the
+//			descriptor writable.
+//
+//  batchMode		stdin is no terminal, the shell runs over pipes
+//			instead of a pty, see batchSession.
+//
+//  shellIn		The pipes to the shell's stdin, from its stdout
+//  shellOut		and from its stderr in batch mode, -1 once closed.
+//  shellErr
+//
+//  errQueue		Output on the shell's stderr our stderr did not
+//			take yet, batch mode only.
 //  
 */
 extern char **environ;
@@ -195,9 +261,46 @@ extern char **environ;
 static char progName[MAXPATHLEN];
 static char sessionId[MAXPATHLEN + 11];
 static int logFile;
-static ino_t logInode;
-static dev_t logDev;
 static char logFileName[MAXPATHLEN - 9];
+struct logSegment {
+  int fd;
+  ino_t inode;
+  dev_t dev;
+  char name[MAXPATHLEN + 16];
+  /*
+  //  In the framed format the segment is a framed file of its own
+  //  with its index, -1 if there is none.
+  */
+  struct logFrame frame;
+  int indexFd;
+  /*
+  //  A compressed segment is written through its compressor.
+  */
+  struct logCompress *compress;
+};
+static struct logSegment *logSegments = NULL;
+static int logSegmentCount = 0;
+static unsigned long long logFileSize = 0;
+static int logManifest = -1;
+static int logIndex = -1;
+static struct logCompress *logCompressor = NULL;
+
+/**
+ * True if the logfile is written as timestamped records, set with
+ * "file.format = framed" in rootsh.cfg. "file.index.interval" bytes
+ * of logfile lie between two entries of the index, 0 for no index.
+ */
+static bool logFramed = false;
+static unsigned long long logIndexInterval = LOGFRAMEINDEXINTERVAL;
+
+/**
+ * True if the logfile is compressed with gzip, "file.compress" in
+ * rootsh.cfg, at "file.compress.level". A frame ends at every group
+ * commit, see file.durability, and after "file.compress.frame" bytes.
+ */
+static bool logCompressed = false;
+static int logCompressLevel = LOGCOMPRESSLEVEL;
+static unsigned long long logCompressFrameSize = LOGCOMPRESSFRAMESIZE;
 static char *userLogFileName;
 static char *userLogFileDir;
 
@@ -244,6 +347,141 @@ static bool syslogLogLineCount = true;
 static bool syslogLogLineCount = false;
 #endif
 
+/**
+ * How pty output is read before the escape sequences are removed for
+ * syslog. Taken from the locale unless "syslog.charset" in rootsh.cfg
+ * is "utf-8" or "8bit".
+ */
+static bool syslogCharsetAuto = true;
+static enum escCharset syslogCharset = ESCCHARSET_8BIT;
+
+/**
+ * How long a line sent to syslog may get, "syslog.linelimit" in
+ * rootsh.cfg. Longer lines go out in tagged pieces.
+ */
+static size_t syslogLineLimit = WRITE2SYSLOGLINE;
+
+/**
+ * How many lines a second go to syslog, "syslog.rate" in rootsh.cfg,
+ * and how many at once, "syslog.burst". Every session has its own
+ * limit, 0 for none.
+ */
+#ifndef SYSLOGBURST
+#define SYSLOGBURST 1000
+#endif
+static unsigned long syslogRate = 0;
+static unsigned long syslogBurst = SYSLOGBURST;
+
+/**
+ * How syslog messages are made and sent. Unless "syslog.format" in
+ * rootsh.cfg is "libc", rootsh writes them to /dev/log itself and
+ * uses syslog(3) only if that socket fails.
+ */
+static enum syslogFormat syslogFormat = SYSLOGFORMAT_RFC3164;
+
+/**
+ * How large the spool for syslog messages the daemon can't take right
+ * now may get, "syslog.spool" in rootsh.cfg. 0 waits for the daemon.
+ */
+#ifndef SYSLOGSPOOLSIZE
+#define SYSLOGSPOOLSIZE (16 * 1024 * 1024)
+#endif
+static unsigned long long syslogSpoolSize = SYSLOGSPOOLSIZE;
+
+/**
+ * host:port of a syslog server which gets the lines over TCP, set
+ * with "syslog.remote" in rootsh.cfg. Empty for none.
+ */
+static char syslogRemote[MAXPATHLEN + 1] = "";
+
+/**
+ * True if pty output may bypass user space when only the logfile
+ * needs it. Switched off with "zerocopy = false" in rootsh.cfg.
+ */
+static bool zeroCopy = true;
+
+/**
+ * True if a rootsh whose stdin is no terminal runs the shell over
+ * pipes. Switched off with "batch = false" in rootsh.cfg.
+ */
+static bool batch = true;
+
+/**
+ * Capacity of the queue between the relay and the logger thread in
+ * bytes, 0 logs inline. Set with "queue.size" in rootsh.cfg.
+ */
+#ifndef LOGQUEUESIZE
+#define LOGQUEUESIZE (1024 * 1024)
+#endif
+static size_t logQueueSize = LOGQUEUESIZE;
+
+/**
+ * What to do when a logger can't keep up, "queue.full" in rootsh.cfg.
+ */
+static enum logQueueFull logQueueFull = LOGQUEUE_BLOCK;
+static bool logQueueFullSet = false;
+
+/**
+ * The queue of the logfile, "file.queue.size" and "file.queue.full"
+ * in rootsh.cfg. SIZE_MAX and -1 leave it to queue.size and
+ * queue.full.
+ */
+static size_t fileQueueSize = SIZE_MAX;
+static int fileQueueFull = -1;
+
+/**
+ * The queue of syslog, "syslog.queue.size" and "syslog.queue.full"
+ * in rootsh.cfg. Unless one of the queue.full settings says block,
+ * syslog spills, a daemon that is stuck doesn't stall the session.
+ */
+static size_t syslogQueueSize = SIZE_MAX;
+static int syslogQueueFull = -1;
+
+/**
+ * The places the session is logged to. beginlogging registers them
+ * and sets their queues from the settings above.
+ */
+static struct sink fileSink = {
+  .name = "file",
+  .open = openFileSink,
+  .write = writeFileSink,
+  .flush = durabilityIdle,
+  .close = closeFileSink
+};
+static struct sink syslogSink = {
+  .name = "syslog",
+  .open = openSyslogSink,
+  .write = writeSyslogSink,
+  .close = closeSyslogSink
+};
+
+/**
+ * When logfile writes are forced to disk, "file.durability" in
+ * rootsh.cfg. Group mode syncs after "file.durability.bytes" bytes or
+ * "file.durability.ms" milliseconds, whichever comes first.
+ */
+static enum durability logDurability = DURABILITY_SYNC;
+#ifndef GROUPCOMMITBYTES
+#define GROUPCOMMITBYTES 65536
+#endif
+#ifndef GROUPCOMMITMS
+#define GROUPCOMMITMS 1000
+#endif
+static size_t groupCommitBytes = GROUPCOMMITBYTES;
+static int groupCommitMs = GROUPCOMMITMS;
+
+/**
+ * Size of a logfile segment, 0 for a single logfile without limit.
+ * "file.maxsize" in rootsh.cfg. At most "file.maxsegments" segments
+ * are written (0 is unlimited), after that only syslog gets the output.
+ */
+#ifndef MAXLOGFILESIZE
+#define MAXLOGFILESIZE 0
+#endif
+static unsigned long long maxLogFileSize = MAXLOGFILESIZE;
+static unsigned long maxLogSegments = 0;
+static bool logFileFull = false;
+
 static char defaultshell[MAXPATHLEN+1];
 
 static char *userName = 0;
@@ -251,9 +489,34 @@ static char *runAsUser = 0;
 static int standalone;
 static int useLoginShell = 0;
 static int isaLoginShell = 0;
-static int masterPty;
+static int masterPty = -1;
 static struct termios termParams, newTty;
 static struct winsize winSize;
+static int stdinFlags = -1;
+static int stdoutFlags = -1;
+static int stderrFlags = -1;
+static struct outputQueue screenQueue;
+static struct outputQueue ptyQueue;
+static bool screenBlocked = false;
+static bool ptyBlocked = false;
+static bool batchMode = false;
+static int shellIn = -1;
+static int shellOut = -1;
+static int shellErr = -1;
+static struct outputQueue errQueue;
+static bool errBlocked = false;
+
+/*
+//  How many reads the relay does on one descriptor before it gives
+//  the other one and pending signals a turn.
+*/
+#define DRAINBUDGET 64
+
+/*
+//  How much each output queue holds. A side isn't read while the
+//  queue towards the other side is full.
+*/
+#define OUTPUTQUEUESIZE 65536
 
 volatile sig_atomic_t sigWinchReceived = 0;
 volatile sig_atomic_t sigIntReceived = 0;
@@ -277,6 +540,24 @@ void signalHandler(int const signal) {
   }
 }
 
+/*
+//  The signals of the relays are blocked from before the fork until
+//  the relay takes them from signalfd or pselect. Otherwise a SIGCHLD
+//  of a shell that exits early is discarded and a SIGINT or SIGQUIT
+//  kills rootsh before finish() closes the logfile. The shell gets
+//  them unblocked again.
+*/
+static void maskRelaySignals(int const how) {
+  sigset_t relaySignals;
+
+  sigemptyset(&relaySignals);
+  sigaddset(&relaySignals, SIGINT);
+  sigaddset(&relaySignals, SIGQUIT);
+  sigaddset(&relaySignals, SIGCHLD);
+  sigaddset(&relaySignals, SIGWINCH);
+  sigprocmask(how, &relaySignals, NULL);
+}
+
 int main(int argc, char **argv) {
   /*
   //  shell		The path to the shell which will be executed.
@@ -399,6 +680,13 @@ int main(int argc, char **argv) {
 
   standalone = ((getenv("SUDO_USER") == NULL) ? 1 : 0);
 
+  /*
+  //  Look at the locale before setupusermode clears the environment.
+  */
+  if (syslogCharsetAuto) {
+    syslogCharset = localeCharset();
+  }
+
   if ((userName = setupusername()) == NULL) {
     exit(EXIT_FAILURE);
   }
@@ -411,10 +699,30 @@ int main(int argc, char **argv) {
     exit(EXIT_FAILURE);
   }
 
+  maskRelaySignals(SIG_BLOCK);
   if (! beginlogging(shellCommands)) {
     exit(EXIT_FAILURE);
   }
 
+  /*
+  //  Without a terminal on stdin (cron, CI, a pipe) there is nobody
+  //  to give a pty to. Run the shell over plain pipes.
+  */
+  batchMode = batch && !isatty(STDIN_FILENO);
+  if (batchMode) {
+    childPid = forkpipes();
+    if(childPid < 0) {
+      perror("fork");
+      exit(EXIT_FAILURE);
+    } else if (childPid == 0) {
+      execShell(shell, shellCommands);
+    } else {
+      syslogTcpStart();
+      batchSession(childPid);
+    }
+    exit(EXIT_SUCCESS);
+  }
+
   /* 
   //  Save original terminal parameters.
   */
@@ -437,668 +745,2395 @@ int main(int argc, char **argv) {
   } else if (childPid == 0) {
     execShell(shell, shellCommands);
   } else {
+    /*
+    //  Threads only after the fork, the child gets no locks held by them.
+    */
+    syslogTcpStart();
     logSession(childPid);
   }
   exit(EXIT_SUCCESS);
 }
 
-void setupSignalHandlers(void) {
-  /* 
-  //  Handle these signals (posix functions preferred).
-  */
-#if HAVE_SIGACTION
-  struct sigaction action;
-#endif
-  
-#if HAVE_SIGACTION
-  memset(&action, 0, sizeof(action));
-  action.sa_handler = signalHandler;
-  sigaction(SIGINT, &action, NULL);
-  sigaction(SIGQUIT, &action, NULL);
-  sigaction(SIGCHLD, &action, NULL);
-  sigaction(SIGWINCH, &action, NULL);
-#elif HAVE_SIGSET
-  sigset(SIGINT, signalHandler);
-  sigset(SIGQUIT, signalHandler);
-  sigset(SIGCHLD, signalHandler);
-  sigset(SIGWINCH, signalHandler);
-#else
-  signal(SIGINT, signalHandler);
-  signal(SIGQUIT, signalHandler);
-  signal(SIGCHLD, signalHandler);
-  signal(SIGWINCH, signalHandler);
-#endif
-
-  sigWinchReceived = 0;
-  sigIntReceived = 0;
-  sigQuitReceived = 0;
-  sigChldReceived = 0;
+/*
+//  Set O_NONBLOCK on a descriptor.
+//  Returns the previous flags or -1 on error.
+*/
+static int setNonBlocking(int const fd) {
+  int const flags = fcntl(fd, F_GETFL);
+  if(flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    return -1;
+  }
+  return flags;
 }
 
-void logSession(const int childPid) {
-  /*
-  //  readmask		A set of filedescriptors to watch. Here we have
-  //			the stdin of the calling terminal and the stdout.
-  //  
-  //  n			Either the filedescriptor which changed state in
-  //			the event loop or a simple counter.
-  //  buf		A buffer used for various red/write operations.
-  //  
-  //  
-  */
-  int n;
-  fd_set readmask;
-  char buf[BUFSIZ];
-  sigset_t emptySet;
+/*
+//  Write a complete buffer to a non-blocking descriptor. If the
+//  descriptor is full, wait until it can take more.
+*/
+static bool writeAll(int const fd, char const *buf, size_t len) {
+  while(len > 0) {
+    ssize_t const n = write(fd, buf, len);
+    if(n > 0) {
+      buf += n;
+      len -= n;
+    } else if(n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+      struct pollfd pfd;
+      pfd.fd = fd;
+      pfd.events = POLLOUT;
+      if(poll(&pfd, 1, -1) < 0 && EINTR != errno) {
+        return false;
+      }
+    } else if(n < 0 && EINTR == errno) {
+      continue;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
 
-  newTty = termParams;
-  /* 
-  //  Let read not return until at least 1 byte has been received.
-  */
-  newTty.c_cc[VMIN] = 1; 
-  newTty.c_cc[VTIME] = 0;
-  /* 
-  //  Don't perform output processing.
-  */
-  newTty.c_oflag &= ~OPOST;
-  /* 
-  //  Noncanonical input | signal characters off |echo off.
-  */
-  newTty.c_lflag &= ~(ICANON|ISIG|ECHO);
-  /* 
-  //  NL to CR off | don't ignore CR | CR to NL off |
-  //  Case sensitive input (not known to FreeBSD) | 
-  //  no output flow control 
-  */
-#ifdef IUCLC
-  newTty.c_iflag &= ~(INLCR|IGNCR|ICRNL|IUCLC|IXON);
-#else
-  newTty.c_iflag &= ~(INLCR|IGNCR|ICRNL|IXON);
-#endif
-  if(isatty(0)) {
-    /* 
-    //  Set the new tty modes.
-    */
-    if (tcsetattr(0, TCSANOW, &newTty) < 0) {
-      char msgbuf[BUFSIZ];
-      int msglen;
-      char *error = strerror(errno);
-      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "tcsetattr on stdin: %s", error);
-      dologging(msgbuf, msglen);
-      exit(EXIT_FAILURE);
+/*
+//  Write what a queue holds, waiting for its descriptor if needed.
+//  Used when the session ends.
+*/
+static void flushQueueBlocking(struct outputQueue * const queue, int const fd) {
+  while (!outputQueueEmpty(queue)
+         && outputQueueFlush(queue, fd)
+         && !outputQueueEmpty(queue)) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    if (poll(&pfd, 1, -1) < 0 && EINTR != errno) {
+      break;
     }
   }
+}
 
-  setupSignalHandlers();
-  
-  /* 
-  //  Now just sit in a loop reading from the keyboard and
-  //  writing to the pseudo-tty, and reading from the  
-  //  pseudo-tty and writing to the screen and the logfile.
-  */
-  for (;;) {
-    /* 
-    //  Watch for users terminal and master pty to change status.
-    */
-    FD_ZERO(&readmask);
-    FD_SET(masterPty, &readmask);
-    FD_SET(0, &readmask);
-
-    /*  Wait for something to read or a signal */
-    sigemptyset(&emptySet);
-    n = pselect(masterPty + 1, &readmask, (fd_set *) 0, (fd_set *) 0,
-                (struct timespec *) 0, &emptySet);
-    if (n < 0) {
-      if(EINTR != errno) {
-        char msgbuf[BUFSIZ];
-        int msglen;
-        char *error = strerror(errno);
-        msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "select: %s", error);
-        dologging(msgbuf, msglen);
-        exit(EXIT_FAILURE);
-      }
-    } else {
+/*
+//  Hand a queue to its descriptor. Once the descriptor doesn't take
+//  everything, watch it for writability besides the events it is
+//  always watched for.
+//  Returns false on a write error, errno is set.
+*/
+static bool flushQueue(struct outputQueue * const queue, int const fd,
+                       unsigned int const events, bool * const blocked) {
+  bool const ok = outputQueueFlush(queue, fd);
+  *blocked = ok && !outputQueueEmpty(queue);
+  /* fails harmlessly once the descriptor is no longer watched */
+  eventLoopModify(fd, events | (*blocked ? EVENTLOOP_WRITE : 0));
+  return ok;
+}
 
-      /* handle file descriptors first */
-    
-      /* 
-      //  The user typed something... 
-      //  Read it and pass it on to the pseudo-tty.
-      */
-      if (FD_ISSET(0, &readmask)) {
-        if ((n = read(0, buf, sizeof(buf))) < 0) {
-          char msgbuf[BUFSIZ];
-          int msglen;
-          char *error = strerror(errno);
-          msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "read - stdin: %s", error);
-          dologging(msgbuf, msglen);
-          exit(EXIT_FAILURE);
-        }
-        if (write(masterPty, buf, n) != n) {
-          char msgbuf[BUFSIZ];
-          int msglen;
-          char *error = strerror(errno);
-          msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "write - pty: %s", error);
-          dologging(msgbuf, msglen);
-          exit(EXIT_FAILURE);
-        }
-      }
+/*
+//  Hand queued output to the screen.
+*/
+static void flushScreen(void) {
+  if (!flushQueue(&screenQueue, STDOUT_FILENO, 0, &screenBlocked)) {
+    char msgbuf[BUFSIZ];
+    int msglen;
+    char *error = strerror(errno);
+    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "write - stdout: %s", error);
+    dologging(LOGSTREAM_META, msgbuf, msglen);
+    exit(EXIT_FAILURE);
+  }
+}
 
-      /* 
-      //  There's output on the pseudo-tty... 
-      //  Read it and pass it on to the screen and the script file.
-      //  Echo is on, so we see here also the users keystrokes.
-      */
-      if (FD_ISSET(masterPty, &readmask)) {
-        if ((n = read(masterPty, buf, sizeof(buf))) > 0) {
-          dologging(buf, n);
-          if(write(STDOUT_FILENO, buf, n) < 0) {
-            char msgbuf[BUFSIZ];
-            int msglen;
-            char *error = strerror(errno);
-            msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "write - stdout: %s", error);
-            dologging(msgbuf, msglen);
-            exit(EXIT_FAILURE);
-          }
-        }
-      }
-    } /* something to read */
+/*
+//  Hand queued keystrokes to the pty. If the pty refuses them, the
+//  shell is gone and the SIGCHLD handling takes over.
+*/
+static void flushPty(void) {
+  if (!flushQueue(&ptyQueue, masterPty, EVENTLOOP_READ, &ptyBlocked)) {
+    char msgbuf[BUFSIZ];
+    int msglen;
+    char *error = strerror(errno);
+    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "write - pty: %s", error);
+    dologging(LOGSTREAM_META, msgbuf, msglen);
+    outputQueueClear(&ptyQueue);
+  }
+}
 
-    /* handle signals next */
-    if(sigWinchReceived) {
-      /* pass SIGWINCH to the child */
-      ioctl(STDIN_FILENO, TIOCGWINSZ, (char *)&winSize);
-      ioctl(masterPty, TIOCSWINSZ, (char *)&winSize);
-      kill(childPid, SIGWINCH);
-      
-      sigWinchReceived = 0;
+/*
+//  Read what the pty still holds and pass it on to the screen and
+//  the logging functions. Used when the shell is gone. Bounded, as
+//  a background job may still be writing to the pty.
+*/
+static void drainPty(void) {
+  char buf[BUFSIZ];
+  int n, reads;
+
+  setNonBlocking(masterPty);
+  for (reads = 0; reads < DRAINBUDGET; ++reads) {
+    if ((n = read(masterPty, buf, sizeof(buf))) > 0) {
+      dologging(LOGSTREAM_OUT, buf, n);
+      writeAll(STDOUT_FILENO, buf, n);
+    } else if (n == 0 || EINTR != errno) {
+      break;
     }
+  }
+}
 
-    if(sigIntReceived || sigQuitReceived || sigChldReceived) {
-      finish();
+/*
+//  Act on the signals received since the last pass of the relay.
+*/
+static void handleSignals(const int childPid) {
+  if(sigWinchReceived) {
+    /* pass SIGWINCH to the child */
+    ioctl(STDIN_FILENO, TIOCGWINSZ, (char *)&winSize);
+    ioctl(masterPty, TIOCSWINSZ, (char *)&winSize);
+    kill(childPid, SIGWINCH);
+    
+    sigWinchReceived = 0;
+  }
 
-      sigIntReceived = 0;
-      sigQuitReceived = 0;
-      sigChldReceived = 0;
+  if(sigIntReceived || sigQuitReceived || sigChldReceived) {
+    flushQueueBlocking(&screenQueue, STDOUT_FILENO);
+    if(sigChldReceived) {
+      drainPty();
     }
-    
+    finish();
 
+    sigIntReceived = 0;
+    sigQuitReceived = 0;
+    sigChldReceived = 0;
+  }
+}
 
-  } /* forever */
+#if USE_IO_URING
+/*
+//  The io_uring relay.
+//
+//  Instead of waiting for readiness and then doing the reads and
+//  writes one syscall at a time, the relay keeps its reads queued in
+//  a ring and hands each chunk of pty output back as a pair of linked
+//  writes (screen, then logfile) on registered buffers. One
+//  io_uring_enter submits all of them and collects the completions.
+//  Only syslog still sees the data in user space.
+//
+//  Output chunks are written in order: while one chunk's writes are in
+//  flight, the next chunk is already being read into another buffer
+//  and queued behind it.
+*/
 
-  {
-    char const *msg = "rootsh closing duplicated pty";
-    char msgbuf[BUFSIZ];
-    int msglen;
-    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "%s", msg);
-    dologging(msgbuf, msglen);
-  }
+/*
+//  PTYBUFFERS		Buffers cycling between the pty read and the writes
+//			to the screen and the logfile.
+//
+//  INPUTBUFFER		Index of the buffer for keyboard input.
+*/
+#define PTYBUFFERS 4
+#define INPUTBUFFER PTYBUFFERS
 
-  exit(EXIT_SUCCESS);
-}
+/*
+//  user_data of the submissions: operation in the upper bits, buffer
+//  index in the lower ones.
+*/
+enum {
+  URING_PTYREAD = 1, URING_STDOUT, URING_LOGFILE, URING_STDINREAD,
+  URING_PTYWRITE, URING_SIGNAL, URING_CANCEL, URING_TIMER
+};
+#define URINGDATA(op, buffer) (((uint64_t)(op) << 8) | (uint64_t)(buffer))
+#define URINGOP(data) ((int)((data) >> 8))
+#define URINGBUFFER(data) ((int)((data) & 0xFF))
 
-void execShell(const char *shell, const char *shellCommands) {
-  /*
-  //
-  //  dashShell		The basename of shell, prepended with "-".
-  //  
-  //  sucmd		The path to the su command.
+/*
+//  length		Bytes read into the buffer.
+//
+//  screenDone		Bytes of it already written to the screen (or to the
+//  logDone		logfile, or, for the input buffer, to the pty).
+*/
+struct uringBuffer {
+  unsigned int length;
+  unsigned int screenDone;
+  unsigned int logDone;
+};
+
+static char uringData[PTYBUFFERS + 1][BUFSIZ];
+static struct uringBuffer uringBuffers[PTYBUFFERS + 1];
+
+/*
+//  ring		The ring shared with the kernel.
+//
+//  signalFd		Delivers the relay's signals as reads.
+//
+//  sigInfo		Target of the pending signalfd read.
+//
+//  writeQueue		Pty buffers with data waiting for their writes,
+//  queueHead		oldest first. The head has its writes in flight.
+//  queueLength
+//
+//  freeBuffers		Pty buffers which can take the next read.
+//
+//  ptyReadBuffer	Buffer of the outstanding pty read, -1 if none.
+//
+//  ptyClosed		The pty hung up, there is nothing more to read.
+//
+//  idleTimer		Timeout of the pending URING_TIMER, it wakes the
+//  timerQueued		relay when the logfile is due to be synced.
+*/
+static struct uring ring;
+static int uringSignalFd = -1;
+static struct signalfd_siginfo sigInfo;
+static int writeQueue[PTYBUFFERS];
+static int queueHead = 0;
+static int queueLength = 0;
+static int freeBuffers[PTYBUFFERS];
+static int freeCount = 0;
+static int ptyReadBuffer = -1;
+static bool ptyClosed = false;
+static struct __kernel_timespec idleTimer;
+static bool timerQueued = false;
+
+static void uringFailure(char const * const what, int const error) {
+  char msgbuf[BUFSIZ];
+  int msglen;
+  msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "%s: %s", what, strerror(error));
+  dologging(LOGSTREAM_META, msgbuf, msglen);
+  exit(EXIT_FAILURE);
+}
+
+static struct io_uring_sqe *uringSqe(void) {
+  struct io_uring_sqe *sqe = uringGetSqe(&ring);
+  if (NULL == sqe) {
+    /* the queue is sized for every operation the relay can have queued */
+    uringFailure("io_uring submission queue", ENOSPC);
+  }
+  return sqe;
+}
+
+static void queuePtyRead(void) {
+  if (ptyClosed || ptyReadBuffer >= 0 || freeCount == 0) {
+    return;
+  }
+  ptyReadBuffer = freeBuffers[--freeCount];
+  uringPrepRw(uringSqe(), IORING_OP_READ_FIXED, masterPty,
+              uringData[ptyReadBuffer], BUFSIZ, -1, ptyReadBuffer,
+              URINGDATA(URING_PTYREAD, ptyReadBuffer));
+}
+
+static void queueStdinRead(void) {
+  uringPrepRw(uringSqe(), IORING_OP_READ_FIXED, STDIN_FILENO,
+              uringData[INPUTBUFFER], BUFSIZ, -1, INPUTBUFFER,
+              URINGDATA(URING_STDINREAD, INPUTBUFFER));
+}
+
+/*
+//  Sync the logfile if it is due and wake up when the next sync is,
+//  durabilityWritten only syncs while output keeps coming.
+*/
+static void queueIdleTimer(void) {
+  int timeoutMs;
+
+  if (timerQueued || !logtofile || (timeoutMs = durabilityIdle()) < 0) {
+    return;
+  }
+  idleTimer.tv_sec = timeoutMs / 1000;
+  idleTimer.tv_nsec = (long long)(timeoutMs % 1000) * 1000000LL;
+  uringPrepRw(uringSqe(), IORING_OP_TIMEOUT, -1, &idleTimer, 1, 0, 0,
+              URINGDATA(URING_TIMER, 0));
+  timerQueued = true;
+}
+
+static void queueSignalRead(void) {
+  uringPrepRw(uringSqe(), IORING_OP_READ, uringSignalFd, &sigInfo,
+              sizeof(sigInfo), -1, 0, URINGDATA(URING_SIGNAL, 0));
+}
+
+/*
+//  Queue the screen write of a pty buffer and link the logfile write
+//  to it. If the screen write comes up short, the kernel cancels the
+//  logfile write and both are requeued separately.
+*/
+static void queueOutputWrites(int const buffer) {
+  struct uringBuffer * const b = &uringBuffers[buffer];
+  bool const screen = b->screenDone < b->length;
+  bool const log = logtofile && b->logDone < b->length;
+  struct io_uring_sqe *sqe;
+
+  if (screen) {
+    sqe = uringSqe();
+    uringPrepRw(sqe, IORING_OP_WRITE_FIXED, STDOUT_FILENO,
+                uringData[buffer] + b->screenDone, b->length - b->screenDone,
+                -1, buffer, URINGDATA(URING_STDOUT, buffer));
+    if (log) {
+      sqe->flags |= IOSQE_IO_LINK;
+    }
+  }
+  if (log) {
+    uringPrepRw(uringSqe(), IORING_OP_WRITE_FIXED, logFile,
+                uringData[buffer] + b->logDone, b->length - b->logDone,
+                -1, buffer, URINGDATA(URING_LOGFILE, buffer));
+  }
+}
+
+/*
+//  Called when one of the writes of the queue head finished. Recycle
+//  the buffer once both are done and start on the next one.
+*/
+static void outputWriteDone(int const buffer) {
+  struct uringBuffer * const b = &uringBuffers[buffer];
+
+  if (b->screenDone < b->length || (logtofile && b->logDone < b->length)) {
+    return;
+  }
+  queueHead = (queueHead + 1) % PTYBUFFERS;
+  --queueLength;
+  freeBuffers[freeCount++] = buffer;
+  if (queueLength > 0) {
+    queueOutputWrites(writeQueue[queueHead]);
+  }
+  queuePtyRead();
+}
+
+static void handleCompletion(struct io_uring_cqe const * const cqe) {
+  int const buffer = URINGBUFFER(cqe->user_data);
+  struct uringBuffer * const b = &uringBuffers[buffer];
+
+  switch (URINGOP(cqe->user_data)) {
+    case URING_PTYREAD:
+      ptyReadBuffer = -1;
+      if (cqe->res <= 0) {
+        /*
+        //  EIO once the shell is gone, the SIGCHLD handling takes
+        //  care of the rest. A cancelled read is picked up by drainPty.
+        */
+        freeBuffers[freeCount++] = buffer;
+        if (cqe->res != -EINTR && cqe->res != -EAGAIN) {
+          ptyClosed = true;
+        }
+        break;
+      }
+      b->length = (unsigned int)cqe->res;
+      b->screenDone = 0;
+      b->logDone = 0;
+      if (logtosyslog) {
+        struct sinkRecord record;
+        record.stream = LOGSTREAM_OUT;
+        record.time = sinkNow();
+        sinkPush(&syslogSink, &record, uringData[buffer], b->length);
+      }
+      writeQueue[(queueHead + queueLength) % PTYBUFFERS] = buffer;
+      if (++queueLength == 1) {
+        queueOutputWrites(buffer);
+      }
+      if (!sigChldReceived) {
+        queuePtyRead();
+      }
+      break;
+    case URING_STDOUT:
+      if (cqe->res < 0) {
+        uringFailure("write - stdout", -cqe->res);
+      } else if (0 == cqe->res) {
+        /* the screen takes nothing, requeueing would spin forever */
+        uringFailure("write - stdout", EIO);
+      }
+      b->screenDone += (unsigned int)cqe->res;
+      if (b->screenDone < b->length) {
+        queueOutputWrites(buffer);
+      } else {
+        outputWriteDone(buffer);
+      }
+      break;
+    case URING_LOGFILE:
+      if (-ECANCELED == cqe->res) {
+        /* requeued together with the rest of the screen write */
+        break;
+      } else if (cqe->res < 0) {
+        errno = -cqe->res;
+        perror("Error writing to logfile");
+        b->logDone = b->length;
+      } else {
+        b->logDone += (unsigned int)cqe->res;
+        durabilityWritten((size_t)cqe->res);
+        if (b->logDone < b->length) {
+          queueOutputWrites(buffer);
+          break;
+        }
+      }
+      outputWriteDone(buffer);
+      break;
+    case URING_STDINREAD:
+      if (cqe->res < 0 && cqe->res != -EINTR && cqe->res != -EAGAIN) {
+        uringFailure("read - stdin", -cqe->res);
+      } else if (cqe->res == 0) {
+        /* end of file on the user's side, nothing more to read there */
+        break;
+      } else if (cqe->res < 0) {
+        queueStdinRead();
+        break;
+      }
+      b->length = (unsigned int)cqe->res;
+      b->screenDone = 0;
+      uringPrepRw(uringSqe(), IORING_OP_WRITE_FIXED, masterPty,
+                  uringData[INPUTBUFFER], b->length, -1, INPUTBUFFER,
+                  URINGDATA(URING_PTYWRITE, INPUTBUFFER));
+      break;
+    case URING_PTYWRITE:
+      if (cqe->res < 0) {
+        uringFailure("write - pty", -cqe->res);
+      }
+      b->screenDone += (unsigned int)cqe->res;
+      if (b->screenDone < b->length) {
+        uringPrepRw(uringSqe(), IORING_OP_WRITE_FIXED, masterPty,
+                    uringData[INPUTBUFFER] + b->screenDone,
+                    b->length - b->screenDone, -1, INPUTBUFFER,
+                    URINGDATA(URING_PTYWRITE, INPUTBUFFER));
+      } else {
+        queueStdinRead();
+      }
+      break;
+    case URING_SIGNAL:
+      if (cqe->res == sizeof(sigInfo)) {
+        signalHandler((int)sigInfo.ssi_signo);
+      }
+      queueSignalRead();
+      break;
+    case URING_TIMER:
+      /* -ETIME, the next pass syncs and queues it again if needed */
+      timerQueued = false;
+      break;
+    default:
+      break;
+  }
+}
+
+/*
+//  Setup the ring, register the buffers and queue the first reads.
+//  Returns false if io_uring can't be used, the event loop relay
+//  takes over then.
+*/
+static bool openUringRelay(void) {
+  static int const signals[] = { SIGINT, SIGQUIT, SIGCHLD, SIGWINCH };
+  struct iovec iov[PTYBUFFERS + 1];
+  sigset_t blocked;
+  int i;
+
+  /*
+  //  Every buffer has at most two writes queued, plus the reads of
+  //  pty, stdin and signalfd, a cancel and the idle timer.
+  */
+  if (!uringOpen(&ring, 4 * (PTYBUFFERS + 4))) {
+    return false;
+  }
+  for (i = 0; i <= PTYBUFFERS; ++i) {
+    iov[i].iov_base = uringData[i];
+    iov[i].iov_len = BUFSIZ;
+  }
+  if (!uringRegisterBuffers(&ring, iov, PTYBUFFERS + 1)) {
+    uringClose(&ring);
+    return false;
+  }
+
+  sigemptyset(&blocked);
+  for (i = 0; i < (int)(sizeof(signals) / sizeof(signals[0])); ++i) {
+    sigaddset(&blocked, signals[i]);
+  }
+  if (sigprocmask(SIG_BLOCK, &blocked, NULL) < 0
+      || (uringSignalFd = signalfd(-1, &blocked, SFD_CLOEXEC)) < 0) {
+    uringClose(&ring);
+    return false;
+  }
+
+  for (i = 0; i < PTYBUFFERS; ++i) {
+    freeBuffers[freeCount++] = i;
+  }
+  queueSignalRead();
+  queueStdinRead();
+  queuePtyRead();
+  return true;
+}
+
+/*
+//  Relay through io_uring until the session ends.
+//  Returns false right away if io_uring is not available.
+*/
+static bool uringRelay(const int childPid) {
+  struct io_uring_cqe cqe;
+  bool cancelled = false;
+
+  if (!openUringRelay()) {
+    return false;
+  }
+  for (;;) {
+    queueIdleTimer();
+    if (uringSubmitAndWait(&ring, 1) < 0) {
+      uringFailure("io_uring_enter", errno);
+    }
+    while (uringNextCqe(&ring, &cqe)) {
+      handleCompletion(&cqe);
+    }
+    if (sigChldReceived) {
+      /*
+      //  The shell is gone. Stop reading through the ring, let the
+      //  queued writes finish and pick up what's left in the pty
+      //  directly, so no output goes missing from the log.
+      */
+      if (ptyReadBuffer >= 0 && !cancelled) {
+        struct io_uring_sqe * const sqe = uringSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = URINGDATA(URING_PTYREAD, ptyReadBuffer);
+        sqe->user_data = URINGDATA(URING_CANCEL, 0);
+        cancelled = true;
+      }
+      if (ptyReadBuffer >= 0 || queueLength > 0) {
+        continue;
+      }
+    } else if ((sigIntReceived || sigQuitReceived) && queueLength > 0) {
+      continue;
+    }
+    handleSignals(childPid);
+  }
+  return true;
+}
+#endif
+
+/*
+//  Move one sink, or all with NULL, into its own thread. Spill files
+//  live next to the logfile, they get the same protection.
+*/
+static void startSinks(struct sink * const sink) {
+  static bool stopAtExit = false;
+  /* logdir, '/' and sessionId, the sizes count the NULs */
+  char prefix[sizeof(logdir) + sizeof(sessionId)];
+
+  if (logtofile) {
+    snprintf(prefix, sizeof(prefix), "%s", logFileName);
+  } else {
+    snprintf(prefix, sizeof(prefix), "%s/%s", logdir, sessionId);
+  }
+  if (NULL == sink) {
+    sinkStartAll(prefix);
+  } else {
+    sinkStart(sink, prefix);
+  }
+  if (!stopAtExit) {
+    /* whoever exits, the queued output goes to the logs first */
+    atexit(sinkStopAll);
+    stopAtExit = true;
+  }
+}
+
+void logSession(const int childPid) {
+  /*
+  //  signals		The signals delivered through the event loop.
+  //
+  //  ready		The descriptors reported by the event loop. Here
+  //			we have the stdin of the calling terminal and the
+  //			master pty.
+  //  
+  //  n			Either the number of ready descriptors or the
+  //			number of bytes read/written.
+  //
+  //  buf		A buffer used for various red/write operations.
+  //  
+  //  stdinPending	The event loop reported stdin or the master pty
+  //  ptyPending	as readable and we did not yet read it up to EAGAIN.
+  //			The loop is edge triggered, so it won't tell us
+  //			again until we did.
+  //
+  //  zeroCopyActive	Pty output is spliced to the screen and the
+  //			logfile, see zeroCopyRelay.
+  //
+  //  zeroCopyWorks	The pty could be spliced at least once.
+  //  
+  */
+  static int const signals[] = { SIGINT, SIGQUIT, SIGCHLD, SIGWINCH };
+  struct eventLoopEvent ready[4];
+  int n, i, reads;
+  char buf[BUFSIZ];
+  bool stdinPending = false;
+  bool ptyPending = false;
+  bool zeroCopyActive = false;
+  bool zeroCopyWorks = false;
+
+  newTty = termParams;
+  /* 
+  //  Let read not return until at least 1 byte has been received.
+  */
+  newTty.c_cc[VMIN] = 1; 
+  newTty.c_cc[VTIME] = 0;
+  /* 
+  //  Don't perform output processing.
+  */
+  newTty.c_oflag &= ~OPOST;
+  /* 
+  //  Noncanonical input | signal characters off |echo off.
+  */
+  newTty.c_lflag &= ~(ICANON|ISIG|ECHO);
+  /* 
+  //  NL to CR off | don't ignore CR | CR to NL off |
+  //  Case sensitive input (not known to FreeBSD) | 
+  //  no output flow control 
+  */
+#ifdef IUCLC
+  newTty.c_iflag &= ~(INLCR|IGNCR|ICRNL|IUCLC|IXON);
+#else
+  newTty.c_iflag &= ~(INLCR|IGNCR|ICRNL|IXON);
+#endif
+  if(isatty(0)) {
+    /* 
+    //  Set the new tty modes.
+    */
+    if (tcsetattr(0, TCSANOW, &newTty) < 0) {
+      char msgbuf[BUFSIZ];
+      int msglen;
+      char *error = strerror(errno);
+      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "tcsetattr on stdin: %s", error);
+      dologging(LOGSTREAM_META, msgbuf, msglen);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  sigWinchReceived = 0;
+  sigIntReceived = 0;
+  sigQuitReceived = 0;
+  sigChldReceived = 0;
+
+  /*
+  //  If nothing needs to look at the output (syslog needs the lines,
+  //  the framed logfile the records, compression all of it),
+  //  keep it out of user space altogether. splice can't append, so
+  //  the logfile gets positioned at its end instead. The relay writes
+  //  the logfile itself, fileSink and its thread are not used.
+  */
+  if (zeroCopy && !logtosyslog && 0 == maxLogFileSize && !logFramed
+      && !logCompressed && zeroCopyOpen()) {
+    zeroCopyActive = true;
+    if (logtofile) {
+      fcntl(logFile, F_SETFL, fcntl(logFile, F_GETFL) & ~O_APPEND);
+      lseek(logFile, 0, SEEK_END);
+    }
+  }
+
+#if USE_IO_URING
+  /*
+  //  Otherwise prefer the io_uring relay, it only returns if the
+  //  kernel doesn't let us use io_uring. It can't split the output
+  //  into logfile segments, frame or compress it. The logfile writes
+  //  are linked to the screen writes in the ring, they bypass fileSink
+  //  and its thread, only syslog gets its sink.
+  */
+  if (!zeroCopyActive
+      && (!logtofile || (0 == maxLogFileSize && !logFramed && !logCompressed))) {
+    if (logtosyslog) {
+      startSinks(&syslogSink);
+    }
+    uringRelay(childPid);
+  }
+#endif
+
+  if (!zeroCopyActive) {
+    startSinks(NULL);
+  }
+
+  /*
+  //  Both sides are read until EAGAIN and neither side may stall the
+  //  other, so nothing blocks. stdin and stdout share their file
+  //  status flags with the caller's terminal, finish() gives them back.
+  */
+  stdinFlags = setNonBlocking(STDIN_FILENO);
+  stdoutFlags = setNonBlocking(STDOUT_FILENO);
+  if (setNonBlocking(masterPty) < 0
+      || !outputQueueInit(&screenQueue, OUTPUTQUEUESIZE)
+      || !outputQueueInit(&ptyQueue, OUTPUTQUEUESIZE)
+      || !eventLoopOpen(signals, sizeof(signals) / sizeof(signals[0]), signalHandler)
+      || !eventLoopAdd(STDIN_FILENO, EVENTLOOP_READ)
+      || !eventLoopAdd(masterPty, EVENTLOOP_READ)
+      || !eventLoopAdd(STDOUT_FILENO, 0)) {
+    char msgbuf[BUFSIZ];
+    int msglen;
+    char *error = strerror(errno);
+    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "event loop: %s", error);
+    dologging(LOGSTREAM_META, msgbuf, msglen);
+    exit(EXIT_FAILURE);
+  }
+  
+  /* 
+  //  Now just sit in a loop reading from the keyboard and
+  //  writing to the pseudo-tty, and reading from the  
+  //  pseudo-tty and writing to the screen and the logfile.
+  */
+  for (;;) {
+    /* 
+    //  Watch for users terminal and master pty to change status.
+    //  Don't sleep if a descriptor still has data from the last pass.
+    //  Unless the logger thread does it, wake up in time to sync an
+    //  idle logfile.
+    */
+    n = eventLoopWait(ready, sizeof(ready) / sizeof(ready[0]),
+                      ((stdinPending && outputQueueSpace(&ptyQueue) > 0)
+                       || (ptyPending && (zeroCopyActive
+                                          || outputQueueSpace(&screenQueue) > 0)))
+                      ? 0 : sinkFlushInline());
+    if (n < 0) {
+      char msgbuf[BUFSIZ];
+      int msglen;
+      char *error = strerror(errno);
+      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "select: %s", error);
+      dologging(LOGSTREAM_META, msgbuf, msglen);
+      exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < n; ++i) {
+      if (ready[i].fd == STDIN_FILENO) {
+        stdinPending = true;
+      } else if (ready[i].fd == STDOUT_FILENO) {
+        screenBlocked = false;
+      } else if (ready[i].fd == masterPty) {
+        if (ready[i].events & EVENTLOOP_READ) {
+          ptyPending = true;
+        }
+        if (ready[i].events & EVENTLOOP_WRITE) {
+          ptyBlocked = false;
+        }
+      }
+    }
+
+    /* handle file descriptors first */
+
+    /*
+    //  Make room in the queues the other side may take from now.
+    */
+    if (!screenBlocked && !outputQueueEmpty(&screenQueue)) {
+      flushScreen();
+    }
+    if (!ptyBlocked && !outputQueueEmpty(&ptyQueue)) {
+      flushPty();
+    }
+    
+    /* 
+    //  The user typed something... 
+    //  Read it and pass it on to the pseudo-tty.
+    //  A single descriptor gets at most DRAINBUDGET reads per pass
+    //  so a flood on one side can't starve the other side or signals.
+    //  Only read as much as the queue to the pty can take.
+    */
+    for (reads = 0; stdinPending && reads < DRAINBUDGET
+           && outputQueueSpace(&ptyQueue) > 0; ++reads) {
+      size_t const room = outputQueueSpace(&ptyQueue) < sizeof(buf)
+        ? outputQueueSpace(&ptyQueue) : sizeof(buf);
+      if ((n = read(0, buf, room)) < 0) {
+        if (EAGAIN == errno || EWOULDBLOCK == errno) {
+          stdinPending = false;
+        } else if (EINTR != errno) {
+          char msgbuf[BUFSIZ];
+          int msglen;
+          char *error = strerror(errno);
+          msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "read - stdin: %s", error);
+          dologging(LOGSTREAM_META, msgbuf, msglen);
+          exit(EXIT_FAILURE);
+        }
+      } else if (n == 0) {
+        /*
+        //  End of file on the user's side, there is nothing more to
+        //  watch there.
+        */
+        eventLoopRemove(STDIN_FILENO);
+        stdinPending = false;
+      } else {
+        outputQueueAppend(&ptyQueue, buf, n);
+        if (!ptyBlocked) {
+          flushPty();
+        }
+      }
+    }
+
+    /* 
+    //  There's output on the pseudo-tty... 
+    //  Read it and pass it on to the screen and the script file.
+    //  Echo is on, so we see here also the users keystrokes.
+    //  Read errors (EIO once the shell is gone) stop the watching of
+    //  the pty, the SIGCHLD handling takes care of the rest. A hung up
+    //  pty would otherwise stay readable and pselect would never get
+    //  around to deliver the signal.
+    */
+    for (reads = 0; ptyPending && reads < DRAINBUDGET; ++reads) {
+      if (zeroCopyActive) {
+        if ((n = zeroCopyRelay(masterPty, STDOUT_FILENO,
+                               logtofile ? logFile : -1)) > 0) {
+          zeroCopyWorks = true;
+          if (logtofile) {
+            durabilityWritten(n);
+          }
+          continue;
+        } else if (n < 0 && EINVAL == errno && !zeroCopyWorks) {
+          /*
+          //  This pty can't be spliced, go the classic way.
+          */
+          zeroCopyActive = false;
+          startSinks(NULL);
+          continue;
+        } else if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+          ptyPending = false;
+        } else if (n == 0 || EINTR != errno) {
+          eventLoopRemove(masterPty);
+          ptyPending = false;
+        }
+      } else if (0 == outputQueueSpace(&screenQueue)) {
+        /* the screen is behind, leave the rest in the pty for now */
+        break;
+      } else if ((n = read(masterPty, buf,
+                           outputQueueSpace(&screenQueue) < sizeof(buf)
+                           ? outputQueueSpace(&screenQueue) : sizeof(buf))) > 0) {
+        dologging(LOGSTREAM_OUT, buf, n);
+        outputQueueAppend(&screenQueue, buf, n);
+        if (!screenBlocked) {
+          flushScreen();
+        }
+      } else if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+        ptyPending = false;
+      } else if (n == 0 || EINTR != errno) {
+        eventLoopRemove(masterPty);
+        ptyPending = false;
+      }
+    }
+
+    /* handle signals next */
+    handleSignals(childPid);
+
+  } /* forever */
+
+  {
+    char const *msg = "rootsh closing duplicated pty";
+    char msgbuf[BUFSIZ];
+    int msglen;
+    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "%s", msg);
+    dologging(LOGSTREAM_META, msgbuf, msglen);
+  }
+
+  exit(EXIT_SUCCESS);
+}
+
+/*
+//  Start the shell with pipes instead of a pty as its stdin, stdout
+//  and stderr. Returns like fork, the parent's ends are left in
+//  shellIn, shellOut and shellErr.
+*/
+static pid_t forkpipes(void) {
+  int in[2], out[2], err[2];
+  pid_t pid;
+
+  if (pipe(in) < 0) {
+    return(-1);
+  }
+  if (pipe(out) < 0) {
+    close(in[0]);
+    close(in[1]);
+    return(-1);
+  }
+  if (pipe(err) < 0) {
+    close(in[0]);
+    close(in[1]);
+    close(out[0]);
+    close(out[1]);
+    return(-1);
+  }
+  if ((pid = fork()) < 0) {
+    close(in[0]);
+    close(in[1]);
+    close(out[0]);
+    close(out[1]);
+    close(err[0]);
+    close(err[1]);
+    return(-1);
+  }
+  if (pid == 0) {
+    /*
+    //  stdin, stdout and stderr are open, so all pipe ends are
+    //  above them and can be closed after the dup2.
+    */
+    dup2(in[0], STDIN_FILENO);
+    dup2(out[1], STDOUT_FILENO);
+    dup2(err[1], STDERR_FILENO);
+    close(in[0]);
+    close(in[1]);
+    close(out[0]);
+    close(out[1]);
+    close(err[0]);
+    close(err[1]);
+    if (logtofile) {
+      close(logFile);
+    }
+    if (logManifest >= 0) {
+      close(logManifest);
+    }
+    if (logIndex >= 0) {
+      close(logIndex);
+    }
+    return(0);
+  }
+  close(in[0]);
+  close(out[1]);
+  close(err[1]);
+  shellIn = in[1];
+  shellOut = out[0];
+  shellErr = err[0];
+  return(pid);
+}
+
+/*
+//  Logging of a batch session.
+//
+//  Without a pty nobody turns LF into CR LF and there is no echo. The
+//  streams are logged line by line, each line ended with CR LF like
+//  terminal output (so syslog gets the same lines), the lines of
+//  stdin and stderr are tagged. Lines longer than BUFSIZ are split.
+//  Complete lines are collected and go to the logging functions in
+//  one piece per pass of the relay, as long as they are of the same
+//  stream.
+*/
+struct batchStream {
+  char const *tag;
+  char line[BUFSIZ];
+  size_t length;
+};
+
+static struct batchStream batchStreams[LOGSTREAM_META] = {
+  { "stdin: ", "", 0 },
+  { "", "", 0 },
+  { "stderr: ", "", 0 }
+};
+
+#define BATCHLOGSIZE 65536
+static char batchLog[BATCHLOGSIZE];
+static size_t batchLogLength = 0;
+static enum logStream batchLogStream = LOGSTREAM_OUT;
+
+static void batchLogFlush(void) {
+  if (batchLogLength > 0) {
+    dologging(batchLogStream, batchLog, batchLogLength);
+    batchLogLength = 0;
+  }
+}
+
+static void batchLogAppend(enum logStream const id, char const * const data,
+                           size_t const len) {
+  if (batchLogLength + len > sizeof(batchLog) || id != batchLogStream) {
+    batchLogFlush();
+    batchLogStream = id;
+  }
+  memcpy(batchLog + batchLogLength, data, len);
+  batchLogLength += len;
+}
+
+static void batchLogLine(enum logStream const id) {
+  struct batchStream * const stream = &batchStreams[id];
+
+  /* the shell's own CR LF doesn't get a second CR */
+  if (stream->length > 0 && '\r' == stream->line[stream->length - 1]) {
+    --stream->length;
+  }
+  batchLogAppend(id, stream->tag, strlen(stream->tag));
+  batchLogAppend(id, stream->line, stream->length);
+  batchLogAppend(id, "\r\n", 2);
+  stream->length = 0;
+}
+
+static void batchLogData(enum logStream const id, char const *data, size_t len) {
+  struct batchStream * const stream = &batchStreams[id];
+
+  while (len > 0) {
+    char const * const newline = memchr(data, '\n', len);
+    size_t const lineLength = newline ? (size_t)(newline - data) : len;
+    size_t done = 0;
+
+    while (done < lineLength) {
+      size_t part = sizeof(stream->line) - stream->length;
+      if (part > lineLength - done) {
+        part = lineLength - done;
+      }
+      memcpy(stream->line + stream->length, data + done, part);
+      stream->length += part;
+      done += part;
+      if (sizeof(stream->line) == stream->length) {
+        batchLogLine(id);
+      }
+    }
+    if (newline) {
+      batchLogLine(id);
+      ++done;
+    }
+    data += done;
+    len -= done;
+  }
+}
+
+/*
+//  A stream ended, log its last line even without a newline.
+*/
+static void batchLogEnd(enum logStream const id) {
+  if (batchStreams[id].length > 0) {
+    batchLogLine(id);
+  }
+}
+
+/*
+//  Hand queued output to stdout or stderr. If the reader went away
+//  the session goes on, its output is still logged but dropped.
+*/
+static void flushBatchOutput(struct outputQueue * const queue, int const fd,
+                             bool * const blocked, bool * const gone) {
+  if (!flushQueue(queue, fd, 0, blocked)) {
+    char msgbuf[BUFSIZ];
+    int msglen;
+    char *error = strerror(errno);
+    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "write - %s: %s",
+                      STDOUT_FILENO == fd ? "stdout" : "stderr", error);
+    dologging(LOGSTREAM_META, msgbuf, msglen);
+    outputQueueClear(queue);
+    eventLoopRemove(fd);
+    *gone = true;
+  }
+}
+
+/*
+//  Read one of the shell's output pipes until EAGAIN, the end of the
+//  file, a full queue or the end of the budget.
+//  Returns false at the end of the file or on error, the pipe is
+//  closed then.
+*/
+static bool readBatchOutput(int * const fd, enum logStream const id,
+                            struct outputQueue * const queue, bool const gone,
+                            int const budget, bool * const pending) {
+  char buf[BUFSIZ * 8];
+  int reads;
+  ssize_t n;
+
+  for (reads = 0; *pending && reads < budget; ++reads) {
+    size_t room = sizeof(buf);
+    if (!gone) {
+      if (0 == outputQueueSpace(queue)) {
+        /* the reader is behind, leave the rest in the pipe for now */
+        break;
+      }
+      if (outputQueueSpace(queue) < room) {
+        room = outputQueueSpace(queue);
+      }
+    }
+    if ((n = read(*fd, buf, room)) > 0) {
+      batchLogData(id, buf, n);
+      if (!gone) {
+        outputQueueAppend(queue, buf, n);
+      }
+    } else if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+      *pending = false;
+    } else if (n < 0 && EINTR == errno) {
+      continue;
+    } else {
+      batchLogEnd(id);
+      eventLoopRemove(*fd);
+      close(*fd);
+      *fd = -1;
+      *pending = false;
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+//  The relay of a batch session: stdin goes to the shell's stdin,
+//  its stdout and stderr to ours. Nothing blocks, like in
+//  logSession. When stdin ends and everything read from it is
+//  written, the shell's stdin is closed, so the shell sees the end
+//  of its input too.
+*/
+static void batchSession(const int childPid) {
+  /*
+  //  signals		The signals delivered through the event loop.
+  //
+  //  ready		The descriptors reported by the event loop.
+  //
+  //  stdinOpen		We did not yet read the end of stdin.
+  //
+  //  stdinPending	The event loop reported the descriptor as
+  //  outPending	readable and we did not yet read it up to EAGAIN.
+  //  errPending
+  //
+  //  stdoutGone	Writing to our stdout or stderr failed, the
+  //  stderrGone	shell's output is only logged from now on.
+  */
+  static int const signals[] = { SIGINT, SIGQUIT, SIGCHLD };
+  struct eventLoopEvent ready[6];
+  char buf[BUFSIZ * 8];
+  int n, i, reads;
+  bool stdinOpen = true;
+  bool stdinPending = false;
+  bool outPending = false;
+  bool errPending = false;
+  bool stdoutGone = false;
+  bool stderrGone = false;
+
+  sigIntReceived = 0;
+  sigQuitReceived = 0;
+  sigChldReceived = 0;
+
+  /*
+  //  A shell that stopped reading its stdin must not kill us with
+  //  SIGPIPE. The shell was started already, it keeps the default.
+  */
+  signal(SIGPIPE, SIG_IGN);
+
+  startSinks(NULL);
+
+  stdinFlags = setNonBlocking(STDIN_FILENO);
+  stdoutFlags = setNonBlocking(STDOUT_FILENO);
+  stderrFlags = setNonBlocking(STDERR_FILENO);
+  if (setNonBlocking(shellIn) < 0
+      || setNonBlocking(shellOut) < 0
+      || setNonBlocking(shellErr) < 0
+      || !outputQueueInit(&screenQueue, OUTPUTQUEUESIZE)
+      || !outputQueueInit(&errQueue, OUTPUTQUEUESIZE)
+      || !outputQueueInit(&ptyQueue, OUTPUTQUEUESIZE)
+      || !eventLoopOpen(signals, sizeof(signals) / sizeof(signals[0]), signalHandler)
+      || !eventLoopAdd(STDIN_FILENO, EVENTLOOP_READ)
+      || !eventLoopAdd(shellOut, EVENTLOOP_READ)
+      || !eventLoopAdd(shellErr, EVENTLOOP_READ)
+      || !eventLoopAdd(shellIn, 0)
+      || !eventLoopAdd(STDOUT_FILENO, 0)
+      || !eventLoopAdd(STDERR_FILENO, 0)) {
+    char msgbuf[BUFSIZ];
+    int msglen;
+    char *error = strerror(errno);
+    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "event loop: %s", error);
+    dologging(LOGSTREAM_META, msgbuf, msglen);
+    exit(EXIT_FAILURE);
+  }
+
+  for (;;) {
+    n = eventLoopWait(ready, sizeof(ready) / sizeof(ready[0]),
+                      ((stdinPending && outputQueueSpace(&ptyQueue) > 0)
+                       || (outPending && (stdoutGone
+                                          || outputQueueSpace(&screenQueue) > 0))
+                       || (errPending && (stderrGone
+                                          || outputQueueSpace(&errQueue) > 0)))
+                      ? 0 : sinkFlushInline());
+    if (n < 0) {
+      char msgbuf[BUFSIZ];
+      int msglen;
+      char *error = strerror(errno);
+      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "select: %s", error);
+      dologging(LOGSTREAM_META, msgbuf, msglen);
+      exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < n; ++i) {
+      if (ready[i].fd == STDIN_FILENO) {
+        stdinPending = true;
+      } else if (ready[i].fd == STDOUT_FILENO) {
+        screenBlocked = false;
+      } else if (ready[i].fd == STDERR_FILENO) {
+        errBlocked = false;
+      } else if (ready[i].fd == shellOut) {
+        outPending = true;
+      } else if (ready[i].fd == shellErr) {
+        errPending = true;
+      } else if (ready[i].fd == shellIn) {
+        ptyBlocked = false;
+      }
+    }
+
+    if (!screenBlocked && !outputQueueEmpty(&screenQueue)) {
+      flushBatchOutput(&screenQueue, STDOUT_FILENO, &screenBlocked, &stdoutGone);
+    }
+    if (!errBlocked && !outputQueueEmpty(&errQueue)) {
+      flushBatchOutput(&errQueue, STDERR_FILENO, &errBlocked, &stderrGone);
+    }
+    if (shellIn >= 0 && !ptyBlocked && !outputQueueEmpty(&ptyQueue)
+        && !flushQueue(&ptyQueue, shellIn, 0, &ptyBlocked)) {
+      /*
+      //  The shell closed its stdin, whatever else comes from ours
+      //  is only logged.
+      */
+      outputQueueClear(&ptyQueue);
+      eventLoopRemove(shellIn);
+      close(shellIn);
+      shellIn = -1;
+    }
+
+    /*
+    //  Forward stdin. Unless nobody takes it anymore, only read as
+    //  much as the queue to the shell can take.
+    */
+    for (reads = 0; stdinPending && reads < DRAINBUDGET; ++reads) {
+      size_t room = sizeof(buf);
+      if (shellIn >= 0) {
+        if (0 == outputQueueSpace(&ptyQueue)) {
+          break;
+        }
+        if (outputQueueSpace(&ptyQueue) < room) {
+          room = outputQueueSpace(&ptyQueue);
+        }
+      }
+      if ((n = read(STDIN_FILENO, buf, room)) < 0) {
+        if (EAGAIN == errno || EWOULDBLOCK == errno) {
+          stdinPending = false;
+        } else if (EINTR != errno) {
+          char msgbuf[BUFSIZ];
+          int msglen;
+          char *error = strerror(errno);
+          msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "read - stdin: %s", error);
+          dologging(LOGSTREAM_META, msgbuf, msglen);
+          exit(EXIT_FAILURE);
+        }
+      } else if (n == 0) {
+        batchLogEnd(LOGSTREAM_IN);
+        eventLoopRemove(STDIN_FILENO);
+        stdinOpen = false;
+        stdinPending = false;
+      } else {
+        batchLogData(LOGSTREAM_IN, buf, n);
+        if (shellIn >= 0) {
+          outputQueueAppend(&ptyQueue, buf, n);
+          if (!ptyBlocked && !flushQueue(&ptyQueue, shellIn, 0, &ptyBlocked)) {
+            outputQueueClear(&ptyQueue);
+            eventLoopRemove(shellIn);
+            close(shellIn);
+            shellIn = -1;
+          }
+        }
+      }
+    }
+
+    /*
+    //  The half-close: the end of stdin reaches the shell once all
+    //  of stdin did.
+    */
+    if (!stdinOpen && shellIn >= 0 && outputQueueEmpty(&ptyQueue)) {
+      eventLoopRemove(shellIn);
+      close(shellIn);
+      shellIn = -1;
+    }
+
+    if (shellOut >= 0) {
+      readBatchOutput(&shellOut, LOGSTREAM_OUT, &screenQueue, stdoutGone,
+                      DRAINBUDGET, &outPending);
+      if (!stdoutGone && !screenBlocked && !outputQueueEmpty(&screenQueue)) {
+        flushBatchOutput(&screenQueue, STDOUT_FILENO, &screenBlocked, &stdoutGone);
+      }
+    }
+    if (shellErr >= 0) {
+      readBatchOutput(&shellErr, LOGSTREAM_ERR, &errQueue, stderrGone,
+                      DRAINBUDGET, &errPending);
+      if (!stderrGone && !errBlocked && !outputQueueEmpty(&errQueue)) {
+        flushBatchOutput(&errQueue, STDERR_FILENO, &errBlocked, &stderrGone);
+      }
+    }
+    batchLogFlush();
+
+    if (sigIntReceived || sigQuitReceived || sigChldReceived) {
+      if (sigChldReceived) {
+        /*
+        //  Collect what the shell wrote before it exited. Bounded,
+        //  as a background job may still be writing to the pipes.
+        */
+        for (reads = 0; reads < DRAINBUDGET
+               && (shellOut >= 0 || shellErr >= 0); ++reads) {
+          outPending = shellOut >= 0;
+          errPending = shellErr >= 0;
+          if (shellOut >= 0) {
+            flushQueueBlocking(&screenQueue, STDOUT_FILENO);
+            readBatchOutput(&shellOut, LOGSTREAM_OUT, &screenQueue, stdoutGone,
+                            1, &outPending);
+          }
+          if (shellErr >= 0) {
+            flushQueueBlocking(&errQueue, STDERR_FILENO);
+            readBatchOutput(&shellErr, LOGSTREAM_ERR, &errQueue, stderrGone,
+                            1, &errPending);
+          }
+          if (!outPending && !errPending) {
+            break;
+          }
+        }
+      }
+      batchLogEnd(LOGSTREAM_OUT);
+      batchLogEnd(LOGSTREAM_ERR);
+      batchLogFlush();
+      flushQueueBlocking(&screenQueue, STDOUT_FILENO);
+      flushQueueBlocking(&errQueue, STDERR_FILENO);
+      finish();
+    }
+  } /* forever */
+}
+
+void execShell(const char *shell, const char *shellCommands) {
+  /*
+  //
+  //  dashShell		The basename of shell, prepended with "-".
+  //  
+  //  sucmd		The path to the su command.
   //
   */
   char *dashShell;
   char *sucmd = SUCMD;
   
+  maskRelaySignals(SIG_UNBLOCK);
+  /* 
+  //  This process will exec a shell.
+  //  If rootsh was called with the -u user parameter, we will exec
+  //  su user instead of a shell.
+  */
+  if (runAsUser) {
+    shell = sucmd;
+  }
+  /*
+  //  If rootsh was called with the -i parameter (initial login)
+  //  then prepend the shell's basename with a dash,
+  //  otherwise call it as an interactive shell, unless there is no
+  //  terminal for it (batch mode).
+  */
+  if (useLoginShell) {
+    char *slash;
+    dashShell = strdup(shell);
+    slash = strchr(dashShell, '/');
+    *slash = '-';
+  } else {
+    dashShell = NULL;
+  }
+  if (runAsUser && useLoginShell && shellCommands) {
+    execl(shell, (strrchr(shell, '/') + 1), "-", runAsUser, "-c", shellCommands, (char *)NULL);
+  } else if (runAsUser && useLoginShell && !shellCommands) {
+    execl(shell, (strrchr(shell, '/') + 1), "-", runAsUser, (char *)NULL);
+  } else if (runAsUser && !useLoginShell && shellCommands) {
+    execl(shell, (strrchr(shell, '/') + 1), runAsUser, "-c", shellCommands, (char *)NULL);
+  } else if (runAsUser && !useLoginShell && !shellCommands) {
+    execl(shell, (strrchr(shell, '/') + 1), runAsUser, (char *)NULL);
+  } else if (!runAsUser && useLoginShell && shellCommands) {
+    execl(shell, dashShell, "-c", shellCommands, (char *)NULL);
+  } else if (!runAsUser && useLoginShell && !shellCommands) {
+    execl(shell, dashShell, (char *)NULL);
+  } else if (!runAsUser && !useLoginShell && shellCommands && batchMode) {
+    execl(shell, (strrchr(shell, '/') + 1), "-c", shellCommands, (char *)NULL);
+  } else if (!runAsUser && !useLoginShell && !shellCommands && batchMode) {
+    execl(shell, (strrchr(shell, '/') + 1), (char *)NULL);
+  } else if (!runAsUser && !useLoginShell && shellCommands) {
+    execl(shell, (strrchr(shell, '/') + 1), "-i", "-c", shellCommands, (char *)NULL);
+  } else if (!runAsUser && !useLoginShell && !shellCommands) {
+    execl(shell, (strrchr(shell, '/') + 1), "-i", (char *)NULL);
+  } else {
+    perror(shell);
+  }
+
+  
+  perror(progName);
+  exit(EXIT_FAILURE);
+}
+
+/**
+ * Consume the remaining args and append them to shellCommands.
+ * 
+ * @return the new value of shellCommands
+ */
+char * consume_remaining_args(int argc, char **argv, char *shellCommands) {
+  char *realloc_retval;
+  while (optind < argc) {
+    if (! shellCommands) {
+      shellCommands = calloc(sizeof(char), 1);
+      if(NULL == shellCommands) {
+        fprintf(stderr, "Cannot allocate memory for shellCommands\n");
+        exit(EXIT_FAILURE);
+      }
+    }
+    realloc_retval = realloc(shellCommands, 
+                            strlen(shellCommands) + strlen(argv[optind]) + 2);
+    if(NULL == realloc_retval) {
+      free(shellCommands);
+      fprintf(stderr, "Cannot allocate memory for shellCommands\n");
+      exit(EXIT_FAILURE);
+    } else {
+      shellCommands = realloc_retval;
+    }
+    strcat(shellCommands, argv[optind]);
+    strcat(shellCommands, " ");
+    optind++;
+  }
+  return shellCommands;
+}
+
+/* 
+//  Do some cleaning after the child exited.
+//  Restore original tty modes.
+//  Send some final words to the logging function.
+*/
+void finish(void) {
+  /*
+  //  msgbuf	A buffer where a variable text will be written.
+  //
+  //  msglen	Counts how many characters have been written.
+  //
+  */
+  char msgbuf[BUFSIZ];
+  int msglen;
+  pid_t pid;
+  int status;
+  int exitStatus = EXIT_SUCCESS;
+  
+  if(isatty(0)) {
+    if (tcsetattr(0, TCSANOW, &termParams) < 0) {
+      perror("tcsetattr: stdin");
+    }
+  }
+  /*
+  //  stdout's (and stderr's) flags were taken after stdin was switched,
+  //  so they go back in reverse order in case they are the same file.
+  */
+  if(stderrFlags != -1) {
+    fcntl(STDERR_FILENO, F_SETFL, stderrFlags);
+  }
+  if(stdoutFlags != -1) {
+    fcntl(STDOUT_FILENO, F_SETFL, stdoutFlags);
+  }
+  if(stdinFlags != -1) {
+    fcntl(STDIN_FILENO, F_SETFL, stdinFlags);
+  }
+  
+  pid = wait(&status);
+  if(pid < 0) {
+    char *error = strerror(errno);
+    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "Error getting status of child process: %s", error);
+    dologging(LOGSTREAM_META, msgbuf, msglen);
+    exitStatus = EXIT_FAILURE;
+  } else {
+    if(WIFEXITED(status)) {
+      exitStatus = WEXITSTATUS(status);
+      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
+                        "\n*** %s session ended by user\r\n", progName);
+      dologging(LOGSTREAM_META, msgbuf, msglen);
+    } else if(WIFSIGNALED(status)) {
+      int const sig = WTERMSIG(status);
+      
+      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
+                        "\n*** %s session interrupted by signal %d\r\n", progName, sig);
+      dologging(LOGSTREAM_META, msgbuf, msglen);
+      exitStatus = EXIT_FAILURE;
+    } else {
+      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
+                        "\n*** %s session ended for unknown reason\r\n", progName);
+      dologging(LOGSTREAM_META, msgbuf, msglen);
+      exitStatus = EXIT_FAILURE;
+    }
+  } /* got status from wait */
+  
+  endlogging();
+  if (masterPty >= 0) {
+    close(masterPty);
+  }
+  zeroCopyClose();
+  exit(exitStatus);
+}
+
+
+/*
+//  Write to a logfile segment, in the framed format as one record.
+//  Returns the bytes that went into the file before compression, -1
+//  on error.
+*/
+
+static ssize_t segmentwrite(struct logSegment * const segment,
+                            struct sinkRecord const * const record,
+                            char const * const data, size_t const length) {
+  if (logFramed) {
+    return logFrameWrite(&segment->frame, record->stream, record->time, data, length);
+  }
+  if (NULL != segment->compress) {
+    struct iovec vector;
+
+    vector.iov_base = (char *)data;
+    vector.iov_len = length;
+    return logCompressWritev(segment->compress, record->time, &vector, 1)
+      ? (ssize_t)length : -1;
+  }
+  return write(segment->fd, data, length);
+}
+
+
+/*
+//  Write a batch of raw output to a logfile segment at once. Returns
+//  the bytes that went into the file before compression, -1 on error.
+*/
+
+static ssize_t segmentwritev(struct logSegment * const segment,
+                             unsigned long long const time,
+                             struct iovec *vector, int count) {
+  ssize_t total = 0;
+  int i;
+
+  for (i = 0; i < count; ++i) {
+    total += vector[i].iov_len;
+  }
+  if (NULL != segment->compress) {
+    return logCompressWritev(segment->compress, time, vector, count) ? total : -1;
+  }
+  while (count > 0) {
+    ssize_t written = writev(segment->fd, vector, count);
+    if (written < 0 && EINTR == errno) {
+      continue;
+    } else if (written <= 0) {
+      if (0 == written) {
+        errno = EIO;
+      }
+      return -1;
+    }
+    while (count > 0 && (size_t)written >= vector->iov_len) {
+      written -= vector->iov_len;
+      ++vector;
+      --count;
+    }
+    if (count > 0) {
+      vector->iov_base = (char *)vector->iov_base + written;
+      vector->iov_len -= written;
+    }
+  }
+  return total;
+}
+
+
+/*
+//  Write a message of rootsh to a logfile segment.
+*/
+
+static ssize_t segmentmessage(struct logSegment * const segment,
+                              char const * const msgbuf, int const msglen) {
+  struct sinkRecord record;
+
+  record.stream = LOGSTREAM_META;
+  record.time = sinkNow();
+  return segmentwrite(segment, &record, msgbuf, msglen);
+}
+
+
+/* 
+//  Open a logfile and initialize syslog. 
+//  Remember the logfile's inode and device for later comparison.
+//  Send introducing lines to the logging functions.
+*/
+
+int beginlogging(const char *shellCommands) {
+  /*
+  //  msgbuf		A buffer where a variable text will be written.
+  //  
+  //  msglen		Counts how many characters have been written.
+  */
+  int msglen;
+  char msgbuf[BUFSIZ];
+
+  if (!logtofile && !logtosyslog) {
+    fprintf(stderr, "you cannot switch off both file and syslog logging\n");
+    return (0);
+  }
+
+  /*
+  //  Each sink gets its own queue, syslog doesn't block by default.
+  */
+  if (logtofile) {
+    fileSink.queueSize = SIZE_MAX == fileQueueSize ? logQueueSize : fileQueueSize;
+    fileSink.queueFull = fileQueueFull < 0 ? logQueueFull
+      : (enum logQueueFull)fileQueueFull;
+    sinkRegister(&fileSink);
+  }
+  if (logtosyslog) {
+    syslogSink.queueSize = SIZE_MAX == syslogQueueSize ? logQueueSize : syslogQueueSize;
+    syslogSink.queueFull = syslogQueueFull >= 0 ? (enum logQueueFull)syslogQueueFull
+      : (logQueueFullSet ? logQueueFull : LOGQUEUE_SPILL);
+    sinkRegister(&syslogSink);
+  }
+  if (!sinkOpenAll()) {
+    return(0);
+  }
+
+  if(NULL != shellCommands) {
+    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
+                      "shell commands: %s\n", shellCommands);
+    dologging(LOGSTREAM_META, msgbuf, msglen);
+  }
+  
+  return(1);
+}
+
+
+/*
+//  Name the logfile, open its first segment and note the start of
+//  the session in it.
+*/
+
+static bool openFileSink(void) {
+  /*
+  //  msgbuf		A buffer where a variable text will be written.
+  //  
+  //  msglen		Counts how many characters have been written.
+  //  
+  //  now		A structure filled with the current time.
+  //  
+  //  sec, min, hour	Components of now.
+  //  
+  //  day, month, year	Components of now.
+  //  
+  */
+  int msglen;
+  ssize_t written;
+  char msgbuf[BUFSIZ];
+  time_t now;
+  char const * user = runAsUser ? runAsUser : getpwuid(getuid())->pw_name;
+  char const * const rawtty = ttyname(0);
+  char const * const tty = rawtty == 0 ? "" : rawtty;
+  int sec, min, hour, day, month, year;
+  int length;
+  char defLogFileName[MAXPATHLEN - 7];
+
+  /*
+  //  defLogFileName	The name of the logfile how it will be called,
+  //			if the user did not provide his own name.
+  //			Made up from username, a timestamp and the
+  //			process id.
+  //  
+  //  Construct the logfile name. 
+  //  logdir/<username>.YYYY.MM.DD.HH.MI.SS.<sessionId>
+  //  In standalone mode, a user may propose his own filename
+  //  When the session is over, the logfile will be renamed 
+  //  to <logfile>.closed.
+  //  If we don't log to a file at all, don't mention 
+  //  a filename in the syslog logs.
+  */
+  now = time(NULL);
+  year = localtime(&now)->tm_year + 1900;
+  month = localtime(&now)->tm_mon + 1;
+  day = localtime(&now)->tm_mday;
+  hour = localtime(&now)->tm_hour;
+  min = localtime(&now)->tm_min;
+  sec = localtime(&now)->tm_sec;
+  if ((size_t)snprintf(defLogFileName, sizeof(defLogFileName),
+      "%s.%04d%02d%02d%02d%02d%02d.%05d", 
+       userName, year,month, day, hour, min, sec, getpid())
+      >= sizeof(defLogFileName)) {
+    fprintf(stderr, "Name for the logfile of %s is too long\n", userName);
+    return false;
+  }
+  /*
+  //  A name that doesn't fit is refused, a cut one would be some
+  //  other file.
+  */
+  if (standalone) {
+    if (userLogFileName && userLogFileDir) {
+      length = snprintf(logFileName, (sizeof(logFileName) - 1), "%s/%s",
+          userLogFileDir, userLogFileName);
+    } else if (userLogFileName && ! userLogFileDir) {
+      if (userLogFileName[0] == '/') {
+        length = snprintf(logFileName, (sizeof(logFileName) - 1), "%s",
+            userLogFileName);
+      } else {
+        length = snprintf(logFileName, (sizeof(logFileName) - 1), "./%s",
+            userLogFileName);
+      }
+    } else if (! userLogFileName && userLogFileDir) {
+      length = snprintf(logFileName, (sizeof(logFileName) - 1), "%s/%s",
+          userLogFileDir, defLogFileName);
+    } else {
+      length = snprintf(logFileName, (sizeof(logFileName) - 1), "%s/%s",
+          logdir, defLogFileName);
+    }
+  } else {
+    length = snprintf(logFileName, (sizeof(logFileName) - 1), "%s/%s",
+        logdir, defLogFileName);
+  }
+  if (length < 0 || (size_t)length >= sizeof(logFileName) - 1) {
+    fprintf(stderr, "Name for the logfile %s is too long\n", logFileName);
+    return false;
+  }
+  /*
+  //  With a size limit the manifest lists the segments.
+  */
+  if (maxLogFileSize > 0) {
+    char manifestName[MAXPATHLEN + 16];
+    snprintf(manifestName, sizeof(manifestName), "%s.manifest", logFileName);
+    if ((logManifest = open(manifestName,
+        O_WRONLY|O_CREAT|O_TRUNC|O_APPEND|durabilityOpenFlags(logDurability),
+        S_IRUSR|S_IWUSR)) == -1) {
+      perror(manifestName);
+      return false;
+    }
+  }
+  /* 
+  //  Open the logfile 
+  */
+  if (!openlogsegment()) {
+    return false;
+  }
+  /* 
+  //  Note the start time in the log file.
+  */
+  msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
+      "%s%s session opened for %s as %s on %s at %s", 
+       isaLoginShell ? "login " : "", progName, userName, 
+       user, 
+       tty, ctime(&now));
+  if((written = segmentmessage(&logSegments[logSegmentCount - 1], msgbuf, msglen)) < 0) {
+    perror(logFileName);
+    return false;
+  }
+  durabilityWritten(written);
+  logFileSize += written;
+  return true;
+}
+
+
+/*
+//  Set up syslog with the session id as prefix and note the start of
+//  the session there.
+*/
+
+static bool openSyslogSink(void) {
+  char const * user = runAsUser ? runAsUser : getpwuid(getuid())->pw_name;
+  char const * const rawtty = ttyname(0);
+  char const * const tty = rawtty == 0 ? "" : rawtty;
+
+  write2syslogCharset(syslogCharset);
+  write2syslogLineLimit(syslogLineLimit);
+  write2syslogRateLimit(syslogRate, syslogBurst);
   /* 
-  //  This process will exec a shell.
-  //  If rootsh was called with the -u user parameter, we will exec
-  //  su user instead of a shell.
+  //  Prepare usage of syslog with sessionid as prefix.
   */
-  if (runAsUser) {
-    shell = sucmd;
+  if(syslogLogUsername) {
+    static char sessionIdWithUid[sizeof(sessionId) + 10];
+    snprintf(sessionIdWithUid, sizeof(sessionIdWithUid), "%s: %s",
+             sessionId, userName);
+    openlog(sessionIdWithUid, LOG_NDELAY, SYSLOGFACILITY);
+  } else {
+    openlog(sessionId, LOG_NDELAY, SYSLOGFACILITY);
+  }
+  if(SYSLOGFORMAT_JOURNAL == syslogFormat
+     && !journaldOpen(JOURNALDPATH, *progName == '-' ? progName + 1 : progName,
+                      getpid(), sessionId, userName, user, tty)) {
+    /*
+    //  No journald, maybe a syslog daemon.
+    */
+    syslogFormat = SYSLOGFORMAT_RFC3164;
   }
   /*
-  //  If rootsh was called with the -i parameter (initial login)
-  //  then prepend the shell's basename with a dash,
-  //  otherwise call it as an interactive shell.
+  //  journald has no use for the client and its spool.
   */
-  if (useLoginShell) {
-    char *slash;
-    dashShell = strdup(shell);
-    slash = strchr(dashShell, '/');
-    *slash = '-';
-  } else {
-    dashShell = NULL;
+  if(SYSLOGFORMAT_RFC3164 == syslogFormat || SYSLOGFORMAT_RFC5424 == syslogFormat) {
+    if(!syslogClientOpen(SYSLOGCLIENTPATH, syslogFormat,
+                         *progName == '-' ? progName + 1 : progName,
+                         getpid(), syslogLogUsername ? userName : NULL)) {
+      /*
+      //  No local daemon listening on a datagram socket, syslog(3)
+      //  knows the other ways and stays quiet about failures.
+      */
+      syslogFormat = SYSLOGFORMAT_LIBC;
+    } else if(syslogSpoolSize > 0) {
+      /* logdir, '/', sessionId and ".syslog", the sizes count the NULs */
+      char spoolName[sizeof(logdir) + sizeof(sessionId) + sizeof(".syslog")];
+      /*
+      //  The spool lives next to the logfile like the spill file.
+      */
+      if (logtofile) {
+        snprintf(spoolName, sizeof(spoolName), "%s.syslog", logFileName);
+      } else {
+        snprintf(spoolName, sizeof(spoolName), "%s/%s.syslog", logdir, sessionId);
+      }
+      if (!syslogClientSpool(spoolName, (off_t)syslogSpoolSize)) {
+        fprintf(stderr, "Spool file name %s is too long, syslog is not spooled\n",
+                spoolName);
+      }
+    }
   }
-  if (runAsUser && useLoginShell && shellCommands) {
-    execl(shell, (strrchr(shell, '/') + 1), "-", runAsUser, "-c", shellCommands, (char *)NULL);
-  } else if (runAsUser && useLoginShell && !shellCommands) {
-    execl(shell, (strrchr(shell, '/') + 1), "-", runAsUser, (char *)NULL);
-  } else if (runAsUser && !useLoginShell && shellCommands) {
-    execl(shell, (strrchr(shell, '/') + 1), runAsUser, "-c", shellCommands, (char *)NULL);
-  } else if (runAsUser && !useLoginShell && !shellCommands) {
-    execl(shell, (strrchr(shell, '/') + 1), runAsUser, (char *)NULL);
-  } else if (!runAsUser && useLoginShell && shellCommands) {
-    execl(shell, dashShell, "-c", shellCommands, (char *)NULL);
-  } else if (!runAsUser && useLoginShell && !shellCommands) {
-    execl(shell, dashShell, (char *)NULL);
-  } else if (!runAsUser && !useLoginShell && shellCommands) {
-    execl(shell, (strrchr(shell, '/') + 1), "-i", "-c", shellCommands, (char *)NULL);
-  } else if (!runAsUser && !useLoginShell && !shellCommands) {
-    execl(shell, (strrchr(shell, '/') + 1), "-i", (char *)NULL);
+  if('\0' != syslogRemote[0]
+     && !syslogTcpOpen(syslogRemote, *progName == '-' ? progName + 1 : progName,
+                       getpid(), sessionId, userName, tty)) {
+    if (ENAMETOOLONG == errno) {
+      fprintf(stderr, "Session data for syslog.remote is too long, not sending to %s\n",
+              syslogRemote);
+    } else {
+      fprintf(stderr, "Configured value for syslog.remote: '%s' is not host:port\n",
+              syslogRemote);
+    }
+  }
+  /* 
+  //  Note the log file name in syslog if there is one.
+  */
+  if (logtofile) {
+    write2syslogMessage(SYSLOGFACILITY, SYSLOGPRIORITY, 
+        "%s=%s,%s: logging new %ssession (%s) to %s", 
+        userName, user, 
+        tty, isaLoginShell ? "login " : "", sessionId, logFileName);
   } else {
-    perror(shell);
+    write2syslogMessage(SYSLOGFACILITY, SYSLOGPRIORITY, 
+        "%s=%s,%s: logging new %ssession (%s)", 
+        userName, user, 
+        tty, isaLoginShell ? "login " : "", sessionId);
   }
+  return true;
+}
 
-  
-  perror(progName);
-  exit(EXIT_FAILURE);
+
+/*
+//  Send a buffer full of output to the selected logging destinations.
+//  The sinks with a logger thread only get a copy in their queue.
+*/
+
+void dologging(enum logStream const stream, char *msgbuf, int msglen) {
+  sinkPushAll(stream, msgbuf, msglen);
 }
 
-/**
- * Consume the remaining args and append them to shellCommands.
- * 
- * @return the new value of shellCommands
- */
-char * consume_remaining_args(int argc, char **argv, char *shellCommands) {
-  char *realloc_retval;
-  while (optind < argc) {
-    if (! shellCommands) {
-      shellCommands = calloc(sizeof(char), 1);
-      if(NULL == shellCommands) {
-        fprintf(stderr, "Cannot allocate memory for shellCommands\n");
-        exit(EXIT_FAILURE);
+
+/*
+//  Write to the local logfile. Output that doesn't fit into the
+//  current logfile segment starts the next one. A framed record is
+//  not split, it starts the next segment as a whole.
+*/
+
+static void writeFileRecord(struct sinkRecord const *record, char *msgbuf, int msglen) {
+  char const *data = msgbuf;
+  int left = msglen;
+
+  if (logFramed) {
+    ssize_t written;
+
+    if (logFileFull) {
+      return;
+    }
+    if (maxLogFileSize > 0 && logFileSize > LOGFRAMEHEADERSIZE
+        && logFileSize + LOGFRAMEMAXRECORDHEADER + msglen > maxLogFileSize
+        && !openlogsegment()) {
+      return;
+    }
+    if ((written = segmentwrite(&logSegments[logSegmentCount - 1], record,
+                                msgbuf, msglen)) < 0) {
+      perror("Error writing to logfile");
+      return;
+    }
+    durabilityWritten(written);
+    logFileSize += written;
+    return;
+  }
+
+  while (left > 0 && !logFileFull) {
+    int chunk = left;
+    ssize_t written;
+
+    if (maxLogFileSize > 0) {
+      if (logFileSize >= maxLogFileSize) {
+        if (!openlogsegment()) {
+          break;
+        }
+        continue;
+      }
+      if ((unsigned long long)chunk > maxLogFileSize - logFileSize) {
+        chunk = (int)(maxLogFileSize - logFileSize);
       }
     }
-    realloc_retval = realloc(shellCommands, 
-                            strlen(shellCommands) + strlen(argv[optind]) + 2);
-    if(NULL == realloc_retval) {
-      free(shellCommands);
-      fprintf(stderr, "Cannot allocate memory for shellCommands\n");
-      exit(EXIT_FAILURE);
-    } else {
-      shellCommands = realloc_retval;
+    if ((written = segmentwrite(&logSegments[logSegmentCount - 1], record,
+                                data, chunk)) < 0) {
+      perror("Error writing to logfile");
+      break;
     }
-    strcat(shellCommands, argv[optind]);
-    strcat(shellCommands, " ");
-    optind++;
+    durabilityWritten(written);
+    logFileSize += written;
+    data += written;
+    left -= written;
   }
-  return shellCommands;
 }
 
-/* 
-//  Do some cleaning after the child exited.
-//  Restore original tty modes.
-//  Send some final words to the logging function.
+
+/*
+//  Raw output that fits into the current segment is written with one
+//  writev, the framed format and output that starts the next segment
+//  go record by record.
 */
-void finish(void) {
+
+static void writeFileSink(struct sinkBatchEntry const *batch, int count) {
+  int i;
+
+  if (!logFramed && !logFileFull && count > 1) {
+    struct iovec vector[SINKBATCHSIZE];
+    unsigned long long total = 0;
+    ssize_t written;
+
+    for (i = 0; i < count; ++i) {
+      vector[i].iov_base = batch[i].data;
+      vector[i].iov_len = batch[i].length;
+      total += batch[i].length;
+    }
+    if (0 == maxLogFileSize || logFileSize + total <= maxLogFileSize) {
+      if ((written = segmentwritev(&logSegments[logSegmentCount - 1],
+                                   batch[0].record.time, vector, count)) < 0) {
+        perror("Error writing to logfile");
+        return;
+      }
+      durabilityWritten(written);
+      logFileSize += written;
+      return;
+    }
+  }
+  for (i = 0; i < count; ++i) {
+    writeFileRecord(&batch[i].record, batch[i].data, batch[i].length);
+  }
+}
+
+
+/*
+//  Write to the syslog server.
+*/
+
+static void writeSyslogSink(struct sinkBatchEntry const *batch, int count) {
+  int i;
+
+  for (i = 0; i < count; ++i) {
+    write2syslog(batch[i].data, batch[i].length, syslogLogLineCount,
+                 SYSLOGFACILITY, SYSLOGPRIORITY);
+  }
+}
+
+
+/*
+//  Open the next logfile segment and make it the current logfile.
+//  The previous segments stay open, endlogging checks them all.
+//  Returns 0 if there is no new segment, either because of an error
+//  or because the configured number of segments is reached.
+*/
+
+static int openlogsegment(void) {
   /*
-  //  msgbuf	A buffer where a variable text will be written.
-  //
-  //  msglen	Counts how many characters have been written.
+  //  segment		The new entry in logSegments.
   //
+  //  statBuf		A buffer for the stat system call which contains
+  //			inode and device.
   */
+  struct logSegment *segment;
+  struct logSegment *grown;
+  struct stat statBuf;
+  char const *baseName;
   char msgbuf[BUFSIZ];
   int msglen;
-  pid_t pid;
-  int status;
-  int exitStatus = EXIT_SUCCESS;
-  
-  if(isatty(0)) {
-    if (tcsetattr(0, TCSANOW, &termParams) < 0) {
-      perror("tcsetattr: stdin");
+
+  if (maxLogSegments > 0 && (unsigned long)logSegmentCount >= maxLogSegments) {
+    /*
+    //  The last segment gets a note, the rest of the session only goes
+    //  to syslog.
+    */
+    ssize_t written;
+
+    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
+        "\r\n*** LOGFILE SIZE LIMIT REACHED, OUTPUT IS NOT LOGGED TO FILE ANYMORE ***\r\n");
+    if ((written = segmentmessage(&logSegments[logSegmentCount - 1], msgbuf, msglen)) < 0) {
+      perror("Error writing to logfile");
+    } else {
+      durabilityWritten(written);
     }
+    durabilityFlush();
+    logFileFull = true;
+    return(0);
   }
-  
-  pid = wait(&status);
-  if(pid < 0) {
-    char *error = strerror(errno);
-    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "Error getting status of child process: %s", error);
-    dologging(msgbuf, msglen);
-    exitStatus = EXIT_FAILURE;
+  if ((grown = realloc(logSegments, (logSegmentCount + 1) * sizeof(*logSegments))) == NULL) {
+    perror("logfile segments");
+    return(0);
+  }
+  logSegments = grown;
+  segment = &logSegments[logSegmentCount];
+  if (maxLogFileSize > 0) {
+    snprintf(segment->name, sizeof(segment->name), "%s.%03d",
+        logFileName, logSegmentCount);
   } else {
-    if(WIFEXITED(status)) {
-      exitStatus = WEXITSTATUS(status);
-      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
-                        "\n*** %s session ended by user\r\n", progName);
-      dologging(msgbuf, msglen);
-    } else if(WIFSIGNALED(status)) {
-      int const sig = WTERMSIG(status);
-      
-      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
-                        "\n*** %s session interrupted by signal %d\r\n", progName, sig);
-      dologging(msgbuf, msglen);
-      exitStatus = EXIT_FAILURE;
-    } else {
-      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
-                        "\n*** %s session ended for unknown reason\r\n", progName);
-      dologging(msgbuf, msglen);
-      exitStatus = EXIT_FAILURE;
+    snprintf(segment->name, sizeof(segment->name), "%s", logFileName);
+  }
+
+  if ((segment->fd = open(segment->name,
+      O_RDWR|O_CREAT|O_APPEND|durabilityOpenFlags(logDurability),
+      S_IRUSR|S_IWUSR)) == -1) {
+    perror(segment->name);
+    return(0);
+  }
+  /*
+  //  Remember inode and device. We will later see if the logfile
+  //  we just opened is the same that we will close.
+  */
+  if (fstat(segment->fd, &statBuf) == -1) {
+    perror(segment->name);
+    close(segment->fd);
+    return(0);
+  }
+  segment->inode = statBuf.st_ino;
+  segment->dev = statBuf.st_dev;
+  segment->indexFd = -1;
+  segment->compress = NULL;
+  if (logCompressed
+      && NULL == (segment->compress = logCompressOpen(segment->fd, logCompressLevel,
+                                                      (size_t)logCompressFrameSize))) {
+    perror(segment->name);
+    close(segment->fd);
+    return(0);
+  }
+  /*
+  //  A framed segment starts where the previous one ended, so the
+  //  records queued meanwhile keep their times.
+  */
+  if (logFramed) {
+    char indexName[MAXPATHLEN + 24];
+    unsigned long long const start = logSegmentCount > 0
+      ? logSegments[logSegmentCount - 1].frame.time : sinkNow();
+
+    if (logIndexInterval > 0) {
+      snprintf(indexName, sizeof(indexName), "%s.idx", segment->name);
+      if ((segment->indexFd = open(indexName,
+          O_WRONLY|O_CREAT|O_TRUNC|O_APPEND, S_IRUSR|S_IWUSR)) == -1) {
+        perror(indexName);
+      }
     }
-  } /* got status from wait */
-  
-  endlogging();
-  close(masterPty);
-  exit(exitStatus);
+    if (!logFrameOpen(&segment->frame, segment->fd, segment->compress,
+                      segment->indexFd, start, logIndexInterval)) {
+      perror(segment->name);
+      if (NULL != segment->compress) {
+        logCompressClose(segment->compress);
+      }
+      close(segment->fd);
+      if (segment->indexFd >= 0) {
+        close(segment->indexFd);
+      }
+      return(0);
+    }
+  }
+  ++logSegmentCount;
+
+  if (logSegmentCount > 1) {
+    durabilityFlush();
+  }
+  logFile = segment->fd;
+  logIndex = segment->indexFd;
+  logCompressor = segment->compress;
+  logFileSize = logFramed ? LOGFRAMEHEADERSIZE : 0;
+  durabilityOpen(logFile, logDurability, groupCommitBytes, groupCommitMs,
+                 logCompressed ? endLogFrame : NULL);
+
+  if (logManifest >= 0) {
+    baseName = strrchr(segment->name, '/');
+    baseName = baseName ? baseName + 1 : segment->name;
+    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1), "%s\n", baseName);
+    if (write(logManifest, msgbuf, msglen) < 0) {
+      perror("Error writing to manifest");
+    }
+  }
+  return(1);
 }
 
 
-/* 
-//  Open a logfile and initialize syslog. 
-//  Remember the logfile's inode and device for later comparison.
-//  Send introducing lines to the logging functions.
+/*
+//  End the frame of the compressed current segment, the boundary of
+//  a group commit.
 */
 
-int beginlogging(const char *shellCommands) {
+static void endLogFrame(void) {
+  if (NULL != logCompressor && !logCompressFrame(logCompressor)) {
+    perror("Error compressing logfile");
+  }
+}
+
+
+/*
+//  Put a message about a manipulated segment into the segment itself
+//  and into syslog. A compressed segment gets a complete frame, so a
+//  copy of it can be read to the end.
+*/
+
+static void segmentnotice(struct logSegment *segment, char *msgbuf,
+                          int msglen) {
+  if (segmentmessage(segment, msgbuf, msglen) < 0
+      || (NULL != segment->compress && !logCompressFrame(segment->compress))) {
+    perror("Error writing to logfile");
+  }
+  if (logtosyslog) {
+    write2syslog(msgbuf, msglen, syslogLogLineCount, SYSLOGFACILITY, SYSLOGPRIORITY);
+  }
+}
+
+
+/*
+//  Examine inode and device of a logfile segment to find traces of
+//  manipulation and close it.
+//  Append ".tampered" to the recovered segment's name if something
+//  was found, ".closed" otherwise, and ".gz" if it is compressed. The
+//  final name is left in segment->name.
+*/
+
+static void closelogsegment(struct logSegment *segment) {
   /*
   //  msgbuf		A buffer where a variable text will be written.
   //  
   //  msglen		Counts how many characters have been written.
   //  
-  //  now		A structure filled with the current time.
-  //  
-  //  sec, min, hour	Components of now.
-  //  
-  //  day, month, year	Components of now.
+  //  closedLogFileName	After the logfile is closed, it will be renamed
+  //			to this name. Normally a ".closed" will be attached
+  //			but if inode and dev differ from their values at
+  //			opening time, ".tampered" will be attached.
   //  
   //  statBuf		A buffer for the stat system call which contains
   //			inode and device.
   //  
   */
-  int msglen;
-  char msgbuf[BUFSIZ];
   struct stat statBuf;
-  time_t now;
-  char const * user = runAsUser ? runAsUser : getpwuid(getuid())->pw_name;
-  char const * const rawtty = ttyname(0);
-  char const * const tty = rawtty == 0 ? "" : rawtty;
+  char msgbuf[BUFSIZ];
+  int msglen = 0;
+  char closedLogFileName[sizeof(segment->name)];
+  char const * const suffix = NULL != segment->compress ? ".gz" : "";
 
-  if (!logtofile && !logtosyslog) {
-    fprintf(stderr, "you cannot switch off both file and syslog logging\n");
-    return (0);
+  /*
+  //  The open frame of a compressed segment is completed first, the
+  //  checks below may copy the segment.
+  */
+  if (NULL != segment->compress && !logCompressFrame(segment->compress)) {
+    perror("Error compressing logfile");
   }
-
-
-  if (logtofile) {
-    int sec, min, hour, day, month, year;
-    char defLogFileName[MAXPATHLEN - 7];
-
+  /*
+  //  From here on, a filled message buffer means an error has occurred.
+  */
+  msgbuf[0] = '\0';
+  if (stat(segment->name, &statBuf) == -1) {
     /*
-    //  defLogFileName	The name of the logfile how it will be called,
-    //			if the user did not provide his own name.
-    //			Made up from username, a timestamp and the
-    //			process id.
-    //  
-    //  Construct the logfile name. 
-    //  logdir/<username>.YYYY.MM.DD.HH.MI.SS.<sessionId>
-    //  In standalone mode, a user may propose his own filename
-    //  When the session is over, the logfile will be renamed 
-    //  to <logfile>.closed.
-    //  If we don't log to a file at all, don't mention 
-    //  a filename in the syslog logs.
+    //  There is no file named like the segment.
     */
-    now = time(NULL);
-    year = localtime(&now)->tm_year + 1900;
-    month = localtime(&now)->tm_mon + 1;
-    day = localtime(&now)->tm_mday;
-    hour = localtime(&now)->tm_hour;
-    min = localtime(&now)->tm_min;
-    sec = localtime(&now)->tm_sec;
-    snprintf(defLogFileName, (sizeof(logFileName) - 1), 
-        "%s.%04d%02d%02d%02d%02d%02d.%05d", 
-         userName, year,month, day, hour, min, sec, getpid());
-    if (standalone) {
-      if (userLogFileName && userLogFileDir) {
-        snprintf(logFileName, (sizeof(logFileName) - 1), "%s/%s",
-            userLogFileDir, userLogFileName);
-      } else if (userLogFileName && ! userLogFileDir) {
-        if (userLogFileName[0] == '/') {
-          snprintf(logFileName, (sizeof(logFileName) - 1), "%s",
-              userLogFileName);
-        } else {
-          snprintf(logFileName, (sizeof(logFileName) - 1), "./%s",
-              userLogFileName);
-        }
-      } else if (! userLogFileName && userLogFileDir) {
-        snprintf(logFileName, (sizeof(logFileName) - 1), "%s/%s",
-            userLogFileDir, defLogFileName);
-      } else {
-        snprintf(logFileName, (sizeof(logFileName) - 1), "%s/%s",
-            logdir, defLogFileName);
-      }
+    if (fstat(segment->fd, &statBuf) == -1) {
+      /*
+      //  Even the open file descriptor does not work.
+      */
+      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
+          "*** THIS FILEHANDLE HAS BEEN DELETED ***\r\n");
     } else {
-      snprintf(logFileName, (sizeof(logFileName) - 1), "%s/%s",
-          logdir, defLogFileName);
-    }
-    /* 
-    //  Open the logfile 
-    */
-    if ((logFile = open(logFileName, O_RDWR|O_CREAT|O_SYNC|O_APPEND,
-        S_IRUSR|S_IWUSR)) == -1) {
-      perror(logFileName);
-      return(0);
+      /*
+      //  The file ist still reachable via file descriptor.
+      */
+      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
+          "*** USER TRIED TO DELETE THIS FILE ***\r\n");
     }
+  } else {
     /*
-    //  Remember inode and device. We will later see if the logfile
-    //  we just opened is the same that we will close.
-    */
-    if (fstat(logFile, &statBuf) == -1) {
-      perror(logFileName);
-      return(0);
-    }
-    logInode = statBuf.st_ino;
-    logDev = statBuf.st_dev;
-    /* 
-    //  Note the start time in the log file.
+    //  A file with the correct name and path was found. Now look
+    //  for manipulations.
     */
-    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
-        "%s%s session opened for %s as %s on %s at %s", 
-         isaLoginShell ? "login " : "", progName, userName, 
-         user, 
-         tty, ctime(&now));
-    if(write(logFile, msgbuf, msglen) < 0) {
-      perror(logFileName);
-      return(0);
+    if ((segment->inode != statBuf.st_ino) || (segment->dev != statBuf.st_dev)) {
+      /*
+      //  Device or inode have changed. This is not the file we opened,
+      //  it has just the same name.
+      */
+      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
+          "*** USER TRIED TO DELETE AND RECREATE THIS FILE ***\r\n");
+      if(unlink(segment->name)) {
+        /* must have been a directory, try and delete it */
+        rmdir(segment->name);
+      }
+    } else {
+      if (fstat(segment->fd, &statBuf) == -1) {
+        /*
+        //  Something bad happened to the file descriptor.
+        //  There's not much i can do here.
+        */
+        msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
+            "*** THIS FILEHANDLE HAS BEEN DELETED ***\r\n");
+      }
     }
   }
-
-  if(logtosyslog) {
-    /* 
-    //  Prepare usage of syslog with sessionid as prefix.
+  if (*msgbuf != '\0') {
+    /*
+    //  There is an error message. Send publish it and then try to
+    //  save the contents of the (manipulated) logfile into a new
+    //  file <logfile>.tampered
     */
-    if(syslogLogUsername) {
-      static char sessionIdWithUid[sizeof(sessionId) + 10];
-      snprintf(sessionIdWithUid, sizeof(sessionIdWithUid), "%s: %s",
-               sessionId, userName);
-      openlog(sessionIdWithUid, LOG_NDELAY, SYSLOGFACILITY);
+    segmentnotice(segment, msgbuf, msglen);
+    if ((size_t)snprintf(closedLogFileName, sizeof(closedLogFileName), "%s.tampered%s",
+        segment->name, suffix) >= sizeof(closedLogFileName)) {
+      fprintf(stderr, "Name for the recovered logfile %s is too long\n", segment->name);
+      snprintf(closedLogFileName, sizeof(closedLogFileName), "%s", segment->name);
+      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
+          "*** THIS LOGFILE CANNOT BE RECOVERED ***\r\n");
+    } else if (! recoverfile(segment->fd, closedLogFileName, segment->compress)) {
+      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
+          "*** THIS LOGFILE CANNOT BE RECOVERED ***\r\n");
     } else {
-      openlog(sessionId, LOG_NDELAY, SYSLOGFACILITY);
+      msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
+          "*** MANIPULATED LOGFILE RECOVERED ***\r\n");
     }
-    /* 
-    //  Note the log file name in syslog if there is one.
-    */
-    if (logtofile) {
-      syslog(SYSLOGFACILITY | SYSLOGPRIORITY, 
-          "%s=%s,%s: logging new %ssession (%s) to %s", 
-          userName, user, 
-          tty, isaLoginShell ? "login " : "", sessionId, logFileName);
+    segmentnotice(segment, msgbuf, msglen);
+  }
+  if (NULL != segment->compress) {
+    logCompressClose(segment->compress);
+    segment->compress = NULL;
+  }
+  close(segment->fd);
+  if (*msgbuf == '\0') {
+    if ((size_t)snprintf(closedLogFileName, sizeof(closedLogFileName), "%s.closed%s",
+        segment->name, suffix) >= sizeof(closedLogFileName)) {
+      /* keep the name it has rather than record one that does not exist */
+      fprintf(stderr, "Closed name for the logfile %s is too long\n", segment->name);
+      snprintf(closedLogFileName, sizeof(closedLogFileName), "%s", segment->name);
     } else {
-      syslog(SYSLOGFACILITY | SYSLOGPRIORITY, 
-          "%s=%s,%s: logging new %ssession (%s)", 
-          userName, user, 
-          tty, isaLoginShell ? "login " : "", sessionId);
+      rename(segment->name, closedLogFileName);
     }
   }
+  /*
+  //  The index follows its segment to the new name.
+  */
+  if (segment->indexFd >= 0) {
+    char indexName[MAXPATHLEN + 24];
+    char closedIndexName[MAXPATHLEN + 40];
 
-  if(NULL != shellCommands) {
-    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
-                      "shell commands: %s\n", shellCommands);
-    dologging(msgbuf, msglen);
+    if (fsync(segment->indexFd) < 0) {
+      perror("Error syncing index");
+    }
+    close(segment->indexFd);
+    segment->indexFd = -1;
+    snprintf(indexName, sizeof(indexName), "%s.idx", segment->name);
+    snprintf(closedIndexName, sizeof(closedIndexName), "%s.idx", closedLogFileName);
+    rename(indexName, closedIndexName);
   }
-  
-  return(1);
+  snprintf(segment->name, sizeof(segment->name), "%s", closedLogFileName);
 }
 
 
 /*
-//  Send a buffer full of output to the selected logging destinations.
-//  Either to a local logfile or to the syslog server or both.
+//  Replace the manifest by <logfile>.manifest.closed which lists the
+//  final names of all segments.
 */
 
-void dologging(char *msgbuf, int msglen) {
-  if (logtofile) {
-    if(write(logFile, msgbuf, msglen) < 0) {
-      perror("Error writing to logfile");
+static void closemanifest(void) {
+  char manifestName[MAXPATHLEN + 16];
+  char closedManifestName[MAXPATHLEN + 32];
+  FILE *manifest = NULL;
+  int fd;
+  int i;
+
+  close(logManifest);
+  logManifest = -1;
+  snprintf(manifestName, sizeof(manifestName), "%s.manifest", logFileName);
+  snprintf(closedManifestName, sizeof(closedManifestName), "%s.manifest.closed",
+      logFileName);
+  if ((fd = open(closedManifestName, O_WRONLY|O_CREAT|O_TRUNC,
+      S_IRUSR|S_IWUSR)) == -1 || (manifest = fdopen(fd, "w")) == NULL) {
+    perror(closedManifestName);
+    if (fd != -1) {
+      close(fd);
     }
+    return;
   }
-
-  if (logtosyslog) {
-    write2syslog(msgbuf, msglen, syslogLogLineCount, SYSLOGFACILITY, SYSLOGPRIORITY);
+  for (i = 0; i < logSegmentCount; ++i) {
+    char const *baseName = strrchr(logSegments[i].name, '/');
+    fprintf(manifest, "%s\n", baseName ? baseName + 1 : logSegments[i].name);
   }
-
+  if (fflush(manifest) != 0 || fsync(fileno(manifest)) < 0) {
+    perror(closedManifestName);
+  }
+  fclose(manifest);
+  unlink(manifestName);
 }
 
 
 /* 
 //  Send a final cr-lf to flush the log.
-//  Close the logfile and syslog.
-//  Examine inode and device of the logfile to find traces of manipulation.
-//  Append ".tampered" to the recovered logfile's name if something was found.
-//  Append ".closed" to the logfile's name otherwise.
+//  Close the logfile segments and syslog.
 */
 
 void endlogging() {
+  sinkCloseAll();
+}
+
+
+/*
+//  Note the end in the logfile and close its segments.
+*/
+
+static void closeFileSink(void) {
   /*
   //  msgbuf		A buffer where a variable text will be written.
   //  
   //  msglen		Counts how many characters have been written.
   //  
-  //  closedLogFileName	After the logfile is closed, it will be renamed
-  //			to this name. Normally a ".closed" will be attached
-  //			but if inode and dev differ from their values at
-  //			opening time, ".tampered" will be attached.
-  //  
   //  now		A structure filled with the current time.
   //  
-  //  sec, min, hour	Components of now.
-  //  
-  //  day, month, year	Components of now.
-  //  
-  //  statBuf		A buffer for the stat system call which contains
-  //			inode and device.
-  //  
   */
   char const * const rawtty = ttyname(0);
   char const * const tty = rawtty == 0 ? "" : rawtty;
-
-  if (logtofile) {
-    struct stat statBuf;
-    time_t now;
-    char msgbuf[BUFSIZ];
-    int msglen;
-    char closedLogFileName[MAXPATHLEN];
-      
+  time_t now;
+  char msgbuf[BUFSIZ];
+  int msglen;
+  ssize_t written;
+  int i;
     
-    now = time(NULL);
-    msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
-        "%s session closed for %s on %s at %s", 
-        *progName == '-' ? progName + 1 : progName,
-        userName, tty, ctime(&now)); 
-    if(write(logFile, msgbuf, msglen) < 0) {
-      perror("Error writing to logfile");
-      return;
-    }
+  now = time(NULL);
+  msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
+      "%s session closed for %s on %s at %s", 
+      *progName == '-' ? progName + 1 : progName,
+      userName, tty, ctime(&now)); 
+  if((written = segmentmessage(&logSegments[logSegmentCount - 1], msgbuf, msglen)) < 0) {
+    perror("Error writing to logfile");
+    return;
+  }
+  /*
+  //  Whatever the durability mode, the closed logfile is on disk.
+  */
+  durabilityWritten(written);
+  durabilityFlush();
 
-    /*
-    //  From here on, a filled message buffer means an error has occurred.
-    */
-    msgbuf[0] = '\0';
-    if (stat(logFileName, &statBuf) == -1) {
-      /*
-      //  There is no file named logFileName.
-      */
-      if (fstat(logFile, &statBuf) == -1) {
-        /*
-        //  Even the open file descriptor does not work.
-        */
-        msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
-            "*** THIS FILEHANDLE HAS BEEN DELETED ***\r\n");
-      } else {
-        /*
-        //  The file ist still reachable via file descriptor.
-        */
-        msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
-            "*** USER TRIED TO DELETE THIS FILE ***\r\n");
-      }
-    } else {
-      /*
-      //  A file with the correct name and path was found. Now look
-      //  for manipulations.
-      */
-      if ((logInode != statBuf.st_ino) || (logDev != statBuf.st_dev)) {
-        /*
-        //  Device or inode have changed. This is not the file we opened,
-        //  it has just the same name.
-        */
-        msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
-            "*** USER TRIED TO DELETE AND RECREATE THIS FILE ***\r\n");
-        if(unlink(logFileName)) {
-          /* must have been a directory, try and delete it */
-          rmdir(logFileName);
-        }
-      } else {
-        if (fstat(logFile, &statBuf) == -1) {
-          /*
-          //  Something bad happened to the file descriptor.
-          //  There's not much i can do here.
-          */
-          msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
-              "*** THIS FILEHANDLE HAS BEEN DELETED ***\r\n");
-        }
-      }
-    }
-    if (*msgbuf != '\0') {
-      /*
-      //  There is an error message. Send publish it and then try to
-      //  save the contents of the (manipulated) logfile into a new
-      //  file <logfile>.tampered
-      */
-      dologging(msgbuf, msglen);
-      snprintf(closedLogFileName, sizeof(closedLogFileName), "%s.tampered",
-          logFileName);
-      if (! recoverfile(logFile, strcat(logFileName, ".tampered"))) {
-        msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
-            "*** THIS LOGFILE CANNOT BE RECOVERED ***\r\n");
-      } else {
-        msglen = snprintf(msgbuf, (sizeof(msgbuf) - 1),
-            "*** MANIPULATED LOGFILE RECOVERED ***\r\n");
-      }
-      dologging(msgbuf, msglen);
-      close(logFile);
-    } else {
-      close(logFile);
-      snprintf(closedLogFileName, sizeof(closedLogFileName), "%s.closed",
-          logFileName);
-      rename(logFileName, closedLogFileName);
-    } 
+  for (i = 0; i < logSegmentCount; ++i) {
+    closelogsegment(&logSegments[i]);
+  }
+  if (logManifest >= 0) {
+    closemanifest();
   }
+}
 
 
-  if (logtosyslog) {
-    write2syslog("\r\n", 2, syslogLogLineCount, SYSLOGFACILITY, SYSLOGPRIORITY);
-    syslog(SYSLOGFACILITY | SYSLOGPRIORITY, "%s,%s: closing %s session (%s)", 
+/*
+//  Tell syslog what the session lost on the way and that it is over.
+*/
+
+static void closeSyslogSink(void) {
+  char const * const rawtty = ttyname(0);
+  char const * const tty = rawtty == 0 ? "" : rawtty;
+  unsigned long long spooled, dropped;
+  struct sink const *sink;
+
+  write2syslog("\r\n", 2, syslogLogLineCount, SYSLOGFACILITY, SYSLOGPRIORITY);
+  write2syslogRateSummary(SYSLOGFACILITY, SYSLOGPRIORITY);
+  for (sink = sinkFirst(); NULL != sink; sink = sink->next) {
+    write2syslogMessage(SYSLOGFACILITY, SYSLOGPRIORITY,
+        "%s,%s: %s got %llu bytes in %llu records, %llu writes",
+        userName, tty, sink->name, sink->stats.bytes, sink->stats.records,
+        sink->stats.writes);
+    if (sink->stats.blocked > 0 || sink->stats.spilled > 0) {
+      write2syslogMessage(SYSLOGFACILITY, SYSLOGPRIORITY,
+          "%s,%s: %s was behind, session waited %llu times, %llu bytes spilled",
+          userName, tty, sink->name, sink->stats.blocked, sink->stats.spilled);
+    }
+  }
+  syslogClientSpoolCounts(&spooled, &dropped);
+  if (spooled > 0 || dropped > 0) {
+    write2syslogMessage(SYSLOGFACILITY, SYSLOGPRIORITY,
+        "%s,%s: syslog was behind, %llu messages spooled, %llu dropped",
+        userName, tty, spooled, dropped);
+  }
+  /*
+  //  With the count rootsh-gaps notices lines lost at the end.
+  */
+  if (syslogLogLineCount) {
+    write2syslogMessage(SYSLOGFACILITY, SYSLOGPRIORITY,
+        "%s,%s: closing %s session (%s) after %llu lines",
+        userName, tty, progName, sessionId, write2syslogLines());
+  } else {
+    write2syslogMessage(SYSLOGFACILITY, SYSLOGPRIORITY,
+        "%s,%s: closing %s session (%s)", 
         userName, tty, progName, sessionId);
-    closelog();
   }
-
+  journaldClose();
+  syslogClientClose();
+  syslogTcpClose();
+  closelog();
 }
 
 
 /*
 //  Try to save the contents of a deleted file with a still open
-//  filehandle to another file.
+//  filehandle to another file. A compressed file has to be at the end
+//  of a frame, the copy gets the footer of the frames so far.
 */
 
-int recoverfile(int ohandle, char *recoverFileName) {
+int recoverfile(int ohandle, char *recoverFileName,
+                struct logCompress const *compress) {
   /*
   //  msgbuf		A buffer where a variable text will be written.
   //  
@@ -1118,6 +3153,9 @@ int recoverfile(int ohandle, char *recoverFileName) {
         perror("write recoverfile");
       }
     }
+    if (NULL != compress && !logCompressFooter(compress, fd)) {
+      perror("write recoverfile");
+    }
     close(fd);
     return (1);
   } else {
@@ -1166,7 +3204,7 @@ int forceopen(char *path) {
             "*** FILE COULD NOT BE CREATED (ERRNO %d)  ***\r\n", errno);
         break;
     }
-    dologging(msgbuf, msglen);
+    dologging(LOGSTREAM_META, msgbuf, msglen);
   }
   return (fd);
 }
@@ -1421,6 +3459,29 @@ char **saveenv(char *name) {
 }
 
 
+
+/*
+//  UTF-8 if the locale the caller runs in says so. The variables are
+//  looked at in the order the C library does.
+*/
+static enum escCharset localeCharset(void) {
+  static char const * const names[] = { "LC_ALL", "LC_CTYPE", "LANG" };
+  size_t i;
+
+  for (i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+    char const * const value = getenv(names[i]);
+    if (value != NULL && *value != '\0') {
+      char const * const codeset = strchr(value, '.');
+      if (codeset != NULL && (0 == strncasecmp(codeset + 1, "utf-8", 5)
+                              || 0 == strncasecmp(codeset + 1, "utf8", 4))) {
+        return ESCCHARSET_UTF8;
+      }
+      return ESCCHARSET_8BIT;
+    }
+  }
+  return ESCCHARSET_8BIT;
+}
+
 /*
 //  Rebuild the environment from saved variables.
 */
@@ -1638,6 +3699,12 @@ pid_t forkpty(int *amaster,  char  *name,  struct  termios *termp, struct winsiz
     close(master);
     if (logtofile) {
       close(logFile);
+      if (logManifest >= 0) {
+        close(logManifest);
+      }
+      if (logIndex >= 0) {
+        close(logIndex);
+      }
     }
     if (logtosyslog) {
       closelog();
@@ -1689,6 +3756,21 @@ void version() {
   if(logtofile) {
     printf("Logging to file.\n");
     printf("Logfiles go to directory '%s'\n", logdir);
+    if(maxLogFileSize > 0) {
+      printf("Logfiles are split into segments of %llu bytes\n", maxLogFileSize);
+    }
+    if(logCompressed) {
+      printf("Logfiles are compressed with gzip at level %d in frames of %llu bytes\n",
+             logCompressLevel, logCompressFrameSize);
+    }
+    if(logFramed) {
+      if(logIndexInterval > 0) {
+        printf("Logfiles are framed with an index entry every %llu bytes\n",
+               logIndexInterval);
+      } else {
+        printf("Logfiles are framed without an index\n");
+      }
+    }
   }
 
   if(logtosyslog) {
@@ -1705,6 +3787,38 @@ void version() {
     } else {
       printf("syslog logging of username is off\n");
     }
+    if(syslogCharsetAuto) {
+      printf("syslog messages are read as %s (from the locale)\n",
+             ESCCHARSET_UTF8 == localeCharset() ? "UTF-8" : "8 bit");
+    } else {
+      printf("syslog messages are read as %s\n",
+             ESCCHARSET_UTF8 == syslogCharset ? "UTF-8" : "8 bit");
+    }
+    printf("syslog lines longer than %lu bytes are sent in pieces\n",
+           (unsigned long)syslogLineLimit);
+    if(syslogRate > 0) {
+      printf("syslog gets at most %lu lines a second, %lu at once\n",
+             syslogRate, syslogBurst);
+    }
+    if(SYSLOGFORMAT_LIBC == syslogFormat) {
+      printf("syslog messages are sent with syslog(3)\n");
+    } else if(SYSLOGFORMAT_JOURNAL == syslogFormat) {
+      printf("syslog messages are sent to %s with fields\n", JOURNALDPATH);
+    } else {
+      printf("syslog messages are sent to %s in %s format\n", SYSLOGCLIENTPATH,
+             SYSLOGFORMAT_RFC5424 == syslogFormat ? "RFC 5424" : "RFC 3164");
+    }
+    if(SYSLOGFORMAT_LIBC != syslogFormat && SYSLOGFORMAT_JOURNAL != syslogFormat) {
+      if(syslogSpoolSize > 0) {
+        printf("syslog messages the daemon can't take are spooled, up to %llu bytes\n",
+               syslogSpoolSize);
+      } else {
+        printf("syslog messages wait for the daemon\n");
+      }
+    }
+    if('\0' != syslogRemote[0]) {
+      printf("syslog messages are also sent to %s over TCP\n", syslogRemote);
+    }
   }
   
 #ifndef SUCMD
@@ -1789,6 +3903,220 @@ bool readConfigFile(void) {
         } else {
           syslogLogUsername = false;
         }
+      } else if(0 == strncmp("syslog.charset", key, sizeof(key))) {
+        if(0 == strcasecmp("auto", value)) {
+          syslogCharsetAuto = true;
+        } else if(0 == strcasecmp("utf-8", value) || 0 == strcasecmp("utf8", value)) {
+          syslogCharsetAuto = false;
+          syslogCharset = ESCCHARSET_UTF8;
+        } else if(0 == strcasecmp("8bit", value)) {
+          syslogCharsetAuto = false;
+          syslogCharset = ESCCHARSET_8BIT;
+        } else {
+          fprintf(stderr, "Configured value for syslog.charset: '%s' is not auto, utf-8 or 8bit\n", value);
+          retval = false;
+          goto cleanup;
+        }
+      } else if(0 == strncmp("syslog.linelimit", key, sizeof(key))) {
+        unsigned long long limit;
+        if(!parseSize(value, &limit) || limit < WRITE2SYSLOGMINLINE
+           || limit > WRITE2SYSLOGMAXLINE) {
+          fprintf(stderr, "Configured value for syslog.linelimit: '%s' is not between %d and %d bytes\n",
+                  value, WRITE2SYSLOGMINLINE, WRITE2SYSLOGMAXLINE);
+          retval = false;
+          goto cleanup;
+        }
+        syslogLineLimit = (size_t)limit;
+      } else if(0 == strncmp("syslog.rate", key, sizeof(key))) {
+        char *end;
+        unsigned long const lines = strtoul(value, &end, 10);
+        if('\0' == *value || '\0' != *end || ULONG_MAX == lines) {
+          fprintf(stderr, "Configured value for syslog.rate: '%s' is not a number of lines\n", value);
+          retval = false;
+          goto cleanup;
+        }
+        syslogRate = lines;
+      } else if(0 == strncmp("syslog.burst", key, sizeof(key))) {
+        char *end;
+        unsigned long const lines = strtoul(value, &end, 10);
+        if('\0' == *value || '\0' != *end || 0 == lines || ULONG_MAX == lines) {
+          fprintf(stderr, "Configured value for syslog.burst: '%s' is not a number of lines\n", value);
+          retval = false;
+          goto cleanup;
+        }
+        syslogBurst = lines;
+      } else if(0 == strncmp("syslog.format", key, sizeof(key))) {
+        if(0 == strcasecmp("rfc3164", value)) {
+          syslogFormat = SYSLOGFORMAT_RFC3164;
+        } else if(0 == strcasecmp("rfc5424", value)) {
+          syslogFormat = SYSLOGFORMAT_RFC5424;
+        } else if(0 == strcasecmp("libc", value)) {
+          syslogFormat = SYSLOGFORMAT_LIBC;
+        } else if(0 == strcasecmp("journal", value)) {
+          syslogFormat = SYSLOGFORMAT_JOURNAL;
+        } else {
+          fprintf(stderr, "Configured value for syslog.format: '%s' is not rfc3164, rfc5424, journal or libc\n", value);
+          retval = false;
+          goto cleanup;
+        }
+      } else if(0 == strncmp("syslog.spool", key, sizeof(key))) {
+        if(!parseSize(value, &syslogSpoolSize)) {
+          fprintf(stderr, "Configured value for syslog.spool: '%s' is not a size in bytes\n", value);
+          retval = false;
+          goto cleanup;
+        }
+      } else if(0 == strncmp("syslog.remote", key, sizeof(key))) {
+        if(strlen(value) >= sizeof(syslogRemote)) {
+          fprintf(stderr, "Configured value for syslog.remote: '%s' is too long\n", value);
+          retval = false;
+          goto cleanup;
+        }
+        strcpy(syslogRemote, value);
+      } else if(0 == strncmp("zerocopy", key, sizeof(key))) {
+        if(parseBool(value)) {
+          zeroCopy = true;
+        } else {
+          zeroCopy = false;
+        }
+      } else if(0 == strncmp("batch", key, sizeof(key))) {
+        if(parseBool(value)) {
+          batch = true;
+        } else {
+          batch = false;
+        }
+      } else if(0 == strncmp("queue.size", key, sizeof(key))) {
+        unsigned long long size;
+        if(!parseSize(value, &size) || size > SIZE_MAX) {
+          fprintf(stderr, "Configured value for queue.size: '%s' is not a size in bytes\n", value);
+          retval = false;
+          goto cleanup;
+        }
+        logQueueSize = (size_t)size;
+      } else if(0 == strncmp("queue.full", key, sizeof(key))) {
+        if(!logQueueParseFull(value, &logQueueFull)) {
+          fprintf(stderr, "Configured value for queue.full: '%s' must be block or spill\n", value);
+          retval = false;
+          goto cleanup;
+        }
+        logQueueFullSet = true;
+      } else if(0 == strncmp("file.queue.size", key, sizeof(key))) {
+        unsigned long long size;
+        if(!parseSize(value, &size) || size >= SIZE_MAX) {
+          fprintf(stderr, "Configured value for file.queue.size: '%s' is not a size in bytes\n", value);
+          retval = false;
+          goto cleanup;
+        }
+        fileQueueSize = (size_t)size;
+      } else if(0 == strncmp("file.queue.full", key, sizeof(key))) {
+        enum logQueueFull policy;
+        if(!logQueueParseFull(value, &policy)) {
+          fprintf(stderr, "Configured value for file.queue.full: '%s' must be block or spill\n", value);
+          retval = false;
+          goto cleanup;
+        }
+        fileQueueFull = policy;
+      } else if(0 == strncmp("syslog.queue.size", key, sizeof(key))) {
+        unsigned long long size;
+        if(!parseSize(value, &size) || size >= SIZE_MAX) {
+          fprintf(stderr, "Configured value for syslog.queue.size: '%s' is not a size in bytes\n", value);
+          retval = false;
+          goto cleanup;
+        }
+        syslogQueueSize = (size_t)size;
+      } else if(0 == strncmp("syslog.queue.full", key, sizeof(key))) {
+        enum logQueueFull policy;
+        if(!logQueueParseFull(value, &policy)) {
+          fprintf(stderr, "Configured value for syslog.queue.full: '%s' must be block or spill\n", value);
+          retval = false;
+          goto cleanup;
+        }
+        syslogQueueFull = policy;
+      } else if(0 == strncmp("file.format", key, sizeof(key))) {
+        if(0 == strcmp("raw", value)) {
+          logFramed = false;
+        } else if(0 == strcmp("framed", value)) {
+          logFramed = true;
+        } else {
+          fprintf(stderr, "Configured value for file.format: '%s' must be raw or framed\n", value);
+          retval = false;
+          goto cleanup;
+        }
+      } else if(0 == strncmp("file.compress", key, sizeof(key))) {
+        if(0 == strcmp("none", value)) {
+          logCompressed = false;
+        } else if(0 == strcmp("gzip", value)) {
+#if HAVE_ZLIB_H && HAVE_LIBZ
+          logCompressed = true;
+#else
+          fprintf(stderr, "Configured value for file.compress: '%s' needs zlib, which %s was built without\n", value, progName);
+          retval = false;
+          goto cleanup;
+#endif
+        } else {
+          fprintf(stderr, "Configured value for file.compress: '%s' must be none or gzip\n", value);
+          retval = false;
+          goto cleanup;
+        }
+      } else if(0 == strncmp("file.compress.level", key, sizeof(key))) {
+        char *end;
+        long const level = strtol(value, &end, 10);
+        if(end == value || '\0' != *end || level < 1 || level > 9) {
+          fprintf(stderr, "Configured value for file.compress.level: '%s' must be 1 to 9\n", value);
+          retval = false;
+          goto cleanup;
+        }
+        logCompressLevel = (int)level;
+      } else if(0 == strncmp("file.compress.frame", key, sizeof(key))) {
+        if(!parseSize(value, &logCompressFrameSize) || 0 == logCompressFrameSize
+           || logCompressFrameSize > SIZE_MAX) {
+          fprintf(stderr, "Configured value for file.compress.frame: '%s' is not a size in bytes\n", value);
+          retval = false;
+          goto cleanup;
+        }
+      } else if(0 == strncmp("file.index.interval", key, sizeof(key))) {
+        if(!parseSize(value, &logIndexInterval)) {
+          fprintf(stderr, "Configured value for file.index.interval: '%s' is not a size in bytes\n", value);
+          retval = false;
+          goto cleanup;
+        }
+      } else if(0 == strncmp("file.durability", key, sizeof(key))) {
+        if(!durabilityParse(value, &logDurability)) {
+          fprintf(stderr, "Configured value for file.durability: '%s' must be sync, group or none\n", value);
+          retval = false;
+          goto cleanup;
+        }
+      } else if(0 == strncmp("file.durability.bytes", key, sizeof(key))) {
+        unsigned long long bytes;
+        if(!parseSize(value, &bytes) || bytes > SIZE_MAX) {
+          fprintf(stderr, "Configured value for file.durability.bytes: '%s' is not a size in bytes\n", value);
+          retval = false;
+          goto cleanup;
+        }
+        groupCommitBytes = (size_t)bytes;
+      } else if(0 == strncmp("file.durability.ms", key, sizeof(key))) {
+        char *end;
+        long const ms = strtol(value, &end, 10);
+        if('\0' == *value || '\0' != *end || ms < 0 || ms > INT_MAX) {
+          fprintf(stderr, "Configured value for file.durability.ms: '%s' is not a number of milliseconds\n", value);
+          retval = false;
+          goto cleanup;
+        }
+        groupCommitMs = (int)ms;
+      } else if(0 == strncmp("file.maxsize", key, sizeof(key))) {
+        if(!parseSize(value, &maxLogFileSize)) {
+          fprintf(stderr, "Configured value for file.maxsize: '%s' is not a size in bytes\n", value);
+          retval = false;
+          goto cleanup;
+        }
+      } else if(0 == strncmp("file.maxsegments", key, sizeof(key))) {
+        char *end;
+        unsigned long const segments = strtoul(value, &end, 10);
+        if('\0' == *value || '\0' != *end || segments > INT_MAX) {
+          fprintf(stderr, "Configured value for file.maxsegments: '%s' is not a number\n", value);
+          retval = false;
+          goto cleanup;
+        }
+        maxLogSegments = segments;
       } else if(0 == strncmp("defaultshell", key, sizeof(key))) {
         if(strlen(value) > MAXPATHLEN) {
           fprintf(stderr, "Configured value for defaultshell: '%s' is longer than max path len: %d\n", value, MAXPATHLEN);
@@ -0,0 +1,920 @@
+/*
+  rootsh-archive compresses the closed and tampered logfiles in the
+  logdir. A logfile is cut into blocks which a pool of threads
+  compresses at the same time, each block becomes a frame of the same
+  seekable format that "file.compress" writes during the session. The
+  compressed logfile takes the owner, mode and times of the original
+  and takes its place under a new name that never replaces an
+  existing file, and all reads and writes stay within a
+  bandwidth budget so archiving does not starve the sessions.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#define _GNU_SOURCE 1
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include "config.h"
+
+#if HAVE_PTHREAD_H && HAVE_PTHREAD_CREATE
+#  define USE_THREADS 1
+#  include <pthread.h>
+#endif
+
+#include "configParser.h"
+#include "logFrame.h"
+#include "logCompress.h"
+#include "util.h"
+
+/*
+//  A raw logfile has no records, a block of it ends after a line if
+//  one ends within this many bytes of the frame size.
+*/
+#define RAWLINE 4096
+
+/*
+//  Blocks in flight per compressing thread, the writer takes them in
+//  order while the threads work on the next ones.
+*/
+#define BLOCKSPERTHREAD 2
+
+#define MAXTHREADS 256
+
+/*
+//  A logfile being archived.
+//
+//  name	The logfile, <logfile>.closed or <logfile>.tampered.
+//
+//  tempName	The compressed logfile until it is complete, it is then
+//		renamed to <name>.gz.
+//
+//  map		The logfile, mapped.
+//
+//  failed	Something went wrong, the logfile stays as it is.
+*/
+struct archive {
+  char name[MAXPATHLEN + 1];
+  char tempName[MAXPATHLEN + 16];
+  struct stat status;
+  unsigned char *map;
+  int tempFd;
+  struct logCompress *compress;
+  bool framed;
+  bool failed;
+};
+
+/*
+//  A part of a logfile that becomes one frame. time is the time of
+//  its first record, 0 in a raw logfile. The block that is last
+//  finishes the logfile.
+*/
+struct block {
+  struct archive *archive;
+  unsigned char const *data;
+  size_t size;
+  unsigned long long time;
+  bool last;
+  unsigned char *frame;
+  size_t length;
+  int error;
+  bool done;
+};
+
+static char logdir[MAXPATHLEN + 1];
+static int compressLevel = LOGCOMPRESSLEVEL;
+static unsigned long long frameSize = LOGCOMPRESSFRAMESIZE;
+static long threads = 0;
+static unsigned long long bandwidth = 0;
+static bool verbose = false;
+static volatile sig_atomic_t quit = 0;
+
+/*
+//  The blocks in flight are a ring. queued counts the blocks handed
+//  to the threads, taken those a thread started on and written those
+//  the writer is done with.
+*/
+static struct block *ring = NULL;
+static size_t ringSize = 0;
+static size_t queued = 0;
+static size_t taken = 0;
+static size_t written = 0;
+#if USE_THREADS
+static pthread_mutex_t ringLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workReady = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t blockDone = PTHREAD_COND_INITIALIZER;
+static bool stopping = false;
+#endif
+
+/*
+//  The budget counts the bytes read and written since budgetStart.
+*/
+static unsigned long long budgetStart = 0;
+static unsigned long long budgetSpent = 0;
+
+/*
+//  Take bytes from the budget, wait until the bandwidth allows them.
+*/
+static void throttle(size_t const bytes) {
+  unsigned long long due, now;
+
+  if (0 == bandwidth) {
+    return;
+  }
+  if (0 == budgetStart) {
+    budgetStart = utilMonotonicNow();
+  }
+  budgetSpent += bytes;
+  due = budgetStart + (unsigned long long)((double)budgetSpent * 1000000.0 / bandwidth);
+  while (!quit && due > (now = utilMonotonicNow())) {
+    struct timespec pause;
+    pause.tv_sec = (time_t)((due - now) / 1000000);
+    pause.tv_nsec = (long)((due - now) % 1000000) * 1000;
+    nanosleep(&pause, NULL);
+  }
+}
+
+static void compressBlock(struct block * const block) {
+  block->frame = NULL;
+  block->length = 0;
+  block->error = 0;
+  if (block->size > 0
+      && NULL == (block->frame = logCompressDeflate(compressLevel, block->data,
+                                                    block->size, &block->length))) {
+    block->error = errno;
+  }
+}
+
+#if USE_THREADS
+static void *compressor(void *unused) {
+  pthread_mutex_lock(&ringLock);
+  for (;;) {
+    struct block *block;
+
+    while (!stopping && taken == queued) {
+      pthread_cond_wait(&workReady, &ringLock);
+    }
+    if (taken == queued) {
+      break;
+    }
+    block = &ring[taken++ % ringSize];
+    pthread_mutex_unlock(&ringLock);
+    compressBlock(block);
+    pthread_mutex_lock(&ringLock);
+    block->done = true;
+    pthread_cond_broadcast(&blockDone);
+  }
+  pthread_mutex_unlock(&ringLock);
+  return NULL;
+}
+#endif
+
+/*
+//  Put a file name together. One that doesn't fit is reported, it
+//  must not be used, cut off it would be some other file.
+*/
+static bool makeName(char * const buffer, size_t const size, char const * const format, ...)
+  __attribute__((format(printf, 3, 4)));
+
+static bool makeName(char * const buffer, size_t const size, char const * const format, ...) {
+  va_list arguments;
+  int length;
+
+  va_start(arguments, format);
+  length = vsnprintf(buffer, size, format, arguments);
+  va_end(arguments);
+  if (length < 0 || (size_t)length >= size) {
+    fprintf(stderr, "rootsh-archive: %s...: name is too long\n", buffer);
+    return false;
+  }
+  return true;
+}
+
+/*
+//  Open the logfile and the file it is compressed into, next to it.
+*/
+static struct archive *openArchive(char const * const name) {
+  struct archive *archive = calloc(1, sizeof(*archive));
+  char const *base = strrchr(name, '/');
+  int fd = -1;
+
+  if (NULL == archive) {
+    perror("rootsh-archive");
+    return NULL;
+  }
+  archive->tempFd = -1;
+  if (!makeName(archive->name, sizeof(archive->name), "%s", name)
+      || !makeName(archive->tempName, sizeof(archive->tempName), "%.*s.%s.gz.XXXXXX",
+                   (int)(base + 1 - name), name, base + 1)) {
+    goto failed;
+  }
+  if ((fd = open(name, O_RDONLY | O_NOFOLLOW)) < 0 || 0 != fstat(fd, &archive->status)) {
+    perror(name);
+    goto failed;
+  }
+  if (archive->status.st_size > 0) {
+    archive->map = mmap(NULL, (size_t)archive->status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == archive->map) {
+      archive->map = NULL;
+      perror(name);
+      goto failed;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(archive->map, (size_t)archive->status.st_size, MADV_SEQUENTIAL);
+#endif
+  }
+  close(fd);
+  fd = -1;
+  {
+    unsigned long long start;
+    archive->framed = archive->status.st_size >= LOGFRAMEHEADERSIZE
+      && logFrameStart(archive->map, LOGFRAMEMAGIC, &start);
+  }
+  if ((archive->tempFd = mkstemp(archive->tempName)) < 0) {
+    perror(archive->tempName);
+    goto failed;
+  }
+  if (NULL == (archive->compress = logCompressOpen(archive->tempFd, compressLevel,
+                                                   (size_t)frameSize))) {
+    perror(archive->tempName);
+    unlink(archive->tempName);
+    goto failed;
+  }
+  return archive;
+
+failed:
+  if (fd >= 0) {
+    close(fd);
+  }
+  if (archive->tempFd >= 0) {
+    close(archive->tempFd);
+  }
+  if (NULL != archive->map) {
+    munmap(archive->map, (size_t)archive->status.st_size);
+  }
+  free(archive);
+  return NULL;
+}
+
+/*
+//  Where the block from offset on ends: after at least frameSize
+//  bytes, in a framed logfile at the end of a record, in a raw one
+//  after a line if possible. time moves from the record before offset
+//  to the last one in the block, first gets the time of the first.
+*/
+static size_t blockEnd(struct archive const * const archive, size_t const offset,
+                       unsigned long long * const time, unsigned long long * const first) {
+  size_t const size = (size_t)archive->status.st_size;
+  size_t position = offset;
+
+  if (!archive->framed) {
+    unsigned char const *newline;
+
+    *first = 0;
+    if (size - offset <= frameSize) {
+      return size;
+    }
+    position = offset + (size_t)frameSize;
+    newline = memchr(archive->map + position, '\n',
+                     size - position < RAWLINE ? size - position : RAWLINE);
+    return NULL == newline ? position : (size_t)(newline - archive->map) + 1;
+  }
+  if (0 == offset) {
+    logFrameStart(archive->map, LOGFRAMEMAGIC, time);
+    position = LOGFRAMEHEADERSIZE;
+  }
+  *first = *time;
+  while (position < size && position - offset < frameSize) {
+    unsigned long long delta, length;
+    enum logStream stream;
+    ssize_t const header = logFrameDecode(archive->map + position, size - position,
+                                          &delta, &stream, &length);
+
+    if (header <= 0 || length > size - position - (size_t)header) {
+      /* broken or cut short by a crash, it goes along as it is */
+      return size;
+    }
+    *time += delta;
+    if (position == offset) {
+      *first = *time;
+    }
+    position += (size_t)header + (size_t)length;
+  }
+  return position;
+}
+
+/*
+//  Give fd the owner, mode and times in status and sync it, the times
+//  last before the sync so it makes them durable too. Returns false
+//  on error, errno is set.
+*/
+static bool keepAttributes(int const fd, struct stat const * const status) {
+  struct timespec times[2];
+  struct stat current;
+
+  times[0] = status->st_atim;
+  times[1] = status->st_mtim;
+  return 0 == fstat(fd, &current)
+    && ((current.st_uid == status->st_uid && current.st_gid == status->st_gid)
+        || 0 == fchown(fd, status->st_uid, status->st_gid))
+    && 0 == fchmod(fd, status->st_mode & 07777)
+    && 0 == futimens(fd, times)
+    && 0 == fsync(fd);
+}
+
+/*
+//  Rename, but fail with EEXIST instead of replacing an existing
+//  file, like a <name>.gz left by an earlier run.
+*/
+static bool renameNew(char const * const from, char const * const to) {
+  if (0 != link(from, to)) {
+    return false;
+  }
+  if (0 != unlink(from)) {
+    int const saved = errno;
+    unlink(to);
+    errno = saved;
+    return false;
+  }
+  return true;
+}
+
+/*
+//  Give the logfile the owner, mode and times of the original, put it
+//  in the original's place and remove the original.
+*/
+static bool finishArchive(struct archive * const archive) {
+  char finalName[MAXPATHLEN + 8];
+  char indexName[MAXPATHLEN + 8];
+  char finalIndexName[MAXPATHLEN + 16];
+  bool done = !archive->failed;
+  off_t size = 0;
+  int dirFd;
+
+  if (!logCompressClose(archive->compress) && done) {
+    perror(archive->tempName);
+    done = false;
+  }
+  archive->compress = NULL;
+  size = lseek(archive->tempFd, 0, SEEK_END);
+  if (done && !keepAttributes(archive->tempFd, &archive->status)) {
+    fprintf(stderr, "rootsh-archive: %s: cannot keep its owner, mode and times: %s\n",
+            archive->name, strerror(errno));
+    done = false;
+  }
+  if (0 != close(archive->tempFd) && done) {
+    perror(archive->tempName);
+    done = false;
+  }
+  archive->tempFd = -1;
+  if (NULL != archive->map) {
+    munmap(archive->map, (size_t)archive->status.st_size);
+    archive->map = NULL;
+  }
+  if (done && !makeName(finalName, sizeof(finalName), "%s.gz", archive->name)) {
+    done = false;
+  }
+  if (!done || !renameNew(archive->tempName, finalName)) {
+    if (done) {
+      perror(finalName);
+    }
+    unlink(archive->tempName);
+    return false;
+  }
+  /* the index counts offsets before compression, it stays valid */
+  if (makeName(indexName, sizeof(indexName), "%s.idx", archive->name)
+      && makeName(finalIndexName, sizeof(finalIndexName), "%s.idx", finalName)
+      && !renameNew(indexName, finalIndexName) && ENOENT != errno) {
+    perror(indexName);
+  }
+  /*
+  //  The new name is on disk before the original goes.
+  */
+  if ((dirFd = open(logdir, O_RDONLY | O_DIRECTORY)) >= 0) {
+    fsync(dirFd);
+    close(dirFd);
+  }
+  if (0 != unlink(archive->name)) {
+    perror(archive->name);
+    return false;
+  }
+  if (verbose) {
+    printf("%s: %lld -> %lld bytes\n", archive->name,
+           (long long)archive->status.st_size, (long long)size);
+  }
+  return true;
+}
+
+/*
+//  Wait for the oldest block in flight and write it, it may finish
+//  its logfile.
+*/
+static bool writeBlock(void) {
+  struct block * const block = &ring[written % ringSize];
+  struct archive * const archive = block->archive;
+  bool retval = true;
+
+#if USE_THREADS
+  pthread_mutex_lock(&ringLock);
+  while (!block->done) {
+    pthread_cond_wait(&blockDone, &ringLock);
+  }
+  pthread_mutex_unlock(&ringLock);
+#endif
+  if (0 != block->error && !archive->failed) {
+    fprintf(stderr, "rootsh-archive: %s: %s\n", archive->name, strerror(block->error));
+    archive->failed = true;
+  }
+  if (NULL != block->frame && !archive->failed) {
+    throttle(block->length);
+    if (!logCompressAppend(archive->compress, block->time, block->frame,
+                           block->length, block->size)) {
+      perror(archive->tempName);
+      archive->failed = true;
+    }
+  }
+  free(block->frame);
+  block->frame = NULL;
+  ++written;
+  if (block->last) {
+    retval = finishArchive(archive);
+    free(archive);
+  }
+  return retval;
+}
+
+/*
+//  Hand a block to the threads, when the ring is full the oldest
+//  block is written first.
+*/
+static bool queueBlock(struct block const * const next) {
+  bool retval = true;
+  struct block *block;
+
+  if (queued - written == ringSize) {
+    retval = writeBlock();
+  }
+  block = &ring[queued % ringSize];
+  *block = *next;
+  block->done = false;
+#if USE_THREADS
+  if (threads > 0) {
+    pthread_mutex_lock(&ringLock);
+    ++queued;
+    pthread_cond_signal(&workReady);
+    pthread_mutex_unlock(&ringLock);
+    return retval;
+  }
+#endif
+  compressBlock(block);
+  block->done = true;
+  ++queued;
+  return retval;
+}
+
+/*
+//  Cut the logfile into blocks and queue them. Returns false if the
+//  logfile could not be opened, the rest is reported as its blocks
+//  are written.
+*/
+static bool archiveFile(char const * const name) {
+  struct archive * const archive = openArchive(name);
+  size_t const size = NULL == archive ? 0 : (size_t)archive->status.st_size;
+  unsigned long long time = 0;
+  size_t offset = 0;
+  bool retval = true;
+
+  if (NULL == archive) {
+    return false;
+  }
+  do {
+    struct block block;
+
+    memset(&block, 0, sizeof(block));
+    block.archive = archive;
+    block.data = archive->map + offset;
+    block.size = blockEnd(archive, offset, &time, &block.time) - offset;
+    offset += block.size;
+    if (quit) {
+      archive->failed = true;
+      offset = size;
+      block.size = 0;
+    }
+    block.last = offset >= size;
+    throttle(block.size);
+    if (!queueBlock(&block)) {
+      retval = false;
+    }
+  } while (offset < size);
+  return retval;
+}
+
+/*
+//  A logfile that starts like a gzip member was compressed already.
+*/
+static bool isCompressed(char const * const path) {
+  unsigned char magic[2];
+  int const fd = open(path, O_RDONLY | O_NOFOLLOW);
+  bool const compressed = fd >= 0 && sizeof(magic) == read(fd, magic, sizeof(magic))
+    && 0x1f == magic[0] && 0x8b == magic[1];
+
+  if (fd >= 0) {
+    close(fd);
+  }
+  return compressed;
+}
+
+/*
+//  Names ending in .closed or .tampered, but not the manifest.
+*/
+static bool isClosed(char const * const name) {
+  static char const * const suffixes[] = {".closed", ".tampered"};
+  size_t const length = strlen(name);
+  size_t i;
+
+  if ('.' == name[0] || (length >= 16 && 0 == strcmp(name + length - 16, ".manifest.closed"))) {
+    return false;
+  }
+  for (i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); ++i) {
+    size_t const suffix = strlen(suffixes[i]);
+    if (length > suffix && 0 == strcmp(name + length - suffix, suffixes[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+//  A manifest lists the final names of the segments of a logfile,
+//  name those that were archived by their new name.
+*/
+static bool updateManifest(char const * const name) {
+  char tempName[MAXPATHLEN + 16];
+  char line[MAXPATHLEN + 8];
+  struct stat status;
+  bool changed = false, retval = true, whole = true;
+  FILE *manifest, *updated = NULL;
+  int fd = -1;
+
+  if (NULL == (manifest = fopen(name, "r")) || 0 != fstat(fileno(manifest), &status)) {
+    perror(name);
+    if (NULL != manifest) {
+      fclose(manifest);
+    }
+    return false;
+  }
+  if (!makeName(tempName, sizeof(tempName), "%s.XXXXXX", name)) {
+    fclose(manifest);
+    return false;
+  }
+  if ((fd = mkstemp(tempName)) < 0 || NULL == (updated = fdopen(fd, "w"))) {
+    perror(tempName);
+    if (fd >= 0) {
+      close(fd);
+      unlink(tempName);
+    }
+    fclose(manifest);
+    return false;
+  }
+  while (NULL != fgets(line, sizeof(line) - 3, manifest)) {
+    char path[2 * MAXPATHLEN + 8];
+    size_t const length = strcspn(line, "\n");
+    bool const started = whole;
+    struct stat segment;
+
+    /*
+    //  A name longer than line comes in pieces, it stays as it is.
+    */
+    whole = '\n' == line[length] || feof(manifest);
+    line[length] = '\0';
+    if (!started || !whole) {
+      if (started) {
+        fprintf(stderr, "rootsh-archive: %s: %.40s...: name is too long\n", name, line);
+      }
+      fprintf(updated, "%s%s", line, whole ? "\n" : "");
+      continue;
+    }
+    if (isClosed(line) && makeName(path, sizeof(path), "%s/%s", logdir, line)
+        && 0 != lstat(path, &segment) && ENOENT == errno
+        && makeName(path, sizeof(path), "%s/%s.gz", logdir, line)
+        && 0 == lstat(path, &segment)) {
+      strcat(line, ".gz");
+      changed = true;
+    }
+    fprintf(updated, "%s\n", line);
+  }
+  if (changed && (0 != fflush(updated) || ferror(manifest)
+                  || !keepAttributes(fd, &status))) {
+    perror(tempName);
+    retval = false;
+  }
+  fclose(manifest);
+  if (0 != fclose(updated) && changed && retval) {
+    perror(tempName);
+    retval = false;
+  }
+  if (!changed || !retval || 0 != rename(tempName, name)) {
+    if (changed && retval) {
+      perror(name);
+      retval = false;
+    }
+    unlink(tempName);
+  }
+  return retval;
+}
+
+static int compareNames(void const *a, void const *b) {
+  return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/*
+//  The names in logdir that select picks, sorted, NULL on error.
+*/
+static char **listDir(bool (*select)(char const *), size_t * const count) {
+  DIR * const dir = opendir(logdir);
+  struct dirent *entry;
+  char **names = NULL;
+  size_t size = 0;
+
+  *count = 0;
+  if (NULL == dir) {
+    perror(logdir);
+    return NULL;
+  }
+  while (NULL != (entry = readdir(dir))) {
+    if (!select(entry->d_name)) {
+      continue;
+    }
+    if (*count == size) {
+      char ** const grown = realloc(names, (size > 0 ? 2 * size : 64) * sizeof(*names));
+      if (NULL == grown) {
+        break;
+      }
+      names = grown;
+      size = size > 0 ? 2 * size : 64;
+    }
+    if (NULL == (names[*count] = strdup(entry->d_name))) {
+      break;
+    }
+    ++*count;
+  }
+  closedir(dir);
+  if (NULL != entry) {
+    perror("rootsh-archive");
+  }
+  if (*count > 0) {
+    qsort(names, *count, sizeof(*names), compareNames);
+  }
+  return NULL == names ? calloc(1, sizeof(*names)) : names;
+}
+
+static bool isManifest(char const * const name) {
+  size_t const length = strlen(name);
+  return '.' != name[0] && length > 16 && 0 == strcmp(name + length - 16, ".manifest.closed");
+}
+
+static bool readConfigFile(void) {
+  FILE *config = fopen(CONFIGFILE, "r");
+  char line[MAXPATHLEN];
+  bool retval = true;
+
+  if (NULL == config) {
+    return true;
+  }
+  while (NULL != fgets(line, sizeof(line), config)) {
+    char key[MAXPATHLEN + 1];
+    char value[MAXPATHLEN + 1];
+    unsigned long long number;
+
+    if (!isConfigLine(line)
+        || !splitConfigLine(line, sizeof(key), key, sizeof(value), value)) {
+      continue;
+    }
+    if (0 == strncmp("file.dir", key, sizeof(key))) {
+      snprintf(logdir, sizeof(logdir), "%s", value);
+    } else if (0 == strncmp("file.compress.level", key, sizeof(key))) {
+      if (!parseSize(value, &number) || number < 1 || number > 9) {
+        fprintf(stderr, "Configured value for file.compress.level: '%s' must be 1 to 9\n", value);
+        retval = false;
+      }
+      compressLevel = (int)number;
+    } else if (0 == strncmp("file.compress.frame", key, sizeof(key))) {
+      if (!parseSize(value, &frameSize) || 0 == frameSize || frameSize > SIZE_MAX) {
+        fprintf(stderr, "Configured value for file.compress.frame: '%s' is not a size in bytes\n", value);
+        retval = false;
+      }
+    } else if (0 == strncmp("archive.threads", key, sizeof(key))) {
+      if (!parseSize(value, &number) || number > MAXTHREADS) {
+        fprintf(stderr, "Configured value for archive.threads: '%s' must be 0 to %d\n",
+                value, MAXTHREADS);
+        retval = false;
+      }
+      threads = (long)number;
+    } else if (0 == strncmp("archive.bandwidth", key, sizeof(key))) {
+      if (!parseSize(value, &bandwidth)) {
+        fprintf(stderr, "Configured value for archive.bandwidth: '%s' is not a size in bytes\n", value);
+        retval = false;
+      }
+    }
+  }
+  fclose(config);
+  return retval;
+}
+
+static void stop(int const signo) {
+  quit = 1;
+}
+
+static void usage(void) {
+  printf("Usage: rootsh-archive [-d DIR] [-j THREADS] [-b BYTES] [-l LEVEL] [-v]\n"
+         "Compress the closed and tampered logfiles in the logdir.\n"
+         " -d    the logdir, \"file.dir\" in rootsh.cfg\n"
+         " -j    compress on THREADS threads, 0 in this one, \"archive.threads\"\n"
+         " -b    read and write at most BYTES per second, like 20m,\n"
+         "       \"archive.bandwidth\", 0 for no limit\n"
+         " -l    compression LEVEL 1 to 9, \"file.compress.level\"\n"
+         " -v    list the logfiles with their sizes\n");
+}
+
+int main(int argc, char **argv) {
+  struct sigaction action;
+  char **names;
+  size_t count, i;
+  bool ok = true;
+  int option;
+#if USE_THREADS
+  pthread_t pool[MAXTHREADS];
+  long started = 0;
+#endif
+
+  snprintf(logdir, sizeof(logdir), "%s", LOGDIR);
+  threads = sysconf(_SC_NPROCESSORS_ONLN);
+  if (threads < 1) {
+    threads = 1;
+  } else if (threads > MAXTHREADS) {
+    threads = MAXTHREADS;
+  }
+  if (!readConfigFile()) {
+    return EXIT_FAILURE;
+  }
+  while (-1 != (option = getopt(argc, argv, "d:j:b:l:vh?"))) {
+    unsigned long long number;
+
+    switch (option) {
+    case 'd':
+      if (strlen(optarg) > MAXPATHLEN) {
+        fprintf(stderr, "rootsh-archive: %s is too long\n", optarg);
+        return EXIT_FAILURE;
+      }
+      snprintf(logdir, sizeof(logdir), "%s", optarg);
+      break;
+    case 'j':
+      if (!parseSize(optarg, &number) || number > MAXTHREADS) {
+        fprintf(stderr, "rootsh-archive: threads must be from 0 to %d\n", MAXTHREADS);
+        return EXIT_FAILURE;
+      }
+      threads = (long)number;
+      break;
+    case 'b':
+      if (!parseSize(optarg, &bandwidth)) {
+        fprintf(stderr, "rootsh-archive: bad bandwidth %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'l':
+      if (!parseSize(optarg, &number) || number < 1 || number > 9) {
+        fprintf(stderr, "rootsh-archive: level must be from 1 to 9\n");
+        return EXIT_FAILURE;
+      }
+      compressLevel = (int)number;
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      usage();
+      return 'h' == option ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if (optind != argc) {
+    usage();
+    return EXIT_FAILURE;
+  }
+#if !(HAVE_ZLIB_H && HAVE_LIBZ)
+  fprintf(stderr, "rootsh-archive: needs zlib, which it was built without\n");
+  return EXIT_FAILURE;
+#endif
+#if !USE_THREADS
+  threads = 0;
+#endif
+  ringSize = threads > 0 ? (size_t)threads * BLOCKSPERTHREAD : 1;
+  if (NULL == (ring = calloc(ringSize, sizeof(*ring)))) {
+    perror("rootsh-archive");
+    return EXIT_FAILURE;
+  }
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = stop;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  sigaction(SIGHUP, &action, NULL);
+
+#if USE_THREADS
+  for (started = 0; started < threads; ++started) {
+    if (0 != pthread_create(&pool[started], NULL, compressor, NULL)) {
+      perror("rootsh-archive");
+      break;
+    }
+  }
+  if (0 == started) {
+    threads = 0;
+    ringSize = 1;
+  }
+#endif
+
+  /*
+  //  The names are listed first, the directory changes as they are
+  //  archived.
+  */
+  if (NULL == (names = listDir(isClosed, &count))) {
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < count && !quit; ++i) {
+    char path[2 * MAXPATHLEN + 2];
+    struct stat status;
+
+    if (!makeName(path, sizeof(path), "%s/%s", logdir, names[i])) {
+      ok = false;
+      continue;
+    }
+    if (0 != lstat(path, &status) || !S_ISREG(status.st_mode) || isCompressed(path)) {
+      continue;
+    }
+    if (!archiveFile(path)) {
+      ok = false;
+    }
+  }
+  while (written < queued) {
+    if (!writeBlock()) {
+      ok = false;
+    }
+  }
+  for (i = 0; i < count; ++i) {
+    free(names[i]);
+  }
+  free(names);
+
+#if USE_THREADS
+  pthread_mutex_lock(&ringLock);
+  stopping = true;
+  pthread_cond_broadcast(&workReady);
+  pthread_mutex_unlock(&ringLock);
+  while (started > 0) {
+    pthread_join(pool[--started], NULL);
+  }
+#endif
+
+  if (NULL != (names = listDir(isManifest, &count))) {
+    for (i = 0; i < count; ++i) {
+      char path[2 * MAXPATHLEN + 2];
+      if (!makeName(path, sizeof(path), "%s/%s", logdir, names[i])
+          || !updateManifest(path)) {
+        ok = false;
+      }
+      free(names[i]);
+    }
+    free(names);
+  }
+  free(ring);
+  return ok && !quit ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,341 @@
+/*
+  rootsh-gaps reads syslog files and reports which numbered lines of
+  each rootsh session never arrived, how many were lost and in which
+  bursts.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#define _GNU_SOURCE 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "config.h"
+
+#include "seqGaps.h"
+
+/*
+//  The sessions are found by host and session id, like
+//  "srv1 rootsh[062fd]". As pids come again, a session ends when a
+//  new one with the same key starts.
+*/
+#define BUCKETS 4096
+
+/*
+//  The bursts are counted by their length in powers of ten: 1, 2-9,
+//  10-99, ... up to 100000 and more.
+*/
+#define BURSTCLASSES 7
+
+struct session {
+  char *key;
+  struct seqGaps gaps;
+  /*
+  //  The line count of the closing message, so lines lost at the
+  //  end are noticed.
+  */
+  bool closed;
+  struct session *nextInBucket;
+  struct session *nextInOrder;
+};
+
+static struct session *buckets[BUCKETS];
+static struct session *firstSession = NULL;
+static struct session *lastSession = NULL;
+static bool summaryOnly = false;
+
+static unsigned long hashKey(char const *key, size_t const length) {
+  unsigned long hash = 2166136261UL;
+  size_t index;
+
+  for (index = 0; index < length; ++index) {
+    hash = (hash ^ (unsigned char)key[index]) * 16777619UL;
+  }
+  return hash % BUCKETS;
+}
+
+/*
+//  Find the running session of key, or start one. With fresh set a
+//  running session is ended and a new one started.
+*/
+static struct session *findSession(char const *key, size_t const length,
+                                   bool const fresh) {
+  struct session **link = &buckets[hashKey(key, length)];
+  struct session *session;
+
+  for (; NULL != *link; link = &(*link)->nextInBucket) {
+    if (0 == strncmp((*link)->key, key, length) && '\0' == (*link)->key[length]) {
+      if (!fresh) {
+        return *link;
+      }
+      /*
+      //  the old one stays in the report but isn't found anymore
+      */
+      *link = (*link)->nextInBucket;
+      break;
+    }
+  }
+  session = calloc(1, sizeof(*session));
+  if (NULL == session || NULL == (session->key = strndup(key, length))) {
+    perror("rootsh-gaps");
+    exit(EXIT_FAILURE);
+  }
+  seqGapsInit(&session->gaps);
+  link = &buckets[hashKey(key, length)];
+  session->nextInBucket = *link;
+  *link = session;
+  if (NULL == lastSession) {
+    firstSession = session;
+  } else {
+    lastSession->nextInOrder = session;
+  }
+  lastSession = session;
+  return session;
+}
+
+/*
+//  Read a number which ends with ": ", return where the text after it
+//  starts or NULL.
+*/
+static char const *parseSequence(char const *text,
+                                 unsigned long long * const sequence) {
+  char *end;
+
+  if (*text < '0' || *text > '9') {
+    return NULL;
+  }
+  errno = 0;
+  *sequence = strtoull(text, &end, 10);
+  if (0 != errno || ':' != end[0] || ' ' != end[1]) {
+    return NULL;
+  }
+  return end + 2;
+}
+
+/*
+//  "Mar 24 13:44:39 srv1 rootsh[062fd]: user1234: 000: ..." like
+//  the daemon writes it. The key is host and tag, the user name is
+//  optional, lines without a number are looked at for the start and
+//  the end of the session.
+*/
+static void parseLine(char const *line) {
+  char const *tagEnd = strstr(line, "]: ");
+  char const *keyStart, *text, *numbered;
+  unsigned long long sequence;
+  struct session *session;
+  bool hostSeen = false;
+
+  if (NULL == tagEnd) {
+    return;
+  }
+  for (keyStart = tagEnd; keyStart > line; --keyStart) {
+    if (' ' == keyStart[-1]) {
+      if (hostSeen) {
+        break;
+      }
+      hostSeen = true;
+    }
+  }
+  text = tagEnd + 3;
+  numbered = parseSequence(text, &sequence);
+  if (NULL == numbered) {
+    /*
+    //  skip the user name
+    */
+    char const *user = strstr(text, ": ");
+    if (NULL != user && NULL == memchr(text, ' ', user - text)) {
+      numbered = parseSequence(user + 2, &sequence);
+    }
+  }
+  if (NULL == numbered) {
+    char const *closing = strstr(text, " session (");
+    if (NULL != strstr(text, ": logging new ")) {
+      findSession(keyStart, tagEnd + 1 - keyStart, true);
+    } else if (NULL != closing && NULL != strstr(text, ": closing ")) {
+      unsigned long long total;
+      closing = strstr(closing, ") after ");
+      if (NULL != closing && 1 == sscanf(closing, ") after %llu lines", &total)) {
+        session = findSession(keyStart, tagEnd + 1 - keyStart, false);
+        if (!seqGapsEnd(&session->gaps, total)) {
+          perror("rootsh-gaps");
+          exit(EXIT_FAILURE);
+        }
+        session->closed = true;
+      }
+    }
+    return;
+  }
+  session = findSession(keyStart, tagEnd + 1 - keyStart, false);
+  /*
+  //  0 again without a new session message, and not a late one: the
+  //  pid was used again and the start got lost
+  */
+  if (0 == sequence && (session->closed || session->gaps.next > 0)
+      && (session->closed || 0 == session->gaps.count
+          || session->gaps.gaps[0].from > 0)) {
+    session = findSession(keyStart, tagEnd + 1 - keyStart, true);
+  }
+  if (SEQGAPS_NOMEMORY == seqGapsAdd(&session->gaps, sequence)) {
+    perror("rootsh-gaps");
+    exit(EXIT_FAILURE);
+  }
+}
+
+static bool readFile(FILE *file, char const *name) {
+  char *line = NULL;
+  size_t size = 0;
+  ssize_t length;
+
+  while ((length = getline(&line, &size, file)) >= 0) {
+    parseLine(line);
+  }
+  free(line);
+  if (ferror(file)) {
+    perror(name);
+    return false;
+  }
+  return true;
+}
+
+/*
+//  1, 2-9, 10-99, ... as 0, 1, 2, ...
+*/
+static int burstClass(unsigned long long length) {
+  int class = 0;
+
+  if (length > 1) {
+    for (class = 1; class < BURSTCLASSES - 1 && length >= 10; ++class) {
+      length /= 10;
+    }
+  }
+  return class;
+}
+
+static double percent(unsigned long long const part,
+                      unsigned long long const whole) {
+  return whole > 0 ? 100.0 * part / whole : 0.0;
+}
+
+static void report(void) {
+  static char const * const classNames[BURSTCLASSES] = {
+    "1", "2-9", "10-99", "100-999", "1000-9999", "10000-99999", "100000+"
+  };
+  unsigned long long bursts[BURSTCLASSES] = {0};
+  unsigned long long sessions = 0, lossy = 0, sent = 0, received = 0;
+  unsigned long long lost = 0, late = 0, duplicates = 0, longest = 0;
+  struct session *session;
+  int class;
+
+  for (session = firstSession; NULL != session; session = session->nextInOrder) {
+    struct seqGaps const * const gaps = &session->gaps;
+    unsigned long long const sessionLost = seqGapsLost(gaps);
+    size_t index;
+
+    if (0 == gaps->next) {
+      continue;
+    }
+    ++sessions;
+    sent += gaps->next;
+    received += gaps->received;
+    lost += sessionLost;
+    late += gaps->late;
+    duplicates += gaps->duplicates;
+    if (seqGapsLongest(gaps) > longest) {
+      longest = seqGapsLongest(gaps);
+    }
+    for (index = 0; index < gaps->count; ++index) {
+      ++bursts[burstClass(gaps->gaps[index].to - gaps->gaps[index].from + 1)];
+    }
+    if (sessionLost > 0) {
+      ++lossy;
+    }
+    if (summaryOnly) {
+      continue;
+    }
+    printf("%s: lines 0-%llu%s, %llu received, %llu lost (%.2f%%) in %lu bursts",
+           session->key, gaps->next - 1, session->closed ? "" : " or more",
+           gaps->received, sessionLost, percent(sessionLost, gaps->next),
+           (unsigned long)gaps->count);
+    if (gaps->count > 0) {
+      printf(", longest %llu", seqGapsLongest(gaps));
+    }
+    if (gaps->late > 0 || gaps->duplicates > 0) {
+      printf(", %llu late, %llu twice", gaps->late, gaps->duplicates);
+    }
+    printf("\n");
+    for (index = 0; index < gaps->count && index < 10; ++index) {
+      if (gaps->gaps[index].from == gaps->gaps[index].to) {
+        printf("\tmissing %llu\n", gaps->gaps[index].from);
+      } else {
+        printf("\tmissing %llu-%llu\n", gaps->gaps[index].from, gaps->gaps[index].to);
+      }
+    }
+    if (gaps->count > 10) {
+      printf("\t... and %lu more gaps\n", (unsigned long)(gaps->count - 10));
+    }
+  }
+  printf("%llu sessions, %llu with losses\n", sessions, lossy);
+  printf("%llu lines sent, %llu received, %llu lost (%.2f%%), %llu late, %llu twice\n",
+         sent, received, lost, percent(lost, sent), late, duplicates);
+  printf("bursts by length, longest %llu:\n", longest);
+  for (class = 0; class < BURSTCLASSES; ++class) {
+    printf("\t%-12s %llu\n", classNames[class], bursts[class]);
+  }
+}
+
+static void usage(void) {
+  printf("Usage: rootsh-gaps [-s] [FILE] ...\n"
+         "Report the lines of rootsh sessions that are missing in syslog files,\n"
+         "standard input without FILE.\n"
+         " -s    only the summary, not each session\n");
+}
+
+int main(int argc, char **argv) {
+  int option;
+  bool retval = true;
+
+  while (-1 != (option = getopt(argc, argv, "sh?"))) {
+    switch (option) {
+    case 's':
+      summaryOnly = true;
+      break;
+    default:
+      usage();
+      return 'h' == option ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if (optind == argc) {
+    retval = readFile(stdin, "stdin");
+  }
+  for (; optind < argc; ++optind) {
+    FILE * const file = fopen(argv[optind], "r");
+    if (NULL == file) {
+      perror(argv[optind]);
+      retval = false;
+      continue;
+    }
+    retval = readFile(file, argv[optind]) && retval;
+    fclose(file);
+  }
+  report();
+  return retval ? EXIT_SUCCESS : EXIT_FAILURE;
+}
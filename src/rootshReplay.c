@@ -0,0 +1,628 @@
+/*
+  rootsh-replay plays a session logfile back on the terminal. A framed
+  logfile is played with the timing of the session, faster if asked,
+  a raw one as fast as the terminal takes it. The logfile is mapped,
+  not read, and a seek uses the time index next to it, so even large
+  sessions start at once. Of a compressed logfile only the frame that
+  is played is decompressed, its footer tells where the frames are.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#define _GNU_SOURCE 1
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "config.h"
+
+#include "logFrame.h"
+#include "logCompress.h"
+#include "util.h"
+
+/*
+//  Records due at the same time are written together, up to this
+//  many pieces or bytes.
+*/
+#define REPLAYVECTORS 64
+#define REPLAYBYTES 65536
+
+/*
+//  A raw logfile has no records, it is played in lines of at most
+//  this length so pause and step work the same.
+*/
+#define RAWLINE 4096
+
+#define MINSPEED 1.0
+#define MAXSPEED 100.0
+
+/*
+//  Where the player is: the next record starts at offset, time is the
+//  time of the record before it, which the delta counts from.
+*/
+struct position {
+  size_t offset;
+  unsigned long long time;
+};
+
+struct record {
+  enum logStream stream;
+  unsigned long long time;
+  unsigned char const *data;
+  size_t length;
+  size_t next;
+};
+
+/*
+//  map		The logfile as it is on disk.
+//
+//  logSize	The size of the logfile after decompression.
+//
+//  window	The part of the uncompressed logfile from windowStart
+//		to windowEnd that can be read: all of a plain logfile,
+//		one frame of a compressed one.
+//
+//  frames	The footer of a compressed logfile, NULL if the window
+//		holds all of the logfile.
+*/
+static char const *fileName;
+static unsigned char *map = NULL;
+static size_t mapSize = 0;
+static size_t logSize = 0;
+static unsigned char *window = NULL;
+static size_t windowStart = 0;
+static size_t windowEnd = 0;
+static struct logCompressEntry *frames = NULL;
+static size_t frameCount = 0;
+static bool framed = false;
+static int indexFd = -1;
+static unsigned long long startTime = 0;
+
+static double speed = MINSPEED;
+static bool shown[LOGSTREAM_META + 1] = {false, true, true, false};
+static bool interactive = false;
+static struct termios savedTty;
+static volatile sig_atomic_t quit = 0;
+
+static void stop(int const signo) {
+  quit = 1;
+}
+
+static void restoreTty(void) {
+  tcsetattr(STDIN_FILENO, TCSANOW, &savedTty);
+}
+
+/*
+//  Keys are read one by one without echo, ^C still stops.
+*/
+static void setupTty(void) {
+  struct termios raw;
+
+  if (!isatty(STDIN_FILENO) || 0 != tcgetattr(STDIN_FILENO, &savedTty)) {
+    return;
+  }
+  raw = savedTty;
+  raw.c_lflag &= ~(ICANON | ECHO);
+  raw.c_cc[VMIN] = 1;
+  raw.c_cc[VTIME] = 0;
+  if (0 == tcsetattr(STDIN_FILENO, TCSANOW, &raw)) {
+    interactive = true;
+    atexit(restoreTty);
+  }
+}
+
+/*
+//  The last frame that starts at or before value, by time or by
+//  uncompressed offset, the first one if none does.
+*/
+static size_t findFrame(bool const byTime, unsigned long long const value) {
+  size_t low = 0, high = frameCount;
+
+  while (high - low > 1) {
+    size_t const middle = low + (high - low) / 2;
+    if ((byTime ? frames[middle].time : frames[middle].in) <= value) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+/*
+//  Make the window cover offset, decompress its frame if needed.
+//  Returns false past the end or if the frame is broken.
+*/
+static bool load(size_t const offset) {
+  static unsigned char *frameBuffer = NULL;
+  size_t frame, end, size;
+  unsigned char *grown;
+
+  if (offset >= logSize) {
+    return false;
+  }
+  if (offset >= windowStart && offset < windowEnd) {
+    return true;
+  }
+  if (NULL == frames) {
+    return false;
+  }
+  frame = findFrame(false, offset);
+  end = frame + 1 < frameCount ? (size_t)frames[frame + 1].in : logSize;
+  size = end - (size_t)frames[frame].in;
+  if (NULL == (grown = realloc(frameBuffer, size > 0 ? size : 1))) {
+    perror("rootsh-replay");
+    return false;
+  }
+  frameBuffer = grown;
+  if (0 == size || !logCompressInflate(map + frames[frame].out, mapSize - frames[frame].out,
+                                       frameBuffer, size)) {
+    fprintf(stderr, "%s: broken frame at %llu\n", fileName, frames[frame].out);
+    return false;
+  }
+  window = frameBuffer;
+  windowStart = (size_t)frames[frame].in;
+  windowEnd = end;
+  return offset >= windowStart && offset < windowEnd;
+}
+
+/*
+//  Read the record at position. Returns false at the end, a broken
+//  record is reported, one cut short by a crash is not. The record's
+//  data stays valid until a record outside the window is read.
+*/
+static bool readRecord(struct position const * const position,
+                       struct record * const record) {
+  unsigned char const *at;
+  size_t available;
+
+  if (!load(position->offset)) {
+    return false;
+  }
+  at = window + (position->offset - windowStart);
+  available = windowEnd - position->offset;
+  if (framed) {
+    unsigned long long delta, length;
+    ssize_t const size = logFrameDecode(at, available,
+                                        &delta, &record->stream, &length);
+    if (size < 0) {
+      fprintf(stderr, "%s: broken record at %lu\n", fileName,
+              (unsigned long)position->offset);
+      return false;
+    }
+    if (0 == size || length > available - size) {
+      return false;
+    }
+    record->time = position->time + delta;
+    record->data = at + size;
+    record->length = (size_t)length;
+  } else {
+    unsigned char const * const newline =
+      memchr(at, '\n', available < RAWLINE ? available : RAWLINE);
+
+    record->stream = LOGSTREAM_OUT;
+    record->time = position->time;
+    record->data = at;
+    record->length = NULL == newline ? (available < RAWLINE ? available : RAWLINE)
+                                     : (size_t)(newline - record->data) + 1;
+  }
+  record->next = position->offset + (size_t)(record->data - at) + record->length;
+  return true;
+}
+
+static void advance(struct position * const position, struct record const * const record) {
+  position->offset = record->next;
+  position->time = record->time;
+}
+
+/*
+//  Put position on the indexed record found by logFrameSeek or
+//  logFrameSeekOffset. The index has the time of the record, position
+//  needs the one before it.
+*/
+static void startAt(struct position * const position, unsigned long long const offset,
+                    unsigned long long const time) {
+  unsigned long long delta, length;
+  enum logStream stream;
+
+  if (offset < LOGFRAMEHEADERSIZE || !load((size_t)offset)
+      || logFrameDecode(window + (offset - windowStart), windowEnd - offset,
+                        &delta, &stream, &length) <= 0
+      || delta > time) {
+    return;
+  }
+  position->offset = (size_t)offset;
+  position->time = time - delta;
+}
+
+/*
+//  Move to the first record at or after time. Only the record headers
+//  from the indexed record on are looked at. Without the index of a
+//  framed logfile the frames of a compressed one are searched, each
+//  starts with a record and has its time.
+*/
+static void seekTime(struct position * const position, unsigned long long const time) {
+  unsigned long long offset, recordTime;
+  struct record record;
+
+  if (indexFd >= 0 && logFrameSeek(indexFd, time, &offset, &recordTime)) {
+    startAt(position, offset, recordTime);
+  } else if (frameCount > 0) {
+    size_t const found = findFrame(true, time);
+    startAt(position, frames[found].in, frames[found].time);
+  }
+  while (readRecord(position, &record) && record.time < time) {
+    advance(position, &record);
+  }
+}
+
+static void seekOffset(struct position * const position, unsigned long long const offset) {
+  unsigned long long indexed, recordTime;
+  struct record record;
+
+  if (!framed) {
+    position->offset = offset < logSize ? (size_t)offset : logSize;
+    return;
+  }
+  if (indexFd >= 0 && logFrameSeekOffset(indexFd, offset, &indexed, &recordTime)) {
+    startAt(position, indexed, recordTime);
+  } else if (frameCount > 0) {
+    size_t const found = findFrame(false, offset);
+    startAt(position, frames[found].in, frames[found].time);
+  }
+  while (position->offset < offset && readRecord(position, &record)) {
+    advance(position, &record);
+  }
+}
+
+/*
+//  "90", "1:30" or "0:01:30.5" to microseconds.
+*/
+static bool parseTime(char const *text, unsigned long long * const time) {
+  unsigned long long whole = 0;
+  char *end;
+  double seconds;
+  int fields;
+
+  for (fields = 0; fields < 2; ++fields) {
+    char const * const colon = strchr(text, ':');
+    unsigned long long part;
+    if (NULL == colon) {
+      break;
+    }
+    errno = 0;
+    part = strtoull(text, &end, 10);
+    if (0 != errno || end != colon || end == text) {
+      return false;
+    }
+    whole = whole * 60 + part;
+    text = colon + 1;
+  }
+  errno = 0;
+  seconds = strtod(text, &end);
+  if (0 != errno || end == text || '\0' != *end || seconds < 0
+      || (fields > 0 && seconds >= 60)) {
+    return false;
+  }
+  *time = (unsigned long long)((whole * 60 + seconds) * 1000000.0);
+  return true;
+}
+
+static bool writeAll(struct iovec *vector, int count) {
+  while (count > 0) {
+    ssize_t written = writev(STDOUT_FILENO, vector, count);
+    if (written < 0 && EINTR == errno) {
+      if (quit) {
+        return false;
+      }
+      continue;
+    } else if (written <= 0) {
+      return false;
+    }
+    while (count > 0 && (size_t)written >= vector->iov_len) {
+      written -= vector->iov_len;
+      ++vector;
+      --count;
+    }
+    if (count > 0) {
+      vector->iov_base = (char *)vector->iov_base + written;
+      vector->iov_len -= written;
+    }
+  }
+  return true;
+}
+
+/*
+//  The player keeps an anchor: session time anchorTime was played at
+//  anchorWall, a record is due (its time - anchorTime) / speed later.
+//  Pause, resume and a new speed move the anchor to the present.
+*/
+static bool play(struct position position, unsigned long long anchorTime) {
+  unsigned long long anchorWall = utilMonotonicNow();
+  bool paused = false;
+  struct record record;
+
+  while (!quit && readRecord(&position, &record)) {
+    struct iovec vector[REPLAYVECTORS];
+    int count = 0;
+    size_t bytes = 0;
+    bool step = false;
+    unsigned long long now;
+
+    if (!shown[record.stream]) {
+      advance(&position, &record);
+      continue;
+    }
+    /*
+    //  wait for the record or a key
+    */
+    for (;;) {
+      unsigned long long const due = record.time <= anchorTime ? anchorWall
+        : anchorWall + (unsigned long long)((record.time - anchorTime) / speed);
+      struct pollfd key;
+      int timeoutMs = -1;
+      char pressed;
+
+      now = utilMonotonicNow();
+      if (quit) {
+        break;
+      }
+      if (!paused) {
+        if (now >= due) {
+          break;
+        }
+        timeoutMs = (due - now + 999) / 1000 > INT_MAX ? INT_MAX
+                                                       : (int)((due - now + 999) / 1000);
+      }
+      key.fd = STDIN_FILENO;
+      key.events = POLLIN;
+      if (poll(&key, interactive ? 1 : 0, timeoutMs) <= 0
+          || 1 != read(STDIN_FILENO, &pressed, 1)) {
+        continue;
+      }
+      now = utilMonotonicNow();
+      if (!paused) {
+        /*
+        //  where the session is now, the record isn't played yet
+        */
+        unsigned long long current = anchorTime
+          + (unsigned long long)((now - anchorWall) * speed);
+        if (current > record.time) {
+          current = record.time;
+        }
+        anchorTime = current;
+      }
+      anchorWall = now;
+      if (' ' == pressed) {
+        paused = !paused;
+      } else if ('.' == pressed && paused) {
+        step = true;
+        break;
+      } else if ('+' == pressed) {
+        speed = speed * 2 > MAXSPEED ? MAXSPEED : speed * 2;
+      } else if ('-' == pressed) {
+        speed = speed / 2 < MINSPEED ? MINSPEED : speed / 2;
+      } else if ('q' == pressed) {
+        quit = 1;
+      }
+    }
+    if (quit) {
+      break;
+    }
+    /*
+    //  this one and all that are due with it, from the same window
+    */
+    do {
+      if (!shown[record.stream]) {
+        advance(&position, &record);
+        continue;
+      }
+      if (!step && count > 0 && record.time > anchorTime
+          && anchorWall + (unsigned long long)((record.time - anchorTime) / speed) > now) {
+        break;
+      }
+      if (count > 0 && (unsigned char *)vector[count - 1].iov_base
+                       + vector[count - 1].iov_len == record.data) {
+        vector[count - 1].iov_len += record.length;
+      } else {
+        vector[count].iov_base = (void *)record.data;
+        vector[count].iov_len = record.length;
+        ++count;
+      }
+      bytes += record.length;
+      advance(&position, &record);
+    } while (!step && count < REPLAYVECTORS && bytes < REPLAYBYTES
+             && position.offset < windowEnd && readRecord(&position, &record));
+    if (step) {
+      anchorTime = position.time;
+      anchorWall = utilMonotonicNow();
+    }
+    if (!writeAll(vector, count)) {
+      if (!quit) {
+        perror("rootsh-replay");
+        return false;
+      }
+    }
+  }
+  if (quit) {
+    fprintf(stderr, "\nrootsh-replay: stopped at %.3f seconds, offset %lu\n",
+            position.time > startTime ? (position.time - startTime) / 1000000.0 : 0.0,
+            (unsigned long)position.offset);
+  }
+  return true;
+}
+
+static bool openLog(void) {
+  char indexName[PATH_MAX];
+  struct stat status;
+  int const fd = open(fileName, O_RDONLY);
+
+  if (fd < 0 || 0 != fstat(fd, &status)) {
+    perror(fileName);
+    return false;
+  }
+  mapSize = (size_t)status.st_size;
+  if (mapSize > 0) {
+    map = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == map) {
+      perror(fileName);
+      close(fd);
+      return false;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(map, mapSize, MADV_SEQUENTIAL);
+#endif
+  }
+  close(fd);
+  window = map;
+  windowEnd = logSize = mapSize;
+  if (mapSize >= 2 && 0x1f == map[0] && 0x8b == map[1]) {
+    unsigned long long total;
+
+    if (logCompressReadFooter(map, mapSize, &frames, &frameCount, &total)
+        && total <= SIZE_MAX) {
+      logSize = (size_t)total;
+      windowEnd = 0;
+    } else if (ENOMEM != errno) {
+      /* no footer, the session did not end */
+      fprintf(stderr, "%s: has no footer, decompressing all of it\n", fileName);
+      free(frames);
+      frames = NULL;
+      frameCount = 0;
+      if (NULL == (window = logCompressInflateAll(map, mapSize, &logSize))) {
+        fprintf(stderr, "%s: cannot be decompressed\n", fileName);
+        return false;
+      }
+      windowEnd = logSize;
+    } else {
+      perror(fileName);
+      return false;
+    }
+  }
+  framed = load(0) && windowEnd >= LOGFRAMEHEADERSIZE
+    && logFrameStart(window, LOGFRAMEMAGIC, &startTime);
+  if (framed && (size_t)snprintf(indexName, sizeof(indexName), "%s.idx", fileName)
+                < sizeof(indexName)) {
+    indexFd = open(indexName, O_RDONLY);
+  }
+  return true;
+}
+
+static void usage(void) {
+  printf("Usage: rootsh-replay [-s SPEED] [-t TIME | -o OFFSET] [-i] [-m] FILE\n"
+         "Play a rootsh logfile back, a framed one with the timing of the session.\n"
+         " -s    play SPEED (1 to 100) times as fast\n"
+         " -t    start at TIME of the session, like 90, 1:30 or 1:02:03.5\n"
+         " -o    start at the record at or after byte OFFSET of the logfile,\n"
+         "       counted before compression\n"
+         " -i    show the input too, not only the output\n"
+         " -m    show the messages of rootsh too\n"
+         "Keys while playing: space pauses and resumes, . plays the next piece\n"
+         "while paused, + and - double and halve the speed, q quits.\n");
+}
+
+int main(int argc, char **argv) {
+  struct position position;
+  struct sigaction action;
+  unsigned long long seek = 0;
+  bool seekByTime = false, seekByOffset = false;
+  int option;
+  char *end;
+
+  while (-1 != (option = getopt(argc, argv, "s:t:o:imh?"))) {
+    switch (option) {
+    case 's':
+      errno = 0;
+      speed = strtod(optarg, &end);
+      if (0 != errno || end == optarg || '\0' != *end
+          || speed < MINSPEED || speed > MAXSPEED) {
+        fprintf(stderr, "rootsh-replay: speed must be from %g to %g\n",
+                MINSPEED, MAXSPEED);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 't':
+      if (!parseTime(optarg, &seek)) {
+        fprintf(stderr, "rootsh-replay: bad time %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      seekByTime = true;
+      break;
+    case 'o':
+      errno = 0;
+      seek = strtoull(optarg, &end, 10);
+      if (0 != errno || end == optarg || '\0' != *end) {
+        fprintf(stderr, "rootsh-replay: bad offset %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      seekByOffset = true;
+      break;
+    case 'i':
+      shown[LOGSTREAM_IN] = true;
+      break;
+    case 'm':
+      shown[LOGSTREAM_META] = true;
+      break;
+    default:
+      usage();
+      return 'h' == option ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if (optind + 1 != argc || (seekByTime && seekByOffset)) {
+    usage();
+    return EXIT_FAILURE;
+  }
+  fileName = argv[optind];
+  if (!openLog()) {
+    return EXIT_FAILURE;
+  }
+  if (seekByTime && !framed) {
+    fprintf(stderr, "rootsh-replay: %s is not framed, it has no times\n", fileName);
+    return EXIT_FAILURE;
+  }
+  position.offset = framed ? LOGFRAMEHEADERSIZE : 0;
+  position.time = startTime;
+  if (seekByTime) {
+    seekTime(&position, startTime + seek);
+  } else if (seekByOffset) {
+    seekOffset(&position, seek);
+  }
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = stop;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  sigaction(SIGHUP, &action, NULL);
+  setupTty();
+  return play(position, seekByTime ? startTime + seek : position.time)
+    ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,138 @@
+/*
+  Finds the gaps in the sequence numbers of a session. Numbers usually
+  arrive in order, a late one is looked up from the most recent gap
+  backwards.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "seqGaps.h"
+
+/*
+//  Make room for a gap at index, the ones from there move up.
+*/
+static bool insertGap(struct seqGaps * const gaps, size_t const index,
+                      unsigned long long const from,
+                      unsigned long long const to) {
+  if (gaps->count == gaps->size) {
+    size_t const size = gaps->size > 0 ? 2 * gaps->size : 16;
+    struct seqGap * const grown = realloc(gaps->gaps, size * sizeof(*grown));
+    if (NULL == grown) {
+      return false;
+    }
+    gaps->gaps = grown;
+    gaps->size = size;
+  }
+  memmove(gaps->gaps + index + 1, gaps->gaps + index,
+          (gaps->count - index) * sizeof(*gaps->gaps));
+  gaps->gaps[index].from = from;
+  gaps->gaps[index].to = to;
+  ++gaps->count;
+  return true;
+}
+
+void seqGapsInit(struct seqGaps * const gaps) {
+  memset(gaps, 0, sizeof(*gaps));
+}
+
+enum seqGapsResult seqGapsAdd(struct seqGaps * const gaps,
+                              unsigned long long const sequence) {
+  size_t index;
+
+  if (sequence >= gaps->next) {
+    if (sequence > gaps->next
+        && !insertGap(gaps, gaps->count, gaps->next, sequence - 1)) {
+      return SEQGAPS_NOMEMORY;
+    }
+    gaps->next = sequence + 1;
+    ++gaps->received;
+    return SEQGAPS_INORDER;
+  }
+  for (index = gaps->count; index > 0; --index) {
+    struct seqGap * const gap = &gaps->gaps[index - 1];
+    if (sequence > gap->to) {
+      break;
+    }
+    if (sequence < gap->from) {
+      continue;
+    }
+    /*
+    //  the number is in this gap: shrink it, drop it or split it
+    */
+    if (gap->from == gap->to) {
+      memmove(gap, gap + 1, (gaps->count - index) * sizeof(*gap));
+      --gaps->count;
+    } else if (sequence == gap->from) {
+      ++gap->from;
+    } else if (sequence == gap->to) {
+      --gap->to;
+    } else {
+      unsigned long long const to = gap->to;
+      gap->to = sequence - 1;
+      if (!insertGap(gaps, index, sequence + 1, to)) {
+        gap->to = to;
+        return SEQGAPS_NOMEMORY;
+      }
+    }
+    ++gaps->received;
+    ++gaps->late;
+    return SEQGAPS_LATE;
+  }
+  ++gaps->duplicates;
+  return SEQGAPS_DUPLICATE;
+}
+
+bool seqGapsEnd(struct seqGaps * const gaps, unsigned long long const total) {
+  if (total > gaps->next) {
+    if (!insertGap(gaps, gaps->count, gaps->next, total - 1)) {
+      return false;
+    }
+    gaps->next = total;
+  }
+  return true;
+}
+
+unsigned long long seqGapsLost(struct seqGaps const * const gaps) {
+  unsigned long long lost = 0;
+  size_t index;
+
+  for (index = 0; index < gaps->count; ++index) {
+    lost += gaps->gaps[index].to - gaps->gaps[index].from + 1;
+  }
+  return lost;
+}
+
+unsigned long long seqGapsLongest(struct seqGaps const * const gaps) {
+  unsigned long long longest = 0;
+  size_t index;
+
+  for (index = 0; index < gaps->count; ++index) {
+    if (gaps->gaps[index].to - gaps->gaps[index].from + 1 > longest) {
+      longest = gaps->gaps[index].to - gaps->gaps[index].from + 1;
+    }
+  }
+  return longest;
+}
+
+void seqGapsFree(struct seqGaps * const gaps) {
+  free(gaps->gaps);
+  seqGapsInit(gaps);
+}
@@ -0,0 +1,103 @@
+/*
+  Header for finding the gaps in the sequence numbers of a session.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef SEQGAPS_H
+#define SEQGAPS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+//  A run of sequence numbers that did not arrive, from and to
+//  included.
+*/
+struct seqGap {
+  unsigned long long from;
+  unsigned long long to;
+};
+
+/*
+//  The sequence numbers seen of one session. The numbers start at 0,
+//  everything below next that did not arrive is in gaps, which are
+//  kept in ascending order.
+*/
+struct seqGaps {
+  unsigned long long next;
+  unsigned long long received;
+  unsigned long long late;
+  unsigned long long duplicates;
+  struct seqGap *gaps;
+  size_t count;
+  size_t size;
+};
+
+/**
+ * What seqGapsAdd made of a number.
+ */
+enum seqGapsResult {
+  /** the next one or beyond, anything in between is a new gap */
+  SEQGAPS_INORDER,
+  /** it closes (part of) a gap */
+  SEQGAPS_LATE,
+  /** it was seen before */
+  SEQGAPS_DUPLICATE,
+  /** a new gap could not be stored */
+  SEQGAPS_NOMEMORY
+};
+
+/**
+ * @param gaps the session to setup, nothing seen yet
+ */
+void seqGapsInit(struct seqGaps * const gaps);
+
+/**
+ * Count a sequence number which arrived.
+ *
+ * @return what the number was
+ */
+enum seqGapsResult seqGapsAdd(struct seqGaps * const gaps,
+                              unsigned long long const sequence);
+
+/**
+ * The sender said how many numbers it used, the ones after the last
+ * seen are lost too.
+ *
+ * @param total how many numbers were sent
+ * @return false if the gap could not be stored
+ */
+bool seqGapsEnd(struct seqGaps * const gaps, unsigned long long const total);
+
+/**
+ * @return how many numbers are missing
+ */
+unsigned long long seqGapsLost(struct seqGaps const * const gaps);
+
+/**
+ * @return the longest gap, 0 without one
+ */
+unsigned long long seqGapsLongest(struct seqGaps const * const gaps);
+
+/**
+ * Release the memory.
+ */
+void seqGapsFree(struct seqGaps * const gaps);
+
+#endif
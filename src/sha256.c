@@ -0,0 +1,142 @@
+/*
+  SHA-256 (FIPS 180-4), so a record can tell which data it stands for
+  without a crypto library.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <string.h>
+
+#include "sha256.h"
+
+static uint32_t const rounds[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void compress(struct sha256 * const hash, unsigned char const *block) {
+  uint32_t w[64], a, b, c, d, e, f, g, h;
+  int i;
+
+  for (i = 0; i < 16; ++i) {
+    w[i] = (uint32_t)block[4 * i] << 24 | (uint32_t)block[4 * i + 1] << 16
+      | (uint32_t)block[4 * i + 2] << 8 | block[4 * i + 3];
+  }
+  for (i = 16; i < 64; ++i) {
+    uint32_t const s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t const s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  a = hash->state[0];
+  b = hash->state[1];
+  c = hash->state[2];
+  d = hash->state[3];
+  e = hash->state[4];
+  f = hash->state[5];
+  g = hash->state[6];
+  h = hash->state[7];
+  for (i = 0; i < 64; ++i) {
+    uint32_t const t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25))
+      + ((e & f) ^ (~e & g)) + rounds[i] + w[i];
+    uint32_t const t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22))
+      + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  hash->state[0] += a;
+  hash->state[1] += b;
+  hash->state[2] += c;
+  hash->state[3] += d;
+  hash->state[4] += e;
+  hash->state[5] += f;
+  hash->state[6] += g;
+  hash->state[7] += h;
+}
+
+void sha256Init(struct sha256 * const hash) {
+  static uint32_t const initial[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+
+  memcpy(hash->state, initial, sizeof(initial));
+  hash->length = 0;
+  hash->used = 0;
+}
+
+void sha256Update(struct sha256 * const hash, void const *data,
+                  size_t length) {
+  unsigned char const *bytes = data;
+
+  hash->length += length;
+  if (hash->used > 0) {
+    size_t const take = length < 64 - hash->used ? length : 64 - hash->used;
+    memcpy(hash->block + hash->used, bytes, take);
+    hash->used += take;
+    bytes += take;
+    length -= take;
+    if (hash->used < 64) {
+      return;
+    }
+    compress(hash, hash->block);
+    hash->used = 0;
+  }
+  for (; length >= 64; bytes += 64, length -= 64) {
+    compress(hash, bytes);
+  }
+  memcpy(hash->block, bytes, length);
+  hash->used = length;
+}
+
+void sha256Hex(struct sha256 * const hash, char * const hex) {
+  static char const digits[] = "0123456789abcdef";
+  uint64_t const bits = hash->length * 8;
+  int i;
+
+  hash->block[hash->used++] = 0x80;
+  if (hash->used > 56) {
+    memset(hash->block + hash->used, 0, 64 - hash->used);
+    compress(hash, hash->block);
+    hash->used = 0;
+  }
+  memset(hash->block + hash->used, 0, 56 - hash->used);
+  for (i = 0; i < 8; ++i) {
+    hash->block[56 + i] = (unsigned char)(bits >> (56 - 8 * i));
+  }
+  compress(hash, hash->block);
+  for (i = 0; i < SHA256SIZE; ++i) {
+    unsigned char const byte = (unsigned char)(hash->state[i / 4] >> (24 - 8 * (i % 4)));
+    hex[2 * i] = digits[byte >> 4];
+    hex[2 * i + 1] = digits[byte & 0x0f];
+  }
+  hex[2 * SHA256SIZE] = '\0';
+}
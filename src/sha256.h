@@ -0,0 +1,66 @@
+/*
+  Header for the SHA-256 hash (FIPS 180-4).
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * How long a digest is, and its hex form with the \0.
+ */
+#define SHA256SIZE 32
+#define SHA256HEXSIZE (2 * SHA256SIZE + 1)
+
+/*
+//  The state of a hash that takes its data in pieces.
+*/
+struct sha256 {
+  uint32_t state[8];
+  uint64_t length;
+  unsigned char block[64];
+  size_t used;
+};
+
+/**
+ * @param hash start a new hash
+ */
+void sha256Init(struct sha256 * const hash);
+
+/**
+ * Hash more data.
+ *
+ * @param data what to add
+ * @param length how long data is
+ */
+void sha256Update(struct sha256 * const hash, void const *data,
+                  size_t length);
+
+/**
+ * Finish the hash and write the digest as lower case hex. The hash has
+ * to be setup with sha256Init again before it is used once more.
+ *
+ * @param hex where the digest goes, SHA256HEXSIZE bytes
+ */
+void sha256Hex(struct sha256 * const hash, char * const hex);
+
+#endif
@@ -0,0 +1,288 @@
+/*
+  Registry of the places the session is logged to.
+
+  Every sink, like the logfile or syslog, gets a queue and a logger
+  thread of its own. The relay copies each chunk of output into all
+  queues, so a syslog daemon that doesn't answer only fills the queue
+  of syslog while the logfile is written as fast as before.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sink.h"
+
+static struct sink *firstSink = NULL;
+
+void sinkRegister(struct sink * const sink) {
+  struct sink **link = &firstSink;
+
+  while (NULL != *link) {
+    link = &(*link)->next;
+  }
+  sink->queue = NULL;
+  sink->data = NULL;
+  sink->next = NULL;
+  *link = sink;
+  /* the clock starts before any thread may read it */
+  sinkNow();
+}
+
+struct sink *sinkFirst(void) {
+  return firstSink;
+}
+
+bool sinkOpenAll(void) {
+  struct sink *sink;
+
+  for (sink = firstSink; NULL != sink; sink = sink->next) {
+    if (NULL != sink->open && !sink->open()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+unsigned long long sinkNow(void) {
+  static bool started = false;
+  static unsigned long long wallStart;
+  static unsigned long long clockStart;
+  struct timespec now;
+  unsigned long long clockNow;
+
+#ifdef CLOCK_MONOTONIC
+  clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+  clock_gettime(CLOCK_REALTIME, &now);
+#endif
+  clockNow = (unsigned long long)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+  if (!started) {
+    clock_gettime(CLOCK_REALTIME, &now);
+    wallStart = (unsigned long long)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+    clockStart = clockNow;
+    started = true;
+  }
+  return wallStart + (clockNow - clockStart);
+}
+
+/*
+//  The stats are only written by the thread that calls write, the
+//  relay reads them after the thread ended.
+*/
+static void writeSink(struct sink * const sink, struct sinkBatchEntry const * const batch,
+                      int const count) {
+  int i;
+
+  if (0 == count) {
+    return;
+  }
+  sink->write(batch, count);
+  for (i = 0; i < count; ++i) {
+    sink->stats.bytes += batch[i].length;
+  }
+  sink->stats.records += count;
+  ++sink->stats.writes;
+}
+
+/*
+//  The queue is a stream of bytes, every record in it is a
+//  sinkRecordHeader and the data. The records the ring hands over in
+//  one piece are passed to the sink from there, together in one
+//  batch. The others are put together in sink->data first, a batch
+//  holds at most one of them, so it is written before sink->data is
+//  reused.
+*/
+static void queueWrite(void *context, char *msgbuf, int msglen) {
+  struct sink * const sink = context;
+  struct sinkBatchEntry batch[SINKBATCHSIZE];
+  int count = 0;
+
+  while (msglen > 0) {
+    size_t left;
+
+    if (sink->headerRead < sizeof(sink->header)) {
+      size_t part = sizeof(sink->header) - sink->headerRead;
+      if (part > (size_t)msglen) {
+        part = msglen;
+      }
+      memcpy((char *)&sink->header + sink->headerRead, msgbuf, part);
+      sink->headerRead += part;
+      msgbuf += part;
+      msglen -= part;
+      continue;
+    }
+    if (SINKBATCHSIZE == count) {
+      writeSink(sink, batch, count);
+      count = 0;
+    }
+    left = sink->header.length - sink->dataRead;
+    if (0 == sink->dataRead && (size_t)msglen >= left) {
+      batch[count].data = msgbuf;
+    } else {
+      writeSink(sink, batch, count);
+      count = 0;
+      if (left > (size_t)msglen) {
+        left = msglen;
+      }
+      memcpy(sink->data + sink->dataRead, msgbuf, left);
+      sink->dataRead += left;
+      if (sink->dataRead < sink->header.length) {
+        return;
+      }
+      batch[count].data = sink->data;
+    }
+    batch[count].record = sink->header.record;
+    batch[count].length = (int)sink->header.length;
+    ++count;
+    msgbuf += left;
+    msglen -= left;
+    sink->headerRead = 0;
+    sink->dataRead = 0;
+  }
+  writeSink(sink, batch, count);
+}
+
+static int queueFlush(void *context) {
+  return ((struct sink *)context)->flush();
+}
+
+bool sinkStart(struct sink * const sink, char const * const spillPrefix) {
+  char spillTemplate[BUFSIZ];
+
+  if (NULL != sink->queue) {
+    return true;
+  }
+  if (0 == sink->queueSize) {
+    return false;
+  }
+  if (NULL == (sink->data = malloc(SINKRECORDSIZE))) {
+    return false;
+  }
+  sink->headerRead = 0;
+  sink->dataRead = 0;
+  if ((size_t)snprintf(spillTemplate, sizeof(spillTemplate), "%s.%s.spill.XXXXXX",
+                       spillPrefix, sink->name) >= sizeof(spillTemplate)) {
+    fprintf(stderr, "Spill file name for %s is too long\n", sink->name);
+    free(sink->data);
+    sink->data = NULL;
+    return false;
+  }
+  sink->queue = logQueueStart(sink->queueSize, sink->queueFull, spillTemplate,
+                              queueWrite, NULL == sink->flush ? NULL : queueFlush,
+                              sink);
+  if (NULL == sink->queue) {
+    free(sink->data);
+    sink->data = NULL;
+    return false;
+  }
+  return true;
+}
+
+void sinkStartAll(char const * const spillPrefix) {
+  struct sink *sink;
+
+  for (sink = firstSink; NULL != sink; sink = sink->next) {
+    sinkStart(sink, spillPrefix);
+  }
+}
+
+void sinkPush(struct sink * const sink, struct sinkRecord const * const record,
+              char * const msgbuf, int const msglen) {
+  int done = 0;
+
+  while (done < msglen) {
+    int const part = msglen - done > SINKRECORDSIZE ? SINKRECORDSIZE : msglen - done;
+
+    if (NULL != sink->queue) {
+      struct sinkRecordHeader header;
+
+      memset(&header, 0, sizeof(header));
+      header.record = *record;
+      header.length = part;
+      logQueuePush(sink->queue, (char const *)&header, sizeof(header));
+      logQueuePush(sink->queue, msgbuf + done, part);
+    } else {
+      struct sinkBatchEntry entry;
+
+      entry.record = *record;
+      entry.data = msgbuf + done;
+      entry.length = part;
+      writeSink(sink, &entry, 1);
+    }
+    done += part;
+  }
+}
+
+void sinkPushAll(enum logStream const stream, char * const msgbuf, int const msglen) {
+  struct sinkRecord record;
+  struct sink *sink;
+
+  record.stream = stream;
+  record.time = sinkNow();
+  for (sink = firstSink; NULL != sink; sink = sink->next) {
+    sinkPush(sink, &record, msgbuf, msglen);
+  }
+}
+
+int sinkFlushInline(void) {
+  struct sink *sink;
+  int timeoutMs = -1;
+
+  for (sink = firstSink; NULL != sink; sink = sink->next) {
+    if (NULL == sink->queue && NULL != sink->flush) {
+      int const next = sink->flush();
+      if (next >= 0 && (timeoutMs < 0 || next < timeoutMs)) {
+        timeoutMs = next;
+      }
+    }
+  }
+  return timeoutMs;
+}
+
+void sinkStopAll(void) {
+  struct sink *sink;
+
+  for (sink = firstSink; NULL != sink; sink = sink->next) {
+    if (NULL != sink->queue) {
+      struct logQueueStats queueStats;
+      logQueueStop(sink->queue, &queueStats);
+      sink->queue = NULL;
+      free(sink->data);
+      sink->data = NULL;
+      sink->stats.blocked += queueStats.blocked;
+      sink->stats.spilled += queueStats.spilled;
+    }
+  }
+}
+
+void sinkCloseAll(void) {
+  struct sink *sink;
+
+  sinkStopAll();
+  for (sink = firstSink; NULL != sink; sink = sink->next) {
+    if (NULL != sink->close) {
+      sink->close();
+    }
+  }
+  firstSink = NULL;
+}
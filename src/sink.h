@@ -0,0 +1,197 @@
+/*
+  Header for the registry of the places the session is logged to.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef SINK_H
+#define SINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "logQueue.h"
+#include "logStream.h"
+
+/**
+ * The largest piece a sink gets with one write, longer output is
+ * split.
+ */
+#define SINKRECORDSIZE 65536
+
+/**
+ * The most records a sink gets with one write.
+ */
+#define SINKBATCHSIZE 64
+
+/**
+ * What a sink did during the session.
+ */
+struct sinkStats {
+  /** bytes given to write */
+  unsigned long long bytes;
+  /** records given to write */
+  unsigned long long records;
+  /** calls of write */
+  unsigned long long writes;
+  /** how often the relay waited for the sink's thread */
+  unsigned long long blocked;
+  /** bytes that went through the spill file */
+  unsigned long long spilled;
+};
+
+/**
+ * Where and when the relay got a piece of output.
+ */
+struct sinkRecord {
+  enum logStream stream;
+  /** microseconds since the epoch, from sinkNow */
+  unsigned long long time;
+};
+
+/**
+ * A record and its data, which stays where the queue or the relay
+ * has it.
+ */
+struct sinkBatchEntry {
+  struct sinkRecord record;
+  char *data;
+  int length;
+};
+
+/**
+ * What goes into a queue before the data of each record.
+ */
+struct sinkRecordHeader {
+  struct sinkRecord record;
+  size_t length;
+};
+
+/**
+ * A place the session is logged to. The hooks are called from the
+ * sink's own thread while it runs, from the relay otherwise. Only
+ * write is required.
+ */
+struct sink {
+  /** shown in messages and spill file names */
+  char const *name;
+  /** @return false if the sink can't be used */
+  bool (*open)(void);
+  /**
+   * Log the next pieces of output, in order. A sink with a thread
+   * gets what the queue handed over at once, up to SINKBATCHSIZE
+   * records.
+   */
+  void (*write)(struct sinkBatchEntry const *batch, int count);
+  /**
+   * Called when there is nothing to write.
+   *
+   * @return milliseconds until it wants to be called again, -1 if
+   * not before the next write
+   */
+  int (*flush)(void);
+  /** write what is left, the session is over */
+  void (*close)(void);
+  /** capacity of the queue in bytes, 0 writes inline */
+  size_t queueSize;
+  /** what the relay does when the queue is full */
+  enum logQueueFull queueFull;
+
+  /* the rest belongs to the registry */
+  struct logQueue *queue;
+  /** a record the queue handed over in pieces */
+  struct sinkRecordHeader header;
+  size_t headerRead;
+  char *data;
+  size_t dataRead;
+  struct sinkStats stats;
+  struct sink *next;
+};
+
+/**
+ * Add a sink. The sinks are opened, written and closed in the order
+ * they were added.
+ */
+void sinkRegister(struct sink * const sink);
+
+/**
+ * @return the first registered sink, the others follow through next
+ */
+struct sink *sinkFirst(void);
+
+/**
+ * Open all sinks in order.
+ *
+ * @return false if a sink can't be opened, the session must not start
+ */
+bool sinkOpenAll(void);
+
+/**
+ * Move a sink into a thread of its own. Does nothing if the sink has
+ * no queue or already runs.
+ *
+ * @param spillPrefix the spill file is made from it and the name of
+ * the sink
+ * @return true if the sink runs in its thread
+ */
+bool sinkStart(struct sink * const sink, char const * const spillPrefix);
+
+/**
+ * sinkStart for every sink.
+ */
+void sinkStartAll(char const * const spillPrefix);
+
+/**
+ * The clock of the records. It starts with the wall clock but never
+ * goes back, even if the wall clock does.
+ *
+ * @return microseconds since the epoch
+ */
+unsigned long long sinkNow(void);
+
+/**
+ * Hand output to one sink. Only the relay may call this while the
+ * sink runs in its thread.
+ */
+void sinkPush(struct sink * const sink, struct sinkRecord const * const record,
+              char * const msgbuf, int const msglen);
+
+/**
+ * Hand output to every sink, as a record of now.
+ */
+void sinkPushAll(enum logStream const stream, char * const msgbuf, int const msglen);
+
+/**
+ * Call flush of the sinks which don't have a thread.
+ *
+ * @return milliseconds until the next call, -1 if there is no hurry
+ */
+int sinkFlushInline(void);
+
+/**
+ * Let the sink threads write what is queued and end them. The sinks
+ * stay open and are written inline from now on.
+ */
+void sinkStopAll(void);
+
+/**
+ * Stop the threads and close all sinks.
+ */
+void sinkCloseAll(void);
+
+#endif
@@ -0,0 +1,491 @@
+/*
+  A syslog client that formats the messages itself and sends the
+  lines of a whole read chunk with one sendmmsg to /dev/log.
+
+  With a spool the client never waits for the daemon: what it doesn't
+  take right now is appended to a file and sent from there, in order,
+  as soon as the daemon is back.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+/* sendmmsg is a GNU extension */
+#define _GNU_SOURCE 1
+
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "syslogClient.h"
+#include "util.h"
+
+/*
+//  At most this many messages, together no longer than the batch
+//  buffer, go out with one sendmmsg.
+*/
+#define SYSLOGBATCH 64
+#define SYSLOGBATCHSIZE 65536
+
+/*
+//  Room for "<191>1 2026-10-17T07:36:00+02:00 ".
+*/
+#define STAMPSIZE 48
+
+/*
+//  How long syslogClientClose waits for the daemon to take the spool.
+*/
+#define SPOOLCLOSETIMEOUT 5
+
+/*
+//  socketFd		The datagram socket connected to the daemon, -1
+//			while syslog(3) is used.
+//
+//  socketPath		Where it is connected to, for a reconnect after
+//			the daemon was restarted.
+//
+//  tag			What follows the timestamp: "rootsh[01234]: "
+//			or "host rootsh 01234 - - " and the user name.
+//			It doesn't change, so it is made only once.
+//
+//  stamp		The priority and the timestamp, made again when
+//			one of them changes.
+*/
+static int socketFd = -1;
+static struct sockaddr_un socketPath;
+static enum syslogFormat socketFormat;
+static char tag[512];
+static size_t tagLength;
+static char stamp[STAMPSIZE];
+static size_t stampLength;
+static time_t stampSecond = -1;
+static int stampPriority = -1;
+
+/*
+//  The queued messages. Each is copied completely into the batch
+//  buffer, headerLengths tells syslog(3) where the text starts if the
+//  socket fails.
+*/
+static char batch[SYSLOGBATCHSIZE];
+static size_t batchUsed;
+static struct mmsghdr messages[SYSLOGBATCH];
+static struct iovec vectors[SYSLOGBATCH];
+static size_t headerLengths[SYSLOGBATCH];
+static unsigned int batchCount;
+
+/*
+//  spoolName		The spool file, "" for none. It is created when
+//			it is needed first.
+//
+//  spoolRead		What of the file was sent and what was written.
+//  spoolWritten	The file holds the datagrams in octet-counted
+//			frames like RFC 6587, "LEN <PRI>...". Once all of
+//			it is sent, it is emptied.
+//
+//  spoolLimit		The largest the file may get, messages that don't
+//			fit anymore are dropped.
+//
+//  reconnectSecond	When the daemon was last looked for while it was
+//			down, to try only once a second.
+*/
+static char spoolName[4096] = "";
+static int spoolFd = -1;
+static off_t spoolRead;
+static off_t spoolWritten;
+static off_t spoolLimit;
+static unsigned long long spooledCount;
+static unsigned long long droppedCount;
+static time_t reconnectSecond;
+
+/*
+//  Sending from the spool needs its own batch, the spool is read while
+//  the normal batch is full.
+*/
+static char drainBuffer[SYSLOGBATCHSIZE + 17];
+static struct mmsghdr drainMessages[SYSLOGBATCH];
+static struct iovec drainVectors[SYSLOGBATCH];
+static size_t drainEnds[SYSLOGBATCH];
+
+static bool connectSocket(void) {
+  socketFd = socket(AF_UNIX, SOCK_DGRAM, 0);
+  if (socketFd < 0) {
+    return false;
+  }
+  fcntl(socketFd, F_SETFD, FD_CLOEXEC);
+  if (connect(socketFd, (struct sockaddr *)&socketPath, sizeof(socketPath)) < 0) {
+    int const saved = errno;
+    close(socketFd);
+    socketFd = -1;
+    errno = saved;
+    return false;
+  }
+  return true;
+}
+
+bool syslogClientOpen(char const *path, enum syslogFormat const format,
+                      char const *ident, pid_t const pid, char const *user) {
+  int length;
+
+  if (strlen(path) >= sizeof(socketPath.sun_path)) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  memset(&socketPath, 0, sizeof(socketPath));
+  socketPath.sun_family = AF_UNIX;
+  strcpy(socketPath.sun_path, path);
+  socketFormat = format;
+  if (SYSLOGFORMAT_RFC5424 == format) {
+    char host[256];
+    if (gethostname(host, sizeof(host)) < 0 || '\0' == host[0]) {
+      strcpy(host, "-");
+    }
+    host[sizeof(host) - 1] = '\0';
+    length = snprintf(tag, sizeof(tag), "%s %s %d - - %s%s", host, ident,
+                      (int)pid, user ? user : "", user ? ": " : "");
+  } else {
+    length = snprintf(tag, sizeof(tag), "%s[%05d]: %s%s", ident, (int)pid,
+                      user ? user : "", user ? ": " : "");
+  }
+  if (length < 0 || (size_t)length >= sizeof(tag)) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  tagLength = length;
+  stampSecond = -1;
+  batchUsed = 0;
+  batchCount = 0;
+  return connectSocket();
+}
+
+size_t syslogTimestamp(char *buffer, size_t const size, time_t const when) {
+  struct tm local;
+  char zone[8];
+  size_t length;
+
+  localtime_r(&when, &local);
+  /*
+  //  %z gives +0200, RFC 5424 wants +02:00
+  */
+  strftime(zone, sizeof(zone), "%z", &local);
+  length = strftime(buffer, size, "%Y-%m-%dT%H:%M:%S", &local);
+  length += snprintf(buffer + length, size - length, "%.3s:%.2s", zone, zone + 3);
+  return length;
+}
+
+/*
+//  Bring the priority and timestamp up to date. time() is cheap, the
+//  formatting is done at most once a second.
+*/
+static void makeStamp(int const priority) {
+  time_t const now = time(NULL);
+  struct tm local;
+
+  if (now == stampSecond && priority == stampPriority) {
+    return;
+  }
+  if (SYSLOGFORMAT_RFC5424 == socketFormat) {
+    stampLength = snprintf(stamp, sizeof(stamp), "<%d>1 ", priority);
+    stampLength += syslogTimestamp(stamp + stampLength, sizeof(stamp) - stampLength, now);
+    stamp[stampLength++] = ' ';
+  } else {
+    static char const * const months[] = {
+      "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+      "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+    };
+    /*
+    //  not strftime: the month must not be localized
+    */
+    localtime_r(&now, &local);
+    stampLength = snprintf(stamp, sizeof(stamp), "<%d>%s %2d %02d:%02d:%02d ",
+                           priority, months[local.tm_mon], local.tm_mday,
+                           local.tm_hour, local.tm_min, local.tm_sec);
+  }
+  stampSecond = now;
+  stampPriority = priority;
+}
+
+/*
+//  Give the queued messages from first on to syslog(3).
+*/
+static void fallback(unsigned int first) {
+  for (; first < batchCount; ++first) {
+    char const *message = vectors[first].iov_base;
+    int const priority = stampPriority;
+    syslog(priority, "%.*s", (int)(vectors[first].iov_len - headerLengths[first]),
+           message + headerLengths[first]);
+  }
+}
+
+/*
+//  The daemon went away, e.g. it was restarted and has a new socket.
+*/
+static bool daemonGone(int const error) {
+  return ECONNREFUSED == error || ENOTCONN == error || ENOENT == error;
+}
+
+/*
+//  Send count messages, with a spool without waiting. Returns how
+//  many went out, errno tells why the rest didn't.
+*/
+static unsigned int sendMessages(struct mmsghdr * const vector, unsigned int const count) {
+  int const flags = '\0' == spoolName[0] ? 0 : MSG_DONTWAIT;
+  unsigned int sent = 0;
+  bool reconnected = false;
+
+  while (sent < count && socketFd >= 0) {
+    int const result = sendmmsg(socketFd, vector + sent, count - sent, flags);
+    if (result > 0) {
+      sent += result;
+    } else if (result < 0 && EINTR == errno) {
+      continue;
+    } else if (!reconnected && daemonGone(errno)) {
+      close(socketFd);
+      reconnected = true;
+      if (!connectSocket()) {
+        reconnectSecond = time(NULL);
+        break;
+      }
+    } else {
+      break;
+    }
+  }
+  return sent;
+}
+
+/*
+//  Append the queued messages from first on to the spool. Returns
+//  false if there is no spool file and it can't be made.
+*/
+static bool spoolAppend(unsigned int first) {
+  if (spoolFd < 0) {
+    spoolFd = open(spoolName, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (spoolFd < 0) {
+      spoolName[0] = '\0';
+      return false;
+    }
+    fcntl(spoolFd, F_SETFD, FD_CLOEXEC);
+    spoolRead = spoolWritten = 0;
+  }
+  for (; first < batchCount; ++first) {
+    char length[16];
+    struct iovec frame[2];
+    ssize_t written;
+
+    frame[0].iov_base = length;
+    frame[0].iov_len = snprintf(length, sizeof(length), "%lu ",
+                                (unsigned long)vectors[first].iov_len);
+    frame[1] = vectors[first];
+    if (spoolWritten + (off_t)(frame[0].iov_len + frame[1].iov_len) > spoolLimit) {
+      ++droppedCount;
+      continue;
+    }
+    do {
+      written = pwritev(spoolFd, frame, 2, spoolWritten);
+    } while (written < 0 && EINTR == errno);
+    if (written != (ssize_t)(frame[0].iov_len + frame[1].iov_len)) {
+      /* a piece of a frame is overwritten by the next one */
+      ++droppedCount;
+      continue;
+    }
+    spoolWritten += written;
+    ++spooledCount;
+  }
+  return true;
+}
+
+/*
+//  Send from the spool as long as the daemon takes it. Returns true
+//  once the spool is empty.
+*/
+static bool spoolDrain(void) {
+  while (spoolRead < spoolWritten && socketFd >= 0) {
+    /* one byte is left for the NUL that ends the lengths for strtoul */
+    size_t const want = spoolWritten - spoolRead < (off_t)sizeof(drainBuffer) - 1
+      ? (size_t)(spoolWritten - spoolRead) : sizeof(drainBuffer) - 1;
+    size_t position = 0;
+    unsigned int count = 0, sent;
+    ssize_t n;
+
+    do {
+      n = pread(spoolFd, drainBuffer, want, spoolRead);
+    } while (n < 0 && EINTR == errno);
+    if (n <= 0) {
+      /* don't get stuck on a broken spool, the rest is lost */
+      spoolRead = spoolWritten;
+      break;
+    }
+    drainBuffer[n] = '\0';
+    while (count < SYSLOGBATCH && position < (size_t)n) {
+      char *end;
+      unsigned long const length = strtoul(drainBuffer + position, &end, 10);
+      if (' ' != *end || (size_t)(end + 1 - drainBuffer) + length > (size_t)n) {
+        break;
+      }
+      drainVectors[count].iov_base = end + 1;
+      drainVectors[count].iov_len = length;
+      memset(&drainMessages[count], 0, sizeof(drainMessages[count]));
+      drainMessages[count].msg_hdr.msg_iov = &drainVectors[count];
+      drainMessages[count].msg_hdr.msg_iovlen = 1;
+      position = end + 1 - drainBuffer + length;
+      drainEnds[count++] = position;
+    }
+    if (0 == count) {
+      spoolRead = spoolWritten;
+      break;
+    }
+    sent = sendMessages(drainMessages, count);
+    if (sent > 0) {
+      spoolRead += drainEnds[sent - 1];
+    }
+    if (sent < count) {
+      return false;
+    }
+  }
+  if (spoolRead < spoolWritten) {
+    return false;
+  }
+  if (spoolFd >= 0 && spoolWritten > 0 && ftruncate(spoolFd, 0) == 0) {
+    spoolRead = spoolWritten = 0;
+  }
+  return true;
+}
+
+void syslogClientFlush(void) {
+  unsigned int sent = 0;
+  bool const spooling = '\0' != spoolName[0];
+
+  if (spooling && socketFd < 0 && time(NULL) != reconnectSecond) {
+    reconnectSecond = time(NULL);
+    connectSocket();
+  }
+  /*
+  //  Older messages in the spool go first. If they can't, the new
+  //  ones are queued behind them.
+  */
+  if (spooling && spoolRead < spoolWritten && !spoolDrain()) {
+    sent = 0;
+  } else if (batchCount > 0) {
+    sent = sendMessages(messages, batchCount);
+  }
+  if (sent < batchCount && (!spooling || !spoolAppend(sent))) {
+    fallback(sent);
+  }
+  batchUsed = 0;
+  batchCount = 0;
+}
+
+bool syslogClientSpool(char const *path, off_t const limit) {
+  if (strlen(path) >= sizeof(spoolName)) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  strcpy(spoolName, path);
+  spoolLimit = limit;
+  return true;
+}
+
+void syslogClientSpoolCounts(unsigned long long * const spooled,
+                             unsigned long long * const dropped) {
+  *spooled = spooledCount;
+  *dropped = droppedCount;
+}
+
+void syslogClientAdd(int const priority, char const *prefix,
+                     char const *text, size_t const length) {
+  size_t const prefixLength = strlen(prefix);
+  size_t header, body = length;
+  char *message;
+
+  if (socketFd < 0 && '\0' == spoolName[0]) {
+    syslog(priority, "%s%.*s", prefix, (int)length, text);
+    return;
+  }
+  /*
+  //  All messages of a batch share one priority, see fallback.
+  */
+  if (priority != stampPriority && batchCount > 0) {
+    syslogClientFlush();
+  }
+  makeStamp(priority);
+  header = stampLength + tagLength;
+  if (header + prefixLength + body > SYSLOGBATCHSIZE) {
+    body = SYSLOGBATCHSIZE - header - prefixLength;
+  }
+  if (SYSLOGBATCH == batchCount
+      || batchUsed + header + prefixLength + body > SYSLOGBATCHSIZE) {
+    syslogClientFlush();
+  }
+  message = batch + batchUsed;
+  memcpy(message, stamp, stampLength);
+  memcpy(message + stampLength, tag, tagLength);
+  memcpy(message + header, prefix, prefixLength);
+  memcpy(message + header + prefixLength, text, body);
+  vectors[batchCount].iov_base = message;
+  vectors[batchCount].iov_len = header + prefixLength + body;
+  memset(&messages[batchCount], 0, sizeof(messages[batchCount]));
+  messages[batchCount].msg_hdr.msg_iov = &vectors[batchCount];
+  messages[batchCount].msg_hdr.msg_iovlen = 1;
+  headerLengths[batchCount] = header;
+  batchUsed += vectors[batchCount].iov_len;
+  ++batchCount;
+}
+
+void syslogClientClose(void) {
+  time_t const giveUp = time(NULL) + SPOOLCLOSETIMEOUT;
+
+  syslogClientFlush();
+  /*
+  //  Give the daemon a few seconds to take what is still spooled.
+  */
+  while (spoolRead < spoolWritten && time(NULL) < giveUp) {
+    if (socketFd >= 0) {
+      struct pollfd writable;
+      writable.fd = socketFd;
+      writable.events = POLLOUT;
+      poll(&writable, 1, 100);
+    } else {
+      poll(NULL, 0, 100);
+    }
+    syslogClientFlush();
+  }
+  if (spoolFd >= 0) {
+    /*
+    //  What the daemon never got stays in the file.
+    */
+    if (spoolRead == spoolWritten) {
+      unlink(spoolName);
+    }
+    close(spoolFd);
+    spoolFd = -1;
+  }
+  spoolName[0] = '\0';
+  if (socketFd >= 0) {
+    close(socketFd);
+    socketFd = -1;
+  }
+}
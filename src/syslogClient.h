@@ -0,0 +1,118 @@
+/*
+  Header for the syslog client that writes to /dev/log itself.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef SYSLOGCLIENT_H
+#define SYSLOGCLIENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+
+/**
+ * The socket of the local syslog daemon.
+ */
+#define SYSLOGCLIENTPATH "/dev/log"
+
+/**
+ * How the messages are sent.
+ */
+enum syslogFormat {
+  /** every message is a syslog(3) call */
+  SYSLOGFORMAT_LIBC,
+  /** "<PRI>Mmm dd hh:mm:ss tag: msg" like syslog(3) writes it */
+  SYSLOGFORMAT_RFC3164,
+  /** "<PRI>1 TIMESTAMP HOST APP PROCID - - msg" */
+  SYSLOGFORMAT_RFC5424,
+  /** fields on the native socket of journald, see journald.h */
+  SYSLOGFORMAT_JOURNAL
+};
+
+/**
+ * Connect to the syslog daemon. openlog must have been called with
+ * the same ident before, syslog(3) takes over whenever the socket
+ * fails.
+ *
+ * @param path the socket, normally SYSLOGCLIENTPATH
+ * @param format SYSLOGFORMAT_RFC3164 or SYSLOGFORMAT_RFC5424
+ * @param ident the program name
+ * @param pid written as the process id
+ * @param user put in front of each message, NULL for none
+ * @return false if the socket can't be used, errno is set
+ */
+bool syslogClientOpen(char const *path, enum syslogFormat const format,
+                      char const *ident, pid_t const pid, char const *user);
+
+/**
+ * Queue a message for the next syslogClientFlush. When the batch is
+ * full it is sent first. Without a connection the message goes to
+ * syslog(3) right away.
+ *
+ * @param priority facility and priority
+ * @param prefix written in front of the text, "" for none
+ * @param text the message, needs no \0
+ * @param length how long text is
+ */
+void syslogClientAdd(int const priority, char const *prefix,
+                     char const *text, size_t const length);
+
+/**
+ * Send the queued messages, as far as possible with one syscall.
+ * With a spool, what the daemon doesn't take right away is spooled.
+ */
+void syslogClientFlush(void);
+
+/**
+ * Never wait for the daemon or fall back to syslog(3), but keep what
+ * it doesn't take in a file and send it from there later. The file is
+ * created when it is needed first and removed when the client is
+ * closed with the file empty.
+ *
+ * @param path the spool file
+ * @param limit how large it may get, later messages are dropped
+ * @return false if the path is too long
+ */
+bool syslogClientSpool(char const *path, off_t const limit);
+
+/**
+ * @param spooled how many messages went through the spool
+ * @param dropped how many were lost because it was full
+ */
+void syslogClientSpoolCounts(unsigned long long * const spooled,
+                             unsigned long long * const dropped);
+
+/**
+ * Write an RFC 5424 timestamp in local time, 2026-10-17T07:36:00+02:00.
+ *
+ * @param buffer where to write it, 26 bytes are enough
+ * @param size how large buffer is
+ * @param when the time
+ * @return how long the timestamp is
+ */
+size_t syslogTimestamp(char *buffer, size_t const size, time_t const when);
+
+/**
+ * Send what is left, waiting a few seconds for the daemon to take the
+ * spool, and close the socket.
+ */
+void syslogClientClose(void);
+
+#endif
@@ -0,0 +1,574 @@
+/*
+  A syslog sink that streams RFC 5424 messages over TCP.
+
+  The lines go into a ring buffer as octet-counted frames (RFC 6587)
+  and a sender thread writes whatever has piled up with one writev.
+  Every message carries the session in its structured data and a
+  64 bit sequence number, so the receiver can tell when messages were
+  lost while the connection was down.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#if HAVE_PTHREAD_H && HAVE_PTHREAD_CREATE
+#  define USE_SYSLOGTCP 1
+#  include <pthread.h>
+#endif
+
+#include "syslogTcp.h"
+#include "syslogClient.h"
+
+#if USE_SYSLOGTCP
+
+/*
+//  Size of the ring, a power of two. While the remote host is down
+//  it holds about 5000 average lines.
+*/
+#define RINGSIZE (1024 * 1024)
+
+/*
+//  The longest frame, longer messages are cut.
+*/
+#define MAXFRAME 65536
+
+/*
+//  Seconds to wait after a failed connect, doubled up to the maximum.
+*/
+#define MINBACKOFF 1
+#define MAXBACKOFF 60
+
+/*
+//  Seconds a connect or a write may take, and how long syslogTcpClose
+//  keeps trying to get the rest out.
+*/
+#define IOTIMEOUT 10
+#define CLOSETIMEOUT 5
+
+/*
+//  host, port		The endpoint, resolved again for each connect.
+//
+//  header		What follows the timestamp up to the sequence
+//			number: " host rootsh 01234 - [rootsh@32473
+//			session=... seq=\"". Made once.
+//
+//  ring		The frames not sent yet.
+//
+//  head		Bytes sent so far.
+//
+//  frameHead		Where the first frame which is not sent
+//			completely starts. After a reconnect it is sent
+//			again from its start, the receiver never gets a
+//			piece of a frame.
+//
+//  tail		Bytes queued so far. The positions only grow,
+//			the ring offset is position & (RINGSIZE - 1).
+//			head and frameHead are written by the sender,
+//			tail by the producer, all under lock.
+//
+//  sequence		The number of the next message.
+//
+//  dropped		Messages that did not fit since the last one that
+//			did.
+*/
+static char host[256];
+static char port[32];
+static char header[1024];
+static size_t headerLength;
+static char *ring = NULL;
+static size_t head, frameHead, tail;
+static uint64_t sequence;
+static uint64_t dropped;
+static bool stopping;
+static bool running = false;
+static bool started;
+static int remote = -1;
+static pthread_t sender;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeSender = PTHREAD_COND_INITIALIZER;
+
+/*
+//  Split host:port, [v6address]:port.
+*/
+static bool parseEndpoint(char const *endpoint) {
+  char const *colon = strrchr(endpoint, ':');
+  char const *start = endpoint;
+  size_t length;
+
+  if (NULL == colon || '\0' == colon[1] || strlen(colon + 1) >= sizeof(port)) {
+    return false;
+  }
+  length = colon - endpoint;
+  if ('[' == *endpoint) {
+    if (length < 2 || ']' != endpoint[length - 1]) {
+      return false;
+    }
+    ++start;
+    length -= 2;
+  }
+  if (0 == length || length >= sizeof(host)) {
+    return false;
+  }
+  memcpy(host, start, length);
+  host[length] = '\0';
+  strcpy(port, colon + 1);
+  return true;
+}
+
+/*
+//  Append text to the header, false if it doesn't fit.
+*/
+static bool appendHeader(char const *text) {
+  size_t const length = strlen(text);
+
+  if (length >= sizeof(header) - headerLength) {
+    return false;
+  }
+  memcpy(header + headerLength, text, length + 1);
+  headerLength += length;
+  return true;
+}
+
+/*
+//  Append an SD-PARAM value to the header, " \ and ] need a
+//  backslash. False if it doesn't fit.
+*/
+static bool escapeParam(char const *value) {
+  for (; *value; ++value) {
+    if (headerLength + 3 > sizeof(header)) {
+      return false;
+    }
+    if ('"' == *value || '\\' == *value || ']' == *value) {
+      header[headerLength++] = '\\';
+    }
+    header[headerLength++] = *value;
+  }
+  header[headerLength] = '\0';
+  return true;
+}
+
+static bool connectTimed(int const fd, struct sockaddr const *address,
+                         socklen_t const length) {
+  int const flags = fcntl(fd, F_GETFL);
+  struct pollfd pending;
+  int error = 0;
+  socklen_t errorLength = sizeof(error);
+
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  if (connect(fd, address, length) < 0) {
+    if (EINPROGRESS != errno) {
+      return false;
+    }
+    pending.fd = fd;
+    pending.events = POLLOUT;
+    if (poll(&pending, 1, IOTIMEOUT * 1000) <= 0
+        || getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) < 0
+        || 0 != error) {
+      return false;
+    }
+  }
+  fcntl(fd, F_SETFL, flags);
+  return true;
+}
+
+static bool connectRemote(void) {
+  struct addrinfo hints, *addresses, *address;
+  struct timeval timeout;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (0 != getaddrinfo(host, port, &hints, &addresses)) {
+    return false;
+  }
+  for (address = addresses; address != NULL; address = address->ai_next) {
+    remote = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (remote < 0) {
+      continue;
+    }
+    fcntl(remote, F_SETFD, FD_CLOEXEC);
+    if (connectTimed(remote, address->ai_addr, address->ai_addrlen)) {
+      break;
+    }
+    close(remote);
+    remote = -1;
+  }
+  freeaddrinfo(addresses);
+  if (remote < 0) {
+    return false;
+  }
+  /*
+  //  A receiver that stops reading must not keep us forever.
+  */
+  timeout.tv_sec = IOTIMEOUT;
+  timeout.tv_usec = 0;
+  setsockopt(remote, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  return true;
+}
+
+/*
+//  The receiver never sends anything. If the socket is readable the
+//  connection was closed, and a write would still succeed once and
+//  lose its data.
+*/
+static bool remoteClosed(void) {
+  struct pollfd readable;
+  char byte;
+
+  readable.fd = remote;
+  readable.events = POLLIN;
+  return poll(&readable, 1, 0) > 0
+    && recv(remote, &byte, 1, MSG_PEEK | MSG_DONTWAIT) <= 0;
+}
+
+/*
+//  Move frameHead over the frames which are sent completely. Each
+//  frame starts with its length in decimal and a space.
+*/
+static void skipSentFrames(void) {
+  while (frameHead < head) {
+    size_t length = 0, digits = 0;
+    char c;
+    while ((c = ring[(frameHead + digits) & (RINGSIZE - 1)]) != ' ') {
+      length = length * 10 + (c - '0');
+      ++digits;
+    }
+    if (frameHead + digits + 1 + length > head) {
+      break;
+    }
+    frameHead += digits + 1 + length;
+  }
+}
+
+/*
+//  Sleep until woken or the seconds passed. Called with lock held.
+*/
+static void waitSeconds(int const seconds) {
+  struct timespec deadline;
+
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += seconds;
+  pthread_cond_timedwait(&wakeSender, &lock, &deadline);
+}
+
+static void *senderMain(void *unused) {
+  int backoff = MINBACKOFF;
+  time_t giveUp = 0;
+
+  (void)unused;
+  pthread_mutex_lock(&lock);
+  for (;;) {
+    struct iovec pending[2];
+    size_t offset, length;
+    ssize_t written;
+    int vectors = 1;
+
+    while (head == tail && !stopping) {
+      pthread_cond_wait(&wakeSender, &lock);
+    }
+    if (head == tail) {
+      break;
+    }
+    if (stopping && 0 == giveUp) {
+      giveUp = time(NULL) + CLOSETIMEOUT;
+    }
+    if (remote < 0 || remoteClosed()) {
+      if (remote >= 0) {
+        close(remote);
+        remote = -1;
+        head = frameHead;
+      }
+      pthread_mutex_unlock(&lock);
+      if (connectRemote()) {
+        backoff = MINBACKOFF;
+        pthread_mutex_lock(&lock);
+        continue;
+      }
+      pthread_mutex_lock(&lock);
+      if (stopping && time(NULL) >= giveUp) {
+        break;
+      }
+      waitSeconds(stopping ? 1 : backoff);
+      if (backoff < MAXBACKOFF) {
+        backoff *= 2;
+      }
+      continue;
+    }
+    /*
+    //  Everything queued, in two pieces if it wraps around.
+    */
+    offset = head & (RINGSIZE - 1);
+    length = tail - head;
+    pending[0].iov_base = ring + offset;
+    pending[0].iov_len = length;
+    if (offset + length > RINGSIZE) {
+      pending[0].iov_len = RINGSIZE - offset;
+      pending[1].iov_base = ring;
+      pending[1].iov_len = length - pending[0].iov_len;
+      vectors = 2;
+    }
+    pthread_mutex_unlock(&lock);
+    written = writev(remote, pending, vectors);
+    pthread_mutex_lock(&lock);
+    if (written > 0) {
+      head += written;
+      skipSentFrames();
+    } else if (written < 0 && EINTR != errno) {
+      close(remote);
+      remote = -1;
+      head = frameHead;
+    }
+    if (stopping && time(NULL) >= giveUp) {
+      break;
+    }
+  }
+  pthread_mutex_unlock(&lock);
+  if (remote >= 0) {
+    close(remote);
+    remote = -1;
+  }
+  return NULL;
+}
+
+bool syslogTcpOpen(char const *endpoint, char const *ident, pid_t const pid,
+                   char const *session, char const *user, char const *tty) {
+  char hostName[256];
+  int length;
+
+  if (!parseEndpoint(endpoint)) {
+    errno = EINVAL;
+    return false;
+  }
+  if (gethostname(hostName, sizeof(hostName)) < 0 || '\0' == hostName[0]) {
+    strcpy(hostName, "-");
+  }
+  hostName[sizeof(hostName) - 1] = '\0';
+  /*
+  //  RFC 5424 allows 255 characters of HOSTNAME and 48 of APP-NAME.
+  */
+  length = snprintf(header, sizeof(header), " %.255s %.48s %d - [" SYSLOGTCPSDID
+                    " session=\"", hostName, ident, (int)pid);
+  if (length < 0 || (size_t)length >= sizeof(header)) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  headerLength = length;
+  if (!escapeParam(session) || !appendHeader("\" user=\"")
+      || !escapeParam(user) || !appendHeader("\" tty=\"")
+      || !escapeParam(tty) || !appendHeader("\" seq=\"")) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  if (NULL == (ring = malloc(RINGSIZE))) {
+    return false;
+  }
+  head = frameHead = tail = 0;
+  sequence = 0;
+  dropped = 0;
+  stopping = false;
+  started = false;
+  running = true;
+  return true;
+}
+
+void syslogTcpStart(void) {
+  sigset_t allSignals, oldMask;
+  int error;
+
+  if (!running || started) {
+    return;
+  }
+  started = true;
+  /*
+  //  Signals are for the relay, the sender never gets one.
+  */
+  sigfillset(&allSignals);
+  pthread_sigmask(SIG_SETMASK, &allSignals, &oldMask);
+  error = pthread_create(&sender, NULL, senderMain, NULL);
+  pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+  if (0 != error) {
+    errno = error;
+    perror("Error starting the remote syslog sender");
+    running = false;
+    free(ring);
+    ring = NULL;
+  }
+}
+
+bool syslogTcpActive(void) {
+  return running;
+}
+
+/*
+//  Build the frame and copy it into the ring, or count it as dropped.
+*/
+static void addFrame(int const priority, char const *fragment,
+                     char const *text, size_t length) {
+  static char frame[MAXFRAME];
+  static time_t stampSecond = -1;
+  static char stamp[32];
+  static size_t stampLength;
+  char prefix[64];
+  size_t prefixLength, messageLength, frameLength, room, offset;
+  time_t const now = time(NULL);
+
+  if (now != stampSecond) {
+    stampLength = syslogTimestamp(stamp, sizeof(stamp), now);
+    stampSecond = now;
+  }
+  if ('\0' != fragment[0]) {
+    prefixLength = snprintf(prefix, sizeof(prefix), "%llu\" frag=\"%.24s\"] ",
+                            (unsigned long long)sequence++, fragment);
+  } else {
+    prefixLength = snprintf(prefix, sizeof(prefix), "%llu\"] ",
+                            (unsigned long long)sequence++);
+  }
+  messageLength = snprintf(frame + 16, 16, "<%d>1 ", priority);
+  memcpy(frame + 16 + messageLength, stamp, stampLength);
+  messageLength += stampLength;
+  memcpy(frame + 16 + messageLength, header, headerLength);
+  messageLength += headerLength;
+  memcpy(frame + 16 + messageLength, prefix, prefixLength);
+  messageLength += prefixLength;
+  if (length > MAXFRAME - 16 - messageLength) {
+    length = MAXFRAME - 16 - messageLength;
+  }
+  memcpy(frame + 16 + messageLength, text, length);
+  messageLength += length;
+  /*
+  //  The length goes right in front of the message.
+  */
+  prefixLength = snprintf(prefix, sizeof(prefix), "%lu ", (unsigned long)messageLength);
+  frameLength = prefixLength + messageLength;
+  memcpy(frame + 16 - prefixLength, prefix, prefixLength);
+
+  pthread_mutex_lock(&lock);
+  room = RINGSIZE - (tail - frameHead);
+  pthread_mutex_unlock(&lock);
+  if (frameLength > room) {
+    ++dropped;
+    return;
+  }
+  /*
+  //  Only the sender reads the ring and never beyond tail, the copy
+  //  needs no lock.
+  */
+  offset = tail & (RINGSIZE - 1);
+  if (offset + frameLength > RINGSIZE) {
+    memcpy(ring + offset, frame + 16 - prefixLength, RINGSIZE - offset);
+    memcpy(ring, frame + 16 - prefixLength + (RINGSIZE - offset),
+           frameLength - (RINGSIZE - offset));
+  } else {
+    memcpy(ring + offset, frame + 16 - prefixLength, frameLength);
+  }
+  pthread_mutex_lock(&lock);
+  tail += frameLength;
+  pthread_mutex_unlock(&lock);
+}
+
+void syslogTcpAdd(int const priority, char const *fragment,
+                  char const *text, size_t const length) {
+  if (!running) {
+    return;
+  }
+  if (dropped > 0) {
+    char note[96];
+    uint64_t const lost = dropped;
+    int const noteLength = snprintf(note, sizeof(note),
+                                    "%llu messages dropped, the remote host was unreachable",
+                                    (unsigned long long)lost);
+    dropped = 0;
+    addFrame(LOG_SYSLOG | LOG_WARNING, "", note, noteLength);
+    /*
+    //  Still no room: next time the note tells about these and itself.
+    */
+    if (dropped > 0) {
+      dropped += lost;
+    }
+  }
+  addFrame(priority, fragment, text, length);
+}
+
+void syslogTcpFlush(void) {
+  if (!running) {
+    return;
+  }
+  pthread_mutex_lock(&lock);
+  pthread_cond_signal(&wakeSender);
+  pthread_mutex_unlock(&lock);
+}
+
+void syslogTcpClose(void) {
+  if (!running) {
+    return;
+  }
+  syslogTcpStart();
+  if (!running) {
+    return;
+  }
+  pthread_mutex_lock(&lock);
+  stopping = true;
+  pthread_cond_signal(&wakeSender);
+  pthread_mutex_unlock(&lock);
+  pthread_join(sender, NULL);
+  free(ring);
+  ring = NULL;
+  running = false;
+}
+
+#else
+
+bool syslogTcpOpen(char const *endpoint, char const *ident, pid_t const pid,
+                   char const *session, char const *user, char const *tty) {
+  errno = ENOSYS;
+  return false;
+}
+
+bool syslogTcpActive(void) {
+  return false;
+}
+
+void syslogTcpAdd(int const priority, char const *fragment,
+                  char const *text, size_t const length) {
+}
+
+void syslogTcpStart(void) {
+}
+
+void syslogTcpFlush(void) {
+}
+
+void syslogTcpClose(void) {
+}
+
+#endif
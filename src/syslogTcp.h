@@ -0,0 +1,92 @@
+/*
+  Header for the syslog sink that streams to a remote host over TCP.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef SYSLOGTCP_H
+#define SYSLOGTCP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * The SD-ID of the structured data in each message. 32473 is the
+ * enterprise number RFC 5612 sets aside for examples.
+ */
+#define SYSLOGTCPSDID "rootsh@32473"
+
+/**
+ * Prepare a thread which connects to host:port (or [address]:port)
+ * and sends the messages as octet-counted RFC 5424 frames (RFC 6587).
+ * The thread is started separately, so the process can still fork
+ * safely after the first messages are queued.
+ * When the connection breaks it is made again, waiting longer after
+ * each failed attempt. Messages that don't fit into the buffer in
+ * the meantime are dropped, their sequence numbers are missing at
+ * the receiver.
+ *
+ * @param endpoint host:port
+ * @param ident the program name, APP-NAME, cut to 48 characters
+ * @param pid PROCID
+ * @param session session id, user and tty go into the structured data
+ * @param user
+ * @param tty
+ * @return false if the endpoint is malformed, EINVAL, or the session
+ *         data doesn't fit into the header, ENAMETOOLONG
+ */
+bool syslogTcpOpen(char const *endpoint, char const *ident, pid_t const pid,
+                   char const *session, char const *user, char const *tty);
+
+/**
+ * Start the thread. Until then the messages are only queued.
+ */
+void syslogTcpStart(void);
+
+/**
+ * @return true between syslogTcpOpen and syslogTcpClose
+ */
+bool syslogTcpActive(void);
+
+/**
+ * Queue a message with the next sequence number. Only one thread may
+ * add messages.
+ *
+ * @param priority facility and priority
+ * @param fragment which piece of a split line this is, like "2+", goes
+ *        into the structured data as frag, "" for a whole line
+ * @param text the message, needs no \0
+ * @param length how long text is
+ */
+void syslogTcpAdd(int const priority, char const *fragment,
+                  char const *text, size_t const length);
+
+/**
+ * Let the thread send what was queued, all of it with one write if
+ * the connection takes it.
+ */
+void syslogTcpFlush(void);
+
+/**
+ * Send what is left (starting the thread if needed), giving up after a few seconds if the remote
+ * host can't be reached, and stop the thread.
+ */
+void syslogTcpClose(void);
+
+#endif
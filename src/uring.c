@@ -0,0 +1,182 @@
+/*
+  Minimal io_uring interface used by the session relay.
+
+  Only what the relay needs: ring setup, registered buffers,
+  read/write submission and completion reaping. It talks to the
+  kernel directly, so no liburing is needed.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+static int sysSetup(unsigned int const entries, struct io_uring_params * const params) {
+  return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sysEnter(int const fd, unsigned int const toSubmit,
+                    unsigned int const minComplete, unsigned int const flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags,
+                      NULL, 0);
+}
+
+static int sysRegister(int const fd, unsigned int const opcode,
+                       void const * const arg, unsigned int const nrArgs) {
+  return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs);
+}
+
+bool uringOpen(struct uring * const ring, unsigned int const entries) {
+  struct io_uring_params params;
+  char *sq, *cq;
+
+  memset(ring, 0, sizeof(*ring));
+  memset(&params, 0, sizeof(params));
+  if((ring->fd = sysSetup(entries, &params)) < 0) {
+    return false;
+  }
+  ring->features = params.features;
+
+  ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if(params.features & IORING_FEAT_SINGLE_MMAP) {
+    if(ring->cqRingSize > ring->sqRingSize) {
+      ring->sqRingSize = ring->cqRingSize;
+    }
+    ring->cqRingSize = ring->sqRingSize;
+  }
+
+  ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ|PROT_WRITE,
+                      MAP_SHARED|MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if(MAP_FAILED == ring->sqRing) {
+    close(ring->fd);
+    return false;
+  }
+  if(params.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cqRing = ring->sqRing;
+  } else {
+    ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ|PROT_WRITE,
+                        MAP_SHARED|MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if(MAP_FAILED == ring->cqRing) {
+      munmap(ring->sqRing, ring->sqRingSize);
+      close(ring->fd);
+      return false;
+    }
+  }
+
+  ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ|PROT_WRITE,
+                    MAP_SHARED|MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if(MAP_FAILED == ring->sqes) {
+    if(ring->cqRing != ring->sqRing) {
+      munmap(ring->cqRing, ring->cqRingSize);
+    }
+    munmap(ring->sqRing, ring->sqRingSize);
+    close(ring->fd);
+    return false;
+  }
+
+  sq = ring->sqRing;
+  ring->sqHead = (unsigned int *)(sq + params.sq_off.head);
+  ring->sqTail = (unsigned int *)(sq + params.sq_off.tail);
+  ring->sqMask = (unsigned int *)(sq + params.sq_off.ring_mask);
+  ring->sqArray = (unsigned int *)(sq + params.sq_off.array);
+  ring->sqEntries = params.sq_entries;
+  ring->sqLocalTail = *ring->sqTail;
+
+  cq = ring->cqRing;
+  ring->cqHead = (unsigned int *)(cq + params.cq_off.head);
+  ring->cqTail = (unsigned int *)(cq + params.cq_off.tail);
+  ring->cqMask = (unsigned int *)(cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+  return true;
+}
+
+bool uringRegisterBuffers(struct uring * const ring,
+                          struct iovec const * const buffers,
+                          unsigned int const count) {
+  return sysRegister(ring->fd, IORING_REGISTER_BUFFERS, buffers, count) == 0;
+}
+
+struct io_uring_sqe * uringGetSqe(struct uring * const ring) {
+  unsigned int const head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+  struct io_uring_sqe *sqe;
+
+  if(ring->sqLocalTail - head >= ring->sqEntries) {
+    return NULL;
+  }
+  sqe = &ring->sqes[ring->sqLocalTail & *ring->sqMask];
+  ring->sqArray[ring->sqLocalTail & *ring->sqMask] = ring->sqLocalTail & *ring->sqMask;
+  ++ring->sqLocalTail;
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+void uringPrepRw(struct io_uring_sqe * const sqe, int const op, int const fd,
+                 void const * const addr, unsigned int const len,
+                 int64_t const offset, uint16_t const bufIndex,
+                 uint64_t const userData) {
+  sqe->opcode = (uint8_t)op;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)addr;
+  sqe->len = len;
+  sqe->off = (uint64_t)offset;
+  sqe->buf_index = bufIndex;
+  sqe->user_data = userData;
+}
+
+int uringSubmitAndWait(struct uring * const ring, unsigned int const waitFor) {
+  unsigned int const toSubmit = ring->sqLocalTail - *ring->sqTail;
+  int n;
+
+  /*
+  //  Publish the new tail only after the entries are written.
+  */
+  __atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+  do {
+    n = sysEnter(ring->fd, toSubmit, waitFor,
+                 waitFor > 0 ? IORING_ENTER_GETEVENTS : 0);
+  } while(n < 0 && EINTR == errno);
+  return n;
+}
+
+bool uringNextCqe(struct uring * const ring, struct io_uring_cqe * const cqe) {
+  unsigned int const head = *ring->cqHead;
+
+  if(head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+  *cqe = ring->cqes[head & *ring->cqMask];
+  __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+void uringClose(struct uring * const ring) {
+  munmap(ring->sqes, ring->sqesSize);
+  if(ring->cqRing != ring->sqRing) {
+    munmap(ring->cqRing, ring->cqRingSize);
+  }
+  munmap(ring->sqRing, ring->sqRingSize);
+  close(ring->fd);
+}
@@ -0,0 +1,112 @@
+/*
+  Header for the minimal io_uring interface used by the session relay.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef URING_H
+#define URING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+/*
+//  The rings shared with the kernel. Only the fields the relay needs
+//  are kept, see io_uring_setup(2) for the layout.
+*/
+struct uring {
+  int fd;
+  unsigned int features;
+
+  unsigned int *sqHead;
+  unsigned int *sqTail;
+  unsigned int *sqMask;
+  unsigned int *sqArray;
+  unsigned int sqEntries;
+  /* tail of the sqes prepared but not yet handed to the kernel */
+  unsigned int sqLocalTail;
+  struct io_uring_sqe *sqes;
+
+  unsigned int *cqHead;
+  unsigned int *cqTail;
+  unsigned int *cqMask;
+  struct io_uring_cqe *cqes;
+
+  void *sqRing;
+  size_t sqRingSize;
+  void *cqRing;
+  size_t cqRingSize;
+  size_t sqesSize;
+};
+
+/**
+ * Create a ring.
+ *
+ * @param ring the ring to setup
+ * @param entries number of submission queue entries
+ * @return false if io_uring is not available, errno is set
+ */
+bool uringOpen(struct uring * const ring, unsigned int const entries);
+
+/**
+ * Register buffers for use with the fixed read/write operations.
+ *
+ * @return false on error, errno is set
+ */
+bool uringRegisterBuffers(struct uring * const ring,
+                          struct iovec const * const buffers,
+                          unsigned int const count);
+
+/**
+ * @return a cleared submission queue entry or NULL if the queue is full
+ */
+struct io_uring_sqe * uringGetSqe(struct uring * const ring);
+
+/**
+ * Prepare a read or write. Fixed operations refer to the registered
+ * buffer bufIndex, offset -1 uses (and advances) the file position.
+ */
+void uringPrepRw(struct io_uring_sqe * const sqe, int const op, int const fd,
+                 void const * const addr, unsigned int const len,
+                 int64_t const offset, uint16_t const bufIndex,
+                 uint64_t const userData);
+
+/**
+ * Hand all prepared entries to the kernel and wait until at least
+ * waitFor completions are available.
+ *
+ * @return number of entries submitted, -1 on error with errno set
+ */
+int uringSubmitAndWait(struct uring * const ring, unsigned int const waitFor);
+
+/**
+ * Take the next completion off the queue.
+ *
+ * @param cqe output parameter
+ * @return false if there is no completion
+ */
+bool uringNextCqe(struct uring * const ring, struct io_uring_cqe * const cqe);
+
+/**
+ * Tear down the ring.
+ */
+void uringClose(struct uring * const ring);
+
+#endif
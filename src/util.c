@@ -0,0 +1,75 @@
+/*
+  Small helpers several rootsh programs share: the byte order of the
+  frame and compression indexes, the clock for pacing and a sendmmsg
+  replacement.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+/* struct mmsghdr is a GNU extension */
+#define _GNU_SOURCE 1
+
+#include "config.h"
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "util.h"
+
+void utilPut64(unsigned char * const buffer, unsigned long long const value) {
+  int i;
+
+  for (i = 0; i < 8; ++i) {
+    buffer[i] = (unsigned char)(value >> (8 * i));
+  }
+}
+
+unsigned long long utilGet64(unsigned char const * const buffer) {
+  unsigned long long value = 0;
+  int i;
+
+  for (i = 0; i < 8; ++i) {
+    value |= (unsigned long long)buffer[i] << (8 * i);
+  }
+  return value;
+}
+
+unsigned long long utilMonotonicNow(void) {
+  struct timespec now;
+
+#ifdef CLOCK_MONOTONIC
+  clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+  clock_gettime(CLOCK_REALTIME, &now);
+#endif
+  return (unsigned long long)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+#if !HAVE_SENDMMSG
+int sendmmsg(int fd, struct mmsghdr *vector, unsigned int count, int flags) {
+  unsigned int i;
+  for (i = 0; i < count; ++i) {
+    ssize_t const sent = sendmsg(fd, &vector[i].msg_hdr, flags);
+    if (sent < 0) {
+      return i > 0 ? (int)i : -1;
+    }
+    vector[i].msg_len = sent;
+  }
+  return count;
+}
+#endif
@@ -0,0 +1,54 @@
+/*
+  Header for the small helpers several rootsh programs share.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef UTIL_H
+#define UTIL_H
+
+/**
+ * Store value little endian in the 8 bytes at buffer.
+ */
+void utilPut64(unsigned char * const buffer, unsigned long long const value);
+
+/**
+ * @return the little endian value in the 8 bytes at buffer
+ */
+unsigned long long utilGet64(unsigned char const * const buffer);
+
+/**
+ * @return microseconds of the monotonic clock, of the wall clock where
+ * there is no monotonic one
+ */
+unsigned long long utilMonotonicNow(void);
+
+#if !HAVE_SENDMMSG
+struct mmsghdr;
+
+/**
+ * sendmmsg for systems without it, one sendmsg per message. Needs
+ * config.h and, for struct mmsghdr, sys/socket.h with _GNU_SOURCE.
+ *
+ * @return how many messages were sent, -1 with errno set if the
+ * first one failed
+ */
+int sendmmsg(int fd, struct mmsghdr *vector, unsigned int count, int flags);
+#endif
+
+#endif /* UTIL_H */
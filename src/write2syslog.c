@@ -26,350 +26,355 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #ifdef S_SPLINT_S
 #  include <err.h>
 #endif
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <syslog.h>
 #include <errno.h>
+#include <time.h>
 #include "config.h"
 
 #include "write2syslog.h"
+#include "escFilter.h"
+#include "syslogClient.h"
+#include "syslogTcp.h"
+#include "journald.h"
+#include "sha256.h"
 
-char *stripesc(char *escBuffer);
+/*
+//  The line which is not closed by a \r yet. Only one line is ever
+//  pending: a complete line is handed on right away. So the
+//  pending line always starts at the front of the buffer and the rest
+//  of an input chunk never has to be moved there.
+//  It is kept with the escape sequences already removed. The extra
+//  room is for a C2 the filter held back.
+//  Once lineLimit bytes are pending they are sent as a piece of the
+//  line as soon as more of it arrives. A line which ends right there
+//  isn't split for nothing.
+*/
+static char line[WRITE2SYSLOGMAXLINE + 1];
+static size_t lineLength = 0;
+static size_t lineLimit = WRITE2SYSLOGLINE;
+static struct escFilter filter;
+static enum escCharset lineCharset = ESCCHARSET_8BIT;
 
-#define OBUFSIZ 1024
+/*
+//  The number of the next piece of the pending line, 0 while it
+//  wasn't split.
+*/
+static unsigned long fragment = 0;
 
-#define BEL 0x07
-#define BS 0x08
-#define TAB 0x09
-#define LF 0x0A
-#define VT 0x0B
-#define FF 0x0C
-#define CR 0x0D
-#define SO 0x0E
-#define SI 0x0F
-#define CAN 0x18
-#define SUB 0x1A
-#define ESC 0x1B
-#define DEL 0x7F
+/*
+//  The number of the next line, it prepends each line sent to the
+//  syslog server. It never wraps within a session, so rootsh-gaps can
+//  tell how many lines were dropped and where.
+*/
+static unsigned long long sequence = 0;
 
-#define SS2 0x8E
-#define SS3 0x8F
-#define DCS 0x90
-#define CSI 0x9B
-#define ST 0x9C
-#define OSC 0x9D
-#define PM 0x9E
-#define APC 0x9F
+/*
+//  The rate limit, a token bucket: each line takes a token, rate
+//  tokens come back every second up to burst. 0 for no limit.
+//  Lines without a token are not sent but counted and hashed, a
+//  summary tells about them when lines are sent again or after
+//  RATESUMMARY seconds.
+*/
+#define RATESUMMARY 10
+static unsigned long rate = 0;
+static unsigned long burst = 0;
+static double tokens;
+static long long refilled;
+static unsigned long long suppressedLines = 0;
+static unsigned long long suppressedBytes = 0;
+static long long suppressedSince;
+static struct sha256 suppressedHash;
 
+/*
+//  Set after a \r and at the start: a \n here belongs to the \r or
+//  would start an empty line, both are skipped.
+*/
+static bool lineStart = true;
 
-enum {
-  Normal, Esc, Csi, Dcs, DcsString, Osc, OscString, DropOne, DecSet
-} vtstate = Normal;
+/*
+//  In UTF-8 a piece must not end in the middle of a character: find
+//  where an incomplete one at the end starts. The filter only passes
+//  valid characters, so a lead byte tells how many bytes belong to it.
+*/
+static size_t completeLength(void) {
+  size_t start = lineLength;
+  size_t needed;
 
+  if (ESCCHARSET_UTF8 != lineCharset) {
+    return lineLength;
+  }
+  while (start > 0 && lineLength - start < 3
+         && 0x80 == ((unsigned char)line[start - 1] & 0xC0)) {
+    --start;
+  }
+  if (0 == start) {
+    return lineLength;
+  }
+  --start;
+  if (0xC0 == ((unsigned char)line[start] & 0xE0)) {
+    needed = 2;
+  } else if (0xE0 == ((unsigned char)line[start] & 0xF0)) {
+    needed = 3;
+  } else if (0xF0 == ((unsigned char)line[start] & 0xF8)) {
+    needed = 4;
+  } else {
+    return lineLength;
+  }
+  return lineLength - start < needed ? start : lineLength;
+}
 
+static long long nowMs(void) {
+  struct timespec now;
+#ifdef CLOCK_MONOTONIC
+  clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+  clock_gettime(CLOCK_REALTIME, &now);
+#endif
+  return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
 
-/* 
-//  remove escape sequences from a string
-//  algorithm mostly copied from 
-//  news:<3g5hjg$re2@newhub.xylogics.com> by james carlson
+/*
+//  Take a token if there is one.
 */
+static bool takeToken(long long const now) {
+  if (0 == rate) {
+    return true;
+  }
+  tokens += (double)rate * (now - refilled) / 1000;
+  if (tokens > burst) {
+    tokens = burst;
+  }
+  refilled = now;
+  if (tokens < 1) {
+    return false;
+  }
+  tokens -= 1;
+  return true;
+}
 
-char *stripesc(char *escBuffer) {
-  int buflen = strlen(escBuffer);
-  char *escBufferPtr = escBuffer;
-  char *cleanBuffer = (char *)malloc(buflen + 1);
-  char *cleanBufferPtr = cleanBuffer;
-  int chr;
-
-  while ((chr = *escBufferPtr++) && (buflen-- > 0)) {
-    chr &= 0xFF;
-    if (vtstate == DropOne) {
-      vtstate = Normal;
-      continue;
-    }
-    /* 
-    //  Handle normal ANSI escape mechanism
-    //  (Note that this terminates DCS strings!) 
-    */
-    if (vtstate == Esc && chr >= 0x40 && chr <= 0x5F) {
-     vtstate = Normal;
-     chr += 0x40;
-    }
-    switch (chr) {
-      case CAN: case SUB:
-        vtstate = Normal;
-        break;
-      case ESC:
-        vtstate = Esc;
-        break;
-      case CSI:
-        vtstate = Csi;
-        break;
-      case DCS: case PM: case APC:
-        vtstate = Dcs;  
-        break;
-      case OSC:
-        vtstate = Osc;  
-        break;
-      default:
-        if ((chr & 0x6F) < 0x20) { /* Check controls */
-          switch (chr) {
-            case BEL:
-	      if (vtstate == OscString)
-		vtstate = Normal;
-	      else
-		*cleanBufferPtr++ = chr;
-              break;
-            case BS: case TAB: case LF: case VT: case FF: case CR:
-              *cleanBufferPtr++ = chr;
-              break;
-          }
-          break;
-        }
-        switch (vtstate) {
-          case Normal:
-            *cleanBufferPtr++ = chr;
-            break;
-          case Esc:
-            vtstate = Normal;
-            switch (chr) {
-              case 'c': case '7': case '8': case '=': case '>': case '~':
-              case 'n': case '\123': case 'o':
-              case '|':
-                break;
-              case '#': case ' ': case '(': case ')': case '*': case '+':
-                vtstate = DropOne;
-                break;
-            }
-            break;
-          case Csi: case Dcs:
-            if (chr >= 0x40 && chr <= 0x7E) {
-              if (vtstate == Csi) {
-                vtstate = Normal;
-              } else {
-                vtstate = DcsString;
-              }
-            }
-            break;
-	  case Osc:
-            if (chr >= 0x40 && chr <= 0x7E)
-	      vtstate = OscString;
-	    break;
-          case DecSet:
-            if (chr == 0x68) {
-              vtstate = Normal;
-            }
-            break;
-          case DcsString:
-            break;
-	  case OscString:
-	    break;
-          case DropOne:
-            break;
-        }
-    }
+/*
+//  A message without number to all sinks.
+*/
+static void addMessage(int const priority, char const *text, size_t const length) {
+  if (journaldActive()) {
+    journaldAdd(priority, -1, "", text, length);
+  } else {
+    syslogClientAdd(priority, "", text, length);
   }
-  *cleanBufferPtr = '\0';
-  strncpy(escBuffer, cleanBuffer, buflen);
-  free((void *)cleanBuffer);
-  return(escBuffer);
+  syslogTcpAdd(priority, "", text, length);
 }
 
+static void flushAll(void) {
+  if (journaldActive()) {
+    journaldFlush();
+  } else {
+    syslogClientFlush();
+  }
+  syslogTcpFlush();
+}
 
-void write2syslog(const char *optr, size_t optrLength, bool const useLinecnt,
-                  int const facility, int const priority) {
-  static size_t rptrLength = 0;
-  /* 
-  //  buffer where remaining input will be kept 
-  */
-  static char *rptr;
-  char *realloc_retval;
-  /* 
-  //  pointer to the string which will be output 
-  */
-  char *eptr;                     
-  /* 
-  //  pointer from where the search for '\r' begins 
-  */
-  char *tptr;                     
-  /* 
-  //  pointer to occurrences of '\r' 
-  */
-  char *lptr;                     
-  /* 
-  //  signals the last output character was a '\r' 
-  */
-  static int rflag = 0;           
+/*
+//  Tell syslog about the lines which were not sent since the last
+//  summary. The hash covers them as they would have been sent, without
+//  counter and tags, each complete line followed by a \n.
+*/
+static void sendSummary(int const facility, int const priority) {
+  char hex[SHA256HEXSIZE];
+  char text[256];
+  int length;
 
-  /*
-  //  a 3-digit counter which prepends each line sent to the syslog server 
-  //  this allows the detection of dropped lines 
-  */
-  static int linecnt = 0;
-  
-  /* 
-  //  ignore empty input 
-  */
-  if ((optrLength == 0) || (optr == NULL)) {    
-    return;
-  }
-  /*
-  //  skip newlines 
-  */
-  if ((rflag == 1) && (*optr == '\n')) {     
-    optr++;
-    optrLength--;
-  }
-  rflag = 0;
-  /*
-  //  no remaining output from last run 
-  */
-  if (rptr == NULL) {                        
-    /*
-    //  allocate new buffer for current output 
-    */
-    rptr = malloc(optrLength);                  
-  } else {
+  sha256Hex(&suppressedHash, hex);
+  length = snprintf(text, sizeof(text),
+                    "rate limit: %llu lines (%llu bytes) not sent to syslog, sha256 %s",
+                    suppressedLines, suppressedBytes, hex);
+  addMessage(facility | priority, text, length);
+  suppressedLines = 0;
+  suppressedBytes = 0;
+}
+
+/*
+//  Send the pending line, or with more set the piece of it which is
+//  complete. The rest of a character stays for the next piece.
+*/
+static void sendline(bool const useLinecnt, int const facility,
+                     int const priority, bool const more) {
+  char counter[24] = "";
+  char piece[24] = "";
+  char prefix[sizeof(counter) + sizeof(piece) + 3];
+  size_t const length = more ? completeLength() : lineLength;
+  long long const now = nowMs();
+
+  if (!takeToken(now)) {
     /*
-    //  add space for current output to remaining output 
+    //  Not sent, so it takes no number. A piece still counts, the
+    //  collector sees that the line is incomplete.
     */
-    realloc_retval = realloc(rptr, rptrLength + optrLength);
-    if(NULL == realloc_retval) {
-      free(rptr);
-      fprintf(stderr, "Unable to allocate memory to log to syslog\n");
-      exit(1);
+    if (0 == suppressedLines) {
+      sha256Init(&suppressedHash);
+      suppressedSince = now;
+    }
+    sha256Update(&suppressedHash, line, length);
+    if (!more) {
+      sha256Update(&suppressedHash, "\n", 1);
+      fragment = 0;
     } else {
-      rptr = realloc_retval;
+      ++fragment;
     }
+    ++suppressedLines;
+    suppressedBytes += length;
+    memmove(line, line + length, lineLength - length);
+    lineLength -= length;
+    return;
+  }
+  if (suppressedLines > 0) {
+    sendSummary(facility, priority);
+  }
+  if(useLinecnt) {
+    snprintf(counter, sizeof(counter), "%03llu: ", sequence);
+  }
+  if (more || fragment > 0) {
+    snprintf(piece, sizeof(piece), "%lu%s", ++fragment, more ? "+" : "");
+    snprintf(prefix, sizeof(prefix), "%s[%s] ", counter, piece);
+  } else {
+    strcpy(prefix, counter);
   }
   /*
-  //  fill the newly created memory with the current output 
+  //  journald has fields for the counter and the piece
   */
-  memcpy(rptr + rptrLength, optr, optrLength);  
+  if (journaldActive()) {
+    journaldAdd(facility | priority, useLinecnt ? (long long)sequence : -1,
+                piece, line, length);
+  } else {
+    syslogClientAdd(facility | priority, prefix, line, length);
+  }
+  if(useLinecnt) {
+    ++sequence;
+  }
   /*
-  //  new length is now 
-  //  old buffer length (might have been 0) + current output's length 
+  //  TCP has sequence numbers of its own, no need for the counter,
+  //  and the piece goes into the structured data
   */
-  rptrLength += optrLength;                     
+  syslogTcpAdd(facility | priority, piece, line, length);
+  memmove(line, line + length, lineLength - length);
+  lineLength -= length;
+  if (!more) {
+    fragment = 0;
+  }
+}
+
+unsigned long long write2syslogLines(void) {
+  return sequence;
+}
+
+void write2syslogRateLimit(unsigned long const linesPerSecond,
+                          unsigned long const maxBurst) {
+  rate = linesPerSecond;
+  burst = maxBurst > 0 ? maxBurst : 1;
+  tokens = burst;
+  refilled = nowMs();
+}
+
+void write2syslogRateSummary(int const facility, int const priority) {
+  if (suppressedLines > 0) {
+    sendSummary(facility, priority);
+    flushAll();
+  }
+}
+
+void write2syslogLineLimit(size_t const limit) {
+  lineLimit = limit;
+  if (lineLimit < WRITE2SYSLOGMINLINE) {
+    lineLimit = WRITE2SYSLOGMINLINE;
+  } else if (lineLimit > WRITE2SYSLOGMAXLINE) {
+    lineLimit = WRITE2SYSLOGMAXLINE;
+  }
+}
+
+void write2syslogCharset(enum escCharset const charset) {
+  escFilterInit(&filter, charset);
+  lineCharset = charset;
+}
+
+void write2syslog(const char *optr, size_t optrLength, bool const useLinecnt,
+                  int const facility, int const priority) {
   /*
-  //  tptr points to where be begin looking for crs 
+  //  end of the input 
   */
-  tptr = rptr;                               
-  lptr = memchr(tptr, '\r', rptrLength);
-  /*
-  //  we found a \r at position lptr and we started searching for it
-  //  at an allowed position 
+  char const * const endptr = optr + optrLength;
+  /* 
+  //  pointer to the next \r 
   */
-  while ((lptr != NULL) && (tptr < (rptr + rptrLength))) { 
-    /*
-    //  skip a following \n if rflag is set 
-    */
-    rflag = 1;                             
-    /* 
-    //  allocate space for the line (exclude the found \r) plus
-    //  space for a \0 
-    */
-    eptr = malloc(lptr - tptr + 1);        
-    /*
-    // copy everything except the \r 
-    */
-    memcpy(eptr, tptr, lptr - tptr);       
-    /*
-    //  make a c string from it 
-    */
-    *(eptr + (lptr - tptr)) = '\0';        
-    /*
-    //  filter out escape sequences 
-    */
-    stripesc(eptr);
-    /*
-    //  send the resulting line to syslog 
-    */
-    if(useLinecnt) {
-      syslog(facility | priority, "%03d: %s", linecnt++, eptr);
-      if (linecnt == 101) linecnt = 0;
-    } else {
-      syslog(facility | priority, "%s", eptr);
-    }
-    /*
-    //  release the escape-free buffer 
-    */
-    free(eptr);
-    if ((lptr == rptr + rptrLength - 1) && (*lptr == '\r')) {
-      /*
-      //  the \r was the last character, we're done 
-      */
-      tptr = lptr + 1;
-      lptr = NULL;
-    } else if (lptr < rptr + rptrLength - 1) { 
+  char const *lptr;
+
+  if (optr == NULL) {
+    return;
+  }
+  while (optr < endptr) {
+    if (lineStart) {
       /*
-      //  after the \r there are still characters left 
-      //  start a new search 1 position behind the old \r 
+      //  skip the \n of a \r\n and empty lines 
       */
-      tptr = lptr + 1;         
-      if ((*tptr == '\n') && (tptr == (rptr + rptrLength - 1))) { 
-        /*
-        //  there is excatly 1 character left and it's a \n 
-        //  ignore it, we're done 
-        */
-        lptr = NULL;                                              
-      } else if ((*tptr == '\n') && (tptr < (rptr + rptrLength - 1))) { 
-        /*
-        //  the next character is a \n but there are still more after it
-        //  skip the \n 
-        */
-        tptr++;                            
-        /* start a new search for \r */
-        lptr = memchr(tptr, '\r', rptrLength - (tptr - rptr)); 
-      } else {                             
-        /*
-        //  there are other characters left 
-        //  start a new search for \r 
-        */
-        lptr = memchr(tptr, '\r', rptrLength - (tptr - rptr)); 
+      while ((optr < endptr) && (*optr == '\n')) {
+        optr++;
       }
-    } else {
-      /*
-      //  the \r was the last character, we're done 
-      */
-      lptr = NULL;                         
+      if (optr == endptr) {
+        break;
+      }
+      lineStart = false;
     }
-  }
-  while((tptr < (rptr + rptrLength)) && (*(tptr) == '\n')) { 
-    /*
-    //  skip empty lines 
-    */
-    tptr++;
-  }  
-  if ((lptr == NULL) && (tptr < (rptr + rptrLength))) {    
+    lptr = memchr(optr, '\r', endptr - optr);
     /*
-    //  there are characters left which are kept until a linebreak occurs
-    //  move the remainings to the beginning of the buffer 
+    //  take the line up to the \r (or all of the input), a full
+    //  buffer is sent as a piece when more of the line comes
     */
-    memmove(rptr, tptr, ((rptr + rptrLength) - tptr));    
-    /* 
-    //  recalculate the length of the rest 
-    */
-    rptrLength = (rptr + rptrLength) - tptr;              
-    /* 
-    //  cut off everything we don't need 
-    */
-    realloc_retval = realloc(rptr, (size_t)rptrLength);     
-    if(NULL == realloc_retval) {
-      free(rptr);
-      fprintf(stderr, "Unable to allocate memory to log to syslog\n");
-      exit(1);
-    } else {
-      rptr = realloc_retval;
+    while (optr < (lptr ? lptr : endptr)) {
+      size_t chunk = (lptr ? lptr : endptr) - optr;
+      if (lineLength >= lineLimit) {
+        sendline(useLinecnt, facility, priority, true);
+      }
+      if (chunk > lineLimit - lineLength) {
+        chunk = lineLimit - lineLength;
+      }
+      lineLength += escFilterRun(&filter, line + lineLength, optr, chunk);
+      optr += chunk;
     }
-  } else {
-    /* 
-    //  we are done. a complete line was output with no extra characters left 
-    */
-    free(rptr);
-    rptr = NULL;
-    rptrLength = 0;
+    if (lptr != NULL) {
+      sendline(useLinecnt, facility, priority, false);
+      lineStart = true;
+      optr = lptr + 1;
+    }
+  }
+  /*
+  //  While lines are held back syslog hears about them now and then.
+  */
+  if (suppressedLines > 0 && nowMs() - suppressedSince >= RATESUMMARY * 1000) {
+    sendSummary(facility, priority);
   }
+  /*
+  //  the lines of this chunk go out together
+  */
+  flushAll();
 }
 
+void write2syslogMessage(int const facility, int const priority,
+                         char const *format, ...) {
+  char text[1024];
+  va_list arguments;
+  int length;
+
+  va_start(arguments, format);
+  length = vsnprintf(text, sizeof(text), format, arguments);
+  va_end(arguments);
+  if (length < 0) {
+    return;
+  }
+  if ((size_t)length >= sizeof(text)) {
+    length = sizeof(text) - 1;
+  }
+  addMessage(facility | priority, text, length);
+  flushAll();
+}
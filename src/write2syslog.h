@@ -1,15 +1,86 @@
 #include <stdbool.h>
+#include <stddef.h>
+
+#include "escFilter.h"
+
+/**
+ *  how long a line may get before it is sent in pieces, unless
+ *  write2syslogLineLimit says otherwise
+ */
+#define WRITE2SYSLOGLINE 1024
+
+/**
+ *  the bounds for write2syslogLineLimit
+ */
+#define WRITE2SYSLOGMINLINE 64
+#define WRITE2SYSLOGMAXLINE 16384
 
 /**
  *  takes a variable sized string
  *  breaks the string into pieces (lines) separated by \r
- *  cleans the lines from escape sequences and writes it to syslog
- *  keeps remainings (not closed by a newline) in a static area
+ *  cleans the lines from escape sequences and writes it to syslog,
+ *  all lines of one call together
+ *  keeps remainings (not closed by a newline) in a static area of
+ *  fixed size, longer lines are sent in pieces. Each piece starts
+ *  with its number in brackets, "[1+] ", "[2+] ", ..., the + says
+ *  that more of the line follows, the last piece has none: "[3] ".
  * @param oBuffer what to write
  * @param oCharCount how large oBuffer is
- * @param useLinecnt if true, then output line count as a 3 digit counter
+ * @param useLinecnt if true, then each line starts with its number in
+ *        the session, at least 3 digits: "000: ", "001: ", ...
  * @param facility syslog facility
  * @param priority syslog priority
  */
 void write2syslog(const char *oBuffer, size_t oCharCount, bool const useLinecnt,
                   int const facility, int const priority);
+
+/**
+ *  tells how many numbered lines were sent, the number of the next
+ * @return the count of lines so far
+ */
+unsigned long long write2syslogLines(void);
+
+/**
+ *  limits how many lines go to syslog, a token bucket which holds
+ *  maxBurst lines and gets linesPerSecond back every second. Lines
+ *  over the limit are not sent, a summary with their count, size and
+ *  SHA-256 is sent instead, when lines are sent again or every few
+ *  seconds.
+ * @param linesPerSecond the rate, 0 for no limit
+ * @param maxBurst how many lines may go out at once
+ */
+void write2syslogRateLimit(unsigned long const linesPerSecond,
+                           unsigned long const maxBurst);
+
+/**
+ *  sends the summary of the lines held back by the rate limit so far,
+ *  if there are any
+ * @param facility syslog facility
+ * @param priority syslog priority
+ */
+void write2syslogRateSummary(int const facility, int const priority);
+
+/**
+ *  sets how much of a line is kept before it is sent in pieces,
+ *  between WRITE2SYSLOGMINLINE and WRITE2SYSLOGMAXLINE
+ * @param limit the longest piece in bytes, without the tags
+ */
+void write2syslogLineLimit(size_t const limit);
+
+/**
+ *  sets how the output is read before the escape sequences are
+ *  removed, 8 bit (the default) or UTF-8
+ * @param charset how to read the output
+ */
+void write2syslogCharset(enum escCharset const charset);
+
+/**
+ *  writes a message about the session, like its start and end,
+ *  to syslog
+ * @param facility syslog facility
+ * @param priority syslog priority
+ * @param format printf format of the message
+ */
+void write2syslogMessage(int const facility, int const priority,
+                         char const *format, ...)
+  __attribute__((format(printf, 3, 4)));
@@ -0,0 +1,150 @@
+/*
+  Zero-copy relay of pty output to the screen and the logfile.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+/* splice and tee are GNU extensions */
+#define _GNU_SOURCE 1
+
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "zeroCopy.h"
+
+/*
+//  Both pipes get the same capacity, so a tee of everything in the
+//  screen pipe always fits into the (empty) log pipe.
+*/
+#define PIPESIZE 65536
+
+/*
+//  screenPipe		Takes the chunk from the pty, drained to the screen.
+//
+//  logPipe		Gets a tee'd copy of the chunk, drained to the logfile.
+*/
+static int screenPipe[2] = { -1, -1 };
+static int logPipe[2] = { -1, -1 };
+
+#if HAVE_SPLICE && HAVE_TEE
+bool zeroCopyOpen(void) {
+  if(pipe(screenPipe) < 0) {
+    return false;
+  }
+  if(pipe(logPipe) < 0) {
+    zeroCopyClose();
+    return false;
+  }
+#ifdef F_SETPIPE_SZ
+  fcntl(screenPipe[1], F_SETPIPE_SZ, PIPESIZE);
+  fcntl(logPipe[1], F_SETPIPE_SZ, PIPESIZE);
+#endif
+  /* lets a failed logfile write empty the log pipe without blocking */
+  fcntl(logPipe[0], F_SETFL, fcntl(logPipe[0], F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+/*
+//  Splice len bytes out of a pipe. Waits if the target is a full
+//  non-blocking descriptor.
+*/
+static bool drainPipe(int const pipeFd, int const to, size_t len) {
+  while(len > 0) {
+    ssize_t const n = splice(pipeFd, NULL, to, NULL, len, SPLICE_F_MOVE);
+    if(n > 0) {
+      len -= n;
+    } else if(n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+      struct pollfd pfd;
+      pfd.fd = to;
+      pfd.events = POLLOUT;
+      if(poll(&pfd, 1, -1) < 0 && EINTR != errno) {
+        return false;
+      }
+    } else if(n < 0 && EINTR == errno) {
+      continue;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+ssize_t zeroCopyRelay(int const from, int const screen, int const log) {
+  ssize_t const n = splice(from, NULL, screenPipe[1], NULL, PIPESIZE,
+                           SPLICE_F_MOVE|SPLICE_F_NONBLOCK);
+  if(n <= 0) {
+    return n;
+  }
+  if(log >= 0) {
+    /*
+    //  tee always starts at the front of the pipe, so a partial tee
+    //  couldn't be continued. With equally sized pipes and an empty
+    //  log pipe it doesn't happen.
+    */
+    if(tee(screenPipe[0], logPipe[1], n, 0) != n) {
+      errno = EIO;
+      return -1;
+    }
+    if(!drainPipe(logPipe[0], log, n)) {
+      /*
+      //  Like a failed write to the logfile, this must not end the
+      //  session. Throw away what's left for the logfile.
+      */
+      char discard[BUFSIZ];
+      perror("Error writing to logfile");
+      while(read(logPipe[0], discard, sizeof(discard)) > 0) {
+      }
+    }
+  }
+  if(!drainPipe(screenPipe[0], screen, n)) {
+    return -1;
+  }
+  return n;
+}
+#else
+/*
+//  Without splice and tee the caller always takes the read/write path.
+*/
+bool zeroCopyOpen(void) {
+  errno = ENOSYS;
+  return false;
+}
+
+ssize_t zeroCopyRelay(int const from, int const screen, int const log) {
+  errno = EINVAL;
+  return -1;
+}
+#endif
+
+void zeroCopyClose(void) {
+  int i;
+  for(i = 0; i < 2; ++i) {
+    if(screenPipe[i] >= 0) {
+      close(screenPipe[i]);
+      screenPipe[i] = -1;
+    }
+    if(logPipe[i] >= 0) {
+      close(logPipe[i]);
+      logPipe[i] = -1;
+    }
+  }
+}
@@ -0,0 +1,56 @@
+/*
+  Header for the zero-copy relay of pty output.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef ZEROCOPY_H
+#define ZEROCOPY_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/**
+ * Create the pipes for the zero-copy relay.
+ *
+ * @return false if the system can't splice, errno is set
+ */
+bool zeroCopyOpen(void);
+
+/**
+ * Move one chunk from a non-blocking source to the screen and the
+ * logfile without copying it through user space: the chunk is
+ * spliced into a pipe, tee'd into a second pipe and both pipes are
+ * spliced out. The logfile must not be opened with O_APPEND, splice
+ * refuses such files.
+ *
+ * @param from the master pty
+ * @param screen where the user sees the output, may be non-blocking
+ * @param log the logfile, -1 for none
+ * @return bytes moved, 0 at end of file, -1 on error with errno set.
+ * EINVAL from the first call means the source can't be spliced, the
+ * caller should fall back to read and write.
+ */
+ssize_t zeroCopyRelay(int const from, int const screen, int const log);
+
+/**
+ * Release the pipes.
+ */
+void zeroCopyClose(void);
+
+#endif
@@ -0,0 +1,152 @@
+/*
+  Throughput of the escape filter with each plain text search.
+
+  Not run by "make check", build it with "make benchEscFilter" in this
+  directory. The captures are made up to look like what ls -l --color,
+  a compiler with colored diagnostics and top write to a terminal, the
+  last one also with UTF-8 file names.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "plainScan.h"
+#include "escFilter.h"
+
+#define CAPTURESIZE (8 * 1024 * 1024)
+#define CHUNKSIZE 4096
+#define ROUNDS 8
+
+static char capture[CAPTURESIZE + 1024];
+static char filtered[CHUNKSIZE + 1];
+
+static size_t lsCapture(void) {
+  size_t length = 0;
+  int i = 0;
+  while (length < CAPTURESIZE) {
+    length += sprintf(capture + length,
+                      i % 3 == 0
+                      ? "drwxr-xr-x  2 root root    4096 Oct 17 07:36 \x1b[01;34mdirectory%05d\x1b[0m\r\n"
+                      : "-rw-r--r--  1 root root  %6d Oct 17 07:36 source-file-%d.c\r\n",
+                      i * 37 % 100000, i);
+    ++i;
+  }
+  return length;
+}
+
+static size_t compilerCapture(void) {
+  size_t length = 0;
+  int i = 0;
+  while (length < CAPTURESIZE) {
+    length += sprintf(capture + length,
+                      "\x1b[01m\x1b[Ksrc/module%d.c:%d:%d:\x1b[m\x1b[K \x1b[01;35m\x1b[Kwarning: \x1b[m\x1b[K"
+                      "unused variable '\x1b[01m\x1b[Kcounter%d\x1b[m\x1b[K' [\x1b[01;35m\x1b[K-Wunused-variable\x1b[m\x1b[K]\r\n"
+                      "  %4d |   int counter%d = compute(argument, other_argument, %d);\r\n"
+                      "gcc -DHAVE_CONFIG_H -I. -g -O2 -Wall -c -o module%d.o module%d.c\r\n",
+                      i % 40, i, i % 80, i, i, i, i, i, i);
+    ++i;
+  }
+  return length;
+}
+
+static size_t topCapture(void) {
+  size_t length = 0;
+  int i = 0;
+  while (length < CAPTURESIZE) {
+    if (i % 30 == 0) {
+      length += sprintf(capture + length,
+                        "\x1b[H\x1b[2Jtop - 07:36:%02d up 12 days,  3:01,  2 users,  load average: 0.42, 0.37, 0.30\x1b[K\r\n"
+                        "\x1b[7m    PID USER      PR  NI    VIRT    RES    SHR S  %%CPU  %%MEM     TIME+ COMMAND   \x1b[m\r\n",
+                        i % 60);
+    }
+    length += sprintf(capture + length,
+                      "\x1b[%d;1H\x1b[m %6d root      20   0  %6d  %5d  %5d S   %d.%d   0.%d   0:%02d.%02d %s\x1b[K",
+                      i % 30 + 3, 1000 + i, 20000 + i * 7 % 9000, 4000 + i % 999,
+                      3000 + i % 777, i % 10, i % 7, i % 9, i % 60, i % 100,
+                      i % 2 ? "\x1b[1mbash\x1b[m" : "sshd");
+    ++i;
+  }
+  return length;
+}
+
+static size_t utf8Capture(void) {
+  size_t length = 0;
+  int i = 0;
+  while (length < CAPTURESIZE) {
+    length += sprintf(capture + length,
+                      i % 2 == 0
+                      ? "-rw-r--r--  1 root root  %6d Okt 17 07:36 \x1b[01;32mGr\xc3\xb6\xc3\x9f" "e-%d.txt\x1b[0m\r\n"
+                      : "-rw-r--r--  1 root root  %6d Okt 17 07:36 \xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e-%d \xc2\xb7 \xc4\x9b\r\n",
+                      i * 37 % 100000, i);
+    ++i;
+  }
+  return length;
+}
+
+static double seconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*
+//  Filter the capture in pty sized chunks like the relay does.
+*/
+static void bench(char const *name, size_t const length,
+                  enum escCharset const charset) {
+  static char const * const levels[] = { "none", "scalar", "sse2", "avx2" };
+  int level, round;
+
+  for (level = PLAINSCAN_NONE; level <= PLAINSCAN_AVX2; ++level) {
+    struct escFilter filter;
+    double start, elapsed;
+    size_t kept = 0;
+
+    if (!plainScanSelect(level)) {
+      continue;
+    }
+    escFilterInit(&filter, charset);
+    start = seconds();
+    for (round = 0; round < ROUNDS; ++round) {
+      size_t done;
+      for (done = 0; done < length; done += CHUNKSIZE) {
+        kept += escFilterRun(&filter, filtered, capture + done,
+                             length - done < CHUNKSIZE ? length - done : CHUNKSIZE);
+      }
+    }
+    elapsed = seconds() - start;
+    printf("%-10s %-7s %8.1f MB/s  %3d%% kept\n", name, levels[level],
+           (double)length * ROUNDS / elapsed / 1e6,
+           (int)(100.0 * kept / ((double)length * ROUNDS)));
+  }
+}
+
+int main(int argc, char **argv) {
+  bench("ls -l", lsCapture(), ESCCHARSET_8BIT);
+  bench("compiler", compilerCapture(), ESCCHARSET_8BIT);
+  bench("top", topCapture(), ESCCHARSET_8BIT);
+  bench("ls -l", lsCapture(), ESCCHARSET_UTF8);
+  bench("utf-8 ls", utf8Capture(), ESCCHARSET_UTF8);
+  return 0;
+}
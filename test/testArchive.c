@@ -0,0 +1,292 @@
+/*
+  Test for rootsh-archive, run on a logdir of its own.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#if HAVE_ZLIB_H && HAVE_LIBZ
+#  define USE_ZLIB 1
+#endif
+
+#include "logCompress.h"
+
+/* several blocks of the default frame size */
+#define LINES 120000
+#define MTIME 1500000000
+#define MANIFEST "root.1.001.closed\nroot.1.002.closed\nroot.1.003.closed\n"
+#define ARCHIVED "root.1.001.closed.gz\nroot.1.002.closed.gz\nroot.1.003.closed\n"
+
+/* function declarations */
+bool testArchive(void);
+
+/* implementations */
+
+#if USE_ZLIB
+static char logdir[] = "/tmp/testArchiveXXXXXX";
+
+static bool writeFile(char const * const name, char const * const data, size_t const length) {
+  char path[MAXPATHLEN];
+  FILE *file;
+  bool written;
+
+  snprintf(path, sizeof(path), "%s/%s", logdir, name);
+  if (NULL == (file = fopen(path, "w"))) {
+    perror(path);
+    return false;
+  }
+  written = length == fwrite(data, 1, length, file);
+  return 0 == fclose(file) && written;
+}
+
+/*
+//  The whole file, NULL if it can't be read.
+*/
+static unsigned char *readFile(char const * const name, size_t * const length) {
+  char path[MAXPATHLEN];
+  unsigned char *data = NULL;
+  struct stat status;
+  int fd;
+
+  snprintf(path, sizeof(path), "%s/%s", logdir, name);
+  if ((fd = open(path, O_RDONLY)) < 0) {
+    return NULL;
+  }
+  if (0 == fstat(fd, &status) && NULL != (data = malloc(status.st_size + 1))
+      && status.st_size != read(fd, data, status.st_size)) {
+    free(data);
+    data = NULL;
+  }
+  if (NULL != data) {
+    data[status.st_size] = '\0';
+    *length = (size_t)status.st_size;
+  }
+  close(fd);
+  return data;
+}
+
+static bool exists(char const * const name) {
+  char path[MAXPATHLEN];
+  struct stat status;
+
+  snprintf(path, sizeof(path), "%s/%s", logdir, name);
+  return 0 == lstat(path, &status);
+}
+
+static int runArchive(void) {
+  int status;
+  pid_t const pid = fork();
+
+  if (0 == pid) {
+    execl(ARCHIVEPROGRAM, "rootsh-archive", "-d", logdir, "-j", "2", "-l", "6", (char *)NULL);
+    perror(ARCHIVEPROGRAM);
+    _exit(127);
+  }
+  if (pid < 0 || pid != waitpid(pid, &status, 0) || !WIFEXITED(status)) {
+    return -1;
+  }
+  return WEXITSTATUS(status);
+}
+
+/*
+//  Every frame the footer lists decompresses to its part of the
+//  original.
+*/
+static bool checkFrames(unsigned char const * const file, size_t const size,
+                        char const * const original, size_t const length) {
+  struct logCompressEntry *entries = NULL;
+  unsigned long long total;
+  size_t count, i;
+  bool retval = false;
+  unsigned char *out = malloc(length);
+
+  if (NULL == out || !logCompressReadFooter(file, size, &entries, &count, &total)) {
+    printf("no footer\n");
+    goto cleanup;
+  }
+  if (total != length || count < 3) {
+    printf("footer has %lu frames of %llu bytes\n", (unsigned long)count, total);
+    goto cleanup;
+  }
+  for (i = 0; i < count; ++i) {
+    unsigned long long const end = i + 1 < count ? entries[i + 1].in : total;
+    if (!logCompressInflate(file + entries[i].out, size - entries[i].out,
+                            out + entries[i].in, end - entries[i].in)) {
+      printf("frame %lu broken\n", (unsigned long)i);
+      goto cleanup;
+    }
+  }
+  retval = 0 == memcmp(out, original, length);
+  if (!retval) {
+    printf("frames differ from the logfile\n");
+  }
+
+cleanup:
+  free(entries);
+  free(out);
+  return retval;
+}
+
+static void removeLogdir(void) {
+  DIR *dir = opendir(logdir);
+  struct dirent *entry;
+  char path[MAXPATHLEN];
+
+  while (NULL != dir && NULL != (entry = readdir(dir))) {
+    if (0 != strcmp(entry->d_name, ".") && 0 != strcmp(entry->d_name, "..")) {
+      snprintf(path, sizeof(path), "%s/%s", logdir, entry->d_name);
+      unlink(path);
+    }
+  }
+  if (NULL != dir) {
+    closedir(dir);
+  }
+  rmdir(logdir);
+}
+
+/*
+//  No temporary file may stay behind.
+*/
+static bool onlyLogfiles(void) {
+  DIR *dir = opendir(logdir);
+  struct dirent *entry;
+  bool retval = NULL != dir;
+
+  while (NULL != dir && NULL != (entry = readdir(dir))) {
+    if ('.' == entry->d_name[0] && 0 != strcmp(entry->d_name, ".")
+        && 0 != strcmp(entry->d_name, "..")) {
+      printf("%s left behind\n", entry->d_name);
+      retval = false;
+    }
+  }
+  if (NULL != dir) {
+    closedir(dir);
+  }
+  return retval;
+}
+#endif
+
+/*
+//  A raw logfile of several blocks is replaced by its compressed
+//  version with a footer, owner, mode and times are kept and the
+//  manifest names the new segments. A logfile whose .gz already
+//  exists is left alone.
+*/
+bool testArchive(void) {
+#if USE_ZLIB
+  static char original[LINES * 16];
+  char path[MAXPATHLEN];
+  struct timespec times[2];
+  struct stat status;
+  unsigned char *archived = NULL, *manifest = NULL, *kept = NULL;
+  size_t length = 0, size, i;
+  bool const owner = 0 == getuid();
+  bool retval = false;
+
+  if (NULL == mkdtemp(logdir)) {
+    perror(logdir);
+    return false;
+  }
+  for (i = 0; i < LINES; ++i) {
+    length += sprintf(original + length, "line %07lu\r\n", (unsigned long)i);
+  }
+  if (!writeFile("root.1.001.closed", original, length)
+      || !writeFile("root.1.002.closed", "exit\r\n", 6)
+      || !writeFile("root.1.manifest.closed", MANIFEST, strlen(MANIFEST))
+      || !writeFile("root.2.closed", "second\r\n", 8)
+      || !writeFile("root.2.closed.gz", "earlier run", 11)) {
+    goto cleanup;
+  }
+  snprintf(path, sizeof(path), "%s/root.1.001.closed", logdir);
+  times[0].tv_sec = times[1].tv_sec = MTIME;
+  times[0].tv_nsec = times[1].tv_nsec = 0;
+  if (0 != chmod(path, 0640) || 0 != utimensat(AT_FDCWD, path, times, 0)
+      || (owner && 0 != chown(path, 1, 1))) {
+    perror(path);
+    goto cleanup;
+  }
+
+  /* root.2.closed can't be archived, the run fails */
+  if (0 == runArchive()) {
+    printf("rootsh-archive replaced an existing .gz\n");
+    goto cleanup;
+  }
+  if (exists("root.1.001.closed") || exists("root.1.002.closed")
+      || NULL == (archived = readFile("root.1.001.closed.gz", &size))) {
+    printf("root.1 not archived\n");
+    goto cleanup;
+  }
+  if (!checkFrames(archived, size, original, length)) {
+    goto cleanup;
+  }
+  strcat(path, ".gz");
+  if (0 != stat(path, &status) || 0640 != (status.st_mode & 07777)
+      || MTIME != status.st_mtim.tv_sec
+      || (owner && (1 != status.st_uid || 1 != status.st_gid))) {
+    printf("mode %o, mtime %ld, owner %d:%d not kept\n", (unsigned)(status.st_mode & 07777),
+           (long)status.st_mtim.tv_sec, (int)status.st_uid, (int)status.st_gid);
+    goto cleanup;
+  }
+  if (NULL == (manifest = readFile("root.1.manifest.closed", &size))
+      || 0 != strcmp((char *)manifest, ARCHIVED)) {
+    printf("manifest is '%s'\n", NULL == manifest ? "" : (char *)manifest);
+    goto cleanup;
+  }
+  if (!exists("root.2.closed") || NULL == (kept = readFile("root.2.closed.gz", &size))
+      || 0 != strcmp((char *)kept, "earlier run")) {
+    printf("root.2 was touched\n");
+    goto cleanup;
+  }
+  retval = onlyLogfiles();
+
+cleanup:
+  free(archived);
+  free(manifest);
+  free(kept);
+  removeLogdir();
+  return retval;
+#else
+  return true;
+#endif
+}
+
+int main(int argc, char **argv) {
+  int retval = 0;
+
+  printf("testArchive:\n");
+  if(!testArchive()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  return retval;
+}
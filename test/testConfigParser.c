@@ -35,6 +35,7 @@ bool testAllWhitespace(void);
 bool testSplitLine0(void);
 bool testSplitLine1(void);
 bool testParseBool(void);
+bool testParseSize(void);
 
 /* implementations */
 bool testTrimWhitespace0(void) {
@@ -224,6 +225,68 @@ bool testParseBool(void) {
   return true;
 }
 
+bool testParseSize(void) {
+  unsigned long long size;
+
+  if(!parseSize("4096", &size) || 4096 != size) {
+    printf("'4096' is not 4096\n");
+    return false;
+  }
+
+  if(!parseSize("0", &size) || 0 != size) {
+    printf("'0' is not 0\n");
+    return false;
+  }
+
+  if(!parseSize("8k", &size) || 8192 != size) {
+    printf("'8k' is not 8192\n");
+    return false;
+  }
+
+  if(!parseSize("10M", &size) || 10485760 != size) {
+    printf("'10M' is not 10485760\n");
+    return false;
+  }
+
+  if(!parseSize("2g", &size) || 2147483648ULL != size) {
+    printf("'2g' is not 2147483648\n");
+    return false;
+  }
+
+  size = 42;
+  if(parseSize("10x", &size) || 42 != size) {
+    printf("'10x' is a size\n");
+    return false;
+  }
+
+  if(parseSize("", &size)) {
+    printf("'' is a size\n");
+    return false;
+  }
+
+  if(parseSize("-1", &size)) {
+    printf("'-1' is a size\n");
+    return false;
+  }
+
+  if(parseSize("99999999999999999999", &size)) {
+    printf("'99999999999999999999' is a size\n");
+    return false;
+  }
+
+  if(parseSize("17179869184g", &size)) {
+    printf("'17179869184g' is a size\n");
+    return false;
+  }
+
+  if(parseSize(NULL, &size)) {
+    printf("NULL is a size\n");
+    return false;
+  }
+
+  return true;
+}
+
 int main(int argc, char **argv) {
   int retval = 0;
 
@@ -235,6 +298,14 @@ int main(int argc, char **argv) {
     printf("\tPASSED\n");
   }
   
+  printf("testParseSize:\n");
+  if(!testParseSize()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+  
   printf("testAllWhitespace:\n");
   if(!testAllWhitespace()) {
     printf("\tFAILED\n");
@@ -0,0 +1,396 @@
+/*
+  Test for the escape filter and its plain text search.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "plainScan.h"
+#include "escFilter.h"
+#include "escReference.h"
+
+/* function declarations */
+bool testPlainSpan(void);
+bool testEscFilter(void);
+bool testEscFilterSplit(void);
+bool testEscFilterStreams(void);
+bool testEscFilterReference(void);
+bool testEscFilterReferenceUtf8(void);
+bool testEscFilterUtf8(void);
+bool testPlainSpanUtf8(void);
+
+/* implementations */
+static size_t referenceSpan(unsigned char const *buffer, size_t length) {
+  size_t i;
+  for (i = 0; i < length; ++i) {
+    if (buffer[i] < 0x20 || buffer[i] == 0x7F
+        || (buffer[i] >= 0x80 && buffer[i] < 0xA0)) {
+      break;
+    }
+  }
+  return i;
+}
+
+/*
+//  Every implementation the CPU has must find the same end of the
+//  plain text, wherever the special byte is and whatever it is.
+*/
+bool testPlainSpan(void) {
+  unsigned char buffer[200];
+  int level, round;
+
+  srand(1);
+  for (level = PLAINSCAN_SCALAR; level <= PLAINSCAN_AVX2; ++level) {
+    if (!plainScanSelect(level)) {
+      continue;
+    }
+    for (round = 0; round < 20000; ++round) {
+      size_t const length = rand() % sizeof(buffer);
+      size_t i, expected, actual;
+      for (i = 0; i < length; ++i) {
+        buffer[i] = 0x20 + rand() % 0x5F;
+      }
+      if (length > 0 && rand() % 4 != 0) {
+        buffer[rand() % length] = rand() % 256;
+      }
+      expected = referenceSpan(buffer, length);
+      actual = plainSpan((char const *)buffer, length);
+      if (expected != actual) {
+        printf("level %d: span %lu instead of %lu\n", level,
+               (unsigned long)actual, (unsigned long)expected);
+        return false;
+      }
+    }
+  }
+  plainScanSelect(PLAINSCAN_NONE);
+  return true;
+}
+
+bool testEscFilter(void) {
+  char const *input = "\x1b[01;34mdir\x1b[0m\tfile \x9b" "1mbold\x1b]0;title\x07 end\r\n";
+  char const *expected = "dir\tfile bold end\r\n";
+  char buffer[100];
+  int level;
+  size_t length;
+
+  for (level = PLAINSCAN_NONE; level <= PLAINSCAN_AVX2; ++level) {
+    if (!plainScanSelect(level)) {
+      continue;
+    }
+    struct escFilter filter;
+    escFilterInit(&filter, ESCCHARSET_8BIT);
+    strcpy(buffer, input);
+    length = escFilterRun(&filter, buffer, buffer, strlen(buffer));
+    if (length != strlen(expected) || 0 != memcmp(buffer, expected, length)) {
+      buffer[length] = '\0';
+      printf("level %d: bad filtered value: '%s'\n", level, buffer);
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+//  A sequence split between two calls is still removed.
+*/
+bool testEscFilterSplit(void) {
+  char const *first = "abc\x1b[3";
+  char const *second = "1mdef";
+  char buffer[20];
+  struct escFilter filter;
+  size_t length;
+
+  escFilterInit(&filter, ESCCHARSET_8BIT);
+  length = escFilterRun(&filter, buffer, first, strlen(first));
+  length += escFilterRun(&filter, buffer + length, second, strlen(second));
+  if (length != 6 || 0 != memcmp(buffer, "abcdef", 6)) {
+    buffer[length] = '\0';
+    printf("Bad filtered value: '%s'\n", buffer);
+    return false;
+  }
+  return true;
+}
+
+/*
+//  Two streams don't disturb each other: a sequence left open in one
+//  stream doesn't swallow the text of the other one.
+*/
+bool testEscFilterStreams(void) {
+  char const *open = "abc\x1b]0;window title";
+  char const *text = "plain\x1b[1m text";
+  char const *close = " continued\x07" "def";
+  char buffer[40];
+  struct escFilter first, second;
+  size_t length;
+
+  escFilterInit(&first, ESCCHARSET_8BIT);
+  escFilterInit(&second, ESCCHARSET_8BIT);
+  length = escFilterRun(&first, buffer, open, strlen(open));
+  if (length != 3 || 0 != memcmp(buffer, "abc", 3)) {
+    printf("Bad value of the first stream\n");
+    return false;
+  }
+  length = escFilterRun(&second, buffer, text, strlen(text));
+  if (length != 10 || 0 != memcmp(buffer, "plain text", 10)) {
+    buffer[length] = '\0';
+    printf("Bad value of the second stream: '%s'\n", buffer);
+    return false;
+  }
+  length = escFilterRun(&first, buffer, close, strlen(close));
+  if (length != 3 || 0 != memcmp(buffer, "def", 3)) {
+    buffer[length] = '\0';
+    printf("Bad value of the first stream: '%s'\n", buffer);
+    return false;
+  }
+  return true;
+}
+
+/*
+//  Differential test: random streams, mostly text with escape
+//  sequences and UTF-8 characters but also any other byte including
+//  NUL, cut into random pieces, must give what the reference state
+//  machine gives byte by byte.
+*/
+static bool compareWithReference(enum escCharset const charset) {
+  static char const * const pieces[] = {
+    "\x1b[", "\x1b]", "\x1bP", "\x1b(", "\x1b#", "\x1b\\", "\x9b", "\x9d",
+    "\x90", "\x07", "\r\n", "\t", "01;34m", "0;title", "K", "h", "\x18",
+    "\xc3\xbc", "\xe6\x97\xa5\xe6\x9c\xac", "\xc4\x9b", "\xc2\x9b", "\xc2\x9d",
+    "\xc2\xa0", "\xc2", "\xe6\x97", "\xf0\x9f\x98\x80", "\xed\xa0\x80"
+  };
+  char input[4096], expected[4200], actual[4200];
+  int level, round;
+
+  srand(2);
+  for (level = PLAINSCAN_NONE; level <= PLAINSCAN_AVX2; ++level) {
+    if (!plainScanSelect(level)) {
+      continue;
+    }
+    for (round = 0; round < 2000; ++round) {
+      struct escFilter filter;
+      enum escState state = Normal;
+      enum utf8Wait wait = UTF8_NONE;
+      size_t length = 0, expectedLength = 0, actualLength = 0, done, i;
+
+      while (length < sizeof(input) - 16) {
+        int const kind = rand() % 4;
+        if (kind == 0) {
+          char const *piece = pieces[rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+          memcpy(input + length, piece, strlen(piece));
+          length += strlen(piece);
+        } else if (kind == 1) {
+          input[length++] = (char)(rand() % 256);
+        } else {
+          input[length++] = (char)(0x20 + rand() % 0x5F);
+        }
+      }
+      for (i = 0; i < length; ++i) {
+        if (ESCCHARSET_UTF8 == charset) {
+          int const step = escReferenceStepUtf8(&state, &wait, input[i]);
+          if (step & ESCSTEP_HELD) {
+            expected[expectedLength++] = (char)0xC2;
+          }
+          if (step & ESCSTEP_KEPT) {
+            expected[expectedLength++] = input[i];
+          }
+        } else if (escReferenceStep(&state, input[i])) {
+          expected[expectedLength++] = input[i];
+        }
+      }
+      escFilterInit(&filter, charset);
+      for (done = 0; done < length; ) {
+        size_t piece = 1 + rand() % 64;
+        if (piece > length - done) {
+          piece = length - done;
+        }
+        actualLength += escFilterRun(&filter, actual + actualLength,
+                                     input + done, piece);
+        done += piece;
+      }
+      if (actualLength != expectedLength
+          || 0 != memcmp(actual, expected, actualLength)
+          || (ESCCHARSET_8BIT == charset && filter.state != state)) {
+        printf("level %d, round %d: filter and reference differ\n", level, round);
+        return false;
+      }
+    }
+  }
+  plainScanSelect(PLAINSCAN_NONE);
+  return true;
+}
+
+bool testEscFilterReference(void) {
+  return compareWithReference(ESCCHARSET_8BIT);
+}
+
+bool testEscFilterReferenceUtf8(void) {
+  return compareWithReference(ESCCHARSET_UTF8);
+}
+
+/*
+//  Umlauts and CJK have bytes in 0x80-0x9F, in UTF-8 they are kept.
+//  C1 controls count only in their encoded form, also when the C2 is
+//  the last byte of a read.
+*/
+bool testEscFilterUtf8(void) {
+  char const *input = "Gr\xc3\xbc\xc3\x9f" "e \xe6\x97\xa5\xe6\x9c\xac\xc4\x9b "
+    "\xc2\x9b" "1mbold\xc2\x9b" "0m \x9b" "x\xc2\xa0" "y";
+  char const *expected = "Gr\xc3\xbc\xc3\x9f" "e \xe6\x97\xa5\xe6\x9c\xac\xc4\x9b "
+    "bold x\xc2\xa0" "y";
+  char const *split = "ab\xc2";
+  char buffer[100];
+  int level;
+  size_t length;
+
+  for (level = PLAINSCAN_NONE; level <= PLAINSCAN_AVX2; ++level) {
+    struct escFilter filter;
+    if (!plainScanSelect(level)) {
+      continue;
+    }
+    escFilterInit(&filter, ESCCHARSET_UTF8);
+    length = escFilterRun(&filter, buffer, input, strlen(input));
+    if (length != strlen(expected) || 0 != memcmp(buffer, expected, length)) {
+      buffer[length] = '\0';
+      printf("level %d: bad filtered value: '%s'\n", level, buffer);
+      return false;
+    }
+    length = escFilterRun(&filter, buffer, split, strlen(split));
+    length += escFilterRun(&filter, buffer + length, "\xa9", 1);
+    if (length != 4 || 0 != memcmp(buffer, "ab\xc2\xa9", 4)) {
+      printf("level %d: split character not kept\n", level);
+      return false;
+    }
+  }
+  plainScanSelect(PLAINSCAN_NONE);
+  return true;
+}
+
+/*
+//  What plainSpanUtf8 skips must be whole characters, for every
+//  implementation the same.
+*/
+bool testPlainSpanUtf8(void) {
+  static char const * const pieces[] = {
+    "abc", "\xc3\xbc", "\xe6\x97\xa5", "\xf0\x9f\x98\x80", "\xc2\xa0",
+    "\xc2\x9b", "\xe6\x97", "\xed\xa0\x80", "\x80", "\x1b", "\t", "\x7f"
+  };
+  char buffer[300];
+  int level, round;
+  size_t expected[2000];
+
+  srand(3);
+  for (level = PLAINSCAN_SCALAR; level <= PLAINSCAN_AVX2; ++level) {
+    if (!plainScanSelect(level)) {
+      continue;
+    }
+    srand(3);
+    for (round = 0; round < 2000; ++round) {
+      size_t length = 0, actual;
+      while (length < sizeof(buffer) - 8 && rand() % 40 != 0) {
+        char const *piece = rand() % 3 ? pieces[rand() % 5]
+          : pieces[rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+        memcpy(buffer + length, piece, strlen(piece));
+        length += strlen(piece);
+      }
+      actual = plainSpanUtf8(buffer, length);
+      if (level == PLAINSCAN_SCALAR) {
+        expected[round] = actual;
+      } else if (expected[round] != actual) {
+        printf("level %d: span %lu instead of %lu\n", level,
+               (unsigned long)actual, (unsigned long)expected[round]);
+        return false;
+      }
+    }
+  }
+  plainScanSelect(PLAINSCAN_NONE);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int retval = 0;
+
+  printf("testPlainSpan:\n");
+  if(!testPlainSpan()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testEscFilter:\n");
+  if(!testEscFilter()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testEscFilterSplit:\n");
+  if(!testEscFilterSplit()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testEscFilterStreams:\n");
+  if(!testEscFilterStreams()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testEscFilterReference:\n");
+  if(!testEscFilterReference()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testEscFilterReferenceUtf8:\n");
+  if(!testEscFilterReferenceUtf8()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testEscFilterUtf8:\n");
+  if(!testEscFilterUtf8()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testPlainSpanUtf8:\n");
+  if(!testPlainSpanUtf8()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  return retval;
+}
@@ -0,0 +1,194 @@
+/*
+  Test for the journald sink against a socket standing in for the
+  native one.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "config.h"
+#include "journald.h"
+
+/* function declarations */
+bool testFields(void);
+bool testMemfd(void);
+
+/* implementations */
+
+static int journalFd = -1;
+static char journalPath[64];
+static char received[JOURNALDDATAGRAMSIZE + 4096];
+static size_t receivedLength;
+
+static bool openJournal(void) {
+  struct sockaddr_un address;
+
+  snprintf(journalPath, sizeof(journalPath), "/tmp/testJournald.%d", (int)getpid());
+  unlink(journalPath);
+  journalFd = socket(AF_UNIX, SOCK_DGRAM, 0);
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, journalPath);
+  if (journalFd < 0
+      || bind(journalFd, (struct sockaddr *)&address, sizeof(address)) < 0
+      || !journaldOpen(journalPath, "rootsh", 42, "rootsh[00042]", "user1234",
+                       "root", "/dev/pts/1")) {
+    printf("no socket\n");
+    return false;
+  }
+  return true;
+}
+
+static void closeJournal(void) {
+  journaldClose();
+  close(journalFd);
+  unlink(journalPath);
+}
+
+/*
+//  Take the next datagram, or the content of the memfd passed with it.
+*/
+static bool receive(void) {
+  struct msghdr header;
+  struct iovec vector;
+  union {
+    struct cmsghdr align;
+    char buffer[CMSG_SPACE(sizeof(int))];
+  } control;
+  struct cmsghdr *passed;
+  ssize_t length;
+
+  memset(&header, 0, sizeof(header));
+  vector.iov_base = received;
+  vector.iov_len = sizeof(received);
+  header.msg_iov = &vector;
+  header.msg_iovlen = 1;
+  header.msg_control = control.buffer;
+  header.msg_controllen = sizeof(control.buffer);
+  length = recvmsg(journalFd, &header, MSG_DONTWAIT);
+  if (length < 0) {
+    printf("no message\n");
+    return false;
+  }
+  receivedLength = length;
+  passed = CMSG_FIRSTHDR(&header);
+  if (NULL != passed && SCM_RIGHTS == passed->cmsg_type) {
+    int fd;
+    memcpy(&fd, CMSG_DATA(passed), sizeof(fd));
+    length = pread(fd, received, sizeof(received), 0);
+    close(fd);
+    if (length < 0) {
+      printf("memfd not readable\n");
+      return false;
+    }
+    receivedLength = length;
+  }
+  return true;
+}
+
+static bool contains(char const *expected, size_t const length) {
+  size_t offset;
+
+  for (offset = 0; offset + length <= receivedLength; ++offset) {
+    if (0 == memcmp(received + offset, expected, length)) {
+      return true;
+    }
+  }
+  printf("'%.*s' not in '%.*s'\n", (int)length, expected, (int)receivedLength, received);
+  return false;
+}
+
+#define CONTAINS(expected) contains(expected, sizeof(expected) - 1)
+
+/*
+//  The shared fields, the ones of the line and a message with a
+//  newline in the binary form. Without a number there is no SEQ.
+*/
+bool testFields(void) {
+  bool retval;
+
+  if (!openJournal()) {
+    return false;
+  }
+  journaldAdd(LOG_LOCAL5 | LOG_NOTICE, 7, "", "ls -l", 5);
+  journaldAdd(LOG_LOCAL5 | LOG_NOTICE, -1, "2+", "a\nb", 3);
+  journaldFlush();
+  retval = receive()
+    && CONTAINS("SYSLOG_IDENTIFIER=rootsh\nSYSLOG_PID=42\nROOTSH_SESSION=rootsh[00042]\n"
+                "ROOTSH_USER=user1234\nROOTSH_RUNAS=root\nTTY=/dev/pts/1\n")
+    && CONTAINS("\nPRIORITY=5\nSYSLOG_FACILITY=21\nSEQ=7\nMESSAGE=ls -l\n")
+    && receive()
+    && CONTAINS("\nSYSLOG_FACILITY=21\nROOTSH_FRAGMENT=2+\nMESSAGE\n\3\0\0\0\0\0\0\0a\nb\n");
+  closeJournal();
+  return retval;
+}
+
+/*
+//  A message too large for a datagram comes in a memfd.
+*/
+bool testMemfd(void) {
+  static char text[JOURNALDDATAGRAMSIZE];
+  bool retval;
+
+  if (!openJournal()) {
+    return false;
+  }
+  memset(text, 'x', sizeof(text));
+  journaldAdd(LOG_LOCAL5 | LOG_NOTICE, 1, "", "before", 6);
+  journaldAdd(LOG_LOCAL5 | LOG_NOTICE, 2, "", text, sizeof(text));
+  journaldAdd(LOG_LOCAL5 | LOG_NOTICE, 3, "", "after", 5);
+  journaldFlush();
+  retval = receive() && CONTAINS("SEQ=1\nMESSAGE=before\n")
+    && receive() && CONTAINS("TTY=/dev/pts/1\n") && CONTAINS("SEQ=2\nMESSAGE=xxxx")
+    && receivedLength > sizeof(text)
+    && receive() && CONTAINS("SEQ=3\nMESSAGE=after\n");
+  closeJournal();
+  return retval;
+}
+
+int main(int argc, char **argv) {
+  int retval = 0;
+
+  printf("testFields:\n");
+  if(!testFields()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+#if HAVE_MEMFD_CREATE
+  printf("testMemfd:\n");
+  if(!testMemfd()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+#endif
+
+  return retval;
+}
@@ -0,0 +1,442 @@
+/*
+  Test for the streaming compression of the session logfile.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#if HAVE_ZLIB_H && HAVE_LIBZ
+#  define USE_ZLIB 1
+#  include <zlib.h>
+#endif
+
+#include "logCompress.h"
+
+#define TOTAL 300000
+#define FRAMES 3
+#define START 1700000000000000ULL
+#define WRITE 1000
+
+/* function declarations */
+bool testFrames(void);
+bool testFooter(void);
+bool testAppend(void);
+bool testEmpty(void);
+
+/* implementations */
+
+#if USE_ZLIB
+/*
+//  Inflate all gzip members in compressed, like zcat does. Returns
+//  the length of the output, -1 if the data is broken or ends within
+//  a member.
+*/
+static long gunzip(unsigned char *compressed, size_t const length,
+                   unsigned char * const out, size_t const size) {
+  z_stream stream;
+  int result = Z_OK;
+
+  memset(&stream, 0, sizeof(stream));
+  if (Z_OK != inflateInit2(&stream, 15 + 32)) {
+    return -1;
+  }
+  stream.next_in = compressed;
+  stream.avail_in = length;
+  stream.next_out = out;
+  stream.avail_out = size;
+  while (stream.avail_in > 0) {
+    result = inflate(&stream, Z_NO_FLUSH);
+    if (Z_STREAM_END == result) {
+      inflateReset(&stream);
+    } else if (Z_OK != result) {
+      break;
+    }
+  }
+  inflateEnd(&stream);
+  return Z_STREAM_END == result ? (long)(size - stream.avail_out) : -1;
+}
+#endif
+
+/*
+//  Every frame is a gzip member of its own, the file cut after a
+//  frame still reads to its end.
+*/
+bool testFrames(void) {
+#if USE_ZLIB
+  static unsigned char data[TOTAL];
+  static unsigned char out[TOTAL];
+  char name[] = "/tmp/testLogCompressXXXXXX";
+  int const fd = mkstemp(name);
+  struct logCompress *compress;
+  unsigned char *file = NULL;
+  off_t frameEnd[FRAMES];
+  off_t fileSize;
+  bool retval = false;
+  size_t index;
+  int frame;
+
+  if (fd < 0) {
+    perror("mkstemp");
+    return false;
+  }
+  unlink(name);
+  for (index = 0; index < TOTAL; ++index) {
+    data[index] = (unsigned char)(index % 251 < 200 ? 'a' + index % 23 : index * 7);
+  }
+  if (NULL == (compress = logCompressOpen(fd, LOGCOMPRESSLEVEL, TOTAL))) {
+    perror("logCompressOpen");
+    goto cleanup;
+  }
+  for (frame = 0; frame < FRAMES; ++frame) {
+    struct iovec vector[2];
+    size_t const start = TOTAL / FRAMES * frame;
+    size_t const half = TOTAL / FRAMES / 2;
+
+    vector[0].iov_base = data + start;
+    vector[0].iov_len = half;
+    vector[1].iov_base = data + start + half;
+    vector[1].iov_len = TOTAL / FRAMES - half;
+    if (!logCompressWritev(compress, START, vector, 2) || !logCompressFrame(compress)) {
+      perror("logCompressWritev");
+      goto cleanup;
+    }
+    frameEnd[frame] = lseek(fd, 0, SEEK_END);
+  }
+  if (!logCompressClose(compress)) {
+    perror("logCompressClose");
+    goto cleanup;
+  }
+  fileSize = lseek(fd, 0, SEEK_END);
+  if (fileSize <= frameEnd[FRAMES - 1] || fileSize >= TOTAL / 2) {
+    printf("%ld bytes written for %d of data\n", (long)fileSize, TOTAL);
+    goto cleanup;
+  }
+  if (NULL == (file = malloc(fileSize))
+      || fileSize != pread(fd, file, fileSize, 0)) {
+    perror("read back");
+    goto cleanup;
+  }
+  for (frame = 0; frame < FRAMES; ++frame) {
+    long const length = gunzip(file, frameEnd[frame], out, sizeof(out));
+    if (length != (long)(TOTAL / FRAMES * (frame + 1)) || 0 != memcmp(out, data, length)) {
+      printf("%d frames decompress to %ld bytes\n", frame + 1, length);
+      goto cleanup;
+    }
+  }
+  /* the footer is read past */
+  if (gunzip(file, fileSize, out, sizeof(out)) != TOTAL) {
+    printf("the footer does not decompress to nothing\n");
+    goto cleanup;
+  }
+  if (gunzip(file, frameEnd[0] - 1, out, sizeof(out)) >= 0) {
+    printf("a frame cut short decompresses\n");
+    goto cleanup;
+  }
+  retval = true;
+
+cleanup:
+  free(file);
+  close(fd);
+  return retval;
+#else
+  return true;
+#endif
+}
+
+/*
+//  Small writes into small frames, every frame is found through the
+//  footer and decompresses on its own. Without the footer the frames
+//  are still read, all at once.
+*/
+bool testFooter(void) {
+#if USE_ZLIB
+  static unsigned char data[TOTAL];
+  static unsigned char out[TOTAL];
+  char name[] = "/tmp/testLogCompressXXXXXX";
+  int const fd = mkstemp(name);
+  struct logCompress *compress;
+  struct logCompressEntry *entries = NULL;
+  struct logCompressEntry *none = NULL;
+  unsigned char *file = NULL;
+  unsigned char *all = NULL;
+  unsigned long long total;
+  size_t count, length, index;
+  off_t fileSize, footerStart;
+  bool retval = false;
+
+  if (fd < 0) {
+    perror("mkstemp");
+    return false;
+  }
+  unlink(name);
+  for (index = 0; index < TOTAL; ++index) {
+    data[index] = (unsigned char)(index % 251 < 200 ? 'a' + index % 23 : index * 7);
+  }
+  if (NULL == (compress = logCompressOpen(fd, 1, 16384))) {
+    perror("logCompressOpen");
+    goto cleanup;
+  }
+  for (index = 0; index < TOTAL; index += WRITE) {
+    struct iovec vector;
+
+    vector.iov_base = data + index;
+    vector.iov_len = WRITE;
+    if (!logCompressWritev(compress, START + index, &vector, 1)) {
+      perror("logCompressWritev");
+      goto cleanup;
+    }
+  }
+  /* the footer needs the frame ended */
+  if (logCompressFooter(compress, fd)) {
+    printf("footer written within a frame\n");
+    goto cleanup;
+  }
+  if (!logCompressFrame(compress)) {
+    perror("logCompressFrame");
+    goto cleanup;
+  }
+  footerStart = lseek(fd, 0, SEEK_END);
+  if (!logCompressClose(compress)) {
+    perror("logCompressClose");
+    goto cleanup;
+  }
+  fileSize = lseek(fd, 0, SEEK_END);
+  if (NULL == (file = malloc(fileSize))
+      || fileSize != pread(fd, file, fileSize, 0)) {
+    perror("read back");
+    goto cleanup;
+  }
+  if (!logCompressReadFooter(file, fileSize, &entries, &count, &total)) {
+    perror("logCompressReadFooter");
+    goto cleanup;
+  }
+  if (TOTAL != total || count < TOTAL / 16384 - 1 || count > TOTAL / 16384 + 1) {
+    printf("footer has %lu frames for %llu bytes\n", (unsigned long)count, total);
+    goto cleanup;
+  }
+  for (index = 0; index < count; ++index) {
+    unsigned long long const end = index + 1 < count ? entries[index + 1].in : total;
+
+    /* frames end after the write that fills them */
+    if (0 != entries[index].in % WRITE || START + entries[index].in != entries[index].time
+        || end - entries[index].in < (index + 1 < count ? 16384 : 1)
+        || end - entries[index].in >= 16384 + WRITE
+        || entries[index].out >= (unsigned long long)footerStart
+        || !logCompressInflate(file + entries[index].out, fileSize - entries[index].out,
+                               out, end - entries[index].in)
+        || 0 != memcmp(out, data + entries[index].in, end - entries[index].in)) {
+      printf("frame %lu at %llu does not decompress\n", (unsigned long)index,
+             entries[index].in);
+      goto cleanup;
+    }
+  }
+  if (logCompressReadFooter(file, footerStart, &none, &count, &total) || ENOENT != errno) {
+    printf("a logfile without footer has one\n");
+    goto cleanup;
+  }
+  /* cut within the last frame */
+  if (NULL == (all = logCompressInflateAll(file, (entries[count - 1].out + footerStart) / 2,
+                                           &length))
+      || length >= TOTAL || length < entries[count - 1].in
+      || 0 != memcmp(all, data, length)) {
+    printf("a logfile cut short does not decompress\n");
+    goto cleanup;
+  }
+  retval = true;
+
+cleanup:
+  free(all);
+  free(entries);
+  free(file);
+  close(fd);
+  return retval;
+#else
+  return true;
+#endif
+}
+
+/*
+//  Frames compressed apart, out of order, and appended in order read
+//  like frames written through the stream.
+*/
+bool testAppend(void) {
+#if USE_ZLIB
+  static unsigned char data[TOTAL];
+  static unsigned char out[TOTAL];
+  char name[] = "/tmp/testLogCompressXXXXXX";
+  int const fd = mkstemp(name);
+  struct logCompress *compress = NULL;
+  struct logCompressEntry *entries = NULL;
+  unsigned char *frames[FRAMES] = {NULL};
+  size_t lengths[FRAMES];
+  unsigned char *file = NULL;
+  unsigned long long total;
+  size_t count, index;
+  off_t fileSize;
+  bool retval = false;
+  int frame;
+
+  if (fd < 0) {
+    perror("mkstemp");
+    return false;
+  }
+  unlink(name);
+  for (index = 0; index < TOTAL; ++index) {
+    data[index] = (unsigned char)(index % 251 < 200 ? 'a' + index % 23 : index * 7);
+  }
+  for (frame = FRAMES - 1; frame >= 0; --frame) {
+    if (NULL == (frames[frame] = logCompressDeflate(LOGCOMPRESSLEVEL,
+                                                    data + TOTAL / FRAMES * frame,
+                                                    TOTAL / FRAMES, &lengths[frame]))) {
+      perror("logCompressDeflate");
+      goto cleanup;
+    }
+  }
+  if (NULL == (compress = logCompressOpen(fd, LOGCOMPRESSLEVEL, LOGCOMPRESSFRAMESIZE))) {
+    perror("logCompressOpen");
+    goto cleanup;
+  }
+  for (frame = 0; frame < FRAMES; ++frame) {
+    if (!logCompressAppend(compress, START + frame, frames[frame], lengths[frame],
+                           TOTAL / FRAMES)) {
+      perror("logCompressAppend");
+      goto cleanup;
+    }
+  }
+  if (!logCompressClose(compress)) {
+    compress = NULL;
+    perror("logCompressClose");
+    goto cleanup;
+  }
+  compress = NULL;
+  fileSize = lseek(fd, 0, SEEK_END);
+  if (NULL == (file = malloc(fileSize))
+      || fileSize != pread(fd, file, fileSize, 0)) {
+    perror("read back");
+    goto cleanup;
+  }
+  if (gunzip(file, fileSize, out, sizeof(out)) != TOTAL || 0 != memcmp(out, data, TOTAL)) {
+    printf("appended frames do not decompress\n");
+    goto cleanup;
+  }
+  if (!logCompressReadFooter(file, fileSize, &entries, &count, &total)
+      || FRAMES != count || TOTAL != total) {
+    printf("footer of appended frames is wrong\n");
+    goto cleanup;
+  }
+  for (frame = 0; frame < FRAMES; ++frame) {
+    if (TOTAL / FRAMES * frame != entries[frame].in || START + frame != entries[frame].time
+        || !logCompressInflate(file + entries[frame].out, fileSize - entries[frame].out,
+                               out, TOTAL / FRAMES)
+        || 0 != memcmp(out, data + entries[frame].in, TOTAL / FRAMES)) {
+      printf("appended frame %d does not decompress\n", frame);
+      goto cleanup;
+    }
+  }
+  retval = true;
+
+cleanup:
+  if (NULL != compress) {
+    logCompressClose(compress);
+  }
+  for (frame = 0; frame < FRAMES; ++frame) {
+    free(frames[frame]);
+  }
+  free(entries);
+  free(file);
+  close(fd);
+  return retval;
+#else
+  return true;
+#endif
+}
+
+/*
+//  Ending a frame that got no data writes nothing but the footer.
+*/
+bool testEmpty(void) {
+#if USE_ZLIB
+  char name[] = "/tmp/testLogCompressXXXXXX";
+  int const fd = mkstemp(name);
+  struct logCompress *compress;
+  bool retval;
+
+  if (fd < 0) {
+    perror("mkstemp");
+    return false;
+  }
+  unlink(name);
+  if (NULL == (compress = logCompressOpen(fd, 1, LOGCOMPRESSFRAMESIZE))) {
+    perror("logCompressOpen");
+    close(fd);
+    return false;
+  }
+  retval = logCompressFrame(compress) && 0 == lseek(fd, 0, SEEK_END)
+    && logCompressClose(compress);
+  close(fd);
+  return retval && NULL == logCompressOpen(fd, 10, LOGCOMPRESSFRAMESIZE)
+    && NULL == logCompressOpen(fd, 1, 0);
+#else
+  return true;
+#endif
+}
+
+int main(int argc, char **argv) {
+  int retval = 0;
+
+  printf("testFrames:\n");
+  if(!testFrames()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testFooter:\n");
+  if(!testFooter()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testAppend:\n");
+  if(!testAppend()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testEmpty:\n");
+  if(!testEmpty()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  return retval;
+}
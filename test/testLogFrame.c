@@ -0,0 +1,236 @@
+/*
+  Test for the framed logfile format and its time index.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "logFrame.h"
+
+#define START 1700000000000000ULL
+#define RECORDS 1000
+
+/* function declarations */
+bool testHeader(void);
+bool testSeek(void);
+
+/* implementations */
+
+/*
+//  Headers decode to what was encoded, cut short they ask for more.
+*/
+bool testHeader(void) {
+  static unsigned long long const values[] = {
+    0, 1, 127, 128, 300, 16383, 16384, 1ULL << 35, ~0ULL
+  };
+  unsigned char header[LOGFRAMEMAXRECORDHEADER];
+  unsigned char broken[12];
+  size_t i;
+
+  for (i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+    unsigned long long delta, length;
+    enum logStream stream;
+    size_t const size = logFrameEncode(header, values[i], LOGSTREAM_ERR,
+                                       values[sizeof(values) / sizeof(values[0]) - 1 - i]);
+    size_t cut;
+
+    if (size > LOGFRAMEMAXRECORDHEADER
+        || (ssize_t)size != logFrameDecode(header, size, &delta, &stream, &length)
+        || values[i] != delta || LOGSTREAM_ERR != stream
+        || values[sizeof(values) / sizeof(values[0]) - 1 - i] != length) {
+      printf("header of %llu does not decode\n", values[i]);
+      return false;
+    }
+    for (cut = 0; cut < size; ++cut) {
+      if (0 != logFrameDecode(header, cut, &delta, &stream, &length)) {
+        printf("header of %llu cut to %lu does not ask for more\n", values[i],
+               (unsigned long)cut);
+        return false;
+      }
+    }
+  }
+  memset(broken, 0xff, sizeof(broken));
+  {
+    unsigned long long delta, length;
+    enum logStream stream;
+
+    if (-1 != logFrameDecode(broken, sizeof(broken), &delta, &stream, &length)) {
+      printf("endless varint accepted\n");
+      return false;
+    }
+    broken[0] = 1;
+    broken[1] = LOGSTREAM_META + 1;
+    if (-1 != logFrameDecode(broken, sizeof(broken), &delta, &stream, &length)) {
+      printf("unknown stream accepted\n");
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+//  Write records a millisecond apart, find some of them through the
+//  index and read on from there.
+*/
+bool testSeek(void) {
+  char logName[] = "/tmp/testLogFrameXXXXXX";
+  char indexName[] = "/tmp/testLogFrameIdxXXXXXX";
+  int const fd = mkstemp(logName);
+  int const indexFd = mkstemp(indexName);
+  struct logFrame frame;
+  unsigned char *file = NULL;
+  off_t fileSize;
+  bool retval = false;
+  int i;
+
+  if (fd < 0 || indexFd < 0) {
+    perror("mkstemp");
+    return false;
+  }
+  unlink(logName);
+  unlink(indexName);
+  if (!logFrameOpen(&frame, fd, NULL, indexFd, START, 1024)) {
+    perror("logFrameOpen");
+    goto cleanup;
+  }
+  for (i = 0; i < RECORDS; ++i) {
+    char data[64];
+    int const length = snprintf(data, sizeof(data), "record %d\r\n", i);
+    if (logFrameWrite(&frame, i % 2 ? LOGSTREAM_OUT : LOGSTREAM_IN,
+                      START + 1000ULL * (i + 1), data, length) < 0) {
+      perror("logFrameWrite");
+      goto cleanup;
+    }
+  }
+  fileSize = lseek(fd, 0, SEEK_END);
+  if (NULL == (file = malloc(fileSize))
+      || fileSize != pread(fd, file, fileSize, 0)) {
+    perror("read back");
+    goto cleanup;
+  }
+  {
+    unsigned long long start;
+    if (!logFrameStart(file, LOGFRAMEMAGIC, &start) || START != start) {
+      printf("bad file header\n");
+      goto cleanup;
+    }
+  }
+  for (i = -1; i <= RECORDS; i += 97) {
+    unsigned long long const wanted = START + 1000ULL * (i + 1);
+    unsigned long long offset, time;
+    int found;
+
+    if (!logFrameSeek(indexFd, wanted, &offset, &time)) {
+      perror("logFrameSeek");
+      goto cleanup;
+    }
+    /* before the first record the first one is found */
+    if ((i >= 0 && time > wanted) || offset >= (unsigned long long)fileSize
+        || (i > 0 && wanted - time > 100 * 1000ULL)) {
+      printf("seek to %d found %llu at %llu\n", i, time, offset);
+      goto cleanup;
+    }
+    /*
+    //  The record at offset has the time of the entry, not its delta.
+    */
+    found = -1;
+    while (offset < (unsigned long long)fileSize) {
+      unsigned long long delta, length;
+      enum logStream stream;
+      ssize_t const size = logFrameDecode(file + offset, fileSize - offset,
+                                          &delta, &stream, &length);
+      char expected[64];
+
+      if (size <= 0) {
+        printf("broken record at %llu\n", offset);
+        goto cleanup;
+      }
+      if (found >= 0) {
+        time += delta;
+      }
+      found = (int)((time - START) / 1000) - 1;
+      snprintf(expected, sizeof(expected), "record %d\r\n", found);
+      if (length != strlen(expected)
+          || 0 != memcmp(file + offset + size, expected, length)
+          || (found % 2 ? LOGSTREAM_OUT : LOGSTREAM_IN) != stream) {
+        printf("record at %llu is not %d\n", offset, found);
+        goto cleanup;
+      }
+      if (time >= wanted) {
+        break;
+      }
+      offset += size + length;
+    }
+    if (i >= 0 && i < RECORDS && found != i) {
+      printf("seek to %d ended at %d\n", i, found);
+      goto cleanup;
+    }
+  }
+  /*
+  //  By offset the entry is at most an interval and a record before.
+  */
+  for (i = LOGFRAMEHEADERSIZE; i < fileSize; i += 1021) {
+    unsigned long long offset, time, delta, length;
+    enum logStream stream;
+
+    if (!logFrameSeekOffset(indexFd, i, &offset, &time)) {
+      perror("logFrameSeekOffset");
+      goto cleanup;
+    }
+    if (offset > (unsigned long long)i || offset + 1024 + 64 < (unsigned long long)i
+        || logFrameDecode(file + offset, fileSize - offset, &delta, &stream, &length) <= 0
+        || (int)((time - START) / 1000) - 1 < 0) {
+      printf("seek to offset %d found %llu\n", i, offset);
+      goto cleanup;
+    }
+  }
+  retval = true;
+
+cleanup:
+  free(file);
+  close(fd);
+  close(indexFd);
+  return retval;
+}
+
+int main(int argc, char **argv) {
+  int retval = 0;
+
+  printf("testHeader:\n");
+  if(!testHeader()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testSeek:\n");
+  if(!testSeek()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  return retval;
+}
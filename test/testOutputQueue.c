@@ -0,0 +1,303 @@
+/*
+  Test for the ring buffer between the two sides of the relay.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+/* F_SETPIPE_SZ is a GNU extension */
+#define _GNU_SOURCE 1
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "outputQueue.h"
+
+/* function declarations */
+bool testWrap(void);
+bool testHeadReset(void);
+bool testBrokenPipe(void);
+
+/* implementations */
+
+/*
+//  The queue writes to fds[1], the test reads what arrived from
+//  fds[0]. Both ends are non-blocking and the pipe holds pipeSize
+//  bytes, so a flush of more than that makes partial progress.
+*/
+static int fds[2] = {-1, -1};
+static size_t pipeSize;
+static char *output;
+static size_t outputLength;
+
+static bool openPipe(void) {
+  int size = 0;
+
+  if (0 != pipe(fds)) {
+    perror("pipe");
+    return false;
+  }
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+  fcntl(fds[1], F_SETFL, O_NONBLOCK);
+#ifdef F_SETPIPE_SZ
+  size = fcntl(fds[1], F_SETPIPE_SZ, 4096);
+#endif
+  if (size <= 0) {
+    perror("F_SETPIPE_SZ");
+    return false;
+  }
+  pipeSize = (size_t)size;
+  outputLength = 0;
+  return NULL != (output = malloc(4 * pipeSize));
+}
+
+static void closePipe(void) {
+  if (fds[0] >= 0) {
+    close(fds[0]);
+  }
+  if (fds[1] >= 0) {
+    close(fds[1]);
+  }
+  fds[0] = fds[1] = -1;
+  free(output);
+  output = NULL;
+}
+
+/*
+//  Read everything the pipe holds into output.
+*/
+static void drain(void) {
+  ssize_t n;
+
+  while ((n = read(fds[0], output + outputLength, pipeSize)) > 0) {
+    outputLength += (size_t)n;
+  }
+}
+
+/*
+//  Bytes of a stream no two pieces of which look alike.
+*/
+static void fill(char * const data, size_t const offset, size_t const length) {
+  size_t index;
+
+  for (index = 0; index < length; ++index) {
+    data[index] = (char)((offset + index) % 251);
+  }
+}
+
+static bool sameAsStream(char const * const data, size_t const length) {
+  size_t index;
+
+  for (index = 0; index < length; ++index) {
+    if ((char)(index % 251) != data[index]) {
+      printf("byte %lu differs\n", (unsigned long)index);
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+//  Data appended behind a partly flushed queue wraps around the end,
+//  the flush writes both pieces with one writev and keeps track of
+//  how much the pipe took.
+*/
+bool testWrap(void) {
+  struct outputQueue queue;
+  char *input = NULL;
+  size_t capacity, appended, taken;
+  bool wrappedPartial = false;
+  bool retval = false;
+  int flushes;
+
+  if (!openPipe()) {
+    closePipe();
+    return false;
+  }
+  capacity = 3 * pipeSize;
+  if (!outputQueueInit(&queue, capacity) || NULL == (input = malloc(capacity))) {
+    printf("no memory\n");
+    goto cleanup;
+  }
+  fill(input, 0, 2 * pipeSize);
+  appended = outputQueueAppend(&queue, input, 2 * pipeSize);
+  if (!outputQueueFlush(&queue, fds[1]) || 0 == queue.head || outputQueueEmpty(&queue)) {
+    printf("first flush took everything or nothing\n");
+    goto cleanup;
+  }
+  drain();
+
+  /* fill the queue up to the end and over it */
+  fill(input, appended, capacity);
+  taken = outputQueueAppend(&queue, input, capacity);
+  appended += taken;
+  if (0 != outputQueueSpace(&queue) || queue.head + queue.length <= capacity) {
+    printf("append did not wrap, head %lu, length %lu\n",
+           (unsigned long)queue.head, (unsigned long)queue.length);
+    goto cleanup;
+  }
+  if (0 != outputQueueAppend(&queue, input, 1)) {
+    printf("a full queue took more\n");
+    goto cleanup;
+  }
+  if (0 != memcmp(queue.data, input + taken - queue.head, queue.head)) {
+    printf("wrapped data is not at the start\n");
+    goto cleanup;
+  }
+
+  for (flushes = 0; !outputQueueEmpty(&queue) && flushes < 16; ++flushes) {
+    bool const wrapped = queue.head + queue.length > capacity;
+    size_t const before = queue.length;
+
+    if (!outputQueueFlush(&queue, fds[1])) {
+      perror("outputQueueFlush");
+      goto cleanup;
+    }
+    wrappedPartial = wrappedPartial
+        || (wrapped && queue.length < before && !outputQueueEmpty(&queue));
+    drain();
+  }
+  if (!outputQueueEmpty(&queue) || !wrappedPartial) {
+    printf("%lu bytes left, partial write of a wrapped queue %sseen\n",
+           (unsigned long)queue.length, wrappedPartial ? "" : "not ");
+    goto cleanup;
+  }
+  if (appended != outputLength) {
+    printf("%lu bytes appended, %lu arrived\n", (unsigned long)appended,
+           (unsigned long)outputLength);
+    goto cleanup;
+  }
+  retval = sameAsStream(output, outputLength);
+
+cleanup:
+  free(input);
+  outputQueueFree(&queue);
+  closePipe();
+  return retval;
+}
+
+/*
+//  Once everything is written the queue starts over at the front, so
+//  the next append is in one piece again.
+*/
+bool testHeadReset(void) {
+  struct outputQueue queue;
+  char *input = NULL;
+  size_t capacity;
+  bool retval = false;
+
+  if (!openPipe()) {
+    closePipe();
+    return false;
+  }
+  capacity = 2 * pipeSize;
+  if (!outputQueueInit(&queue, capacity) || NULL == (input = malloc(capacity))) {
+    printf("no memory\n");
+    goto cleanup;
+  }
+  fill(input, 0, pipeSize / 2);
+  outputQueueAppend(&queue, input, pipeSize / 2);
+  if (!outputQueueFlush(&queue, fds[1]) || !outputQueueEmpty(&queue) || 0 != queue.head) {
+    printf("head %lu after a complete flush\n", (unsigned long)queue.head);
+    goto cleanup;
+  }
+  drain();
+  fill(input, pipeSize / 2, capacity);
+  if (capacity != outputQueueAppend(&queue, input, capacity)
+      || 0 != memcmp(queue.data, input, capacity)) {
+    printf("the whole queue is not free in one piece\n");
+    goto cleanup;
+  }
+  while (!outputQueueEmpty(&queue)) {
+    if (!outputQueueFlush(&queue, fds[1])) {
+      perror("outputQueueFlush");
+      goto cleanup;
+    }
+    drain();
+  }
+  retval = pipeSize / 2 + capacity == outputLength && 0 == queue.head
+      && sameAsStream(output, outputLength);
+
+cleanup:
+  free(input);
+  outputQueueFree(&queue);
+  closePipe();
+  return retval;
+}
+
+/*
+//  Only a full pipe is no error, a pipe without a reader is.
+*/
+bool testBrokenPipe(void) {
+  struct outputQueue queue;
+  bool retval;
+
+  if (!openPipe() || !outputQueueInit(&queue, 16)) {
+    closePipe();
+    return false;
+  }
+  signal(SIGPIPE, SIG_IGN);
+  close(fds[0]);
+  fds[0] = -1;
+  outputQueueAppend(&queue, "gone", 4);
+  retval = !outputQueueFlush(&queue, fds[1]) && EPIPE == errno;
+  if (!retval) {
+    printf("flush to a closed pipe did not fail\n");
+  }
+  outputQueueClear(&queue);
+  retval = retval && outputQueueEmpty(&queue) && 16 == outputQueueSpace(&queue);
+  outputQueueFree(&queue);
+  closePipe();
+  return retval;
+}
+
+int main(int argc, char **argv) {
+  int retval = 0;
+
+  printf("testWrap:\n");
+  if(!testWrap()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testHeadReset:\n");
+  if(!testHeadReset()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testBrokenPipe:\n");
+  if(!testBrokenPipe()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  return retval;
+}
@@ -0,0 +1,124 @@
+/*
+  Test for finding the gaps in the sequence numbers of a session.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "seqGaps.h"
+
+/* function declarations */
+bool testGaps(void);
+bool testLate(void);
+
+/* implementations */
+
+static bool checkGaps(struct seqGaps const *gaps, size_t const count,
+                      unsigned long long const *ranges) {
+  size_t index;
+
+  if (gaps->count != count) {
+    printf("%lu gaps instead of %lu\n", (unsigned long)gaps->count, (unsigned long)count);
+    return false;
+  }
+  for (index = 0; index < count; ++index) {
+    if (gaps->gaps[index].from != ranges[2 * index]
+        || gaps->gaps[index].to != ranges[2 * index + 1]) {
+      printf("gap %lu is %llu-%llu instead of %llu-%llu\n", (unsigned long)index,
+             gaps->gaps[index].from, gaps->gaps[index].to,
+             ranges[2 * index], ranges[2 * index + 1]);
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+//  Lost numbers at the start, in between and at the end.
+*/
+bool testGaps(void) {
+  static unsigned long long const ranges[] = {0, 1, 3, 3, 5, 9, 12, 14};
+  struct seqGaps gaps;
+  bool retval;
+
+  seqGapsInit(&gaps);
+  retval = SEQGAPS_INORDER == seqGapsAdd(&gaps, 2)
+    && SEQGAPS_INORDER == seqGapsAdd(&gaps, 4)
+    && SEQGAPS_INORDER == seqGapsAdd(&gaps, 10)
+    && SEQGAPS_INORDER == seqGapsAdd(&gaps, 11)
+    && seqGapsEnd(&gaps, 15)
+    && checkGaps(&gaps, 4, ranges)
+    && 4 == gaps.received && 11 == seqGapsLost(&gaps)
+    && 5 == seqGapsLongest(&gaps);
+  seqGapsFree(&gaps);
+  return retval;
+}
+
+/*
+//  Late numbers close gaps, numbers seen before are duplicates.
+*/
+bool testLate(void) {
+  static unsigned long long const ranges[] = {0, 0, 2, 2, 6, 7};
+  struct seqGaps gaps;
+  bool retval;
+
+  seqGapsInit(&gaps);
+  retval = SEQGAPS_INORDER == seqGapsAdd(&gaps, 9)
+    && SEQGAPS_LATE == seqGapsAdd(&gaps, 5)
+    && SEQGAPS_LATE == seqGapsAdd(&gaps, 1)
+    && SEQGAPS_LATE == seqGapsAdd(&gaps, 8)
+    && SEQGAPS_LATE == seqGapsAdd(&gaps, 3)
+    && SEQGAPS_LATE == seqGapsAdd(&gaps, 4)
+    && SEQGAPS_DUPLICATE == seqGapsAdd(&gaps, 4)
+    && SEQGAPS_DUPLICATE == seqGapsAdd(&gaps, 9)
+    && checkGaps(&gaps, 3, ranges)
+    && 6 == gaps.received && 5 == gaps.late && 2 == gaps.duplicates
+    && 4 == seqGapsLost(&gaps)
+    && SEQGAPS_LATE == seqGapsAdd(&gaps, 0)
+    && SEQGAPS_LATE == seqGapsAdd(&gaps, 2)
+    && SEQGAPS_LATE == seqGapsAdd(&gaps, 7)
+    && SEQGAPS_LATE == seqGapsAdd(&gaps, 6)
+    && 0 == gaps.count && 0 == seqGapsLost(&gaps);
+  seqGapsFree(&gaps);
+  return retval;
+}
+
+int main(int argc, char **argv) {
+  int retval = 0;
+
+  printf("testGaps:\n");
+  if(!testGaps()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testLate:\n");
+  if(!testLate()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  return retval;
+}
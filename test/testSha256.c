@@ -0,0 +1,99 @@
+/*
+  Test for the SHA-256 hash with the examples of FIPS 180-4.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "sha256.h"
+
+/* function declarations */
+bool testVectors(void);
+bool testPieces(void);
+
+/* implementations */
+
+static bool check(struct sha256 *hash, char const *expected) {
+  char hex[SHA256HEXSIZE];
+
+  sha256Hex(hash, hex);
+  if (0 != strcmp(hex, expected)) {
+    printf("%s instead of %s\n", hex, expected);
+    return false;
+  }
+  return true;
+}
+
+static bool checkString(char const *data, char const *expected) {
+  struct sha256 hash;
+
+  sha256Init(&hash);
+  sha256Update(&hash, data, strlen(data));
+  return check(&hash, expected);
+}
+
+bool testVectors(void) {
+  return checkString("", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855")
+    && checkString("abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad")
+    && checkString("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+                   "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+/*
+//  A million a's in pieces which don't fit the blocks.
+*/
+bool testPieces(void) {
+  char data[997];
+  struct sha256 hash;
+  size_t left = 1000000;
+
+  memset(data, 'a', sizeof(data));
+  sha256Init(&hash);
+  while (left > 0) {
+    size_t const piece = left < sizeof(data) ? left : sizeof(data);
+    sha256Update(&hash, data, piece);
+    left -= piece;
+  }
+  return check(&hash, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+int main(int argc, char **argv) {
+  int retval = 0;
+
+  printf("testVectors:\n");
+  if(!testVectors()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testPieces:\n");
+  if(!testPieces()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  return retval;
+}
@@ -0,0 +1,237 @@
+/*
+  Test for the registry of log sinks and their threads.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#if HAVE_PTHREAD_H && HAVE_STDATOMIC_H && HAVE_PTHREAD_CREATE
+#  define USE_LOGQUEUE 1
+#  include <stdatomic.h>
+#endif
+
+#include "sink.h"
+
+#define TOTAL 65536
+#define PIECE 1000
+
+/* function declarations */
+bool testInline(void);
+bool testStalled(void);
+
+/* implementations */
+
+/*
+//  What the sinks got. The fast sink counts atomically, the test
+//  watches it while the thread writes.
+*/
+static char fastData[TOTAL];
+static char slowData[TOTAL];
+static size_t slowLength;
+static int opened, closed;
+static bool wrongStream;
+#if USE_LOGQUEUE
+static atomic_size_t fastLength;
+static atomic_bool slowReleased;
+#else
+static size_t fastLength;
+static bool slowReleased;
+#endif
+
+static bool openSink(void) {
+  ++opened;
+  return true;
+}
+
+static void closeSink(void) {
+  ++closed;
+}
+
+static void sleepMs(long const ms) {
+  struct timespec pause;
+
+  pause.tv_sec = ms / 1000;
+  pause.tv_nsec = (ms % 1000) * 1000000L;
+  nanosleep(&pause, NULL);
+}
+
+static void writeFast(struct sinkBatchEntry const *batch, int count) {
+  size_t length = fastLength;
+  int i;
+
+  for (i = 0; i < count; ++i) {
+    wrongStream = wrongStream || LOGSTREAM_OUT != batch[i].record.stream;
+    memcpy(fastData + length, batch[i].data, batch[i].length);
+    length += batch[i].length;
+  }
+  fastLength = length;
+}
+
+/*
+//  Hangs like a syslog daemon that doesn't answer until the test
+//  releases it.
+*/
+static void writeSlow(struct sinkBatchEntry const *batch, int count) {
+  int i;
+
+  while (!slowReleased) {
+    sleepMs(1);
+  }
+  for (i = 0; i < count; ++i) {
+    wrongStream = wrongStream || LOGSTREAM_OUT != batch[i].record.stream;
+    memcpy(slowData + slowLength, batch[i].data, batch[i].length);
+    slowLength += batch[i].length;
+  }
+}
+
+static void fill(char * const data) {
+  size_t index;
+
+  for (index = 0; index < TOTAL; ++index) {
+    data[index] = (char)('a' + index % 26);
+  }
+}
+
+/*
+//  Without a queue the sinks are written before sinkPush returns.
+*/
+bool testInline(void) {
+  static struct sink fast = {
+    .name = "fast", .open = openSink, .write = writeFast, .close = closeSink
+  };
+  char data[] = "inline";
+
+  fastLength = 0;
+  opened = closed = 0;
+  sinkRegister(&fast);
+  if (!sinkOpenAll() || 1 != opened) {
+    printf("sink not opened\n");
+    return false;
+  }
+  sinkStartAll("/tmp/testSink");
+  sinkPushAll(LOGSTREAM_OUT, data, strlen(data));
+  if (fastLength != strlen(data) || 0 != memcmp(fastData, data, strlen(data))) {
+    printf("inline write missing\n");
+    return false;
+  }
+  sinkCloseAll();
+  if (1 != closed || 1 != fast.stats.writes || 1 != fast.stats.records
+      || strlen(data) != fast.stats.bytes) {
+    printf("%d closed, %llu writes of %llu records, %llu bytes\n", closed,
+           fast.stats.writes, fast.stats.records, fast.stats.bytes);
+    return false;
+  }
+  return NULL == sinkFirst();
+}
+
+/*
+//  A sink that hangs spills and doesn't hold up the other one.
+*/
+bool testStalled(void) {
+#if USE_LOGQUEUE
+  static struct sink fast = {
+    .name = "fast", .write = writeFast, .queueSize = 4096,
+    .queueFull = LOGQUEUE_BLOCK
+  };
+  static struct sink slow = {
+    .name = "slow", .write = writeSlow, .close = closeSink,
+    .queueSize = 4096, .queueFull = LOGQUEUE_SPILL
+  };
+  static char data[TOTAL];
+  size_t offset;
+  int waited;
+
+  fill(data);
+  fastLength = 0;
+  slowLength = 0;
+  slowReleased = false;
+  closed = 0;
+  sinkRegister(&slow);
+  sinkRegister(&fast);
+  sinkStartAll("/tmp/testSink");
+  for (offset = 0; offset < TOTAL; offset += PIECE) {
+    sinkPushAll(LOGSTREAM_OUT, data + offset,
+                TOTAL - offset < PIECE ? TOTAL - offset : PIECE);
+  }
+  for (waited = 0; fastLength < TOTAL && waited < 5000; ++waited) {
+    sleepMs(1);
+  }
+  if (fastLength != TOTAL || 0 != memcmp(fastData, data, TOTAL)) {
+    printf("fast sink got %lu bytes while the slow one hangs\n",
+           (unsigned long)fastLength);
+    slowReleased = true;
+    sinkCloseAll();
+    return false;
+  }
+  slowReleased = true;
+  sinkCloseAll();
+  if (1 != closed || slowLength != TOTAL || 0 != memcmp(slowData, data, TOTAL)) {
+    printf("slow sink got %lu bytes\n", (unsigned long)slowLength);
+    return false;
+  }
+  if (wrongStream) {
+    printf("records lost their stream\n");
+    return false;
+  }
+  if (0 == slow.stats.spilled || 0 != slow.stats.blocked
+      || TOTAL != slow.stats.bytes || TOTAL != fast.stats.bytes) {
+    printf("slow: %llu spilled, %llu blocked, %llu bytes, fast: %llu bytes\n",
+           slow.stats.spilled, slow.stats.blocked, slow.stats.bytes,
+           fast.stats.bytes);
+    return false;
+  }
+  /*
+  //  What piled up while the slow sink hung goes out in batches.
+  */
+  if ((TOTAL + PIECE - 1) / PIECE != slow.stats.records
+      || slow.stats.writes >= slow.stats.records) {
+    printf("slow: %llu records in %llu writes\n", slow.stats.records,
+           slow.stats.writes);
+    return false;
+  }
+#endif
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int retval = 0;
+
+  printf("testInline:\n");
+  if(!testInline()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testStalled:\n");
+  if(!testStalled()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  return retval;
+}
@@ -0,0 +1,278 @@
+/*
+  Test for the syslog client.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "syslogClient.h"
+
+/* function declarations */
+bool testRfc3164(void);
+bool testRfc5424(void);
+bool testBatch(void);
+bool testSpool(void);
+
+/* implementations */
+
+/*
+//  A datagram socket in /tmp standing in for /dev/log.
+*/
+static int daemonSocket(char *path, size_t size) {
+  struct sockaddr_un address;
+  int fd;
+
+  snprintf(path, size, "/tmp/testSyslogClient.%d", (int)getpid());
+  unlink(path);
+  fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+  if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static bool receive(int const fd, char *message, size_t const size) {
+  ssize_t const length = recv(fd, message, size - 1, MSG_DONTWAIT);
+  if (length < 0) {
+    printf("no message\n");
+    return false;
+  }
+  message[length] = '\0';
+  return true;
+}
+
+static bool endsWith(char const *message, char const *expected) {
+  size_t const length = strlen(message);
+  if (length < strlen(expected)
+      || 0 != strcmp(message + length - strlen(expected), expected)) {
+    printf("Bad message: '%s'\n", message);
+    return false;
+  }
+  return true;
+}
+
+bool testRfc3164(void) {
+  char path[64], message[256];
+  int const fd = daemonSocket(path, sizeof(path));
+  bool retval = false;
+
+  if (fd < 0 || !syslogClientOpen(path, SYSLOGFORMAT_RFC3164, "rootsh", 42, "root")) {
+    printf("no socket\n");
+  } else {
+    syslogClientAdd(LOG_LOCAL5 | LOG_NOTICE, "007: ", "ls -l", 5);
+    syslogClientFlush();
+    /*
+    //  <173>Oct 17 07:36:00 rootsh[00042]: root: 007: ls -l
+    */
+    retval = receive(fd, message, sizeof(message))
+      && 0 == strncmp(message, "<173>", 5)
+      && ' ' == message[8] && ':' == message[14] && ' ' == message[20]
+      && endsWith(message, " rootsh[00042]: root: 007: ls -l");
+  }
+  syslogClientClose();
+  close(fd);
+  unlink(path);
+  return retval;
+}
+
+bool testRfc5424(void) {
+  char path[64], message[256];
+  int const fd = daemonSocket(path, sizeof(path));
+  bool retval = false;
+
+  if (fd < 0 || !syslogClientOpen(path, SYSLOGFORMAT_RFC5424, "rootsh", 42, NULL)) {
+    printf("no socket\n");
+  } else {
+    syslogClientAdd(LOG_LOCAL5 | LOG_NOTICE, "", "closing rootsh session", 22);
+    syslogClientFlush();
+    /*
+    //  <173>1 2026-10-17T07:36:00+02:00 host rootsh 42 - - closing ...
+    */
+    retval = receive(fd, message, sizeof(message))
+      && 0 == strncmp(message, "<173>1 ", 7)
+      && '-' == message[11] && 'T' == message[17] && ':' == message[29]
+      && endsWith(message, " rootsh 42 - - closing rootsh session");
+  }
+  syslogClientClose();
+  close(fd);
+  unlink(path);
+  return retval;
+}
+
+/*
+//  Nothing is sent before the flush, then all messages arrive in
+//  order. The socket queue of the test daemon holds only ten
+//  datagrams (net.unix.max_dgram_qlen), so the batches stay small.
+*/
+bool testBatch(void) {
+  char path[64], message[256], expected[32];
+  int const fd = daemonSocket(path, sizeof(path));
+  bool retval = true;
+  int i, j;
+
+  if (fd < 0 || !syslogClientOpen(path, SYSLOGFORMAT_RFC3164, "rootsh", 42, NULL)) {
+    printf("no socket\n");
+    retval = false;
+  }
+  for (i = 0; i < 40 && retval; i += 8) {
+    for (j = i; j < i + 8; ++j) {
+      snprintf(expected, sizeof(expected), "line %d", j);
+      syslogClientAdd(LOG_LOCAL5 | LOG_NOTICE, "", expected, strlen(expected));
+    }
+    if (recv(fd, message, sizeof(message), MSG_DONTWAIT) >= 0) {
+      printf("message before the flush\n");
+      retval = false;
+    }
+    syslogClientFlush();
+    for (j = i; j < i + 8 && retval; ++j) {
+      snprintf(expected, sizeof(expected), ": line %d", j);
+      retval = receive(fd, message, sizeof(message)) && endsWith(message, expected);
+    }
+  }
+  syslogClientClose();
+  if (fd >= 0) {
+    close(fd);
+  }
+  unlink(path);
+  return retval;
+}
+
+/*
+//  What the daemon doesn't take goes to the spool and arrives later
+//  in order: first the daemon is slow (its queue holds ten
+//  datagrams), then it is restarted. A full spool drops messages.
+*/
+bool testSpool(void) {
+  char path[64], spool[64], message[256], expected[32];
+  int fd = daemonSocket(path, sizeof(path));
+  unsigned long long spooled, dropped;
+  bool retval = true;
+  int i;
+
+  snprintf(spool, sizeof(spool), "/tmp/testSyslogClient.%d.spool", (int)getpid());
+  if (fd < 0 || !syslogClientOpen(path, SYSLOGFORMAT_RFC3164, "rootsh", 42, NULL)
+      || !syslogClientSpool(spool, 1200)) {
+    printf("no socket\n");
+    retval = false;
+  }
+  for (i = 0; i < 15 && retval; ++i) {
+    snprintf(expected, sizeof(expected), "line %d", i);
+    syslogClientAdd(LOG_LOCAL5 | LOG_NOTICE, "", expected, strlen(expected));
+    syslogClientFlush();
+  }
+  syslogClientSpoolCounts(&spooled, &dropped);
+  if (retval && (spooled < 3 || 0 != dropped || 0 != access(spool, F_OK))) {
+    printf("%llu spooled, %llu dropped\n", spooled, dropped);
+    retval = false;
+  }
+  for (i = 0; i < 15 && retval; ++i) {
+    snprintf(expected, sizeof(expected), ": line %d", i);
+    if (i % 5 == 0) {
+      syslogClientFlush();
+    }
+    retval = receive(fd, message, sizeof(message)) && endsWith(message, expected);
+  }
+
+  /*
+  //  The daemon restarts. Only about 30 messages fit into the spool.
+  */
+  close(fd);
+  fd = daemonSocket(path, sizeof(path));
+  for (i = 15; i < 60 && retval; ++i) {
+    snprintf(expected, sizeof(expected), "line %d", i);
+    syslogClientAdd(LOG_LOCAL5 | LOG_NOTICE, "", expected, strlen(expected));
+    syslogClientFlush();
+  }
+  syslogClientSpoolCounts(&spooled, &dropped);
+  if (retval && 0 == dropped) {
+    printf("nothing dropped\n");
+    retval = false;
+  }
+  sleep(1);
+  for (i = 15; i < 60 - (int)dropped && retval; ++i) {
+    snprintf(expected, sizeof(expected), ": line %d", i);
+    if (i % 5 == 0) {
+      syslogClientFlush();
+    }
+    retval = receive(fd, message, sizeof(message)) && endsWith(message, expected);
+  }
+  syslogClientClose();
+  if (retval && 0 == access(spool, F_OK)) {
+    printf("empty spool left behind\n");
+    retval = false;
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+  unlink(path);
+  unlink(spool);
+  return retval;
+}
+
+int main(int argc, char **argv) {
+  int retval = 0;
+
+  printf("testRfc3164:\n");
+  if(!testRfc3164()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testRfc5424:\n");
+  if(!testRfc5424()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testSpool:\n");
+  if(!testSpool()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testBatch:\n");
+  if(!testBatch()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  return retval;
+}
@@ -0,0 +1,250 @@
+/*
+  Test for the TCP syslog sink against a listener on the loopback.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "syslogTcp.h"
+
+/* function declarations */
+bool testFrames(void);
+bool testLongFields(void);
+
+/* implementations */
+
+static int listener = -1;
+static char received[65536];
+static size_t receivedLength;
+
+static int listenLoopback(void) {
+  struct sockaddr_in address;
+  socklen_t length = sizeof(address);
+
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (listener < 0
+      || bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0
+      || listen(listener, 1) < 0
+      || getsockname(listener, (struct sockaddr *)&address, &length) < 0) {
+    return -1;
+  }
+  return ntohs(address.sin_port);
+}
+
+static int acceptTimed(void) {
+  struct pollfd pending;
+
+  pending.fd = listener;
+  pending.events = POLLIN;
+  if (poll(&pending, 1, 5000) <= 0) {
+    printf("no connection\n");
+    return -1;
+  }
+  return accept(listener, NULL, NULL);
+}
+
+/*
+//  Read until count frames are complete, then take them apart. Each
+//  must be "LEN <PRI>1 ..." with the right length.
+*/
+static bool readFrames(int const fd, int const count, char messages[][512]) {
+  int frames = 0;
+
+  receivedLength = 0;
+  while (frames < count) {
+    struct pollfd pending;
+    ssize_t n;
+    size_t offset = 0;
+
+    pending.fd = fd;
+    pending.events = POLLIN;
+    if (poll(&pending, 1, 5000) <= 0
+        || (n = read(fd, received + receivedLength,
+                     sizeof(received) - receivedLength)) <= 0) {
+      printf("got %d frames of %d\n", frames, count);
+      return false;
+    }
+    receivedLength += n;
+    for (frames = 0; offset < receivedLength && frames < count; ++frames) {
+      char *end;
+      unsigned long const length = strtoul(received + offset, &end, 10);
+      if (' ' != *end) {
+        printf("bad frame: '%.40s'\n", received + offset);
+        return false;
+      }
+      if ((size_t)(end + 1 - received) + length > receivedLength) {
+        break;
+      }
+      if (length >= 512) {
+        printf("frame too long\n");
+        return false;
+      }
+      memcpy(messages[frames], end + 1, length);
+      messages[frames][length] = '\0';
+      offset = end + 1 - received + length;
+    }
+  }
+  return true;
+}
+
+static bool contains(char const *message, char const *expected) {
+  if (NULL == strstr(message, expected)) {
+    printf("'%s' not in '%s'\n", expected, message);
+    return false;
+  }
+  return true;
+}
+
+/*
+//  The frames arrive in order with the session data and consecutive
+//  sequence numbers, also across a connection the server closed.
+*/
+bool testFrames(void) {
+  char endpoint[32], messages[3][512];
+  int const port = listenLoopback();
+  int connection;
+  bool retval;
+
+  if (port < 0) {
+    printf("no listener\n");
+    return false;
+  }
+  snprintf(endpoint, sizeof(endpoint), "127.0.0.1:%d", port);
+  if (syslogTcpOpen("localhost", "rootsh", 42, "rootsh[00042]", "root", "/dev/pts/1")) {
+    printf("endpoint without port taken\n");
+    return false;
+  }
+  if (!syslogTcpOpen(endpoint, "rootsh", 42, "rootsh[00042]", "ro\"ot", "/dev/pts/1")) {
+    printf("could not open %s\n", endpoint);
+    return false;
+  }
+  syslogTcpAdd(LOG_LOCAL5 | LOG_NOTICE, "", "ls -l", 5);
+  syslogTcpAdd(LOG_LOCAL5 | LOG_NOTICE, "1+", "total 0", 7);
+  syslogTcpStart();
+  syslogTcpFlush();
+  connection = acceptTimed();
+  retval = connection >= 0 && readFrames(connection, 2, messages)
+    && 0 == strncmp(messages[0], "<173>1 ", 7)
+    && contains(messages[0], " rootsh 42 - [" SYSLOGTCPSDID " session=\"rootsh[00042\\]\""
+                " user=\"ro\\\"ot\" tty=\"/dev/pts/1\" seq=\"0\"] ls -l")
+    && contains(messages[1], " seq=\"1\" frag=\"1+\"] total 0");
+  if (connection >= 0) {
+    close(connection);
+  }
+  if (retval) {
+    /*
+    //  Give the FIN time to arrive, the sender sees it and reconnects.
+    */
+    usleep(100000);
+    syslogTcpAdd(LOG_LOCAL5 | LOG_NOTICE, "", "exit", 4);
+    syslogTcpFlush();
+    connection = acceptTimed();
+    retval = connection >= 0 && readFrames(connection, 1, messages)
+      && contains(messages[0], " seq=\"2\"] exit");
+    syslogTcpClose();
+    if (connection >= 0) {
+      close(connection);
+    }
+  } else {
+    syslogTcpClose();
+  }
+  close(listener);
+  return retval;
+}
+
+/*
+//  APP-NAME is cut to the 48 characters RFC 5424 allows, SD-PARAM
+//  values that don't fit into the header make the open fail.
+*/
+bool testLongFields(void) {
+  static char ident[1001], user[1001];
+  char endpoint[32], messages[1][512];
+  char expected[64];
+  int const port = listenLoopback();
+  int connection;
+  bool retval;
+
+  if (port < 0) {
+    printf("no listener\n");
+    return false;
+  }
+  snprintf(endpoint, sizeof(endpoint), "127.0.0.1:%d", port);
+  memset(ident, 'x', sizeof(ident) - 1);
+  memset(user, '"', sizeof(user) - 1);
+  errno = 0;
+  if (syslogTcpOpen(endpoint, "rootsh", 42, "rootsh[00042]", user, "/dev/pts/1")
+      || ENAMETOOLONG != errno) {
+    printf("overlong user taken\n");
+    close(listener);
+    return false;
+  }
+  if (!syslogTcpOpen(endpoint, ident, 42, "rootsh[00042]", "root", "/dev/pts/1")) {
+    printf("long ident refused\n");
+    close(listener);
+    return false;
+  }
+  syslogTcpAdd(LOG_LOCAL5 | LOG_NOTICE, "", "ls", 2);
+  syslogTcpStart();
+  syslogTcpFlush();
+  connection = acceptTimed();
+  snprintf(expected, sizeof(expected), " %.48s 42 - [", ident);
+  retval = connection >= 0 && readFrames(connection, 1, messages)
+    && contains(messages[0], expected);
+  syslogTcpClose();
+  if (connection >= 0) {
+    close(connection);
+  }
+  close(listener);
+  return retval;
+}
+
+int main(int argc, char **argv) {
+  int retval = 0;
+
+  printf("testFrames:\n");
+  if(!testFrames()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testLongFields:\n");
+  if(!testLongFields()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  return retval;
+}
@@ -0,0 +1,246 @@
+/*
+  Test for how write2syslog splits output into lines and pieces.
+
+  Copyright (C) 2026 Jon Schewe
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 3
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "write2syslog.h"
+#include "syslogClient.h"
+
+/* function declarations */
+bool testPieces(void);
+bool testPiecesUtf8(void);
+bool testRateLimit(void);
+
+/* implementations */
+
+static int daemonFd = -1;
+static char daemonPath[64];
+
+/*
+//  A datagram socket in /tmp standing in for /dev/log.
+*/
+static bool openDaemon(void) {
+  struct sockaddr_un address;
+
+  snprintf(daemonPath, sizeof(daemonPath), "/tmp/testWrite2syslog.%d", (int)getpid());
+  unlink(daemonPath);
+  daemonFd = socket(AF_UNIX, SOCK_DGRAM, 0);
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, daemonPath);
+  if (daemonFd < 0
+      || bind(daemonFd, (struct sockaddr *)&address, sizeof(address)) < 0
+      || !syslogClientOpen(daemonPath, SYSLOGFORMAT_RFC3164, "rootsh", 42, NULL)) {
+    printf("no socket\n");
+    return false;
+  }
+  return true;
+}
+
+static void closeDaemon(void) {
+  syslogClientClose();
+  close(daemonFd);
+  unlink(daemonPath);
+}
+
+/*
+//  Compare the next message after the tag with expected.
+*/
+static bool expect(char const *expected) {
+  char message[WRITE2SYSLOGMAXLINE + 256];
+  char const *text;
+  ssize_t const length = recv(daemonFd, message, sizeof(message) - 1, MSG_DONTWAIT);
+
+  if (length < 0) {
+    printf("no message, expected '%s'\n", expected);
+    return false;
+  }
+  message[length] = '\0';
+  text = strstr(message, "]: ");
+  if (NULL == text || 0 != strcmp(text + 3, expected)) {
+    printf("Bad message: '%s', expected '%s'\n", message, expected);
+    return false;
+  }
+  return true;
+}
+
+static bool expectNothing(void) {
+  char message[256];
+
+  if (recv(daemonFd, message, sizeof(message), MSG_DONTWAIT) >= 0) {
+    printf("unexpected message\n");
+    return false;
+  }
+  return true;
+}
+
+static void emit(char const *output) {
+  write2syslog(output, strlen(output), false, LOG_LOCAL5, LOG_NOTICE);
+}
+
+/*
+//  Short lines stay whole. A line without \r goes out in tagged pieces
+//  once more of it arrives, the last piece comes with the \r.
+*/
+bool testPieces(void) {
+  char output[WRITE2SYSLOGMINLINE + 1];
+  char expected[WRITE2SYSLOGMINLINE + 16];
+  bool retval;
+
+  if (!openDaemon()) {
+    return false;
+  }
+  write2syslogCharset(ESCCHARSET_8BIT);
+  write2syslogLineLimit(0);
+  memset(output, 'a', WRITE2SYSLOGMINLINE);
+  output[WRITE2SYSLOGMINLINE] = '\0';
+  emit("ls\r\n");
+  retval = expect("ls");
+  /*
+  //  exactly the limit: nothing yet, and no empty piece at the \r
+  */
+  emit(output);
+  retval = retval && expectNothing();
+  emit("\r\n");
+  retval = retval && expect(output);
+  /*
+  //  the limit twice and a bit, in chunks which don't fit
+  */
+  emit("bb");
+  emit(output);
+  emit(output);
+  emit("\033[K\r\n");
+  snprintf(expected, sizeof(expected), "[1+] bb%.*s", WRITE2SYSLOGMINLINE - 2, output);
+  retval = retval && expect(expected);
+  snprintf(expected, sizeof(expected), "[2+] %.*s", WRITE2SYSLOGMINLINE, output);
+  retval = retval && expect(expected);
+  retval = retval && expect("[3] aa") && expectNothing();
+  /*
+  //  the count starts again with the next line
+  */
+  emit(output);
+  emit("c\r");
+  snprintf(expected, sizeof(expected), "[1+] %s", output);
+  retval = retval && expect(expected) && expect("[2] c") && expectNothing();
+  closeDaemon();
+  return retval;
+}
+
+/*
+//  A piece never ends in the middle of a UTF-8 character, the rest of
+//  it starts the next piece.
+*/
+bool testPiecesUtf8(void) {
+  char output[WRITE2SYSLOGMINLINE + 1];
+  char expected[WRITE2SYSLOGMINLINE + 16];
+  bool retval;
+
+  if (!openDaemon()) {
+    return false;
+  }
+  write2syslogCharset(ESCCHARSET_UTF8);
+  write2syslogLineLimit(WRITE2SYSLOGMINLINE);
+  memset(output, 'a', WRITE2SYSLOGMINLINE - 1);
+  output[WRITE2SYSLOGMINLINE - 1] = '\0';
+  /*
+  //  the limit ends after the first byte of the euro sign
+  */
+  emit(output);
+  emit("\xE2\x82\xAC x\r\n");
+  snprintf(expected, sizeof(expected), "[1+] %s", output);
+  retval = expect(expected) && expect("[2] \xE2\x82\xAC x") && expectNothing();
+  closeDaemon();
+  return retval;
+}
+
+/*
+//  Over the limit lines are held back, the summary has their count,
+//  size and hash. Lines which are sent again bring the summary first.
+*/
+bool testRateLimit(void) {
+  bool retval;
+
+  if (!openDaemon()) {
+    return false;
+  }
+  write2syslogCharset(ESCCHARSET_8BIT);
+  write2syslogRateLimit(1, 2);
+  emit("line1\r\nline2\r\nline3\r\nline4\r\n");
+  emit("line5\r\n");
+  retval = expect("line1") && expect("line2") && expectNothing();
+  write2syslogRateSummary(LOG_LOCAL5, LOG_NOTICE);
+  retval = retval
+    && expect("rate limit: 3 lines (15 bytes) not sent to syslog, sha256 "
+              "dc9417f3f392a1fae2c08e9c2bda0fa6813b5211df81d3236e43393afa7ff180")
+    && expectNothing();
+  write2syslogRateSummary(LOG_LOCAL5, LOG_NOTICE);
+  retval = retval && expectNothing();
+  /*
+  //  the bucket is empty, a second later line7 has a token again
+  */
+  emit("line6\r\n");
+  usleep(1100000);
+  emit("line7\r\n");
+  retval = retval
+    && expect("rate limit: 1 lines (5 bytes) not sent to syslog, sha256 "
+              "f8fc5fd4f81274badd3cb859c7a4e5f7ef1075cf6ceba550a0dbbb4797cb93bf")
+    && expect("line7") && expectNothing();
+  write2syslogRateLimit(0, 0);
+  closeDaemon();
+  return retval;
+}
+
+int main(int argc, char **argv) {
+  int retval = 0;
+
+  printf("testPieces:\n");
+  if(!testPieces()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testPiecesUtf8:\n");
+  if(!testPiecesUtf8()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  printf("testRateLimit:\n");
+  if(!testRateLimit()) {
+    printf("\tFAILED\n");
+    retval = 1;
+  } else {
+    printf("\tPASSED\n");
+  }
+
+  return retval;
+}